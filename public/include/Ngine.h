@@ -57,11 +57,13 @@
 #include "core/rendering/device.h" // Public interface
 #include "resources/resources.h"   // Public interface
 #include "resources/forsyth.h"     // Public interface
+#include "resources/simplify.h"    // Public interface
 #include "resources/bmp.h"         // Public interface
 #include "resources/tga.h"         // Public interface
 #include "resources/png.h"         // Public interface
 #include "resources/exr.h"         // Public interface
 #include "resources/hdr.h"         // Public interface
+#include "resources/tex.h"         // Public interface
 #include "resources/obj.h"         // Public interface
 #include "resources/mtl.h"         // Public interface
 
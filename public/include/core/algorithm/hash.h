@@ -20,6 +20,7 @@
 // Tweak hash seed until finding perfect hash for given set of assets. Hash seed
 // should be stored together with assets in the package, so patching asset set 
 // can also update used seed to maintain perfect hash.
+// Packer starts its search from this seed (see storage::createPack).
 #define PerfectHashSeed 0xC438F289 
 
 namespace en
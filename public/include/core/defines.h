@@ -40,6 +40,8 @@
     #define EN_PLATFORM_OSX
 #elif defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
     #define EN_PLATFORM_WINDOWS
+#elif defined(__linux__) || defined(__linux)
+    #define EN_PLATFORM_LINUX
 #else
     static_assert(false, "Unknown target platform!");
 #endif
@@ -52,8 +54,10 @@
 #endif
 
 // Define platform architecture
-#if defined(_WIN64)
+#if defined(_WIN64) || defined(__x86_64__)
     #define EN_ARCHITECTURE_X64
+#elif defined(__aarch64__)
+    #define EN_ARCHITECTURE_ARM64
 #else
     #define EN_ARCHITECTURE_X86
 #endif
@@ -76,6 +80,10 @@
     #define EN_DEBUG
 #endif
 
+// Scheduler profiling (timelines of worker threads and counters of their
+// events), can be also enabled from build settings
+//#define EN_PROFILER
+
 // Forcing inlining
 #if defined(EN_COMPILER_VISUAL_STUDIO)
     #define forceinline __forceinline
@@ -134,7 +142,7 @@
 #endif
 
 // Determine target renderer
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
+#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS) || defined(EN_PLATFORM_LINUX)
     #define EN_DISCRETE_GPU
 #elif defined(EN_PLATFORM_ANDROID) || defined(EN_PLATFORM_IOS)
     #define EN_MOBILE_GPU
@@ -26,7 +26,9 @@
 #define alignTo(value) __pragma( pack(push, value) )
 #define alignToDefault __pragma(pack())
 #elif defined(EN_COMPILER_CLANG) || defined(EN_COMPILER_GCC) || defined(EN_COMPILER_QCC)
-#define alignTo(value) _Pragma("pack(push, value)")
+// Pragma text needs to be stringized after value is expanded
+#define alignToPragma(text) _Pragma(#text)
+#define alignTo(value) alignToPragma(pack(push, value))
 #define alignToDefault _Pragma("pack(pop)")
 #else
 // Concatenates preprocessor tokens A and B before stage of macro-expanding.
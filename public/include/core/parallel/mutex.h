@@ -18,6 +18,9 @@
 #if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
 #include <pthread.h>
 #endif
+#if defined(EN_PLATFORM_LINUX)
+#include <atomic>
+#endif
 #if defined(EN_PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -32,6 +35,9 @@ private:
 #if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
     pthread_mutex_t handle;
 #endif
+#if defined(EN_PLATFORM_LINUX)
+    std::atomic<uint32> handle; // Futex word: 0 - unlocked, 1 - locked, 2 - locked with waiters
+#endif
 #if defined(EN_PLATFORM_WINDOWS)
     HANDLE handle;
 #endif
@@ -16,11 +16,13 @@
 #include "utilities/timer.h"
 
 #include <memory>
+#include <vector>
 
 namespace en
 {
 
 constexpr uint32 InvalidThreadID = 0xFFFFFFFF;
+constexpr uint32 InvalidCoreID   = 0xFFFFFFFF;
 
 class Thread;
 
@@ -59,6 +61,20 @@ extern uint32 spawnedThreads(void);   ///< Threads created since application sta
 extern uint32 runningThreads(void);   ///< Count of threads that are still running
 extern void   wakeUpMainThread(void); ///< Wakes up main thread to process incoming events
 extern uint32 currentCoreId(void);    ///< Index of CPU core on which this thread is currently executing
+extern std::vector<uint32> availableCores(void); ///< Logical CPU cores on which this process is allowed to execute (in ascending order)
+
+// Location of logical CPU core in processor topology. Logical cores with the
+// same physical core are SMT siblings, and logical cores sharing last level
+// cache or NUMA node are closer to each other than to remote ones.
+struct CoreTopology
+{
+    uint32 physicalCore; ///< Index of physical core (shared by SMT siblings)
+    uint32 cache;        ///< Index of last level cache domain
+    uint32 node;         ///< Index of NUMA node (or processor package)
+};
+
+extern bool   coreTopology(const uint32 core,
+                           CoreTopology& topology); ///< Queries location of given logical CPU core, returns false if it's unknown
 
 } // en
 
@@ -21,6 +21,9 @@
 
 namespace en
 {
+
+class TaskState;
+
 namespace storage
 {
 
@@ -31,6 +34,26 @@ enum FileAccess
     ReadWrite
 };
 
+// Expected way of accessing mapped file range, allows OS to adjust read-ahead
+enum class MapHint : uint8
+{
+    Sequential = 0, // Whole range will be read front to back soon (prefetched)
+    Random        , // Range will be accessed sparsely (no read-ahead)
+};
+
+// Read-only view of part of file. Where supported, it's mapped to process
+// address space directly from OS page cache (so no copy of file content is
+// made), otherwise it holds its own copy. View needs to be destroyed before
+// file it was created from.
+class FileView
+{
+    public:
+    virtual const uint8* data(void) const = 0;     // First byte of viewed range
+    virtual uint64       size(void) const = 0;     // Size of viewed range in bytes
+
+    virtual ~FileView() {};                        // Polymorphic deletes require a virtual base destructor
+};
+
 class File
 {
     public:
@@ -40,8 +63,28 @@ class File
                         const uint64 size,
                         volatile void* buffer,
                         uint64* readBytes = nullptr) = 0; // Reads part of file
+
+    // Creates read-only view of part of file and returns its ownership to the
+    // caller (or nullptr on failure).
+    virtual FileView* map(const uint64 offset,
+                          const uint64 size,
+                          const MapHint hint = MapHint::Sequential) = 0;
+
+    // Issues asynchronous read of part of file, and returns immediately. Given
+    // state is finished once read is completed, so task can continue other
+    // work and then call Scheduler->wait(state), which doesn't block worker
+    // thread. Buffer (and readBytes) need to stay valid until then. File
+    // cannot be closed while it has requests in flight.
+    virtual void   readAsync(const uint64 offset,
+                             const uint64 size,
+                             volatile void* buffer,
+                             TaskState* state,
+                             uint64* readBytes = nullptr) = 0;
        
-    // TODO: Temp, file should be read in blocks to memory, and then parsed!
+    // Text helpers, buffered in large blocks (see storage::Reader). Can be
+    // called from several threads, but calls share one buffered block, so
+    // they are serialized. Threads parsing the same file in parallel should
+    // map its parts, or use their own storage::Reader instead.
     virtual uint32 read(const uint64 offset,
                         const uint32 maxSize,
                         std::string& word) = 0;    // Read zero terminated word, but not exceed maxSize chars. Return word length.
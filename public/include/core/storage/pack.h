@@ -0,0 +1,113 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Packed assets archive.
+ Requirements: none
+ Description : Stores many files in single pack file, so that they can be
+               opened without file system lookups (one open() system call
+               for whole pack). Each file is identified by hash of its name
+               (see hashString()). Table of contents is a perfect hash table
+               (hash and displace), so each lookup touches exactly one slot.
+               Seed of name hash is tuned by packer and stored in the pack
+               (see PerfectHashSeed). Payloads are aligned to page size, so
+               they can be mapped directly from pack.
+
+               Layout:
+
+               PackHeader
+               uint32    displacement[buckets]
+               PackEntry entry[slots]
+               payloads (each aligned to PackAlignment)
+
+*/
+
+#ifndef ENG_CORE_STORAGE_PACK
+#define ENG_CORE_STORAGE_PACK
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/storage.h"
+
+#include <string>
+#include <vector>
+
+namespace en
+{
+namespace storage
+{
+
+constexpr uint32 PackSignature = 0x4B41504E; // "NPAK"
+constexpr uint32 PackVersion   = 1;
+constexpr uint32 PackAlignment = 4096;       // Alignment of payloads in pack
+
+enum class PackCompression : uint32
+{
+    None    = 0,
+    Deflate    ,  // zlib stream
+};
+
+struct PackHeader
+{
+    uint32 signature;    // PackSignature
+    uint32 version;      // PackVersion
+    uint32 seed;         // Seed of hashString() used to generate ID's of files
+    uint32 files;        // Count of files in pack
+    uint32 slots;        // Size of table of contents (power of two)
+    uint32 buckets;      // Count of displacement buckets
+    uint64 size;         // Size of whole pack in bytes
+    uint8  reserved[32];
+};
+
+static_assert(sizeof(PackHeader) == 64, "en::storage::PackHeader size mismatch!");
+
+struct PackEntry
+{
+    uint64          id;          // Hash of file name (0 for empty slot)
+    uint64          offset;      // Location of payload in pack
+    uint64          storedSize;  // Size of payload in pack
+    uint64          size;        // Size of file (after decompression)
+    PackCompression compression;
+    uint32          reserved;
+};
+
+static_assert(sizeof(PackEntry) == 40, "en::storage::PackEntry size mismatch!");
+
+// Bucket that given file belongs to
+inline uint32 packBucket(const uint64 id, const uint32 buckets)
+{
+    return static_cast<uint32>((id >> 32) % buckets);
+}
+
+// Slot of table of contents, that given file is stored in, when its bucket
+// has given displacement
+inline uint32 packSlot(const uint64 id, const uint32 displacement, const uint32 slots)
+{
+    // SplitMix64 finalizer
+    uint64 value = id + static_cast<uint64>(displacement) * 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    value =  value ^ (value >> 31);
+    return static_cast<uint32>(value & (slots - 1));
+}
+
+struct PackInput
+{
+    std::string name;  // Name under which file is opened from pack
+    std::string path;  // Location of file to pack (opened with Storage)
+};
+
+// Creates pack from given files (offline packer). Files are compressed if it
+// noticeably reduces their size, and compression is allowed.
+bool createPack(const std::string& filename,
+                const std::vector<PackInput>& files,
+                const bool compress = true);
+
+// Mounts pack over current Storage. Files found in pack are opened from it,
+// remaining ones (and files opened for writing) from previous Storage.
+bool mountPack(const std::string& filename);
+
+} // en::storage
+} // en
+
+#endif
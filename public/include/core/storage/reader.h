@@ -0,0 +1,73 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Buffered file reader.
+ Requirements: none
+ Description : Reads file sequentially in large aligned blocks, refilled on
+               demand, so that text can be processed byte by byte or token
+               by token without calling into file for each byte. Tokens are
+               returned as views into the block, valid until next call.
+
+*/
+
+#ifndef ENG_CORE_STORAGE_READER
+#define ENG_CORE_STORAGE_READER
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/storage.h"
+#include "core/utilities/NonCopyable.h"
+
+#include <string_view>
+
+namespace en
+{
+namespace storage
+{
+
+constexpr uint32 ReaderBlockSize      = 64 * 1024; // Default size of block (max token length)
+constexpr uint32 ReaderBlockAlignment = 4096;      // Block location in file and memory alignment
+
+// Returns true for character that terminates token
+typedef bool(*Delimiter)(uint8 character);
+
+class Reader : private NonCopyable
+{
+    private:
+    File*  file;        // File that is read (not owned)
+    uint8* block;       // Buffered part of file
+    uint32 capacity;    // Size of block
+    uint32 blockSize;   // Count of valid bytes in block
+    uint32 position;    // Current location in block
+    uint64 blockOffset; // Location of first byte of block in file
+
+    bool refill(void);  // Keeps bytes following current location and reads next ones after them
+
+    public:
+    Reader(File* file,
+           const uint32 capacity = ReaderBlockSize);
+   ~Reader();
+
+    uint64 offset(void) const;          // Current location in file
+    void   seek(const uint64 offset);   // Sets current location in file (keeps block if it's inside it)
+    bool   end(void);                   // Returns true if whole file was read
+    uint32 blockCapacity(void) const;   // Max length of token
+    void   invalidate(void);            // Drops buffered block (for e.g. after file was modified)
+
+    bool   read(uint8& character);      // Reads single byte, returns false at end of file
+    uint64 read(void* buffer,           // Reads up to given count of bytes to buffer, returns
+                const uint64 size);     // count of bytes that were read
+
+    // Reads token ending before first delimiter (which is not consumed), or
+    // with length of maxSize (limited by block capacity), or at end of file.
+    std::string_view token(Delimiter delimiter, const uint32 maxSize);
+    std::string_view string(const uint32 maxSize); // Zero terminated string
+    std::string_view word(const uint32 maxSize);   // Sequence of characters ended by whitespace
+    std::string_view line(const uint32 maxSize);   // Sequence of characters ended by EOL
+};
+
+} // en::storage
+} // en
+
+#endif
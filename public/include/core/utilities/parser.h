@@ -14,6 +14,10 @@
 #define ENG_CORE_UTILITIES_PARSER
 
 #include "core/defines.h"
+#include "core/types.h"
+
+#include <string>
+#include <string_view>
 
 namespace en
 {
@@ -34,17 +38,44 @@ class Parser
     bool readLine(std::string& line);        // Reads whole line
     bool skipToNextLine(void);               // Updates offset to position on the beginning of next line
     bool end(void);                          // Returns true if offset reached end of buffer
+
+    // Views into parsed text, valid as long as parser exists (no allocations)
+    bool read(std::string_view& word, bool& eol);
+    bool readLine(std::string_view& line);
 };
 
 bool isCypher(uint8 input);
 bool isCharacter(uint8 input);
 bool isWhitespace(uint8 input);
 bool isEol(uint8 input);
+bool isNull(uint8 input);
 // Length is expected length of provided integer string representation
 bool isInteger(const char* text, const uint32 length);
 // Length is expected length of provided float string representation
 bool isFloat(const char* text, const uint32 length);
 
+// Locale independent number parsing, that doesn't allocate (similar to
+// std::from_chars). Number is parsed from the beginning of text, and pointer
+// to first character following it is returned (or text if there is no
+// number, in which case value is set to 0). Doubles are correctly rounded
+// for up to 15 significant digits and exponents within +/-22, otherwise
+// they may differ in the last bits (floats are computed from them).
+const char* parseNumber(const char* text, const char* end, uint32& value);
+const char* parseNumber(const char* text, const char* end, uint64& value);
+const char* parseNumber(const char* text, const char* end, sint32& value);
+const char* parseNumber(const char* text, const char* end, sint64& value);
+const char* parseNumber(const char* text, const char* end, float&  value);
+const char* parseNumber(const char* text, const char* end, double& value);
+
+// Returns number parsed from the beginning of text (or 0)
+template<typename type>
+type parseNumber(std::string_view text)
+{
+    type value;
+    parseNumber(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
 } // en
 
 #endif
\ No newline at end of file
@@ -0,0 +1,236 @@
+/*
+
+ Ngine v5.0
+
+ Module           : Concurrent Pool Allocator
+ Multi-Threaded   : Safe
+ Type             : Pool allocator of objects of the same type
+ Producers/Consum : Single-Allocator / Multiple-Deallocators
+ Data structure   : Array-based (growing Virtual Memory, no relocation)
+ Intrusiveness    : Intrusive (free entries store pointers to each other)
+ Maximum size     : Unbounded (to defined VM limit)
+ Overflow behavior: Fails on overflow (returns nullptr)
+ Garbage collector: Not Required
+ Allocator FPG    : Wait-freedom (except of growing)
+ Deallocator FPG  : Wait-freedom (owner), Lock-freedom (remote)
+ Expected usage   : Per thread pool of small, short living objects, that are
+                    allocated on owning thread, but may be released on any.
+ Description      : Pool allocator with "remote free" list. Owning thread
+                    allocates and releases entries using local free list,
+                    without any synchronization. Other threads release entries
+                    by pushing them on atomic remote free list (Treiber stack).
+                    When local free list is empty, owner takes whole remote
+                    free list at once using single atomic exchange, which
+                    makes it immune to ABA problem (only pushes are performed
+                    concurrently). Backing memory never moves, so pointers to
+                    entries stay valid while pool grows. Stored object size
+                    cannot be smaller than 8 bytes. Constructors and
+                    destructors of objects need to be called explicitly.
+
+                    See also:
+                    http://www.1024cores.net/home/lock-free-algorithms/tricks/memory-management
+
+    FPG - Forward Progress Guarantee:
+    http://www.1024cores.net/home/lock-free-algorithms/introduction
+*/
+
+#ifndef ENG_MEMORY_CONCURRENT_POOL_ALLOCATOR
+#define ENG_MEMORY_CONCURRENT_POOL_ALLOCATOR
+
+#include "assert.h"
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/memory/alignment.h"
+#include "core/memory/pageAllocator.h"
+#include "core/utilities/NonCopyable.h"
+#include "core/utilities/poolAllocator.h" // PoolDoublingBarrier
+
+#include "utilities/utilities.h"
+
+#include <atomic>
+
+namespace en
+{
+
+template<typename T>
+class ConcurrentPoolAllocator : private NonCopyable
+{
+    private:
+    // Ensure that entry is big enough to store pointer
+    static_assert(sizeof(T) >= sizeof(void*), "ConcurrentPoolAllocator element size smaller than pointer size!");
+
+    // Modified by remote threads, thus kept in separate cache line
+    cachealign std::atomic<T*> remoteHead; // Single linked list of entries released by other threads
+
+    cachealign T* memory;   // Backing memory
+    T*     head;            // Points at first free entry of local free list
+    uint32 entrySize;       // Size of single entry, rounded up to multiple of alignment size
+    uint64 size;            // Current memory size in bytes (rounded up to multiple of 4KB)
+    uint64 maxSize;         // Max memory allocation in bytes (rounded up to multiple of 4KB)
+    uint64 doubleSizeUntil; // Doubling allocation size barrier in bytes
+
+    bool reallocate(void);  // Fails if maximum allowed capacity was reached
+
+    public:
+    // Alignment specifies each element starting address alignment, and needs
+    // to be power of two. If element size differs from multiple of alignment
+    // size, each element address is padded to that alignment. When pool is
+    // growing, it's capacity is doubling until reaching defined size. After
+    // that it always grows by that size, until reaching maxCapacity.
+    ConcurrentPoolAllocator(const uint32 capacity,
+                            const uint32 maxCapacity,
+                            const uint32 alignment = cacheline,
+                            const uint32 doubleSizeUntil = PoolDoublingBarrier);
+
+    // Deallocator is not calling destructors of allocated objects
+   ~ConcurrentPoolAllocator();
+
+    T*   allocate(void);                    // Called only by owner thread
+    void deallocate(T& resource);           // Called only by owner thread
+    void deallocateRemote(T& resource);     // Can be called by any thread
+};
+
+// CompileTimeSizeReporting( ConcurrentPoolAllocator<void*> );
+static_assert(sizeof(ConcurrentPoolAllocator<void*>) == 128, "en::ConcurrentPoolAllocator<void*> size mismatch!");
+
+template<typename T>
+ConcurrentPoolAllocator<T>::ConcurrentPoolAllocator(
+        const uint32 capacity,
+        const uint32 maxCapacity,
+        const uint32 alignment,
+        const uint32 _doubleSizeUntil) :
+    remoteHead(nullptr),
+    memory(nullptr),
+    head(nullptr),
+    entrySize(static_cast<uint32>(roundUp(static_cast<uint64>(sizeof(T)), static_cast<uint64>(alignment)))),
+    size(roundUp(static_cast<uint64>(entrySize) * capacity, static_cast<uint64>(4096))),
+    maxSize(roundUp(static_cast<uint64>(entrySize) * maxCapacity, static_cast<uint64>(4096))),
+    doubleSizeUntil(_doubleSizeUntil)
+{
+    assert( powerOfTwo(alignment) );
+
+    memory = reinterpret_cast<T*>(virtualAllocate(size, maxSize));
+    if (memory)
+    {
+        // Due to allocating multiple of 4KB blocks, there may be some extra entries
+        uint32 actualCapacity = static_cast<uint32>(size / entrySize);
+
+        // At the beginning all entries are free and thus point to the next one
+        head = memory;
+        for(uint32 i=0; i<(actualCapacity - 1); ++i)
+        {
+            *(T**)((uint8*)(memory) + i * entrySize) = (T*)((uint8*)(memory) + (i + 1) * entrySize);
+        }
+
+        // Last free element is not pointing at anything
+        *(T**)((uint8*)(memory) + (actualCapacity - 1) * entrySize) = nullptr;
+    }
+}
+
+template<typename T>
+ConcurrentPoolAllocator<T>::~ConcurrentPoolAllocator()
+{
+    virtualDeallocate((void*)memory, maxSize);
+}
+
+template<typename T>
+bool ConcurrentPoolAllocator<T>::reallocate(void)
+{
+    assert( head == nullptr );
+    if (size >= maxSize)
+    {
+        return false;
+    }
+
+    uint64 newSize = size < doubleSizeUntil ? size * 2 : roundUp(size + doubleSizeUntil, static_cast<uint64>(4096));
+    if (newSize > maxSize)
+    {
+        newSize = maxSize;
+    }
+
+    uint32 actualCapacity = static_cast<uint32>(size / entrySize);
+    uint32 newCapacity    = static_cast<uint32>(newSize / entrySize);
+    if (newCapacity == actualCapacity)
+    {
+        return false;
+    }
+
+    if (!virtualReallocate((void*)memory, size, newSize))
+    {
+        return false;
+    }
+
+    // Link all new entries into local free list
+    head = (T*)((uint8*)(memory) + actualCapacity * entrySize);
+    for(uint32 i=actualCapacity; i<(newCapacity - 1); ++i)
+    {
+        *(T**)((uint8*)(memory) + i * entrySize) = (T*)((uint8*)(memory) + (i + 1) * entrySize);
+    }
+
+    // Last free element is not pointing at anything
+    *(T**)((uint8*)(memory) + (newCapacity - 1) * entrySize) = nullptr;
+
+    size = newSize;
+    return true;
+}
+
+template<typename T>
+T* ConcurrentPoolAllocator<T>::allocate(void)
+{
+    if (!memory)
+    {
+        return nullptr;
+    }
+
+    if (head == nullptr)
+    {
+        // Reclaim all entries released by other threads at once. Acquire
+        // ensures that "next" pointers written by them are visible.
+        head = std::atomic_exchange_explicit(&remoteHead, (T*)(nullptr), std::memory_order_acquire);
+
+        // If pool is still empty try to grow
+        if (head == nullptr)
+        {
+            if (!reallocate())
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    T* entry = head;
+
+    // Head points to next free block (or nullptr if this one was the last one)
+    head = *(T**)(entry);
+
+    return entry;
+}
+
+template<typename T>
+void ConcurrentPoolAllocator<T>::deallocate(T& resource)
+{
+    assert( (uint64)((uint8*)(&resource) - (uint8*)(memory)) < size );
+
+    *(T**)(&resource) = head;
+    head = &resource;
+}
+
+template<typename T>
+void ConcurrentPoolAllocator<T>::deallocateRemote(T& resource)
+{
+    assert( (uint64)((uint8*)(&resource) - (uint8*)(memory)) < maxSize );
+
+    // Push entry on remote free list. Release ensures that "next" pointer is
+    // visible to owner thread, once it takes whole list.
+    T* currentHead = std::atomic_load_explicit(&remoteHead, std::memory_order_relaxed);
+    do
+    {
+        *(T**)(&resource) = currentHead;
+    }
+    while(!std::atomic_compare_exchange_weak_explicit(&remoteHead, &currentHead, &resource, std::memory_order_release, std::memory_order_relaxed));
+}
+
+} // en
+
+#endif
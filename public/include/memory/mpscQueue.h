@@ -0,0 +1,161 @@
+/*
+
+ Ngine v5.0
+
+ Module           : Multiple-Producers Single-Consumer Queue
+ Multi-Threaded   : Safe
+ Type             : Queue (FIFO)
+ Producers/Consum : Multiple-Producers / Single-Consumer (MPSC)
+ Data structure   : Node-based (single linked list)
+ Intrusiveness    : Intrusive (element provides "next" link, no extra allocations)
+ Maximum size     : Unbounded
+ Overflow behavior: Not possible
+ Garbage collector: Not Required
+ Priorities       : No support
+ Ordering         : FIFO (per producer), causal FIFO (across producers)
+ Producer FPG     : Wait-freedom (single XCHG)
+ Consumer FPG     : Obstruction-freedom (may need to retry, if producer
+                    was preempted between its two stores)
+ Expected usage   : Any amount of producers pushing elements for one consumer
+ Failure behavior : Non-blocking (Abort when producer is in progress)
+ Description      : Implementation of Dmitry Vyukov "Intrusive MPSC node-based queue".
+                    http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+
+                    Element type needs to provide "std::atomic<T*> next" member,
+                    that is owned by queue while element is enqueued. Elements
+                    are not copied, so they need to stay valid until taken
+                    from the queue. Queue doesn't allocate any memory, so its
+                    capacity is limited only by backing allocator of elements
+                    (usually growing, page allocator based pool).
+
+    FPG - Forward Progress Guarantee:
+    http://www.1024cores.net/home/lock-free-algorithms/introduction
+*/
+
+#ifndef ENG_MEMORY_MPSC_QUEUE
+#define ENG_MEMORY_MPSC_QUEUE
+
+#include "assert.h"
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/memory/alignment.h"
+#include "core/utilities/NonCopyable.h"
+#include "memory/workStealingDeque.h" // DequeResult
+
+#include <atomic>
+
+namespace en
+{
+
+template<typename T>
+class MPSCQueue : private NonCopyable
+{
+    private:
+    // Producers only touch head, consumer only touches tail (and stub), so
+    // they are kept in separate cache lines.
+    cachealign std::atomic<T*> head; // Last pushed element
+    cachealign T*              tail; // Next element to take
+    T                          stub; // Dummy element, queue is never empty
+
+    void insert(T* element);
+
+    public:
+    MPSCQueue();
+
+    void        push(T* element);   // Can be called by any thread
+    DequeResult take(T*& element);  // Called only by consumer thread
+    bool        empty(void);        // Called only by consumer thread (result may be outdated)
+};
+
+template<typename T>
+MPSCQueue<T>::MPSCQueue() :
+    head(&stub),
+    tail(&stub)
+{
+    stub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+template<typename T>
+void MPSCQueue<T>::insert(T* element)
+{
+    std::atomic_store_explicit(&element->next, (T*)(nullptr), std::memory_order_relaxed);
+
+    // Serialization point of producers. After exchange, previous element is
+    // not linked with this one yet, which is the window in which consumer may
+    // see queue as temporarily broken (and return Abort).
+    T* previous = std::atomic_exchange_explicit(&head, element, std::memory_order_acq_rel);
+    std::atomic_store_explicit(&previous->next, element, std::memory_order_release);
+}
+
+template<typename T>
+void MPSCQueue<T>::push(T* element)
+{
+    assert( element );
+    assert( element != &stub );
+
+    insert(element);
+}
+
+template<typename T>
+DequeResult MPSCQueue<T>::take(T*& element)
+{
+    T* current = tail;
+    T* next    = std::atomic_load_explicit(&current->next, std::memory_order_acquire);
+
+    // Skip stub element
+    if (current == &stub)
+    {
+        if (next == nullptr)
+        {
+            return DequeResult::Empty;
+        }
+
+        tail    = next;
+        current = next;
+        next    = std::atomic_load_explicit(&next->next, std::memory_order_acquire);
+    }
+
+    // There is more than one element in the queue
+    if (next)
+    {
+        tail    = next;
+        element = current;
+        return DequeResult::Success;
+    }
+
+    // If current is not the last pushed element, producer is in the middle
+    // of linking new element. Consumer cannot proceed until it's done.
+    T* last = std::atomic_load_explicit(&head, std::memory_order_acquire);
+    if (current != last)
+    {
+        return DequeResult::Abort;
+    }
+
+    // Current is the last element. Push stub behind it, so that it can be
+    // taken without leaving queue without any element.
+    insert(&stub);
+
+    next = std::atomic_load_explicit(&current->next, std::memory_order_acquire);
+    if (next)
+    {
+        tail    = next;
+        element = current;
+        return DequeResult::Success;
+    }
+
+    // Other producer pushed element between load of head and stub insertion
+    return DequeResult::Abort;
+}
+
+template<typename T>
+bool MPSCQueue<T>::empty(void)
+{
+    // Queue is empty only if stub is the only element in it. Producer in the
+    // middle of push is already counted as element in the queue.
+    return (tail == &stub) && (std::atomic_load_explicit(&head, std::memory_order_acquire) == &stub);
+}
+
+} // en
+
+#endif
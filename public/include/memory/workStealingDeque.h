@@ -36,6 +36,7 @@
 #include "core/defines.h"
 #include "core/types.h"
 #include "core/memory/pageAllocator.h"
+#include "core/utilities/poolAllocator.h" // PoolDoublingBarrier
 #include <atomic>
 
 /* Transcript of original C11 code (for reference):
@@ -174,6 +175,7 @@ class WorkStealingDeque
     DequeResult take(T& value);   // Called only by owner thread
     void        push(T value);    // Called only by owner thread
     DequeResult steal(T& value);  // Can be called by any thread
+    bool        empty(void);      // Can be called by any thread (result may be outdated)
 };
 
 static_assert(sizeof(WorkStealingDeque<void*>) == 48, "en::WorkStealingDeque<void*> size mismatch!");
@@ -335,5 +337,13 @@ DequeResult WorkStealingDeque<T>::steal(T& value)
     return result;
 }
 
+template<typename T>
+bool WorkStealingDeque<T>::empty(void)
+{
+    sint64 t = std::atomic_load_explicit(&top, std::memory_order_acquire);
+    sint64 b = std::atomic_load_explicit(&bottom, std::memory_order_acquire);
+    return b <= t;
+}
+
 } // en
 #endif
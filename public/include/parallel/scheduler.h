@@ -20,6 +20,7 @@
 #define MaxThreads 256   
 
 #include <memory>   // std::unique_ptr
+#include <string>
 
 namespace en
 {
@@ -30,8 +31,25 @@ constexpr uint32 FibersPerWorker    = 128;
 constexpr uint32 MaxFibersPerWorker = 1024;
 constexpr uint32 MaxTasksPerWorker  = 1024;
 
-// TODO: In the future add ability to split tasks while they are processed
-// typedef void(*TaskParallelFunction)(void* taskData, uint32v2 range);
+// Task that can be split while it's processed. Each call processes given
+// sub-range of items (range.base is index of first item, range.count is
+// count of items to process).
+typedef void(*TaskParallelFunction)(void* taskData, uint32v2 range);
+
+// Tasks are started in order of their priority. High priority is meant for
+// latency critical work (for e.g. input handling, or encoding of Command
+// Buffers for current frame), Background priority for bulk work that may
+// span several frames (for e.g. assets decoding). Lower priority tasks are
+// still started from time to time, even if there is always higher priority
+// work, so that they cannot starve.
+enum class TaskPriority : uint8
+{
+    High       = 0,
+    Normal        ,
+    Background    ,
+};
+
+constexpr uint32 TaskPriorities = 3;
 
 // Values in range [0..N] indicate that given task needs to be executed
 // on specified worker thread (and assigned to it CPU core) and Fiber 
@@ -40,6 +58,18 @@ constexpr uint32 MaxTasksPerWorker  = 1024;
 // tracking it's state per thread, and thus task shouldn't switch threads
 // for e.g. in the middle of encoding Command Buffer.
 
+// Counters of worker thread events (available only if EN_PROFILER is defined)
+struct SchedulerCounters
+{
+    uint64 tasksExecuted; // Tasks executed by worker thread
+    uint64 tasksStolen;   // Tasks stolen from other workers
+    uint64 stealAborts;   // Steal attempts that lost race with other thread
+    uint64 fibersResumed; // Unblocked fibers resumed (including stolen ones)
+    uint64 fibersStolen;  // Unblocked fibers stolen from other workers
+    uint64 fiberSwitches; // Switches between fibers
+    uint64 parks;         // Times worker thread was parked (had nothing to do)
+};
+
 namespace parallel
 {
 
@@ -57,16 +87,19 @@ class Interface
     
     virtual uint32 currentWorkerId(void) const = 0;   // Id of first worker thread. If current thread is not worker thread, it will return InvalidWorkerId.
 
-    /// Task execution can migrate between CPU cores 
-    /// (but once started currently will stay locked to that core, there is no Fibers migration)
+    /// Task execution can migrate between CPU cores. Task waiting for other
+    /// task may be resumed by any idle worker thread, unless it's locked to
+    /// core, in which case it will stay on the worker thread that started it
+    /// (for e.g. when it's encoding Command Buffer).
     virtual void run(
         TaskFunction function,           ///< Task to execute
         void* data = nullptr,            ///< Data to be processed by task
-        TaskState* state = nullptr) = 0; ///< State to use, so that caller can synchronize
+        TaskState* state = nullptr,      ///< State to use, so that caller can synchronize
+        bool lockToCore = false,         ///< Specify if task execution can migrate between CPU cores once started
+        TaskPriority priority = TaskPriority::Normal) = 0; ///< Priority class of task
 
     // TODO: Add:
     // runOnCurrentCore()  - Task will execute on the same CPU core as parent task
-    // runOnSingleCore() - Task will execute on any core, but it cannot migrate once it's started (required when fibers migration/stealing is implemented)
 
     virtual void runOnMainThread(
         TaskFunction function,           ///< Task to execute
@@ -84,13 +117,20 @@ class Interface
         void* data = nullptr,            ///< Data to be processed by task
         TaskState* state = nullptr) = 0; ///< State to use, so that caller can synchronize
 
-
-
-//  virtual void run(TaskParallelFunction function, // Task to execute
-//                   void* taskData = nullptr,      // Data to be processed by task
-//                   uint32v2 range,                // Task range, allows splitting task and execution in parallel
-//                   TaskState* state = nullptr,    // State to use, so that caller can synchronize (optional)
-//                   bool lockToCore = false) = 0;  // Specify if task execution can migrate between CPU cores
+    /// Executes task in parallel for given range of items. Range is split
+    /// lazily in halves, only when worker processing it has no other queued
+    /// work (so idle workers can steal second half), otherwise it's processed
+    /// sequentially in chunks of grain size. Single state is used for all
+    /// parts of the range, so caller waits for all of them at once.
+    /// If grain is 0, it's selected based on range size and workers count.
+    virtual void run(
+        TaskParallelFunction function,   ///< Task to execute for each sub-range
+        void* data,                      ///< Data to be processed by task
+        const uint32v2 range,            ///< Range of items (base and count), allows splitting task and execution in parallel
+        TaskState* state = nullptr,      ///< State to use, so that caller can synchronize
+        const uint32 grain = 0,          ///< Max count of items processed by single call (splitting granularity)
+        bool lockToCore = false,         ///< Specify if task execution can migrate between CPU cores once started
+        TaskPriority priority = TaskPriority::Normal) = 0; ///< Priority class of task (and all its parts)
 
     // Warning:
     // Several tasks waiting for single task, are discouraged, as those tasks
@@ -98,6 +138,7 @@ class Interface
     // finished, and thus they won't know which one should release TaskState 
     // that was allocated when original task was passed for execution.
     // (Unless they use some atomic counter to track when last of them terminates).
+    // Use TaskGraph to start tasks once other tasks are finished instead.
     // 
     virtual void wait(TaskState* state) = 0;       // Waits until given task finishes
     
@@ -106,7 +147,21 @@ class Interface
 
 
 
-    // TODO: Add support for handling I/O requests (wait & wake up)
+    // Asynchronous requests (for e.g. file I/O) are tracked by TaskState the
+    // same way as tasks are. Request is issued by acquiring the state, and
+    // once I/O thread or completion queue completes it, state is released,
+    // which resumes all fibers waiting for it (with wait()). This way worker
+    // thread is never blocked by I/O, it executes other tasks instead.
+    virtual void issue(TaskState* state) = 0;      // Marks asynchronous request as in flight (can be called by any thread)
+    virtual void complete(TaskState* state) = 0;   // Marks asynchronous request as completed (can be called by any thread)
+
+    /// Returns counters of given worker thread (or sum of all of them, if
+    /// InvalidWorkerId is passed). All counters are zero if profiling is disabled.
+    virtual SchedulerCounters counters(const uint32 worker = InvalidWorkerId) const = 0;
+
+    /// Saves recent timeline of each worker thread, as Chrome trace event JSON
+    /// file (chrome://tracing). Returns false if profiling is disabled.
+    virtual bool saveTrace(const std::string& filename) const = 0;
 
     virtual void shutdown(void) = 0;              // Send signal to terminate all workers and finish application
     virtual bool closing(void) const = 0;         // Returns true if Thread-Pool is shutting down
@@ -13,17 +13,36 @@
 
 #include "core/defines.h"
 #include "core/types.h"
-#include "parallel/sharedAtomic.h"
+#include "core/memory/alignment.h"
+
+#include <atomic>
 
 namespace en
 {
 
+class TaskScheduler;
+
 // Task execution state is tracked by atomic counter, that represents amount
 // of worker threads that are processing this task (or have it in it's queue).
 // Counter is increased to 1, when task is passed for execution, and finally
 // decreased to 0 when task is finished.
-class TaskState : private SharedAtomic
+//
+// Counter shares single atomic word with index of fiber that waits for this
+// task (fibers waiting for the same task are linked in a list). This way thread
+// finishing the task learns which fibers to resume, without touching the state
+// after it's finished (at that point waiting fiber may already resume and
+// destroy it).
+//
+// It is aligned to cacheline size (64 bytes) to prevent false sharing (see
+// SharedAtomic).
+class cachealign TaskState
 {
+    private:
+    std::atomic<uint64> value; // Lower 32 bits: count of unfinished tasks
+                               // Upper 32 bits: index of last waiting fiber + 1 (0 if none)
+
+    friend class TaskScheduler;
+
     public:
     TaskState();
     void acquire(void);  // Task is acquired by worker thread (scheduled for execution)
@@ -0,0 +1,88 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Task Graph
+ Requirements: none
+ Description : Graph of tasks with dependencies between them, that can be
+               compiled once and executed by Scheduler many times (for e.g.
+               each frame). Task is started automatically as soon as all its
+               predecessors are finished (as continuation), so no fiber needs
+               to block in wait() between stages of the graph. Executing
+               compiled graph performs no memory allocations.
+
+*/
+
+#ifndef ENG_PARALLEL_TASK_GRAPH
+#define ENG_PARALLEL_TASK_GRAPH
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/memory/alignment.h"
+#include "core/utilities/NonCopyable.h"
+#include "parallel/task.h"
+
+#include <atomic>
+#include <vector>
+
+namespace en
+{
+
+class TaskGraph;
+
+// Each node is decremented by threads finishing its predecessors, so nodes
+// are aligned to cache line to prevent false sharing.
+struct cachealign TaskGraphNode
+{
+    TaskFunction        function;       // Function to execute
+    void*               data;           // Data to be processed by task
+    TaskGraph*          graph;          // Graph this node belongs to
+    uint32              firstSuccessor; // Index of first successor in graph successors array
+    uint32              successors;     // Count of successors
+    uint32              predecessors;   // Count of predecessors
+    std::atomic<uint32> pending;        // Count of predecessors that are not finished yet
+    bool                locked;         // Task execution cannot migrate between CPU cores once started
+};
+
+static_assert(sizeof(TaskGraphNode) == 64, "en::TaskGraphNode size mismatch!");
+
+class TaskGraph : private NonCopyable
+{
+    private:
+    TaskGraphNode* nodes;       // Array of graph nodes
+    uint32  capacity;           // Max count of nodes
+    uint32  count;              // Count of added nodes
+    uint32* successor;          // Successors of all nodes (indexed by node firstSuccessor)
+    uint32* root;               // Nodes without predecessors (started when graph is executed)
+    uint32  roots;              // Count of root nodes
+    bool    compiled;           // Set when graph is ready for execution
+    TaskState* state;           // State of current graph execution
+    std::vector<uint32v2> edge; // Declared edges (x - predecessor, y - successor)
+
+    static void execute(void* data);
+
+    public:
+    TaskGraph(const uint32 capacity);
+   ~TaskGraph();
+
+    // Adds task to the graph, returns its index
+    uint32 add(TaskFunction function,
+               void* data = nullptr,
+               bool lockToCore = false);
+
+    // Declares that task cannot start until predecessor is finished
+    void depend(const uint32 task,
+                const uint32 predecessor);
+
+    // Prepares graph for execution (needs to be called after graph is modified).
+    // Returns false if graph has cycles.
+    bool compile(void);
+
+    // Executes all tasks of the graph. Given state is finished once all of them
+    // are finished. Graph cannot be executed again, or modified, before that.
+    void run(TaskState* state);
+};
+
+} // en
+
+#endif
@@ -40,6 +40,7 @@ enum OperatingSystem
     macOS                  ,
     iOS                    ,
     Android                ,
+    Linux                  ,
 };
 
 enum Name
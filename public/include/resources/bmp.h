@@ -13,6 +13,7 @@
 
 #include "core/defines.h"
 #include "core/types.h"
+#include "core/rendering/state.h"
 #include "core/rendering/texture.h"
 
 namespace en
@@ -20,6 +21,12 @@ namespace en
 namespace bmp
 {
 
+/// Reads image properties, without decoding it.
+bool readMetadata(const std::string& filename,
+                  gpu::TextureState& settings,               ///< Texture that can store image
+                  gpu::ColorSpace& colorSpace);              ///< Color space of stored values
+
+/// Decodes image to memory, doesn't require GPU device.
 bool load(const std::string& filename,
           uint8* const destination,                  ///< Pointer to buffer where image should be decompressed and decoded
           const uint32 width,                        ///< Expected width of surface
@@ -14,6 +14,7 @@
 #include "core/defines.h"
 #include "core/types.h"
 #include "core/rendering/state.h"
+#include "core/rendering/texture.h"
 
 namespace en
 {
@@ -24,6 +25,23 @@ namespace dds
 //                      const gpu::ColorSpace colorSpace = gpu::ColorSpaceLinear, 
 //                      const bool invertHorizontal = false);
 
+/// Reads texture properties (including mip-maps and layers count), without
+/// reading its surfaces.
+bool readMetadata(const std::string& filename,
+                  gpu::TextureState& settings,               ///< Texture that can store image
+                  gpu::ColorSpace& colorSpace);              ///< Color space of stored values
+
+/// Reads single surface (given mip-map of given layer, cube face, or 3D
+/// texture depth slice) to memory, doesn't require GPU device. Rows of
+/// compressed formats are rows of texel blocks.
+bool load(const std::string& filename,
+          const uint32 mipmap,                       ///< Mip-map to read
+          const uint32 layer,                        ///< Layer to read
+          uint8* const destination,                  ///< Pointer to buffer where surface should be stored
+          const gpu::ImageMemoryAlignment alignment);///< Alignment in which data is supposed to be ordered in memory
+
+/// Reads all surfaces and uploads them to texture created on primary GPU device.
+/// File is searched for in textures directory, if it doesn't exist at given path.
 std::shared_ptr<gpu::Texture> load(const std::string& filename);
 
 } // en::dds
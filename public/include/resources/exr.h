@@ -13,6 +13,7 @@
 
 #include "core/defines.h"
 #include "core/types.h"
+#include "core/rendering/state.h"
 #include "core/rendering/texture.h"
 
 namespace en
@@ -20,6 +21,22 @@ namespace en
 namespace exr
 {
 
+/// Reads image properties (first part of file), without decoding it.
+bool readMetadata(const std::string& filename,
+                  gpu::TextureState& settings,               ///< Texture that can store image
+                  gpu::ColorSpace& colorSpace);              ///< Color space of stored values
+
+/// Decodes image to memory, doesn't require GPU device.
+bool load(const std::string& filename,
+          uint8* const destination,                  ///< Pointer to buffer where image should be decompressed and decoded
+          const uint32 width,                        ///< Expected width of surface
+          const uint32 height,                       ///< Expected height of surface
+          const gpu::Format format,                  ///< Expected format of surface
+          const gpu::ImageMemoryAlignment alignment, ///< Alignment in which data is supposed to be ordered in memory
+          const bool invertHorizontal = false);      ///< Determines if image should be flipped Horizontally
+
+/// Decodes image and uploads it to texture created on primary GPU device.
+/// File is searched for in textures directory, if it doesn't exist at given path.
 std::shared_ptr<en::gpu::Texture> load(const std::string& filename);
 
 } // en::exr
@@ -1,7 +1,7 @@
 /*
 
  Ngine v5.0
- 
+
  Module      : Forsyth algorithm
  Requirements: none
  Description : Contains set of functions that optimize
@@ -23,7 +23,64 @@ namespace en
 namespace Forsyth
 {
 
-//void optimize(const std::vector<uint32>& input, std::vector<uint32>& output, uint32 vertexes);
+/// Size of simulated Post-Transform Vertex Cache used by default. Vertex
+/// scores are precomputed for caches up to that size.
+constexpr uint32 MaxCacheSize = 32;
+
+/// Marks vertices that are not referenced by any triangle in remap table.
+constexpr uint32 UnusedVertex = 0xFFFFFFFF;
+
+/// Post-Transform Vertex Cache efficiency of indexed triangle list.
+struct Statistics
+{
+    float acmr; ///< Average Cache Miss Ratio - transformed vertices per triangle (0.5 - 3.0)
+    float atvr; ///< Average Transform to Vertex Ratio - transformed vertices per referenced vertex (1.0 is optimal)
+};
+
+/// Reorders triangles of indexed triangle list, to maximize reuse of vertices
+/// in Post-Transform Vertex Cache. Executes in linear time.
+void optimize(const std::vector<uint32>& input,
+              std::vector<uint32>& output,
+              const uint32 vertexes,                 ///< Count of vertices referenced by input indexes
+              const uint32 cacheSize = MaxCacheSize);///< Size of simulated cache (up to MaxCacheSize)
+
+/// Splits triangle list (already optimized for vertex cache) into clusters,
+/// and reorders them so that clusters facing outward from mesh center are
+/// drawn first, reducing overdraw. Clusters are split further as long as
+/// their ACMR doesn't exceed threshold times the ACMR of whole cluster.
+void optimizeOverdraw(std::vector<uint32>& indexes,
+                      const std::vector<float3>& positions,    ///< Position of each vertex
+                      const float  threshold = 1.05f,          ///< Allowed ACMR degradation
+                      const uint32 cacheSize = MaxCacheSize);  ///< Size of simulated cache
+
+/// Renumbers vertices in order of their first use by triangle list, so that
+/// they are fetched from memory sequentially. Fills remap table with new
+/// index of each vertex (or UnusedVertex), and returns count of used ones.
+uint32 optimizeVertexFetch(std::vector<uint32>& indexes,
+                           std::vector<uint32>& remap,
+                           const uint32 vertexes);
+
+/// Reorders array of vertices according to remap table.
+template<typename T>
+void remapVertices(std::vector<T>& vertices, const std::vector<uint32>& remap, const uint32 count)
+{
+    std::vector<T> output(count);
+    for(uint32 i=0; i<vertices.size(); ++i)
+    {
+        if (remap[i] != UnusedVertex)
+        {
+            output[remap[i]] = vertices[i];
+        }
+    }
+
+    vertices.swap(output);
+}
+
+/// Simulates FIFO Post-Transform Vertex Cache, to measure efficiency of
+/// triangles order.
+Statistics analyze(const std::vector<uint32>& indexes,
+                   const uint32 vertexes,
+                   const uint32 cacheSize = MaxCacheSize);
 
 } // en::Forsyth
 } // en
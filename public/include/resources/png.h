@@ -18,9 +18,19 @@
 
 namespace en
 {
+
+class TaskState;
+
 namespace png
 {
 
+/// Reads image properties, without decoding it. Color space passed in
+/// selects between linear and sRGB variant of returned texel format.
+bool readMetadata(const std::string& filename,
+                  gpu::TextureState& settings,               ///< Texture that can store image
+                  gpu::ColorSpace& colorSpace);              ///< Color space of stored values
+
+/// Decodes image to memory, doesn't require GPU device.
 bool load(const std::string& filename, 
           uint8* const destination,                  ///< Pointer to buffer where image should be decompressed and decoded
           const uint32 width,                        ///< Expected width of surface
@@ -29,6 +39,20 @@ bool load(const std::string& filename,
           const gpu::ImageMemoryAlignment alignment, ///< Alignment in which data is supposed to be ordered in memory
           const bool invertHorizontal = false);      ///< Determines if image should be flipped Horizontally
 
+/// Issues decoding of image by worker thread, and returns immediately. Given
+/// state is finished once image is decoded (or loading failed), and caller
+/// can wait for it with Scheduler->wait(state). Destination (and result) need
+/// to stay valid until then. Many images can be loaded this way at once.
+void loadAsync(const std::string& filename, 
+               uint8* const destination,                  ///< Pointer to buffer where image should be decompressed and decoded
+               const uint32 width,                        ///< Expected width of surface
+               const uint32 height,                       ///< Expected height of surface
+               const gpu::Format format,                  ///< Expected format of surface
+               const gpu::ImageMemoryAlignment alignment, ///< Alignment in which data is supposed to be ordered in memory
+               TaskState* state,                          ///< State finished once image is decoded
+               bool* result = nullptr,                    ///< Optional, set to true if image was successfully decoded
+               const bool invertHorizontal = false);      ///< Determines if image should be flipped Horizontally
+
 } // en::png
 } // en
 
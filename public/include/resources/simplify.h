@@ -0,0 +1,71 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Mesh simplification
+ Requirements: none
+ Description : Generates levels of detail of 3D model meshes,
+               by collapsing edges with the lowest Quadric
+               Error Metric (Garland and Heckbert).
+
+*/
+
+#ifndef ENG_RESOURCES_SIMPLIFY
+#define ENG_RESOURCES_SIMPLIFY
+
+#include "core/defines.h"
+#include "core/types.h"
+
+#include <vector>
+
+namespace en
+{
+namespace Simplify
+{
+
+/// Geometry of mesh to simplify. Vertices that have the same position, but
+/// are split because of different attributes (UV seams, hard edges with
+/// different normals), should share position id. Such seams are preserved,
+/// and split vertices are collapsed together. Vertices that survive keep
+/// their original attributes, and collapses that would flip triangles (and
+/// their normals) are rejected.
+struct Geometry
+{
+    const uint32* indexes;     ///< Triangle list
+    const float3* positions;   ///< Position of each vertex
+    const uint32* positionIds; ///< Optional id of position of each vertex (nullptr if each vertex has unique position)
+    uint32        indexCount;  ///< Count of indexes
+    uint32        vertexCount; ///< Count of vertices
+};
+
+/// Level of detail, referencing vertices of original mesh.
+struct Level
+{
+    std::vector<uint32> indexes; ///< Triangle list
+    float error;                 ///< Geometric error relative to mesh extent
+};
+
+/// Simplifies triangle list, until count of indexes is not greater than
+/// target, or further simplification would exceed error limit (relative
+/// to mesh extent). Returns reached error.
+float simplify(const Geometry& geometry,
+               std::vector<uint32>& output,
+               const uint32 targetIndexCount,
+               const float  maxError);
+
+/// Generates chain of up to levelsCount - 1 simplified levels of detail for
+/// each mesh (LOD1 to LODN, as LOD0 is mesh itself). Each level reduces count
+/// of triangles of previous one by given ratio. Chain ends earlier, if error
+/// limit is reached. Meshes are simplified in parallel, if called from
+/// worker thread.
+void generateLevels(const Geometry* meshes,
+                    std::vector<Level>* levels,          ///< Array of chains, one per mesh
+                    const uint32 count,                  ///< Count of meshes
+                    const uint32 levelsCount,            ///< Total count of LOD's (up to 16)
+                    const float  reduction = 0.5f,       ///< Ratio of triangles kept in next level
+                    const float  maxError  = 0.02f);     ///< Error limit relative to mesh extent
+
+} // en::Simplify
+} // en
+
+#endif
@@ -0,0 +1,134 @@
+/*
+
+ Ngine v5.0
+
+ Module      : TEX file support
+ Requirements: none
+ Description : Supports engine proprietary file format for storing
+               textures of any type and format, in layout that can be
+               directly uploaded to GPU. Surfaces are stored smallest
+               mip-map first, so texture can be streamed in starting
+               from its mip-tail. Each surface payload starts at page
+               boundary, so it can be mapped from file (or pack), and
+               is optionally compressed.
+
+               Layout:
+
+               Header_v1
+               TextureHeader_v1
+               TextureSurfaceHeader_v1 surface[surfaces]
+               payloads (each aligned to SurfaceAlignment)
+
+*/
+
+#ifndef ENG_RESOURCES_TEX
+#define ENG_RESOURCES_TEX
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/rendering/state.h"
+#include "core/rendering/texture.h"
+
+#include <memory>
+#include <string>
+
+namespace en
+{
+namespace tex
+{
+
+constexpr uint32 Signature        = 0x58455445; // "ETEX"
+constexpr uint32 Version          = 1;
+constexpr uint32 SurfaceAlignment = 4096;       // Alignment of surface payloads in file
+
+enum class Compression : uint32
+{
+    None    = 0,  // Rows of texels (or texel blocks) tightly packed
+    Deflate    ,  // zlib stream of tightly packed rows
+};
+
+struct Header_v1
+{
+    uint32 signature;    // Signature
+    uint32 version;      // Version of format in which file is stored
+    uint64 filesize;     // Total file size for verification
+    uint32 textures;     // Textures in file (currently always 1)
+    uint8  reserved[12];
+};
+
+static_assert(sizeof(Header_v1) == 32, "en::tex::Header_v1 size mismatch!");
+
+struct TextureHeader_v1
+{
+    uint64 offset;       // Offset in file to array of surface headers
+    uint32 type;         // Texture type (gpu::TextureType)
+    uint32 format;       // Texel format (gpu::Format)
+    uint32 width;        // Width (mip-map 0)
+    uint32 height;       // Height (mip-map 0)
+    uint16 layers;       // Layers, cube faces, or depth (mip-map 0)
+    uint8  mipmaps;      // Mip-maps count
+    uint8  samples;      // Samples (if multisampled)
+    uint16 colorSpace;   // Color space of stored values (gpu::ColorSpace)
+    uint16 usage;        // Intended usage (gpu::TextureUsage)
+    uint32 surfaces;     // Count of surfaces
+    uint8  reserved[28];
+};
+
+static_assert(sizeof(TextureHeader_v1) == 64, "en::tex::TextureHeader_v1 size mismatch!");
+
+struct TextureSurfaceHeader_v1
+{
+    uint64      offset;      // Offset in file to surface payload
+    uint64      storedSize;  // Size of payload in file
+    uint32      size;        // Size of surface (after decompression)
+    uint16      mipmap;      // Which mip-map of texture it is
+    uint16      layer;       // Which layer, cube face, or depth slice of mip-map it is
+    Compression compression; // Compression of payload
+    uint32      reserved;
+};
+
+static_assert(sizeof(TextureSurfaceHeader_v1) == 32, "en::tex::TextureSurfaceHeader_v1 size mismatch!");
+
+/// Stores texture in TEX file (offline writer). Source surfaces are rows of
+/// texels (or rows of texel blocks) tightly packed, ordered mip-map after
+/// mip-map, each with all its layers (cube faces, or depth slices). Surfaces
+/// are compressed if it noticeably reduces their size, and compression is
+/// allowed.
+bool save(const std::string& filename,
+          const gpu::TextureState& settings,   ///< Texture described by data
+          const gpu::ColorSpace colorSpace,    ///< Color space of stored values
+          const uint8* data,                   ///< Surfaces of texture
+          const uint64 size,                   ///< Size of data (for validation)
+          const bool compress = true);         ///< Allows compression of surfaces
+
+/// Reads texture properties (including mip-maps and layers count), without
+/// reading its surfaces.
+bool readMetadata(const std::string& filename,
+                  gpu::TextureState& settings,               ///< Texture that can store image
+                  gpu::ColorSpace& colorSpace);              ///< Color space of stored values
+
+/// Reads single surface (given mip-map of given layer, cube face, or 3D
+/// texture depth slice) to memory, doesn't require GPU device. Rows of
+/// compressed formats are rows of texel blocks.
+bool load(const std::string& filename,
+          const uint32 mipmap,                       ///< Mip-map to read
+          const uint32 layer,                        ///< Layer to read
+          uint8* const destination,                  ///< Pointer to buffer where surface should be stored
+          const gpu::ImageMemoryAlignment alignment);///< Alignment in which data is supposed to be ordered in memory
+
+/// Uploads all surfaces of given mip-map, to texture created on primary GPU
+/// device with settings returned by readMetadata(). Allows streaming in
+/// texture mip-map after mip-map, starting from the smallest one. File is
+/// searched for in textures directory, if it doesn't exist at given path.
+bool upload(const std::string& filename,
+            gpu::Texture& texture,                   ///< Destination texture
+            const uint32 mipmap);                    ///< Mip-map to upload
+
+/// Reads all surfaces and uploads them to texture created on primary GPU device.
+/// File is searched for in textures directory, if it doesn't exist at given path.
+std::shared_ptr<gpu::Texture> load(const std::string& filename);
+
+} // en::tex
+} // en
+
+#endif
@@ -77,6 +77,14 @@ type stringTo(const std::string& in)
 
 #endif
 
+// Numbers are parsed without allocating streams (see parseNumber)
+template<> uint32 stringTo<uint32>(const std::string& in);
+template<> uint64 stringTo<uint64>(const std::string& in);
+template<> sint32 stringTo<sint32>(const std::string& in);
+template<> sint64 stringTo<sint64>(const std::string& in);
+template<> float  stringTo<float>(const std::string& in);
+template<> double stringTo<double>(const std::string& in);
+
 // Converts variable value to string representation
 std::string stringFrom(uint8  in);
 std::string stringFrom(uint16 in);
@@ -13,7 +13,7 @@
 
 #include "core/log/StreamLog.h"
 
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
+#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS) || defined(EN_PLATFORM_LINUX)
 
 #include <assert.h>
 
@@ -16,7 +16,7 @@
 
 #include "core/log/log.h"
 
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
+#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS) || defined(EN_PLATFORM_LINUX)
 
 #include <iostream>
 #include <fstream>
@@ -30,7 +30,7 @@ bool Interface::create(void)
 #if defined(EN_PLATFORM_ANDROID)
     Log = std::make_unique<AndLog>();
 #endif
-#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
     Log = std::make_unique<StreamLog>();
 #endif
 #if defined(EN_PLATFORM_WINDOWS)
@@ -19,6 +19,11 @@
 #include <mach/vm_map.h>
 #endif
 
+#if defined(EN_PLATFORM_LINUX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #if defined(EN_PLATFORM_WINDOWS)
 // Only really needs WinBase.h for Virtual Memory
 #define WIN32_LEAN_AND_MEAN
@@ -28,6 +33,17 @@
 namespace en
 {
 
+#if defined(EN_PLATFORM_LINUX)
+// Page size used by kernel (4KB, but 16KB or 64KB on some AArch64 kernels).
+// Reservation is surrounded with one inaccessible page on both sides, so that
+// any overflow (or underflow of fiber stacks growing down) faults immediately.
+static uint64 systemPageSize(void)
+{
+    static const uint64 pageSize = static_cast<uint64>(sysconf(_SC_PAGESIZE));
+    return pageSize;
+}
+#endif
+
 void* virtualAllocate(const uint64 size, const uint64 maximumSize)
 {
     // Size and maximum size needs to be explicitly multiple of 4KB
@@ -74,6 +90,33 @@ void* virtualAllocate(const uint64 size, const uint64 maximumSize)
         }
     }
 
+#elif defined(EN_PLATFORM_LINUX)
+    // First reserve max size, to which given allocation can grow (plus guard
+    // pages). MAP_NORESERVE ensures that no swap space is accounted for the
+    // reservation, and PROT_NONE that nothing can access it until committed.
+    uint64 guardSize = systemPageSize();
+    uint8* base = static_cast<uint8*>(mmap(nullptr,
+                                           maximumSize + 2 * guardSize,
+                                           PROT_NONE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                                           -1,
+                                           0));
+
+    // Once adress space for max possible size is reserved, allocate initial size
+    if (base != MAP_FAILED)
+    {
+        temp = static_cast<void*>(base + guardSize);
+
+        // Pages are backed with physical memory on first access
+        if (size > 0 &&
+            mprotect(temp, size, PROT_READ | PROT_WRITE) != 0)
+        {
+            // Couldn't commit pages, reverting reservation and faulting
+            munmap(base, maximumSize + 2 * guardSize);
+            temp = nullptr;
+        }
+    }
+
 #elif defined(EN_PLATFORM_WINDOWS)
     // First reserve max size, to which given allocation can grow
     temp = VirtualAlloc(nullptr,          // Reserve anywhere in adress space
@@ -120,6 +163,17 @@ bool virtualReallocate(void* address, const uint64 currentSize, const uint64 new
         return false;
     }
 
+#elif defined(EN_PLATFORM_LINUX)
+    // Reserved range is already mapped, it's enough to make next pages
+    // accessible. Allocation grows in 4KB steps, so if kernel uses bigger
+    // pages, range starts at beginning of page containing its first byte.
+    uintptr_t end   = reinterpret_cast<uintptr_t>(subAddress) + growSize;
+    uintptr_t begin = reinterpret_cast<uintptr_t>(subAddress) & ~static_cast<uintptr_t>(systemPageSize() - 1);
+    if (mprotect(reinterpret_cast<void*>(begin), end - begin, PROT_READ | PROT_WRITE) != 0)
+    {
+        return false;
+    }
+
 #elif defined(EN_PLATFORM_WINDOWS)
     if (!VirtualAlloc(subAddress,      // Allocate pages at end of already allocated section
                       growSize,        // Size to grow allocation by
@@ -146,6 +200,14 @@ void virtualDeallocate(void* address, const uint64 maximumSize)
         mach_error("Virtual Memory destruction failed!", error);
     }
 
+#elif defined(EN_PLATFORM_LINUX)
+    // Release whole reservation, including guard pages around it
+    uint64 guardSize = systemPageSize();
+    uint8* base = static_cast<uint8*>(address) - guardSize;
+    int result = munmap(base, maximumSize + 2 * guardSize);
+    assert( result == 0 );
+    (void)result;
+
 #elif defined(EN_PLATFORM_WINDOWS)
     VirtualFree(address, 0, MEM_RELEASE);
 #else
@@ -14,6 +14,7 @@
 #include "core/defines.h"
 #include "core/types.h"
 
+#include <atomic>
 #include <memory>
 
 namespace en
@@ -29,7 +30,30 @@ class Fiber
     FiberFunction function;    // Function this fiber will execute
     void*         state;       // Optional state passed to fiber
     TaskState* waitingForTask; // State of task, that this Fiber is waiting to finish (otherwise nullptr)
-    
+
+    // Scheduler bookkeeping (fibers can migrate between worker threads)
+    std::atomic<Fiber*> next;  // Intrusive link used by MPSC queues
+    Fiber*   nextWaiter;       // Next fiber waiting for the same task
+    std::atomic<bool> signaled;// Set when bound fiber can resume (see TaskScheduler::wait)
+    uint32   index;            // Index of fiber in scheduler
+    uint32   worker;           // Worker thread that fiber executes on (or is locked to)
+    bool     locked;           // Fiber is locked to its worker thread, migration is forbidden
+    bool     bound;            // Fiber waits without releasing its worker thread
+
+    Fiber() :
+        function(nullptr),
+        state(nullptr),
+        waitingForTask(nullptr),
+        next(nullptr),
+        nextWaiter(nullptr),
+        signaled(false),
+        index(0),
+        worker(0),
+        locked(false),
+        bound(false)
+    {
+    };
+
     virtual ~Fiber() {};
 };
 
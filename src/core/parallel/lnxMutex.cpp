@@ -0,0 +1,107 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Mutex support.
+ Requirements: none
+ Description : Linux futex based mutex implementation.
+
+*/
+
+#include "core/parallel/mutex.h"
+
+#if defined(EN_PLATFORM_LINUX)
+#include <assert.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace en
+{
+
+// Implementation follows "Mutex, Take 3" from Ulrich Drepper's "Futexes Are Tricky":
+// https://www.akkadia.org/drepper/futex.pdf
+//
+// Uncontended lock and unlock are single atomic operations, kernel is entered
+// only when thread needs to sleep, or when there are sleeping threads to wake.
+
+constexpr uint32 MutexUnlocked  = 0;
+constexpr uint32 MutexLocked    = 1;
+constexpr uint32 MutexContended = 2;
+
+static inline void futexWait(std::atomic<uint32>* address, const uint32 expectedValue)
+{
+    // Returns immediately if value at address is different than expected one
+    syscall(SYS_futex, reinterpret_cast<uint32*>(address), FUTEX_WAIT_PRIVATE, expectedValue, nullptr, nullptr, 0);
+}
+
+static inline void futexWake(std::atomic<uint32>* address, const uint32 threads)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32*>(address), FUTEX_WAKE_PRIVATE, threads, nullptr, nullptr, 0);
+}
+
+static_assert(sizeof(std::atomic<uint32>) == sizeof(uint32), "en::Mutex futex word size mismatch!");
+
+Mutex::Mutex(void) :
+    handle(MutexUnlocked)
+{
+}
+
+Mutex::~Mutex(void)
+{
+    // Mutex shouldn't be destroyed while it is owned
+    assert( handle.load(std::memory_order_relaxed) == MutexUnlocked );
+}
+
+bool Mutex::lock(void)
+{
+    // Fast path, mutex was free and is now owned by this thread
+    uint32 value = MutexUnlocked;
+    if (handle.compare_exchange_strong(value, MutexLocked, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        return true;
+    }
+
+    // Slow path, mark mutex as contended and sleep until it is released.
+    // Mutex acquired this way stays marked as contended, as there may be
+    // other threads still sleeping on it.
+    if (value != MutexContended)
+    {
+        value = handle.exchange(MutexContended, std::memory_order_acquire);
+    }
+
+    while(value != MutexUnlocked)
+    {
+        futexWait(&handle, MutexContended);
+        value = handle.exchange(MutexContended, std::memory_order_acquire);
+    }
+
+    return true;
+}
+
+bool Mutex::tryLock(void)
+{
+    // Enters critical section
+    uint32 value = MutexUnlocked;
+    return handle.compare_exchange_strong(value, MutexLocked, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+bool Mutex::isLocked(void)
+{
+    return handle.load(std::memory_order_relaxed) != MutexUnlocked;
+}
+
+void Mutex::unlock(void)
+{
+    // Leave critical section, and wake one of sleeping threads if there are any
+    if (handle.fetch_sub(1, std::memory_order_release) != MutexLocked)
+    {
+        handle.store(MutexUnlocked, std::memory_order_release);
+        futexWake(&handle, 1);
+    }
+}
+
+} // en
+
+#endif
@@ -11,7 +11,7 @@
 #include "core/defines.h"
 #include "core/parallel/mutex.h"
 
-#if defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
 #include "core/parallel/psxThread.h"
 #endif
 #if defined(EN_PLATFORM_WINDOWS)
@@ -19,6 +19,7 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
 
 constexpr uint32 MaxThreads      = 256;
 
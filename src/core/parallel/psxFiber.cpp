@@ -10,14 +10,156 @@
 
 #include "core/parallel/psxFiber.h"
 
-#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
+
+#include <assert.h>
+#include <string.h>
 
 #include "core/memory/alignedAllocator.h"
 #include "core/memory/pageAllocator.h"
 
+#if defined(EN_FIBER_ASSEMBLY)
+
+// Context switch:
+//
+// void fiberSwitch(void** saveStackPointer, void* loadStackPointer);
+//
+// Pushes callee-saved registers on current stack, stores stack pointer in
+// saveStackPointer, then loads loadStackPointer and pops registers of resumed
+// fiber from its stack. Return address of resumed fiber is on its stack as well.
+//
+// Fiber entry:
+//
+// New fiber stack is prepared so that first switch to it "returns" to
+// fiberStart, with pointer to Fiber and entry function in callee-saved
+// registers (r12, r13 on x86-64; x19, x20 on AArch64).
+//
+// See also:
+// https://github.com/boostorg/context/tree/develop/src/asm
+// https://graphitemaster.github.io/fibers/
+//
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#define FiberSymbol(name)   "_" #name
+#define FiberFunction(name) ".private_extern _" #name "\n" \
+                            "_" #name ":\n"
+#define FiberFunctionEnd(name)
+#else
+#define FiberSymbol(name)   #name
+#define FiberFunction(name) ".hidden " #name "\n"          \
+                            ".type " #name ", %function\n" \
+                            #name ":\n"
+#define FiberFunctionEnd(name) ".size " #name ", .-" #name "\n"
+#endif
+
+extern "C" void fiberSwitch(void** saveStackPointer, void* loadStackPointer);
+extern "C" void fiberStart(void);
+
+#if defined(__x86_64__)
+
+// Saved state (from lowest address): MXCSR, x87 control word, r15, r14, r13,
+// r12, rbx, rbp, return address.
+asm(".text\n"
+    ".globl " FiberSymbol(fiberSwitch) "\n"
+    ".p2align 4\n"
+    FiberFunction(fiberSwitch)
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    FiberFunctionEnd(fiberSwitch)
+    ".globl " FiberSymbol(fiberStart) "\n"
+    ".p2align 4\n"
+    FiberFunction(fiberStart)
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    FiberFunctionEnd(fiberStart));
+
+constexpr uint32 FiberFrameSize = 80; // 8 saved slots, return address, alignment padding
+
+#elif defined(__aarch64__)
+
+// Saved state (from lowest address): x19-x28, x29 (frame pointer), x30 (link
+// register, return address), d8-d15. Frame is padded to 16 bytes.
+asm(".text\n"
+    ".globl " FiberSymbol(fiberSwitch) "\n"
+    ".p2align 4\n"
+    FiberFunction(fiberSwitch)
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8,  d9,  [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8,  d9,  [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    FiberFunctionEnd(fiberSwitch)
+    ".globl " FiberSymbol(fiberStart) "\n"
+    ".p2align 4\n"
+    FiberFunction(fiberStart)
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+    FiberFunctionEnd(fiberStart));
+
+constexpr uint32 FiberFrameSize = 176;
+
+#endif
+#endif
+
 namespace en
 {
 
+#if defined(EN_FIBER_ASSEMBLY)
+
+static void functionExecutingTask(Fiber* fiber)
+{
+    assert( fiber->function );
+
+    // Executer provided function
+    fiber->function(fiber->state);
+
+    // Fiber function should never return, as there is no context to return to
+    assert( 0 );
+}
+
+#else
+
 typedef void (*helperFunction)();
 
 //extern "C"
@@ -25,7 +167,8 @@ void functionExecutingTask(int hiAdress, int loAdress)
 {
     // Reconstruct pointer to Fiber object, on which this function is running,
     // and for which, task should be executed.
-    Fiber* fiber = (Fiber*)( ((uint64)hiAdress << 32) | (uint64)loAdress );
+    // (low half needs to be zero-extended, otherwise sign bit would corrupt high half)
+    Fiber* fiber = (Fiber*)( ((uint64)(uint32)hiAdress << 32) | (uint64)(uint32)loAdress );
       
     assert( fiber->function );
 
@@ -33,7 +176,12 @@ void functionExecutingTask(int hiAdress, int loAdress)
     fiber->function(fiber->state);
 }
 
+#endif
+
 psxFiber::psxFiber(const uint32 stackSize, const uint32 _maximumStackSize) :
+#if defined(EN_FIBER_ASSEMBLY)
+    stackPointer(nullptr),
+#endif
     stack(nullptr),
     maximumStackSize(_maximumStackSize),
     Fiber()
@@ -43,13 +191,20 @@ psxFiber::psxFiber(const uint32 stackSize, const uint32 _maximumStackSize) :
     waitingForTask = nullptr;
    
     // Default contructor for thread transitioning to Fiber
+#if defined(EN_FIBER_ASSEMBLY)
+    // Thread keeps executing on its own stack, stack pointer will be saved on
+    // first switch to other fiber. Thus there is no need to allocate a stack.
+    (void)stackSize;
+#else
     // (will be used to save state fo this thread on first switch, but it already
     // needs to have proper stack assigned)
     
     // Get current context
     int result = getcontext(&context);
     assert( result != -1 );
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
     assert( context.uc_mcontext );
+#endif
    
     // Allocate fiber stack
     stack = virtualAllocate(stackSize, maximumStackSize);
@@ -65,9 +220,13 @@ psxFiber::psxFiber(const uint32 stackSize, const uint32 _maximumStackSize) :
     // by this fiber) thread default stack won't be used anymore, but separately
     // allocated fiber one will be used. On Windows, thread can be properly
     // converted to Fiber, which in turn reuses it's original stack.
+#endif
 }
 
 psxFiber::psxFiber(const FiberFunction _function, void* fiberState, const uint32 stackSize, const uint32 _maximumStackSize) :
+#if defined(EN_FIBER_ASSEMBLY)
+    stackPointer(nullptr),
+#endif
     stack(nullptr),
     maximumStackSize(_maximumStackSize),
     Fiber()
@@ -76,10 +235,38 @@ psxFiber::psxFiber(const FiberFunction _function, void* fiberState, const uint32
     state          = fiberState;
     waitingForTask = nullptr;
 
+#if defined(EN_FIBER_ASSEMBLY)
+    // Allocate fiber stack
+    stack = virtualAllocate(stackSize, maximumStackSize);
+    assert( stack );
+
+    // Stack grows down from its end (which is page aligned, so also 16 bytes
+    // aligned as required by both ABI's). Initial frame is laid out exactly
+    // as fiberSwitch() leaves it, so that first switch to this fiber pops it
+    // and returns to fiberStart().
+    uint8*  top   = static_cast<uint8*>(stack) + stackSize;
+    uint64* frame = reinterpret_cast<uint64*>(top - FiberFrameSize);
+    memset(frame, 0, FiberFrameSize);
+
+#if defined(__x86_64__)
+    frame[0] = 0x1F80ULL | (0x037FULL << 32);                      // Default MXCSR and x87 control word
+    frame[3] = reinterpret_cast<uint64>(&functionExecutingTask);   // r13
+    frame[4] = reinterpret_cast<uint64>(static_cast<Fiber*>(this)); // r12
+    frame[7] = reinterpret_cast<uint64>(&fiberStart);              // Return address
+#elif defined(__aarch64__)
+    frame[0]  = reinterpret_cast<uint64>(static_cast<Fiber*>(this)); // x19
+    frame[1]  = reinterpret_cast<uint64>(&functionExecutingTask);   // x20
+    frame[11] = reinterpret_cast<uint64>(&fiberStart);              // x30
+#endif
+
+    stackPointer = frame;
+#else
     // Use current context as a base for new one
     int result = getcontext(&context);
     assert( result != -1 );
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
     assert( context.uc_mcontext );
+#endif
    
     // Good description of getcontext(), makecontext():
     // https://en.wikipedia.org/wiki/Setcontext
@@ -120,6 +307,7 @@ psxFiber::psxFiber(const FiberFunction _function, void* fiberState, const uint32
     // https://github.com/stevedekorte/coroutine/blob/master/source/Coro.c
     //
     makecontext(&context, (helperFunction)functionExecutingTask, 2, (int)hiAdress, (int)loAdress);
+#endif
 }
    
 psxFiber::~psxFiber()
@@ -166,7 +354,20 @@ void switchToFiber(Fiber& _current, Fiber& _fiber)
 {
     psxFiber& current = reinterpret_cast<psxFiber&>(_current);
     psxFiber& fiber   = reinterpret_cast<psxFiber&>(_fiber);
+#if defined(EN_FIBER_ASSEMBLY)
+    // Switching fiber to itself is a no-op (stack pointer to load would be
+    // read before the current one is saved, resuming from stale state).
+    if (&current == &fiber)
+    {
+        return;
+    }
+
+    fiberSwitch(&current.stackPointer, fiber.stackPointer);
+#else
     int result = swapcontext(&current.context, &fiber.context);
+    assert( result == 0 );
+    (void)result;
+#endif
 }
 
 } // en
@@ -13,10 +13,22 @@
 
 #include "core/parallel/fiber.h"
 
-#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
+
+// On x86-64 (System V) and AArch64 fibers are switched by hand written code,
+// that saves only callee-saved registers on the fiber stack. swapcontext()
+// additionally saves and restores signal mask, which costs a syscall on each
+// switch. Define EN_FIBER_UCONTEXT to force the ucontext path.
+#if !defined(EN_FIBER_UCONTEXT) && (defined(__x86_64__) || defined(__aarch64__))
+#define EN_FIBER_ASSEMBLY
+#endif
 
+#if !defined(EN_FIBER_ASSEMBLY)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
 #define _XOPEN_SOURCE
+#endif
 #include <ucontext.h>
+#endif
 
 namespace en
 {
@@ -24,7 +36,11 @@ namespace en
 class psxFiber : public Fiber
 {
     public:
+#if defined(EN_FIBER_ASSEMBLY)
+    void*      stackPointer;   // Saved stack pointer (registers are stored on the stack itself)
+#else
     ucontext_t context;
+#endif
     void*      stack;
     uint32     maximumStackSize;
         
@@ -10,21 +10,29 @@
 
 #include "core/parallel/psxThread.h"
 
-#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
 
 #include "assert.h"
 
-#include <cpuid.h>
+#include <vector>
 
 #if defined(EN_PLATFORM_LINUX)
 #include <sched.h>             // for core execution mask
+#include <time.h>
+#include <ctype.h>
+#include <dirent.h>            // opendir(), for core topology
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #endif
 #if defined(EN_PLATFORM_OSX)
+#include <cpuid.h>
+#include <emmintrin.h>         // _mm_pause()
 #include <sys/sysctl.h>
 #include <mach/mach.h>
-#endif
 
 #define CPUID(INFO, LEAF, SUBLEAF) __cpuid_count(LEAF, SUBLEAF, INFO[0], INFO[1], INFO[2], INFO[3])
+#endif
 
 namespace en
 {
@@ -48,9 +56,16 @@ namespace en
 //
 uint64 currentThreadSystemId(void)
 {
+#if defined(EN_PLATFORM_LINUX)
+    // There is no public way to query kernel thread ID of other thread from
+    // its pthread handle, thus on Linux the handle itself is used as system ID
+    // (it is unique for the lifetime of the thread).
+    return static_cast<uint64>(pthread_self());
+#else
     uint64 systemId;
     pthread_threadid_np(nullptr, &systemId);
     return systemId;
+#endif
 }
 
 void wakeUpMainThread(void)
@@ -62,19 +77,27 @@ void wakeUpMainThread(void)
 void setThreadName(std::string threadName)
 {
     // Sets name of current thread
+#if defined(EN_PLATFORM_LINUX)
+    // Linux limits thread names to 16 characters (including terminator)
+    pthread_setname_np(pthread_self(), threadName.substr(0, 15).c_str());
+#else
     pthread_setname_np(threadName.c_str());
+#endif
 }
 
 uint32 currentCoreId(void)
 {
-    // Linux specific implementations:
+#if defined(EN_PLATFORM_LINUX)
+    // Alternative implementation:
     //
     // int result = getcpu(unsigned *cpu, unsigned *node, struct getcpu_cache *tcache);
     // assert( result >= 0 );
     //
-    // int result = sched_getcpu(void);
-    // assert( result >= 0 );
+    int result = sched_getcpu();
+    assert( result >= 0 );
 
+    return static_cast<uint32>(result);
+#else
     // WA for macOS:
     uint32 CPUInfo[4];
     CPUID(CPUInfo, 1, 0);
@@ -95,19 +118,169 @@ uint32 currentCoreId(void)
     // For more recent core detection see also:
     // https://stackoverflow.com/questions/22310028/is-there-an-x86-instruction-to-tell-which-core-the-instruction-is-being-run-on
     return core;
+#endif
+}
+
+std::vector<uint32> availableCores(void)
+{
+    std::vector<uint32> cores;
+
+#if defined(EN_PLATFORM_LINUX)
+    // Process may be restricted to subset of logical cores (by cpuset of the
+    // container, taskset, etc.), and threads cannot be pinned outside of it.
+    cpu_set_t coreSet;
+    CPU_ZERO(&coreSet);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &coreSet) == 0)
+    {
+        cores.reserve(CPU_COUNT(&coreSet));
+        for(uint32 i=0; i<static_cast<uint32>(CPU_SETSIZE); ++i)
+        {
+            if (CPU_ISSET(i, &coreSet))
+            {
+                cores.push_back(i);
+            }
+        }
+    }
+
+    if (cores.empty())
+    {
+        long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+        for(long i=0; i<onlineCores; ++i)
+        {
+            cores.push_back(static_cast<uint32>(i));
+        }
+    }
+#else
+    // macOS is not restricting execution of processes to subset of cores
+    uint32 logicalCores = 0;
+    size_t bufferLength = sizeof(logicalCores);
+    int ret = sysctlbyname("hw.logicalcpu_max", &logicalCores, &bufferLength, nullptr, 0);
+    assert( ret == 0 );
+
+    for(uint32 i=0; i<logicalCores; ++i)
+    {
+        cores.push_back(i);
+    }
+#endif
+
+    return cores;
+}
+
+#if defined(EN_PLATFORM_LINUX)
+// Reads first number from sysfs file (for lists of logical cores, like
+// "0-3,8-11", it is the lowest logical core on the list).
+static bool readFirstNumber(const char* path, uint32& value)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    unsigned int number = 0;
+    bool found = (fscanf(file, "%u", &number) == 1);
+    fclose(file);
+
+    value = static_cast<uint32>(number);
+    return found;
+}
+#endif
+
+bool coreTopology(const uint32 core, CoreTopology& topology)
+{
+#if defined(EN_PLATFORM_LINUX)
+    char path[128];
+
+    // Physical core is identified by lowest of its logical cores
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", core);
+    if (!readFirstNumber(path, topology.physicalCore))
+    {
+        return false;
+    }
+
+    // Last level cache is the one with highest level, and is identified by
+    // lowest of logical cores sharing it.
+    topology.cache = topology.physicalCore;
+    uint32 highestLevel = 0;
+    for(uint32 i=0; ; ++i)
+    {
+        uint32 level = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", core, i);
+        if (!readFirstNumber(path, level))
+        {
+            break;
+        }
+
+        uint32 firstCore = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", core, i);
+        if (level > highestLevel && readFirstNumber(path, firstCore))
+        {
+            highestLevel   = level;
+            topology.cache = firstCore;
+        }
+    }
+
+    // NUMA node is exposed as "nodeN" link in directory of logical core. If
+    // kernel has no NUMA support, processor package is used instead.
+    bool numa = false;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", core);
+    DIR* directory = opendir(path);
+    if (directory)
+    {
+        struct dirent* entry = nullptr;
+        while((entry = readdir(directory)) != nullptr)
+        {
+            if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4]))
+            {
+                topology.node = static_cast<uint32>(atoi(&entry->d_name[4]));
+                numa = true;
+                break;
+            }
+        }
+
+        closedir(directory);
+    }
+
+    if (!numa)
+    {
+        topology.node = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", core);
+        readFirstNumber(path, topology.node);
+    }
+
+    return true;
+#else
+    // macOS is not exposing location of logical cores
+    return false;
+#endif
 }
 
 typedef void*(*ThreadFunctionInternal)(void* thread);
 
 psxThread::psxThread(ThreadFunction function, void* threadState) :
+    Thread(),
     handle(),
     mutex(PTHREAD_MUTEX_INITIALIZER),
     localState(threadState),
     index(0xFFFFFFFF),
+    wakeUpSignaled(false),
     valid(false),
-    Thread()
+    joined(false)
 {
-    int ret = pthread_attr_init(&attr);
+    // Condition used to put thread to sleep, needs to exist before thread starts
+    pthread_condattr_t condAttr;
+    int ret = pthread_condattr_init(&condAttr);
+    assert( ret == 0 );
+#if defined(EN_PLATFORM_LINUX)
+    // Timed sleeps are expressed in the same monotonic time as currentTime()
+    ret = pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    assert( ret == 0 );
+#endif
+    ret = pthread_cond_init(&cond, &condAttr);
+    assert( ret == 0 );
+    pthread_condattr_destroy(&condAttr);
+
+    ret = pthread_attr_init(&attr);
     assert( ret == 0 );
    
     ret = pthread_create(&handle, (const pthread_attr_t*)&attr, (ThreadFunctionInternal)function, (void*)this);
@@ -117,6 +290,11 @@ psxThread::psxThread(ThreadFunction function, void* threadState) :
         valid = true;
     }
 
+#if defined(EN_PLATFORM_LINUX)
+    // Thread handle is known immediately after pthread_create() returns, and
+    // it is what the thread itself will report as its system ID.
+    uint64 thisThreadSystemId = static_cast<uint64>(handle);
+#else
     // Query this thread system ID.
     uint64 thisThreadSystemId = 0;
     ret = pthread_threadid_np(handle, &thisThreadSystemId);
@@ -130,6 +308,7 @@ psxThread::psxThread(ThreadFunction function, void* threadState) :
         ret = pthread_threadid_np(handle, &thisThreadSystemId);
     }
     assert( ret == 0 );
+#endif
     assert( thisThreadSystemId );
    
     // Register unique local thread ID
@@ -141,8 +320,16 @@ psxThread::~psxThread()
     // Mark that thread as terminated
     releaseThread(index);
    
-    pthread_kill(handle, 0);
+    // Handle of joined thread is already released, otherwise thread resources
+    // are released once it terminates.
+    if (valid && !joined)
+    {
+        pthread_detach(handle);
+    }
+
     pthread_attr_destroy(&attr);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
     valid = false;
 }
 
@@ -154,7 +341,11 @@ void* psxThread::state(void)
 void psxThread::name(std::string threadName)
 {
     // Sets name of current thread
+#if defined(EN_PLATFORM_LINUX)
+    pthread_setname_np(handle, threadName.substr(0, 15).c_str());
+#else
     pthread_setname_np(threadName.c_str());
+#endif
 }
    
 uint32 psxThread::id(void)
@@ -171,7 +362,7 @@ uint64 psxThread::coresExecutionMask(void)
     int psxResult = pthread_getaffinity_np(handle, sizeof(cpu_set_t), &coreSet);
     assert( psxResult == 0 );
 
-    for(uint32 i=0; i<min(64, CPU_SETSIZE); ++i)
+    for(uint32 i=0; i<min(64U, static_cast<uint32>(CPU_SETSIZE)); ++i)
     {
         if (CPU_ISSET(i, &coreSet))
         {
@@ -213,7 +404,8 @@ void psxThread::executeOn(const uint64 coresMask)
     CPU_ZERO(&coreSet);
     for(uint32 i=0; i<64; ++i)
     {
-        if (checkBit(coresMask, i))
+        // checkBit() operates on 32bit integers
+        if ((coresMask >> i) & 1ULL)
         {
             CPU_SET(i, &coreSet);
         }
@@ -247,12 +439,17 @@ void psxThread::sleep(void)
     // Only target thread can put itself to sleep
     assert( handle == pthread_self() );
 
-    int result = pthread_cond_init(&cond, nullptr);
-    assert(result == 0);
-   
-    // Sleep by waiting for signal
-    result = pthread_cond_wait(&cond, &mutex);
-    assert(result == 0);
+    // Sleep by waiting for signal. Wake-up flag protects from both spurious
+    // wake-ups and from signal sent before this thread started waiting.
+    pthread_mutex_lock(&mutex);
+    while(!wakeUpSignaled)
+    {
+        int result = pthread_cond_wait(&cond, &mutex);
+        assert(result == 0);
+        (void)result;
+    }
+    wakeUpSignaled = false;
+    pthread_mutex_unlock(&mutex);
    
     // Alternative implementation:
     //pause();
@@ -263,9 +460,14 @@ void psxThread::sleepFor(const Time time)
     // Only target thread can put itself to sleep
     assert( handle == pthread_self() );
 
+#if defined(EN_PLATFORM_LINUX)
+    // Timed wait on condition is interrupted by wakeUp()
+    sleepUntil(currentTime() + time);
+#else
     // TODO: Will mach_wait_until() be woken up by posix signal???
     //       This needs to be interruptable!
     en::sleepFor(time);
+#endif
 }
 
 void psxThread::sleepUntil(const Time time)
@@ -273,9 +475,25 @@ void psxThread::sleepUntil(const Time time)
     // Only target thread can put itself to sleep
     assert( handle == pthread_self() );
 
+#if defined(EN_PLATFORM_LINUX)
+    // Condition clock is CLOCK_MONOTONIC, the same as used by currentTime()
+    struct timespec deadline;
+    deadline.tv_sec  = static_cast<time_t>(time.nanoseconds() / 1000000000);
+    deadline.tv_nsec = static_cast<long>(time.nanoseconds() % 1000000000);
+
+    pthread_mutex_lock(&mutex);
+    int result = 0;
+    while(!wakeUpSignaled && result != ETIMEDOUT)
+    {
+        result = pthread_cond_timedwait(&cond, &mutex, &deadline);
+    }
+    wakeUpSignaled = false;
+    pthread_mutex_unlock(&mutex);
+#else
     // TODO: Will mach_wait_until() be woken up by posix signal???
     //       This needs to be interruptable!
     en::sleepUntil(time);
+#endif
 }
 
 void psxThread::wakeUp(void)
@@ -284,7 +502,10 @@ void psxThread::wakeUp(void)
     assert( handle != pthread_self() );
    
     // Wake-up thread by sending signal
+    pthread_mutex_lock(&mutex);
+    wakeUpSignaled = true;
     pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
    
     // Alternative implementation:
     //pthread_kill(handle, SIGCONT);
@@ -308,6 +529,7 @@ void psxThread::waitUntilCompleted(void)
     assert( handle != pthread_self() );
    
     pthread_join(handle, nullptr);
+    joined = true;
 }
    
 std::unique_ptr<Thread> startThread(ThreadFunction function, void* threadState)
@@ -13,7 +13,7 @@
 
 #include "core/parallel/thread.h"
 
-#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
 
 #include <pthread.h>
 #include <unistd.h>
@@ -26,11 +26,13 @@ class psxThread : public Thread
     public:
     pthread_t handle;          // Thread handle
     pthread_attr_t attr;       // Thread state
-    pthread_cond_t cond;
-    pthread_mutex_t mutex;
+    pthread_cond_t cond;       // Signaled to wake up sleeping thread
+    pthread_mutex_t mutex;     // Guards wake-up flag
     void* localState;          // State passed on thread creation
     uint32 index;              // Thread unique ID
+    bool wakeUpSignaled;       // Wake-up was requested (protects from lost wake-ups)
     volatile bool valid;       // Thread is executing (may sleep)
+    bool joined;               // Thread was joined (its handle is no longer valid)
 
     psxThread(ThreadFunction function, void* threadState);
     virtual ~psxThread();
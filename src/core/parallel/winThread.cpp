@@ -16,6 +16,8 @@
 
 #include "utilities/strings.h"
 
+#include <vector>
+
 namespace en
 {
 
@@ -46,6 +48,113 @@ uint32 currentCoreId(void)
     return GetCurrentProcessorNumber();
 }
 
+std::vector<uint32> availableCores(void)
+{
+    std::vector<uint32> cores;
+
+    // Only first processor group is supported (same as in executeOn())
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask  = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    {
+        for(uint32 i=0; i<sizeof(DWORD_PTR) * 8; ++i)
+        {
+            if ((static_cast<uint64>(processMask) >> i) & 1ULL)
+            {
+                cores.push_back(i);
+            }
+        }
+    }
+
+    if (cores.empty())
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        for(uint32 i=0; i<si.dwNumberOfProcessors; ++i)
+        {
+            cores.push_back(i);
+        }
+    }
+
+    return cores;
+}
+
+bool coreTopology(const uint32 core, CoreTopology& topology)
+{
+    // Only first processor group is supported (same as in executeOn())
+    if (core >= 64)
+    {
+        return false;
+    }
+
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    {
+        return false;
+    }
+
+    std::vector<uint8> buffer(length);
+    if (!GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length))
+    {
+        return false;
+    }
+
+    // Physical cores and caches are identified by their order on the list
+    KAFFINITY mask         = static_cast<KAFFINITY>(1) << core;
+    uint32    physicalCore = 0;
+    uint32    cache        = 0;
+    uint32    highestLevel = 0;
+    bool      found        = false;
+
+    topology.physicalCore = 0;
+    topology.cache        = 0;
+    topology.node         = 0;
+
+    uint8* entry = buffer.data();
+    while(entry < buffer.data() + length)
+    {
+        PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(entry);
+        if (info->Relationship == RelationProcessorCore)
+        {
+            if (info->Processor.GroupMask[0].Group == 0 &&
+                (info->Processor.GroupMask[0].Mask & mask))
+            {
+                topology.physicalCore = physicalCore;
+                found = true;
+            }
+
+            physicalCore++;
+        }
+        else
+        if (info->Relationship == RelationCache)
+        {
+            if (info->Cache.GroupMask.Group == 0 &&
+                (info->Cache.GroupMask.Mask & mask) &&
+                info->Cache.Level > highestLevel)
+            {
+                topology.cache = cache;
+                highestLevel   = info->Cache.Level;
+            }
+
+            cache++;
+        }
+        else
+        if (info->Relationship == RelationNumaNode)
+        {
+            if (info->NumaNode.GroupMask.Group == 0 &&
+                (info->NumaNode.GroupMask.Mask & mask))
+            {
+                topology.node = info->NumaNode.NodeNumber;
+            }
+        }
+
+        entry += info->Size;
+    }
+
+    return found;
+}
+
 winThreadContainer::winThreadContainer(ThreadFunction _function, Thread* _threadClass) :
     function(_function),
     threadClass(_threadClass)
@@ -157,7 +157,7 @@ namespace en
    Validate( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) )
    Validate( glReadPixels(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, data) )
 
-   bool result = en::bmp::save(width, height, data, string(filename + ".bmp"));
+   bool result = en::bmp::save(ResourcesContext.path.screenshots + filename + ".bmp", data, width, height);
    
    ////Swap R and B components
    //if (format == gpu::FormatABGR_8)
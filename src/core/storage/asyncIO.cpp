@@ -0,0 +1,237 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Asynchronous File I/O.
+ Requirements: none
+ Description : Executes file read requests without blocking worker threads
+               of Thread-Pool. Each request is tracked by task state, that
+               is finished once request is completed, which resumes fibers
+               waiting for it (see Scheduler->wait()). Requests are served
+               by io_uring on Linux (for files backed by file descriptor),
+               otherwise by small pool of I/O threads performing blocking
+               reads.
+
+*/
+
+#include "core/storage/asyncIO.h"
+
+#include "assert.h"
+
+#include "core/storage/storage.h"
+#include "core/storage/lnxAsyncIO.h"
+#include "parallel/scheduler.h"
+
+namespace en
+{
+namespace storage
+{
+
+void completeRequest(ReadRequest* request)
+{
+    if (request->readBytes)
+    {
+        *request->readBytes = request->done;
+    }
+
+    // Request is released before state, as waiting fiber may be resumed
+    // immediately after that.
+    TaskState* state = request->state;
+    request->pool->deallocateRemote(*request);
+
+    Scheduler->complete(state);
+}
+
+void* ioThreadFunction(Thread* thread)
+{
+    IOThreadPool::IOThread& state = *(IOThreadPool::IOThread*)(thread->state());
+    IOThreadPool&           pool  = *state.pool;
+
+    thread->name("I/O Thread");
+
+    for(;;)
+    {
+        ReadRequest* request = nullptr;
+        DequeResult  result  = state.queue.take(request);
+        if (result == DequeResult::Success)
+        {
+            uint64 readBytes = 0;
+            request->file->read(request->offset, request->size, request->buffer, &readBytes);
+            request->done = readBytes;
+
+            completeRequest(request);
+            continue;
+        }
+
+        // Producer is in the middle of pushing request
+        if (result == DequeResult::Abort)
+        {
+            continue;
+        }
+
+        // Pending requests are served before thread terminates
+        if (!std::atomic_load_explicit(&pool.running, std::memory_order_acquire))
+        {
+            break;
+        }
+
+        // Flag is set before queue is checked for the last time, while
+        // producer pushes request before checking the flag. Fences guarantee
+        // that at least one of them sees the other one (so wake up is not lost).
+        std::atomic_store_explicit(&state.sleeping, true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (state.queue.empty() && std::atomic_load_explicit(&pool.running, std::memory_order_relaxed))
+        {
+            thread->sleep();
+        }
+
+        std::atomic_store_explicit(&state.sleeping, false, std::memory_order_relaxed);
+    }
+
+    return nullptr;
+}
+
+IOThreadPool::IOThreadPool(const uint32 _threads) :
+    thread(new IOThread[_threads]),
+    threads(_threads),
+    running(true)
+{
+    assert( threads > 0 );
+
+    for(uint32 i=0; i<threads; ++i)
+    {
+        thread[i].sleeping.store(false, std::memory_order_relaxed);
+        thread[i].pool = this;
+    }
+
+    // Threads are started after all states are initialized
+    for(uint32 i=0; i<threads; ++i)
+    {
+        thread[i].thread = startThread(ioThreadFunction, &thread[i]);
+    }
+}
+
+IOThreadPool::~IOThreadPool()
+{
+    std::atomic_store_explicit(&running, false, std::memory_order_seq_cst);
+
+    for(uint32 i=0; i<threads; ++i)
+    {
+        thread[i].thread->wakeUp();
+        thread[i].thread->waitUntilCompleted();
+        thread[i].thread = nullptr;
+    }
+
+    delete [] thread;
+}
+
+void IOThreadPool::submit(ReadRequest* request)
+{
+    // All requests to the same file are served by the same thread in order,
+    // so file implementation doesn't need to support concurrent reads.
+    IOThread& selected = thread[(reinterpret_cast<uintptr_t>(request->file) >> 6) % threads];
+
+    selected.queue.push(request);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (std::atomic_load_explicit(&selected.sleeping, std::memory_order_relaxed))
+    {
+        selected.thread->wakeUp();
+    }
+}
+
+AsyncIO::AsyncIO(const uint32 threads) :
+    requests(nullptr),
+    workers(Scheduler->workers()),
+    externalRequests(PoolRequests, MaxPoolRequests, alignof(ReadRequest)),
+    lockAllocator(),
+    pool(threads)
+{
+    requests = new ConcurrentPoolAllocator<ReadRequest>*[workers];
+    for(uint32 i=0; i<workers; ++i)
+    {
+        requests[i] = new ConcurrentPoolAllocator<ReadRequest>(PoolRequests, MaxPoolRequests, alignof(ReadRequest));
+    }
+
+#if defined(EN_PLATFORM_LINUX)
+    // Kernels older than 5.1 (or with io_uring disabled) use only I/O threads
+    uring = std::make_unique<IOUring>(&pool);
+    if (!uring->ready())
+    {
+        uring = nullptr;
+    }
+#endif
+}
+
+AsyncIO::~AsyncIO()
+{
+#if defined(EN_PLATFORM_LINUX)
+    // Completion thread is terminated before I/O threads
+    uring = nullptr;
+#endif
+
+    // All requests are completed at this point (files cannot be closed while
+    // they have requests in flight)
+    for(uint32 i=0; i<workers; ++i)
+    {
+        delete requests[i];
+    }
+
+    delete [] requests;
+}
+
+void AsyncIO::read(CommonFile* file, const uint64 offset, const uint64 size, volatile void* buffer, TaskState* state, uint64* readBytes)
+{
+    assert( file );
+    assert( state );
+
+    Scheduler->issue(state);
+
+    // Worker thread is the only one allocating from its own pool. Threads
+    // that are not part of Thread-Pool are allowed to block, so they are
+    // serialized on allocation from shared one.
+    uint32 thisWorker = Scheduler->currentWorkerId();
+    ConcurrentPoolAllocator<ReadRequest>* source = &externalRequests;
+    ReadRequest* request = nullptr;
+    if (thisWorker < workers)
+    {
+        source  = requests[thisWorker];
+        request = source->allocate();
+    }
+    else
+    {
+        lockAllocator.lock();
+        request = source->allocate();
+        lockAllocator.unlock();
+    }
+
+    assert( request );
+
+    request->file      = file;
+    request->offset    = offset;
+    request->size      = size;
+    request->done      = 0;
+    request->buffer    = buffer;
+    request->readBytes = readBytes;
+    request->state     = state;
+    request->pool      = source;
+
+    if (size == 0)
+    {
+        completeRequest(request);
+        return;
+    }
+
+#if defined(EN_PLATFORM_LINUX)
+    // Request is passed to I/O thread if completion queue is full
+    if (uring && file->descriptor() >= 0 && uring->submit(request))
+    {
+        return;
+    }
+#endif
+
+    pool.submit(request);
+}
+
+} // en::storage
+} // en
@@ -0,0 +1,122 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Asynchronous File I/O.
+ Requirements: none
+ Description : Executes file read requests without blocking worker threads
+               of Thread-Pool. Each request is tracked by task state, that
+               is finished once request is completed, which resumes fibers
+               waiting for it (see Scheduler->wait()). Requests are served
+               by io_uring on Linux (for files backed by file descriptor),
+               otherwise by small pool of I/O threads performing blocking
+               reads.
+
+*/
+
+#ifndef ENG_CORE_STORAGE_ASYNC_IO
+#define ENG_CORE_STORAGE_ASYNC_IO
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/parallel/mutex.h"
+#include "core/parallel/thread.h"
+#include "memory/concurrentPoolAllocator.h"
+#include "memory/mpscQueue.h"
+#include "parallel/task.h"
+
+#include <atomic>
+#include <memory>
+
+#if defined(EN_PLATFORM_LINUX)
+#include <sys/uio.h>  // iovec
+#endif
+
+namespace en
+{
+namespace storage
+{
+
+class CommonFile;
+
+constexpr uint32 IOThreads       = 4;     // Threads serving requests that cannot be passed to io_uring
+constexpr uint32 PoolRequests    = 256;   // Initial capacity of each pool of read requests
+constexpr uint32 MaxPoolRequests = 65536; // Requests in flight allocated from single pool (only reserves address space)
+
+struct ReadRequest
+{
+    std::atomic<ReadRequest*> next; // Intrusive link used by MPSC queues
+    CommonFile*    file;            // File to read from
+    uint64         offset;          // Location in file
+    uint64         size;            // Bytes to read
+    uint64         done;            // Bytes read so far
+    volatile void* buffer;          // Destination
+    uint64*        readBytes;       // Optional, receives count of read bytes
+    TaskState*     state;           // Finished once request is completed
+    ConcurrentPoolAllocator<ReadRequest>* pool; // Pool request was allocated from
+#if defined(EN_PLATFORM_LINUX)
+    struct iovec   vector;          // Currently read part of destination (io_uring)
+#endif
+};
+
+// Stores count of read bytes, finishes task state and releases request to
+// pool it was allocated from (can be called by any thread).
+extern void completeRequest(ReadRequest* request);
+
+// Pool of threads performing blocking reads. Requests for the same file are
+// always served by the same thread, as files are not required to support
+// concurrent reads.
+class IOThreadPool
+{
+    public:
+    struct IOThread
+    {
+        MPSCQueue<ReadRequest>  queue;    // Requests waiting to be served
+        std::atomic<bool>       sleeping; // Set when thread is going to sleep
+        std::unique_ptr<Thread> thread;
+        IOThreadPool*           pool;
+    };
+
+    IOThread*         thread;   // Array of I/O threads
+    uint32            threads;  // Count of I/O threads
+    std::atomic<bool> running;  // Cleared on termination
+
+    IOThreadPool(const uint32 threads);
+   ~IOThreadPool();
+
+    void submit(ReadRequest* request); // Can be called by any thread
+};
+
+class IOUring;
+
+class AsyncIO
+{
+    private:
+    // Requests are allocated from pools of worker thread that issues them,
+    // and released by thread completing them (through remote free list).
+    ConcurrentPoolAllocator<ReadRequest>** requests; // Pool of requests of each worker thread
+    uint32                                 workers;  // Count of worker threads
+    ConcurrentPoolAllocator<ReadRequest>   externalRequests; // Pool shared by threads not part of Thread-Pool
+    Mutex                                  lockAllocator;    // Only one external thread at a time can allocate from external pool
+
+    IOThreadPool             pool;  // Fallback for files without descriptor, or platforms without io_uring
+#if defined(EN_PLATFORM_LINUX)
+    std::unique_ptr<IOUring> uring; // Native queue (nullptr if unsupported)
+#endif
+
+    public:
+    AsyncIO(const uint32 threads = IOThreads); // Called once Thread-Pool is created
+   ~AsyncIO();
+
+    void read(CommonFile* file,          // Issues read request, given state is finished
+              const uint64 offset,       // once it's completed
+              const uint64 size,
+              volatile void* buffer,
+              TaskState* state,
+              uint64* readBytes);
+};
+
+} // en::storage
+} // en
+
+#endif
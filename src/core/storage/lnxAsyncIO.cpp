@@ -0,0 +1,359 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Linux Asynchronous File I/O.
+ Requirements: none
+ Description : Serves file read requests with io_uring (Linux 5.1+). Reads
+               are queued without locks, and submitted by one of issuing
+               threads at a time. They are completed by single completion
+               thread that sleeps in kernel until any of them finishes. Short reads are resubmitted until whole
+               requested range is read, or end of file is reached.
+               Requests that cannot be submitted are served by I/O
+               threads, or completed as failed if they were partially
+               read already.
+
+*/
+
+#include "core/storage/lnxAsyncIO.h"
+
+#if defined(EN_PLATFORM_LINUX)
+#include "assert.h"
+
+#include "core/storage/storage.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace en
+{
+namespace storage
+{
+
+// Single readv is limited by kernel to slightly less than 2GB, bigger
+// requests are read in parts.
+constexpr uint64 IOUringMaxRead = 1024 * 1024 * 1024;
+
+// Completion with this user data terminates completion thread
+constexpr uint64 IOUringTerminate = 0;
+
+// glibc doesn't provide wrappers for io_uring system calls
+static sint32 ioUringSetup(const uint32 entries, struct io_uring_params* params)
+{
+    return static_cast<sint32>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static sint32 ioUringEnter(const sint32 ring, const uint32 toSubmit, const uint32 minComplete, const uint32 flags)
+{
+    return static_cast<sint32>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+void* completionThreadFunction(Thread* thread)
+{
+    IOUring& uring = *(IOUring*)(thread->state());
+
+    thread->name("I/O Completion");
+
+    for(;;)
+    {
+        // Sleep in kernel until at least one request is completed
+        uint32 head = std::atomic_load_explicit(uring.cqHead, std::memory_order_relaxed);
+        if (head == std::atomic_load_explicit(uring.cqTail, std::memory_order_acquire))
+        {
+            ioUringEnter(uring.ring, 0, 1, IORING_ENTER_GETEVENTS);
+            continue;
+        }
+
+        struct io_uring_cqe& entry = uring.cqes[head & *uring.cqMask];
+        ReadRequest* request = reinterpret_cast<ReadRequest*>(entry.user_data);
+        sint32       result  = entry.res;
+
+        // Entry is returned to kernel as soon as it's read
+        std::atomic_store_explicit(uring.cqHead, head + 1, std::memory_order_release);
+
+        if (entry.user_data == IOUringTerminate)
+        {
+            if (!std::atomic_load_explicit(&uring.running, std::memory_order_acquire))
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        // Read was interrupted before any data was transferred
+        if (result == -EINTR || result == -EAGAIN)
+        {
+            uring.resubmit(request);
+            continue;
+        }
+
+        // Remaining part is read, unless end of file is reached or error occurred
+        if (result > 0)
+        {
+            request->done += static_cast<uint64>(result);
+            if (request->done < request->size)
+            {
+                uring.resubmit(request);
+                continue;
+            }
+        }
+
+        std::atomic_fetch_sub_explicit(&uring.inFlight, 1U, std::memory_order_relaxed);
+        completeRequest(request);
+    }
+
+    return nullptr;
+}
+
+IOUring::IOUring(IOThreadPool* _fallback) :
+    ring(-1),
+    entries(0),
+    sqMemory(MAP_FAILED),
+    sqSize(0),
+    cqMemory(MAP_FAILED),
+    cqSize(0),
+    sqes(reinterpret_cast<struct io_uring_sqe*>(MAP_FAILED)),
+    sqesSize(0),
+    sqTail(nullptr),
+    sqMask(nullptr),
+    sqArray(nullptr),
+    cqHead(nullptr),
+    cqTail(nullptr),
+    cqMask(nullptr),
+    cqes(nullptr),
+    fallback(_fallback),
+    pending(),
+    queued(0),
+    submitting(false),
+    inFlight(0),
+    running(true),
+    thread(nullptr)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring = ioUringSetup(IOUringEntries, &params);
+    if (ring < 0)
+    {
+        return;
+    }
+
+    // Completion queue is at least twice as big as submission queue, so it
+    // cannot overflow while count of requests in flight is below its size.
+    entries  = params.sq_entries;
+    sqSize   = params.sq_off.array + params.sq_entries * sizeof(uint32);
+    cqSize   = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sqMemory = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    cqMemory = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    sqes     = reinterpret_cast<struct io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES));
+    if (sqMemory == MAP_FAILED ||
+        cqMemory == MAP_FAILED ||
+        sqes     == MAP_FAILED)
+    {
+        return;
+    }
+
+    uint8* sq = reinterpret_cast<uint8*>(sqMemory);
+    uint8* cq = reinterpret_cast<uint8*>(cqMemory);
+    sqTail  = reinterpret_cast<std::atomic<uint32>*>(sq + params.sq_off.tail);
+    sqMask  = reinterpret_cast<uint32*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<uint32*>(sq + params.sq_off.array);
+    cqHead  = reinterpret_cast<std::atomic<uint32>*>(cq + params.cq_off.head);
+    cqTail  = reinterpret_cast<std::atomic<uint32>*>(cq + params.cq_off.tail);
+    cqMask  = reinterpret_cast<uint32*>(cq + params.cq_off.ring_mask);
+    cqes    = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    thread = startThread(completionThreadFunction, this);
+}
+
+IOUring::~IOUring()
+{
+    if (thread)
+    {
+        // All requests should be completed at this point. Completion thread
+        // is woken up by empty request.
+        assert( std::atomic_load_explicit(&inFlight, std::memory_order_relaxed) == 0 );
+
+        // There are no other submitters at this point
+        std::atomic_store_explicit(&running, false, std::memory_order_release);
+        while(std::atomic_exchange_explicit(&submitting, true, std::memory_order_acquire))
+        {
+            sched_yield();
+        }
+
+        bool woken = enter(IORING_OP_NOP, nullptr);
+        assert( woken );
+        (void)woken;
+        thread->waitUntilCompleted();
+        thread = nullptr;
+    }
+
+    if (sqes != MAP_FAILED)
+    {
+        munmap(sqes, sqesSize);
+    }
+
+    if (cqMemory != MAP_FAILED)
+    {
+        munmap(cqMemory, cqSize);
+    }
+
+    if (sqMemory != MAP_FAILED)
+    {
+        munmap(sqMemory, sqSize);
+    }
+
+    if (ring >= 0)
+    {
+        close(ring);
+    }
+}
+
+bool IOUring::ready(void) const
+{
+    return thread != nullptr;
+}
+
+bool IOUring::enter(const uint8 opcode, ReadRequest* request)
+{
+    // Submission queue cannot be full, as each request in flight occupies at
+    // most one entry, and their count is limited by its size.
+    uint32 tail  = std::atomic_load_explicit(sqTail, std::memory_order_relaxed);
+    uint32 index = tail & *sqMask;
+
+    struct io_uring_sqe& entry = sqes[index];
+    memset(&entry, 0, sizeof(entry));
+    entry.opcode    = opcode;
+    entry.fd        = -1;
+    entry.user_data = reinterpret_cast<uint64>(request);
+    if (request)
+    {
+        entry.fd   = request->file->descriptor();
+        entry.off  = request->offset + request->done;
+        entry.addr = reinterpret_cast<uint64>(&request->vector);
+        entry.len  = 1;
+
+        request->vector.iov_base = (uint8*)(request->buffer) + request->done;
+        request->vector.iov_len  = static_cast<size_t>(std::min(request->size - request->done, IOUringMaxRead));
+    }
+
+    sqArray[index] = index;
+
+    // Kernel sees entry once tail is published
+    std::atomic_store_explicit(sqTail, tail + 1, std::memory_order_release);
+
+    bool submitted = false;
+    for(;;)
+    {
+        sint32 result = ioUringEnter(ring, 1, 0, 0);
+        if (result > 0)
+        {
+            submitted = true;
+            break;
+        }
+
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // Completion queue is full, or kernel is temporarily out of resources.
+        // Completions that overflowed are flushed to the ring, and submission
+        // is retried once completion thread drains them.
+        if (result == 0 || errno == EAGAIN || errno == EBUSY)
+        {
+            ioUringEnter(ring, 0, 0, IORING_ENTER_GETEVENTS);
+            sched_yield();
+            continue;
+        }
+
+        // Any other error means that entry won't be consumed. Kernel reads
+        // submission queue only while it's entered, so entry can be withdrawn.
+        std::atomic_store_explicit(sqTail, tail, std::memory_order_release);
+        break;
+    }
+
+    return submitted;
+}
+
+void IOUring::push(ReadRequest* request)
+{
+    pending.push(request);
+
+    // Counted after request is linked, so that submitter can take it
+    std::atomic_fetch_add_explicit(&queued, 1U, std::memory_order_seq_cst);
+    submitPending();
+}
+
+void IOUring::submitPending(void)
+{
+    // Thread that pushed request either becomes submitter, or current
+    // submitter sees its request after giving up its role (both operations
+    // are sequentially consistent, so at least one of them sees the other).
+    while(std::atomic_load_explicit(&queued, std::memory_order_seq_cst) > 0)
+    {
+        if (std::atomic_exchange_explicit(&submitting, true, std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // Stops if producer is in the middle of pushing (it's not counted yet)
+        ReadRequest* request = nullptr;
+        while(pending.take(request) == DequeResult::Success)
+        {
+            std::atomic_fetch_sub_explicit(&queued, 1U, std::memory_order_relaxed);
+            if (enter(IORING_OP_READV, request))
+            {
+                continue;
+            }
+
+            // Request that kernel rejected is served by I/O threads, or
+            // completed with bytes that were read so far
+            std::atomic_fetch_sub_explicit(&inFlight, 1U, std::memory_order_relaxed);
+            if (request->done == 0)
+            {
+                fallback->submit(request);
+            }
+            else
+            {
+                completeRequest(request);
+            }
+        }
+
+        std::atomic_store_explicit(&submitting, false, std::memory_order_seq_cst);
+    }
+}
+
+void IOUring::resubmit(ReadRequest* request)
+{
+    push(request);
+}
+
+bool IOUring::submit(ReadRequest* request)
+{
+    assert( request );
+    assert( request->file->descriptor() >= 0 );
+
+    // Reserve place in queue
+    if (std::atomic_fetch_add_explicit(&inFlight, 1U, std::memory_order_relaxed) >= entries)
+    {
+        std::atomic_fetch_sub_explicit(&inFlight, 1U, std::memory_order_relaxed);
+        return false;
+    }
+
+    push(request);
+    return true;
+}
+
+} // en::storage
+} // en
+
+#endif
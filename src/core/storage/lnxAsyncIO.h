@@ -0,0 +1,88 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Linux Asynchronous File I/O.
+ Requirements: none
+ Description : Serves file read requests with io_uring (Linux 5.1+). Reads
+               are submitted directly by issuing thread, and completed by
+               single completion thread that sleeps in kernel until any
+               of them finishes. Short reads are resubmitted until whole
+               requested range is read, or end of file is reached.
+
+*/
+
+#ifndef ENG_CORE_STORAGE_LINUX_ASYNC_IO
+#define ENG_CORE_STORAGE_LINUX_ASYNC_IO
+
+#include "core/defines.h"
+
+#if defined(EN_PLATFORM_LINUX)
+
+#include "core/storage/asyncIO.h"
+
+#include <linux/io_uring.h>
+
+namespace en
+{
+namespace storage
+{
+
+constexpr uint32 IOUringEntries = 256; // Max count of requests in flight (power of two)
+
+class IOUring
+{
+    private:
+    sint32  ring;         // io_uring file descriptor (-1 if setup failed)
+    uint32  entries;      // Size of submission queue
+
+    void*   sqMemory;     // Submission queue ring (mapped)
+    uint64  sqSize;
+    void*   cqMemory;     // Completion queue ring (mapped)
+    uint64  cqSize;
+    struct io_uring_sqe* sqes; // Submission queue entries (mapped)
+    uint64  sqesSize;
+
+    std::atomic<uint32>* sqTail;
+    uint32* sqMask;
+    uint32* sqArray;
+    std::atomic<uint32>* cqHead;
+    std::atomic<uint32>* cqTail;
+    uint32* cqMask;
+    struct io_uring_cqe* cqes;
+
+    IOThreadPool*           fallback;   // Serves requests that kernel rejected
+
+    // Submission queue has single producer at a time. Threads issuing reads
+    // push them on MPSC queue instead, and one of them becomes submitter,
+    // that moves all queued requests to kernel (others don't wait for it).
+    MPSCQueue<ReadRequest>  pending;    // Requests waiting for submission
+    std::atomic<uint32>     queued;     // Count of requests pushed on pending queue
+    std::atomic<bool>       submitting; // Set while some thread is submitter
+
+    std::atomic<uint32>     inFlight;   // Count of requests owned by kernel
+    std::atomic<bool>       running;    // Cleared on termination
+    std::unique_ptr<Thread> thread;     // Completion thread
+
+    bool enter(const uint8 opcode,      // Submits single entry, returns false if kernel rejected it
+               ReadRequest* request);   // (called only by submitter)
+    void push(ReadRequest* request);    // Queues request for submission (can be called by any thread)
+    void submitPending(void);           // Submits queued requests, unless other thread already does it
+    void resubmit(ReadRequest* request);
+
+    friend void* completionThreadFunction(Thread* thread);
+
+    public:
+    IOUring(IOThreadPool* fallback);
+   ~IOUring();
+
+    bool ready(void) const;             // Returns true if io_uring is supported
+    bool submit(ReadRequest* request);  // Returns false if queue is full (can be called by any thread)
+};
+
+} // en::storage
+} // en
+
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Linux File system operations.
+ Requirements: none
+ Description : Holds methods that support reading and
+               writing to files on storage devices or
+               on virtual file system.
+
+*/
+
+#include "core/storage/lnxStorage.h"
+
+#if defined(EN_PLATFORM_LINUX)
+#include "assert.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>    // PATH_MAX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace en
+{
+namespace storage
+{
+
+LinuxFileView::LinuxFileView(void* _base, const uint64 _mappedSize, const uint8* _pointer, const uint64 _length) :
+    base(_base),
+    mappedSize(_mappedSize),
+    CommonFileView(_pointer, _length)
+{
+}
+
+LinuxFileView::~LinuxFileView()
+{
+    munmap(base, mappedSize);
+}
+
+LinuxFile::LinuxFile(const sint32 _handle) :
+    handle(_handle),
+    CommonFile()
+{
+    assert( handle >= 0 );
+
+    struct stat info;
+    if (fstat(handle, &info) == 0)
+    {
+        fileSize = static_cast<uint64>(info.st_size);
+    }
+}
+
+LinuxFile::~LinuxFile()
+{
+    assert( handle >= 0 );
+    close(handle);
+}
+
+bool LinuxFile::read(const uint64 offset, const uint64 _size, volatile void* buffer, uint64* readBytes)
+{
+    assert( handle >= 0 );
+    assert( offset + _size <= fileSize );
+
+    // Single call may read less than requested (it's limited to ~2GB)
+    uint64 read = 0;
+    while(read < _size)
+    {
+        ssize_t result = pread(handle, (uint8*)(buffer) + read, _size - read, static_cast<off_t>(offset + read));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            break;
+        }
+
+        read += static_cast<uint64>(result);
+    }
+
+    if (readBytes != nullptr)
+    {
+        *readBytes = read;
+    }
+
+    return read == _size;
+}
+
+FileView* LinuxFile::map(const uint64 offset, const uint64 _size, const MapHint hint)
+{
+    assert( handle >= 0 );
+    assert( offset + _size <= fileSize );
+
+    // Empty mappings are not allowed
+    if (_size == 0)
+    {
+        return new CommonFileView(nullptr, 0);
+    }
+
+    // Mapping needs to start at page boundary
+    static const uint64 pageSize = static_cast<uint64>(sysconf(_SC_PAGESIZE));
+    uint64 begin  = offset - (offset % pageSize);
+    uint64 length = (offset - begin) + _size;
+
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, handle, static_cast<off_t>(begin));
+    if (base == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    // Hints are only advisory, so their failure is ignored
+    if (hint == MapHint::Sequential)
+    {
+        madvise(base, length, MADV_SEQUENTIAL);
+        madvise(base, length, MADV_WILLNEED);
+    }
+    else
+    {
+        madvise(base, length, MADV_RANDOM);
+    }
+
+    return new LinuxFileView(base, length, reinterpret_cast<const uint8*>(base) + (offset - begin), _size);
+}
+
+sint32 LinuxFile::descriptor(void)
+{
+    return handle;
+}
+
+bool LinuxFile::write(const uint64 _size, void* buffer)
+{
+    assert( handle >= 0 );
+
+    invalidateReader();
+
+    // Writes at current file position
+    uint64 written = 0;
+    while(written < _size)
+    {
+        ssize_t result = ::write(handle, reinterpret_cast<uint8*>(buffer) + written, _size - written);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        written += static_cast<uint64>(result);
+    }
+
+    fileSize = static_cast<uint64>(lseek(handle, 0, SEEK_END));
+    return true;
+}
+
+bool LinuxFile::write(const uint64 offset, const uint64 _size, void* buffer)
+{
+    assert( handle >= 0 );
+
+    invalidateReader();
+
+    uint64 written = 0;
+    while(written < _size)
+    {
+        ssize_t result = pwrite(handle, reinterpret_cast<uint8*>(buffer) + written, _size - written, static_cast<off_t>(offset + written));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        written += static_cast<uint64>(result);
+    }
+
+    if (offset + _size > fileSize)
+    {
+        fileSize = offset + _size;
+    }
+
+    return true;
+}
+
+LinuxInterface::LinuxInterface() :
+    CommonStorage()
+{
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, PATH_MAX - 1);
+    if (length > 0)
+    {
+        processPath = std::string(path, static_cast<size_t>(length));
+    }
+}
+
+LinuxInterface::~LinuxInterface()
+{
+}
+
+bool LinuxInterface::exist(const std::string& filename)
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+    {
+        return false;
+    }
+
+    return S_ISREG(info.st_mode);
+}
+
+File* LinuxInterface::open(const std::string& filename, const FileAccess mode)
+{
+    sint32 flags = O_RDONLY;
+    if (mode == Write)
+    {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    }
+    else
+    if (mode == ReadWrite)
+    {
+        flags = O_RDWR;
+    }
+
+    sint32 handle = ::open(filename.c_str(), flags | O_CLOEXEC, 0644);
+    if (handle < 0)
+    {
+        return nullptr;
+    }
+
+    return new LinuxFile(handle);
+}
+
+} // en::storage
+} // en
+
+#endif
@@ -0,0 +1,80 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Linux File system operations.
+ Requirements: none
+ Description : Holds methods that support reading and
+               writing to files on storage devices or
+               on virtual file system.
+
+*/
+
+#ifndef ENG_CORE_STORAGE_LINUX
+#define ENG_CORE_STORAGE_LINUX
+
+#include "core/storage/storage.h"
+
+#if defined(EN_PLATFORM_LINUX)
+namespace en
+{
+namespace storage
+{
+
+class LinuxFileView : public CommonFileView
+{
+    public:
+    void*  base;        // Start of mapping (aligned to page size)
+    uint64 mappedSize;  // Size of mapping
+
+    LinuxFileView(void* base,
+                  const uint64 mappedSize,
+                  const uint8* pointer,
+                  const uint64 length);
+    virtual ~LinuxFileView();
+};
+
+class LinuxFile : public CommonFile
+{
+    public:
+    sint32 handle;      // File descriptor
+
+    virtual bool read(const uint64 offset,
+                      const uint64 size,
+                      volatile void* buffer,
+                      uint64* readBytes = nullptr); // Reads part of file
+
+    virtual FileView* map(const uint64 offset,
+                          const uint64 size,
+                          const MapHint hint = MapHint::Sequential); // Maps part of file to memory
+
+    virtual sint32 descriptor(void);
+
+    virtual bool write(const uint64 size,
+                       void* buffer);            // Writes block of data to file
+    virtual bool write(const uint64 offset,
+                       const uint64 size,
+                       void* buffer);            // Writes to file at specified location
+
+    LinuxFile(const sint32 handle);
+    virtual ~LinuxFile();
+};
+
+class LinuxInterface : public CommonStorage
+{
+    public:
+    virtual bool exist(const std::string& filename); // Check if file exist
+
+    // Creates file object and returns its ownership to the caller
+    virtual File* open(const std::string& filename,
+                       const FileAccess mode = Read);
+
+    LinuxInterface();
+    virtual ~LinuxInterface();
+};
+
+} // en::storage
+} // en
+
+#endif
+#endif
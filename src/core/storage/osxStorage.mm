@@ -16,6 +16,8 @@
 #if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
 
 #include <fstream>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "utilities/osxStrings.h"
 
@@ -48,6 +50,30 @@ bool OSXFile::read(const uint64 offset, const uint64 _size, volatile void* buffe
 
     return true;
 }
+
+FileView* OSXFile::map(const uint64 offset, const uint64 _size, const MapHint hint)
+{
+    assert( handle );
+    assert( offset + _size <= fileSize );
+
+    // File is already mapped to memory (see NSMappedRead), so view just
+    // points into it. Hints are passed for pages covering viewed range.
+    const uint8* pointer = reinterpret_cast<const uint8*>([handle bytes]) + offset;
+    if (_size > 0)
+    {
+        uint64 pageSize = static_cast<uint64>(getpagesize());
+        uint64 begin    = reinterpret_cast<uint64>(pointer) & ~(pageSize - 1);
+        uint64 length   = reinterpret_cast<uint64>(pointer) + _size - begin;
+
+        madvise(reinterpret_cast<void*>(begin), length, hint == MapHint::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        if (hint == MapHint::Sequential)
+        {
+            madvise(reinterpret_cast<void*>(begin), length, MADV_WILLNEED);
+        }
+    }
+
+    return new CommonFileView(pointer, _size);
+}
   
 // You should not write into your app bundle, and instead use one of the following folders to store files, which can be obtained using NSSearchPathForDirectoriesInDomains:
 //
@@ -59,6 +85,8 @@ bool OSXFile::write(const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     return true;
 }
    
@@ -66,6 +94,8 @@ bool OSXFile::write(const uint64 offset, const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     return true;
 }
    
@@ -125,6 +155,8 @@ bool OSXFile::write(const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     handle->clear();
     handle->seekg(0, ios::beg);
     handle->write((char*)buffer, _size);
@@ -140,6 +172,8 @@ bool OSXFile::write(const uint64 offset, const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     handle->clear();
     handle->seekg(offset, ios::beg);
     handle->write((char*)buffer, _size);
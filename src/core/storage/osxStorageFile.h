@@ -39,6 +39,12 @@ namespace en
                           const uint64 size,
                           volatile void* buffer,
                           uint64* readBytes = nullptr); // Reads part of file
+
+#ifdef APPLE_WAY
+      virtual FileView* map(const uint64 offset,
+                            const uint64 size,
+                            const MapHint hint = MapHint::Sequential); // Returns view of already mapped file
+#endif
          
       virtual bool   write(const uint64 size,
                            void* buffer);            // Writes block of data to file
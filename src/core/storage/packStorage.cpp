@@ -0,0 +1,504 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Packed assets archive.
+ Requirements: none
+ Description : Serves files stored in mounted pack, and forwards requests
+               for remaining files to the OS storage it was mounted over.
+               Also implements offline packer, that searches for hash seed
+               and bucket displacements forming perfect hash table of
+               packed file names.
+
+*/
+
+#include "core/storage/packStorage.h"
+
+#include "assert.h"
+
+#include "core/algorithm/hash.h"
+#include "core/log/log.h"
+#include "utilities/utilities.h"     // nextPowerOfTwo, roundUp, powerOfTwo
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace en
+{
+namespace storage
+{
+
+constexpr uint32 PackSeedAttempts    = 64;        // Seeds tried by packer before giving up
+constexpr uint32 PackMaxDisplacement = 1u << 20;  // Displacements tried for single bucket
+constexpr uint32 PackBucketSize      = 4;         // Average count of files in bucket
+
+PackFile::PackFile(PackStorage* _storage, const PackEntry& entry, uint8* _content) :
+    storage(_storage),
+    base(entry.offset),
+    content(_content),
+    CommonFile()
+{
+    fileSize = entry.size;
+}
+
+PackFile::~PackFile()
+{
+    delete [] content;
+}
+
+bool PackFile::read(const uint64 offset, const uint64 size, volatile void* buffer, uint64* readBytes)
+{
+    assert( offset + size <= fileSize );
+
+    if (!content)
+    {
+        return storage->readPack(base + offset, size, buffer, readBytes);
+    }
+
+    memcpy((void*)(buffer), content + offset, static_cast<size_t>(size));
+    if (readBytes != nullptr)
+    {
+        *readBytes = size;
+    }
+
+    return true;
+}
+
+FileView* PackFile::map(const uint64 offset, const uint64 size, const MapHint hint)
+{
+    assert( offset + size <= fileSize );
+
+    // Inflated file is already in memory, so view just points at it
+    if (content)
+    {
+        return new CommonFileView(content + offset, size);
+    }
+
+    return storage->pack->map(base + offset, size, hint);
+}
+
+void PackFile::readAsync(const uint64 offset, const uint64 size, volatile void* buffer, TaskState* state, uint64* readBytes)
+{
+    assert( offset + size <= fileSize );
+
+    // Uncompressed payload is read from the pack directly (by io_uring where
+    // available). Remaining requests are served by I/O threads calling read().
+    if (!content && storage->positional)
+    {
+        storage->pack->readAsync(base + offset, size, buffer, state, readBytes);
+        return;
+    }
+
+    CommonFile::readAsync(offset, size, buffer, state, readBytes);
+}
+
+bool PackFile::write(const uint64 size, void* buffer)
+{
+    return false;
+}
+
+bool PackFile::write(const uint64 offset, const uint64 size, void* buffer)
+{
+    return false;
+}
+
+PackStorage::PackStorage(std::unique_ptr<Interface> _system,
+                         CommonFile* _pack,
+                         const PackHeader& _header,
+                         std::vector<uint32>&& _displacement,
+                         std::vector<PackEntry>&& _entry) :
+    CommonStorage(),
+    system(std::move(_system)),
+    pack(_pack),
+    positional(_pack->descriptor() >= 0),
+    header(_header),
+    displacement(std::move(_displacement)),
+    entry(std::move(_entry))
+{
+    processPath = static_cast<CommonStorage*>(system.get())->processPath;
+}
+
+PackStorage::~PackStorage()
+{
+    delete pack;
+}
+
+AsyncIO& PackStorage::asyncIO(void)
+{
+    return static_cast<CommonStorage*>(system.get())->asyncIO();
+}
+
+const PackEntry* PackStorage::find(const std::string& filename) const
+{
+    // Perfect hash, so only one slot can hold given file
+    uint64 id = hashString(filename, header.seed);
+    uint32 slot = packSlot(id, displacement[packBucket(id, header.buckets)], header.slots);
+    if (entry[slot].id != id)
+    {
+        return nullptr;
+    }
+
+    return &entry[slot];
+}
+
+bool PackStorage::readPack(const uint64 offset, const uint64 size, volatile void* buffer, uint64* readBytes)
+{
+    // Files that have no descriptor (stream based) cannot be read concurrently
+    if (positional)
+    {
+        return pack->read(offset, size, buffer, readBytes);
+    }
+
+    lock.lock();
+    bool result = pack->read(offset, size, buffer, readBytes);
+    lock.unlock();
+    return result;
+}
+
+bool PackStorage::exist(const std::string& filename)
+{
+    if (find(filename))
+    {
+        return true;
+    }
+
+    return system->exist(filename);
+}
+
+File* PackStorage::open(const std::string& filename, const FileAccess mode)
+{
+    // Files opened for writing are never served from the pack
+    const PackEntry* file = (mode == Read) ? find(filename) : nullptr;
+    if (!file)
+    {
+        return system->open(filename, mode);
+    }
+
+    if (file->offset + file->storedSize > header.size)
+    {
+        enLog << std::string("Pack entry of file " + filename + " is corrupted!");
+        return nullptr;
+    }
+
+    if (file->compression == PackCompression::None)
+    {
+        return new PackFile(this, *file);
+    }
+
+    if (file->compression != PackCompression::Deflate)
+    {
+        enLog << std::string("Unsupported compression of file " + filename + " in pack!");
+        return nullptr;
+    }
+
+    uint8* compressed = new uint8[file->storedSize > 0 ? file->storedSize : 1];
+    uint8* content    = new uint8[file->size > 0 ? file->size : 1];
+
+    uLongf inflatedSize = static_cast<uLongf>(file->size);
+    bool result = readPack(file->offset, file->storedSize, compressed) &&
+                  uncompress(content, &inflatedSize, compressed, static_cast<uLong>(file->storedSize)) == Z_OK &&
+                  inflatedSize == file->size;
+
+    delete [] compressed;
+    if (!result)
+    {
+        enLog << std::string("Error when inflating file " + filename + " from pack!");
+        delete [] content;
+        return nullptr;
+    }
+
+    return new PackFile(this, *file, content);
+}
+
+// Searches for displacement of each bucket, so that all files are assigned to
+// distinct slots. Buckets with most files are placed first, while the table
+// is still mostly empty. Returns false if some bucket couldn't be placed.
+static bool displace(const std::vector<uint64>& id,
+                     const uint32 slots,
+                     const uint32 buckets,
+                     std::vector<uint32>& displacement,
+                     std::vector<uint32>& slot)
+{
+    const uint32 files = static_cast<uint32>(id.size());
+
+    std::vector<std::vector<uint32>> bucket(buckets);
+    for(uint32 i=0; i<files; ++i)
+    {
+        bucket[packBucket(id[i], buckets)].push_back(i);
+    }
+
+    std::vector<uint32> order(buckets);
+    for(uint32 i=0; i<buckets; ++i)
+    {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&bucket](const uint32 a, const uint32 b)
+    {
+        return bucket[a].size() > bucket[b].size();
+    });
+
+    std::vector<bool>   used(slots, false);
+    std::vector<uint32> candidate;
+
+    displacement.assign(buckets, 0);
+    slot.assign(files, 0);
+    for(uint32 index : order)
+    {
+        const std::vector<uint32>& members = bucket[index];
+        if (members.empty())
+        {
+            break;
+        }
+
+        bool placed = false;
+        for(uint32 d=0; d<PackMaxDisplacement && !placed; ++d)
+        {
+            candidate.clear();
+            placed = true;
+            for(uint32 file : members)
+            {
+                uint32 target = packSlot(id[file], d, slots);
+                if (used[target] ||
+                    std::find(candidate.begin(), candidate.end(), target) != candidate.end())
+                {
+                    placed = false;
+                    break;
+                }
+
+                candidate.push_back(target);
+            }
+
+            if (placed)
+            {
+                displacement[index] = d;
+                for(uint32 i=0; i<members.size(); ++i)
+                {
+                    used[candidate[i]] = true;
+                    slot[members[i]]   = candidate[i];
+                }
+            }
+        }
+
+        if (!placed)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool createPack(const std::string& filename, const std::vector<PackInput>& files, const bool compress)
+{
+    assert( Storage );
+
+    const uint32 count = static_cast<uint32>(files.size());
+
+    // Names need to be unique, as no seed can separate them otherwise
+    std::vector<std::string> names;
+    names.reserve(count);
+    for(const PackInput& input : files)
+    {
+        names.push_back(input.name);
+    }
+
+    std::sort(names.begin(), names.end());
+    if (std::adjacent_find(names.begin(), names.end()) != names.end())
+    {
+        enLog << std::string("Pack " + filename + " has duplicated file names!");
+        return false;
+    }
+
+    // Table is kept below 80% load
+    PackHeader header;
+    memset(&header, 0, sizeof(PackHeader));
+    header.signature = PackSignature;
+    header.version   = PackVersion;
+    header.files     = count;
+    header.slots     = static_cast<uint32>(nextPowerOfTwo(std::max(count + count / 4, 1u)));
+    header.buckets   = std::max((count + PackBucketSize - 1) / PackBucketSize, 1u);
+
+    // Tweak seed until ID's are unique and displacements can be found
+    std::vector<uint64> id(count);
+    std::vector<uint64> sorted;
+    std::vector<uint32> displacement;
+    std::vector<uint32> slot;
+    bool found = false;
+    for(uint32 attempt=0; attempt<PackSeedAttempts && !found; ++attempt)
+    {
+        header.seed = PerfectHashSeed + attempt;
+        for(uint32 i=0; i<count; ++i)
+        {
+            id[i] = hashString(files[i].name, header.seed);
+        }
+
+        // ID equal to zero marks empty slot
+        sorted = id;
+        std::sort(sorted.begin(), sorted.end());
+        if ((count > 0 && sorted[0] == 0) ||
+            std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        {
+            continue;
+        }
+
+        found = displace(id, header.slots, header.buckets, displacement, slot);
+    }
+
+    if (!found)
+    {
+        enLog << std::string("Cannot find perfect hash for pack " + filename + "!");
+        return false;
+    }
+
+    File* pack = Storage->open(filename, Write);
+    if (!pack)
+    {
+        enLog << std::string("Cannot create pack " + filename + "!");
+        return false;
+    }
+
+    std::vector<PackEntry> entry(header.slots);
+    memset(&entry[0], 0, header.slots * sizeof(PackEntry));
+
+    // Space for header and table of contents is reserved, as they are
+    // written once location of all payloads is known. All writes specify
+    // offset, as not every platform appends sequential writes.
+    uint64 tableSize = sizeof(PackHeader) + header.buckets * sizeof(uint32) + header.slots * sizeof(PackEntry);
+    uint64 offset    = roundUp(tableSize, static_cast<uint64>(PackAlignment));
+
+    std::vector<uint8> padding(PackAlignment, 0);
+    bool result = true;
+    for(uint64 written=0; result && written<offset; written+=PackAlignment)
+    {
+        result = pack->write(written, PackAlignment, &padding[0]);
+    }
+
+    std::vector<uint8> content;
+    std::vector<uint8> compressed;
+    for(uint32 i=0; result && i<count; ++i)
+    {
+        File* file = Storage->open(files[i].path);
+        if (!file)
+        {
+            enLog << std::string("Cannot open file " + files[i].path + " to pack!");
+            result = false;
+            break;
+        }
+
+        uint64 size = file->size();
+        content.resize(static_cast<size_t>(size > 0 ? size : 1));
+        result = file->read(&content[0]);
+        delete file;
+        if (!result)
+        {
+            enLog << std::string("Error when reading file " + files[i].path + " to pack!");
+            break;
+        }
+
+        PackEntry& current = entry[slot[i]];
+        current.id          = id[i];
+        current.offset      = offset;
+        current.size        = size;
+        current.storedSize  = size;
+        current.compression = PackCompression::None;
+
+        uint8* payload = &content[0];
+
+        // Compressed file is stored only if it saves at least 10% of space
+        if (compress && size > 0)
+        {
+            uLongf compressedSize = compressBound(static_cast<uLong>(size));
+            compressed.resize(static_cast<size_t>(compressedSize));
+            if (compress2(&compressed[0], &compressedSize, &content[0], static_cast<uLong>(size), Z_BEST_COMPRESSION) == Z_OK &&
+                compressedSize * 10 < size * 9)
+            {
+                current.storedSize  = compressedSize;
+                current.compression = PackCompression::Deflate;
+                payload = &compressed[0];
+            }
+        }
+
+        if (current.storedSize > 0)
+        {
+            result = pack->write(offset, current.storedSize, payload);
+        }
+
+        // Each payload starts at page boundary, so it can be mapped
+        uint64 aligned = roundUp(offset + current.storedSize, static_cast<uint64>(PackAlignment));
+        if (result && aligned > offset + current.storedSize)
+        {
+            result = pack->write(offset + current.storedSize, aligned - (offset + current.storedSize), &padding[0]);
+        }
+
+        offset = aligned;
+    }
+
+    header.size = offset;
+    if (result)
+    {
+        result = pack->write(0, sizeof(PackHeader), &header) &&
+                 pack->write(sizeof(PackHeader), header.buckets * sizeof(uint32), &displacement[0]) &&
+                 pack->write(sizeof(PackHeader) + header.buckets * sizeof(uint32), header.slots * sizeof(PackEntry), &entry[0]);
+    }
+
+    delete pack;
+
+    if (!result)
+    {
+        enLog << std::string("Error when writing pack " + filename + "!");
+    }
+
+    return result;
+}
+
+bool mountPack(const std::string& filename)
+{
+    assert( Storage );
+
+    CommonFile* pack = reinterpret_cast<CommonFile*>(Storage->open(filename));
+    if (!pack)
+    {
+        enLog << std::string("Cannot open pack " + filename + "!");
+        return false;
+    }
+
+    PackHeader header;
+    bool result = pack->size() >= sizeof(PackHeader) &&
+                  pack->read(0, sizeof(PackHeader), &header) &&
+                  header.signature == PackSignature &&
+                  header.version   == PackVersion &&
+                  header.size      <= pack->size() &&
+                  header.slots     >= header.files &&
+                  header.slots     > 0 &&
+                  powerOfTwo(header.slots) &&
+                  header.buckets   > 0 &&
+                  sizeof(PackHeader) + header.buckets * sizeof(uint32) + header.slots * sizeof(PackEntry) <= header.size;
+
+    // Whole table of contents is kept in memory
+    std::vector<uint32>    displacement;
+    std::vector<PackEntry> entry;
+    if (result)
+    {
+        displacement.resize(header.buckets);
+        entry.resize(header.slots);
+        result = pack->read(sizeof(PackHeader), header.buckets * sizeof(uint32), &displacement[0]) &&
+                 pack->read(sizeof(PackHeader) + header.buckets * sizeof(uint32), header.slots * sizeof(PackEntry), &entry[0]);
+    }
+
+    if (!result)
+    {
+        enLog << std::string("File " + filename + " is not a valid pack!");
+        delete pack;
+        return false;
+    }
+
+    // Previous storage becomes fallback of the pack
+    Storage = std::make_unique<PackStorage>(std::move(Storage), pack, header, std::move(displacement), std::move(entry));
+    return true;
+}
+
+} // en::storage
+} // en
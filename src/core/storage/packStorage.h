@@ -0,0 +1,96 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Packed assets archive.
+ Requirements: none
+ Description : Serves files stored in mounted pack, and forwards requests
+               for remaining files to the OS storage it was mounted over.
+
+*/
+
+#ifndef ENG_CORE_STORAGE_PACK_STORAGE
+#define ENG_CORE_STORAGE_PACK_STORAGE
+
+#include "core/storage/pack.h"
+#include "core/storage/storage.h"
+#include "core/parallel/mutex.h"
+
+#include <vector>
+
+namespace en
+{
+namespace storage
+{
+
+class PackStorage;
+
+// File stored in pack. Uncompressed files are read directly from the pack
+// (including mapping and asynchronous reads), compressed ones are inflated
+// to memory when opened.
+class PackFile : public CommonFile
+{
+    public:
+    PackStorage* storage;
+    uint64       base;      // Location of payload in pack
+    uint8*       content;   // Inflated file (compressed files only)
+
+    virtual bool   read(const uint64 offset,
+                        const uint64 size,
+                        volatile void* buffer,
+                        uint64* readBytes = nullptr);
+
+    virtual FileView* map(const uint64 offset,
+                          const uint64 size,
+                          const MapHint hint = MapHint::Sequential);
+
+    virtual void   readAsync(const uint64 offset,
+                             const uint64 size,
+                             volatile void* buffer,
+                             TaskState* state,
+                             uint64* readBytes = nullptr);
+
+    // Files in pack are read-only
+    virtual bool   write(const uint64 size,
+                         void* buffer);
+    virtual bool   write(const uint64 offset,
+                         const uint64 size,
+                         void* buffer);
+
+    PackFile(PackStorage* storage, const PackEntry& entry, uint8* content = nullptr);
+    virtual ~PackFile();
+};
+
+class PackStorage : public CommonStorage
+{
+    public:
+    std::unique_ptr<Interface> system;   // Storage that pack was mounted over
+    CommonFile*            pack;         // Opened pack file
+    bool                   positional;   // Pack file supports concurrent reads
+    PackHeader             header;
+    std::vector<uint32>    displacement; // Displacement of each bucket
+    std::vector<PackEntry> entry;        // Table of contents (perfect hash table)
+    Mutex                  lock;         // Guards reads of pack file that doesn't support concurrent reads
+
+    const PackEntry* find(const std::string& filename) const; // Returns entry of file, or nullptr if it's not in pack
+    bool readPack(const uint64 offset, const uint64 size, volatile void* buffer, uint64* readBytes = nullptr);
+
+    virtual bool  exist(const std::string& filename);
+    virtual File* open(const std::string& filename,
+                       const FileAccess mode = Read);
+
+    // Shares asynchronous I/O of storage it's mounted over
+    virtual AsyncIO& asyncIO(void);
+
+    PackStorage(std::unique_ptr<Interface> system,
+                CommonFile* pack,
+                const PackHeader& header,
+                std::vector<uint32>&& displacement,
+                std::vector<PackEntry>&& entry);
+    virtual ~PackStorage();
+};
+
+} // en::storage
+} // en
+
+#endif
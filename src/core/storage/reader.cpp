@@ -0,0 +1,208 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Buffered file reader.
+ Requirements: none
+ Description : Reads file sequentially in large aligned blocks, refilled on
+               demand, so that text can be processed byte by byte or token
+               by token without calling into file for each byte. Tokens are
+               returned as views into the block, valid until next call.
+
+*/
+
+#include "core/storage/reader.h"
+
+#include "assert.h"
+
+#include "core/memory/alignedAllocator.h"
+#include "core/utilities/parser.h"   // isWhitespace, isEol, isNull
+
+#include <algorithm>
+#include <string.h>
+
+namespace en
+{
+namespace storage
+{
+
+Reader::Reader(File* _file, const uint32 _capacity) :
+    file(_file),
+    block(nullptr),
+    capacity(_capacity),
+    blockSize(0),
+    position(0),
+    blockOffset(0)
+{
+    assert( file );
+    assert( capacity >= ReaderBlockAlignment );
+
+    block = allocate<uint8>(capacity, ReaderBlockAlignment);
+}
+
+Reader::~Reader()
+{
+    deallocate<uint8>(block);
+}
+
+uint64 Reader::offset(void) const
+{
+    return blockOffset + position;
+}
+
+void Reader::seek(const uint64 offset)
+{
+    // Location inside buffered block doesn't need any reads
+    if (blockSize > 0 &&
+        offset >= blockOffset &&
+        offset <= blockOffset + blockSize)
+    {
+        position = static_cast<uint32>(offset - blockOffset);
+        return;
+    }
+
+    // Otherwise new block will be read from aligned location on first access
+    blockOffset = offset - (offset % ReaderBlockAlignment);
+    blockSize   = 0;
+    position    = static_cast<uint32>(offset - blockOffset);
+}
+
+bool Reader::end(void)
+{
+    if (position < blockSize)
+    {
+        return false;
+    }
+
+    return !refill();
+}
+
+uint32 Reader::blockCapacity(void) const
+{
+    return capacity;
+}
+
+void Reader::invalidate(void)
+{
+    // Current location is kept, block is read again on next access
+    blockSize = 0;
+}
+
+bool Reader::refill(void)
+{
+    uint64 fileSize = file->size();
+
+    if (blockSize > 0)
+    {
+        if (blockOffset + blockSize >= fileSize)
+        {
+            return false;
+        }
+
+        // Bytes that were not consumed yet are moved to the front of block,
+        // so that token that started in it can continue.
+        uint32 kept = blockSize - position;
+        if (kept == capacity)
+        {
+            return false;
+        }
+
+        memmove(block, block + position, kept);
+        blockOffset += position;
+        blockSize    = kept;
+        position     = 0;
+    }
+
+    if (blockOffset + blockSize >= fileSize)
+    {
+        return false;
+    }
+
+    uint64 size      = std::min(static_cast<uint64>(capacity - blockSize), fileSize - (blockOffset + blockSize));
+    uint64 readBytes = 0;
+    file->read(blockOffset + blockSize, size, block + blockSize, &readBytes);
+    blockSize += static_cast<uint32>(readBytes);
+
+    return (readBytes > 0) && (position < blockSize);
+}
+
+bool Reader::read(uint8& character)
+{
+    if (position >= blockSize && !refill())
+    {
+        return false;
+    }
+
+    character = block[position];
+    position++;
+    return true;
+}
+
+uint64 Reader::read(void* buffer, const uint64 size)
+{
+    uint8* destination = reinterpret_cast<uint8*>(buffer);
+    uint64 copied      = 0;
+    while(copied < size)
+    {
+        if (position >= blockSize && !refill())
+        {
+            break;
+        }
+
+        uint64 part = std::min(static_cast<uint64>(blockSize - position), size - copied);
+        memcpy(destination + copied, block + position, static_cast<size_t>(part));
+        position += static_cast<uint32>(part);
+        copied   += part;
+    }
+
+    return copied;
+}
+
+std::string_view Reader::token(Delimiter delimiter, const uint32 maxSize)
+{
+    assert( delimiter );
+
+    uint32 limit  = std::min(maxSize, capacity);
+    uint32 length = 0;
+    bool   found  = false;
+    while(!found && length < limit)
+    {
+        // Token continues past the end of block
+        if (position + length >= blockSize && !refill())
+        {
+            break;
+        }
+
+        uint32 available = std::min(limit, blockSize - position);
+        for(; length<available; ++length)
+        {
+            if (delimiter(block[position + length]))
+            {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    std::string_view result(reinterpret_cast<const char*>(block + position), length);
+    position += length;
+    return result;
+}
+
+std::string_view Reader::string(const uint32 maxSize)
+{
+    return token(isNull, maxSize);
+}
+
+std::string_view Reader::word(const uint32 maxSize)
+{
+    return token(isWhitespace, maxSize);
+}
+
+std::string_view Reader::line(const uint32 maxSize)
+{
+    return token(isEol, maxSize);
+}
+
+} // en::storage
+} // en
@@ -14,10 +14,13 @@
 
 #include "core/log/log.h"
 
-#include "core/utilities/parser.h"   // isWhitespace, isEol
+#include "core/utilities/parser.h"   // isWhitespace, isEol, isNull
 #include "utilities/strings.h"
 
+#include <algorithm>
+
 #include "core/storage/andStorage.h"
+#include "core/storage/lnxStorage.h"
 #include "core/storage/osxStorage.h"
 #include "core/storage/winStorage.h"
 namespace en
@@ -25,8 +28,32 @@ namespace en
 namespace storage
 {
 
+CommonFileView::CommonFileView(const uint8* _pointer, const uint64 _length, uint8* _copy) :
+    pointer(_pointer),
+    length(_length),
+    copy(_copy),
+    FileView()
+{
+}
+
+CommonFileView::~CommonFileView()
+{
+    delete [] copy;
+}
+
+const uint8* CommonFileView::data(void) const
+{
+    return pointer;
+}
+
+uint64 CommonFileView::size(void) const
+{
+    return length;
+}
+
 CommonFile::CommonFile() :
     fileSize(0u),
+    reader(nullptr),
     File()
 {
 }
@@ -49,90 +76,106 @@ bool CommonFile::read(const uint64 offset, const uint64 size, volatile void* buf
     return false;
 }
    
-// This is super inefficient! Neet to remove it and replace with parser!
-uint32 CommonFile::read(const uint64 offset, const uint32 maxSize, std::string& word)
+// Reads token starting at given location, using buffered reader of this file.
+// Tokens longer than reader block are read in parts. Reader is shared by all
+// callers, so only one of them at a time can use it.
+static uint32 readToken(CommonFile& file, const uint64 offset, const uint32 maxSize, std::string& text, Delimiter delimiter)
 {
-    word.clear();
-    uint64 fileOffset = offset;
-    uint32 counter=0;
-    uint8 letter;
-    for(; counter<maxSize; ++counter)
+    file.readerLock.lock();
+
+    Reader& reader = file.buffered();
+
+    text.clear();
+    reader.seek(offset);
+    while(text.size() < maxSize)
     {
-        if (!read(fileOffset, 1, &letter))
-        {
-            return counter;
-        }
+        uint32 remaining = maxSize - static_cast<uint32>(text.size());
+        std::string_view part = reader.token(delimiter, remaining);
+        text.append(part.data(), part.size());
 
-        if (!letter)
+        // Token ended before its length limit (at delimiter or end of file)
+        if (part.size() < std::min(remaining, reader.blockCapacity()))
         {
-            return counter;
+            break;
         }
-
-        fileOffset++;
-        word.push_back(letter);
     }
 
-    return counter;
+    file.readerLock.unlock();
+    return static_cast<uint32>(text.size());
 }
 
-// This is super inefficient! Neet to remove it and replace with parser!
-uint32 CommonFile::readWord(const uint64 offset, const uint32 maxSize, std::string& word)
+Reader& CommonFile::buffered(void)
 {
-    word.clear();
-    uint64 fileOffset = offset;
-    uint32 counter=0;
-    uint8 letter;
-    for(; counter<maxSize; ++counter)
+    // Created on first use, as most files are read in whole
+    if (!reader)
     {
-        if (!read(fileOffset, 1, &letter))
-        {
-            return counter;
-        }
+        reader = std::make_unique<Reader>(this);
+    }
 
-        if (isWhitespace(letter))
-        {
-            return counter;
-        }
+    return *reader;
+}
 
-        fileOffset++;
-        word.push_back(letter);
+void CommonFile::invalidateReader(void)
+{
+    readerLock.lock();
+    if (reader)
+    {
+        reader->invalidate();
     }
+    readerLock.unlock();
+}
+
+uint32 CommonFile::read(const uint64 offset, const uint32 maxSize, std::string& word)
+{
+    return readToken(*this, offset, maxSize, word, isNull);
+}
 
-    return counter;
+uint32 CommonFile::readWord(const uint64 offset, const uint32 maxSize, std::string& word)
+{
+    return readToken(*this, offset, maxSize, word, isWhitespace);
 }
 
-// This is super inefficient! Neet to remove it and replace with parser!
 uint32 CommonFile::readLine(const uint64 offset, const uint32 maxSize, std::string& line)
 {
-    line.clear();
-    uint64 fileOffset = offset;
-    uint32 counter=0;
-    uint8 letter;
-    for(; counter<maxSize; ++counter)
-    {
-        if (!read(fileOffset, 1, &letter))
-        {
-            return counter;
-        }
+    return readToken(*this, offset, maxSize, line, isEol);
+}
 
-        if (isEol(letter))
-        {
-            return counter;
-        }
 
-        fileOffset++;
-        line.push_back(letter);
-    }
 
-    return counter;
-}
 
 
 
+FileView* CommonFile::map(const uint64 offset, const uint64 size, const MapHint hint)
+{
+    assert( offset + size <= fileSize );
 
+    uint8* buffer = new uint8[size > 0 ? size : 1];
+    if (!read(offset, size, buffer))
+    {
+        delete [] buffer;
+        return nullptr;
+    }
+
+    return new CommonFileView(buffer, size, buffer);
+}
+
+void CommonFile::readAsync(const uint64 offset, const uint64 size, volatile void* buffer, TaskState* state, uint64* readBytes)
+{
+    assert( Storage );
+    assert( state );
+    assert( offset + size <= fileSize );
+
+    CommonStorage* storage = static_cast<CommonStorage*>(Storage.get());
+    storage->asyncIO().read(this, offset, size, buffer, state, readBytes);
+}
 
+sint32 CommonFile::descriptor(void)
+{
+    return -1;
+}
 
 CommonStorage::CommonStorage() :
+    async(nullptr),
     Interface()
 {
     processPath.clear();
@@ -140,6 +183,28 @@ CommonStorage::CommonStorage() :
 
 CommonStorage::~CommonStorage()
 {
+    delete std::atomic_load_explicit(&async, std::memory_order_acquire);
+}
+
+AsyncIO& CommonStorage::asyncIO(void)
+{
+    AsyncIO* current = std::atomic_load_explicit(&async, std::memory_order_acquire);
+    if (current)
+    {
+        return *current;
+    }
+
+    // First asynchronous reads may be issued by several threads at once
+    asyncLock.lock();
+    current = std::atomic_load_explicit(&async, std::memory_order_relaxed);
+    if (!current)
+    {
+        current = new AsyncIO();
+        std::atomic_store_explicit(&async, current, std::memory_order_release);
+    }
+    asyncLock.unlock();
+
+    return *current;
 }
 
 uint64 CommonStorage::read(const std::string& filename, std::string& dst)
@@ -160,25 +225,30 @@ uint64 CommonStorage::read(const std::string& filename, std::string& dst)
         return 0;
     }
 
-    // Creating destination buffer and reading file
-    uint8* buffer = new uint8[sizeToRead+1];
-    uint64 readSize;
-    if (!file->read(0u, sizeToRead, buffer, &readSize))
+    // File content is copied to string directly from mapped view
+    FileView* view = file->map(0u, sizeToRead, MapHint::Sequential);
+    if (!view)
     {
-        enLog << std::string("Error when reading file, read " + stringFrom(readSize) + " from " + stringFrom(sizeToRead) + " bytes!");
+        enLog << std::string("Error when reading file " + filename + "!");
         dst.clear();
         delete file;
         return 0;
     }
+
+    // String ends at first null character, as it did when it was read
+    const char* text   = reinterpret_cast<const char*>(view->data());
+    uint64      length = 0;
+    while(length < sizeToRead && text[length] != 0)
+    {
+        length++;
+    }
+
+    dst.assign(text, static_cast<size_t>(length));
+    delete view;
     delete file;
 
-    // Converts file content to string
-    buffer[readSize] = 0;
-    dst = std::string((const char *)buffer);
-    delete [] buffer;
-   
     // Return results
-    return readSize+1;
+    return sizeToRead+1;
 }
    
 // This static function should be in .mm file if we include iOS/OSX headers !!!
@@ -189,6 +259,9 @@ bool Interface::create(void)
 #if defined(EN_PLATFORM_ANDROID)
     Storage = std::make_unique<AndInterface>();
 #endif
+#if defined(EN_PLATFORM_LINUX)
+    Storage = std::make_unique<LinuxInterface>();
+#endif
 #if defined(EN_PLATFORM_IOS) || defined(EN_PLATFORM_OSX)
     Storage = std::make_unique<OSXInterface>();
 #endif
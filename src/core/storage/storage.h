@@ -14,16 +14,38 @@
 #define ENG_CORE_STORAGE_COMMON
 
 #include "core/storage.h"
+#include "core/parallel/mutex.h"
+#include "core/storage/asyncIO.h"
+#include "core/storage/reader.h"
 
 namespace en
 {
 namespace storage
 {
 
+class CommonFileView : public FileView
+{
+    public:
+    const uint8* pointer;
+    uint64       length;
+    uint8*       copy;     // Owned copy of file range (if file couldn't be mapped)
+
+    virtual const uint8* data(void) const;
+    virtual uint64       size(void) const;
+
+    CommonFileView(const uint8* pointer, const uint64 length, uint8* copy = nullptr);
+    virtual ~CommonFileView();
+};
+
 class CommonFile : public File
 {
     public:
     uint64 fileSize;
+    std::unique_ptr<Reader> reader; // Buffers reads of words and lines
+    Mutex readerLock;               // Reader is used by one thread at a time
+
+    Reader& buffered(void);         // Returns buffered reader of this file (called with readerLock taken)
+    void invalidateReader(void);    // Discards block buffered by reader (needs to be called on each write)
 
     virtual uint64 size(void);                     // File size in bytes
     virtual bool   read(volatile void* buffer);    // Reads whole file to specified buffer
@@ -34,7 +56,25 @@ class CommonFile : public File
                         volatile void* buffer,
                         uint64* readBytes = nullptr); // Reads part of file
 
-    // TODO: Temp, file should be read in blocks to memory, and then parsed!
+    // By default, file range is read to owned copy. Should be specialized
+    // by classes that can map files to memory.
+    virtual FileView* map(const uint64 offset,
+                          const uint64 size,
+                          const MapHint hint = MapHint::Sequential);
+
+    virtual void   readAsync(const uint64 offset,
+                             const uint64 size,
+                             volatile void* buffer,
+                             TaskState* state,
+                             uint64* readBytes = nullptr); // Issues asynchronous read of part of file
+
+    // Native file descriptor that can be read by io_uring (POSIX backends).
+    // Returns -1 if file can be only read through read() by I/O threads.
+    virtual sint32 descriptor(void);
+
+    // Served from block buffered by reader, so consecutive calls don't touch
+    // the file until they reach end of block. Block is read again after file
+    // is written to. Reader is shared, so concurrent calls are serialized.
     virtual uint32 read(const uint64 offset,
                         const uint32 maxSize,
                         std::string& word);         // Read zero terminated word, but not exceed maxSize chars. Return word length.
@@ -53,9 +93,16 @@ class CommonStorage : public Interface
 {
     public:
     std::string processPath;     // Global path to this process
+    std::atomic<AsyncIO*> async; // Executes asynchronous read requests (created on first one)
+    Mutex asyncLock;             // Serializes creation of asynchronous I/O
 
     virtual uint64 read(const std::string& filename, std::string& dst);
 
+    // Returns asynchronous I/O of this storage. I/O threads and io_uring are
+    // created on first call, so applications that don't issue asynchronous
+    // reads don't pay for them.
+    virtual AsyncIO& asyncIO(void);
+
     CommonStorage();
     virtual ~CommonStorage();
 };
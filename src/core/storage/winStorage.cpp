@@ -18,15 +18,64 @@
 #include <fstream>
 
 #include <assert.h>
+#include <windows.h>
 
 namespace en
 {
 namespace storage
 {
 
+WinFileView::WinFileView(void* _base, const uint8* _pointer, const uint64 _length) :
+    base(_base),
+    CommonFileView(_pointer, _length)
+{
+}
+
+WinFileView::~WinFileView()
+{
+    UnmapViewOfFile(base);
+}
+
+// Maps part of file using given handle, view keeps file mapping alive
+static FileView* mapFile(HANDLE file, const uint64 offset, const uint64 size, const MapHint hint)
+{
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        return nullptr;
+    }
+
+    // View needs to start at allocation granularity boundary
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uint64 granularity = info.dwAllocationGranularity;
+    uint64 begin       = offset - (offset % granularity);
+    uint64 length      = (offset - begin) + size;
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(begin >> 32), static_cast<DWORD>(begin), static_cast<SIZE_T>(length));
+    CloseHandle(mapping);
+    if (!base)
+    {
+        return nullptr;
+    }
+
+    // Range that will be read soon is loaded to memory in few large I/O
+    // requests, instead of one page fault at a time.
+    if (hint == MapHint::Sequential)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = base;
+        range.NumberOfBytes  = static_cast<SIZE_T>(length);
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    return new WinFileView(base, reinterpret_cast<const uint8*>(base) + (offset - begin), size);
+}
+
 #if UseFStreamOverWinAPI
-WinFile::WinFile(std::fstream* _handle) :
+WinFile::WinFile(std::fstream* _handle, const std::string& _path) :
     handle(_handle),
+    path(_path),
     CommonFile()
 {
     assert( handle );
@@ -69,6 +118,34 @@ bool WinFile::read(const uint64 offset, const uint64 _size, volatile void* buffe
     return true;
 }
 
+FileView* WinFile::map(const uint64 offset, const uint64 _size, const MapHint hint)
+{
+    assert( handle );
+    assert( offset + _size <= fileSize );
+
+    // Empty views are not allowed
+    if (_size == 0)
+    {
+        return new CommonFileView(nullptr, 0);
+    }
+
+    HANDLE file = CreateFileA(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              hint == MapHint::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    FileView* view = mapFile(file, offset, _size, hint);
+    CloseHandle(file);
+    return view;
+}
+
 // You should not write into your app bundle, and instead
 // use one of the specific folders to store files.
 
@@ -76,6 +153,8 @@ bool WinFile::write(const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     handle->clear();
     handle->seekg(0, std::ios::beg);
     handle->write((char*)buffer, _size);
@@ -91,6 +170,8 @@ bool WinFile::write(const uint64 offset, const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     handle->clear();
     handle->seekg(offset, std::ios::beg);
     handle->write((char*)buffer, _size);
@@ -150,7 +231,7 @@ File* WinInterface::open(const std::string& filename, const FileAccess mode)
 
     if (handle->good())
     {
-        result = new WinFile(handle);
+        result = new WinFile(handle, filename);
     }
     else
     {
@@ -191,6 +272,20 @@ bool WinFile::read(const uint64 offset, const uint64 _size, void* buffer, uint64
     return ReadFile(handle, buffer, static_cast<DWORD>(_size), reinterpret_cast<LPDWORD>(readBytes), &desc);
 }
 
+FileView* WinFile::map(const uint64 offset, const uint64 _size, const MapHint hint)
+{
+    assert( handle );
+    assert( offset + _size <= fileSize );
+
+    // Empty views are not allowed
+    if (_size == 0)
+    {
+        return new CommonFileView(nullptr, 0);
+    }
+
+    return mapFile(handle, offset, _size, hint);
+}
+
 // You should not write into your app bundle, and instead
 // use one of the specific folders to store files.
 
@@ -198,6 +293,8 @@ bool WinFile::write(const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     DWORD writtenBytes = 0;
     return WriteFile(handle, buffer, static_cast<DWORD>(_size), &writtenBytes, nullptr);
 }
@@ -206,6 +303,8 @@ bool WinFile::write(const uint64 offset, const uint64 _size, void* buffer)
 {
     assert( handle );
 
+    invalidateReader();
+
     OVERLAPPED desc;
     desc.Offset     = static_cast<DWORD>(offset);
     desc.OffsetHigh = static_cast<DWORD>(offset >> 32);
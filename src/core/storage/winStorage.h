@@ -24,11 +24,23 @@ namespace en
 namespace storage
 {
 
+class WinFileView : public CommonFileView
+{
+    public:
+    void* base;         // Start of mapped view (aligned to allocation granularity)
+
+    WinFileView(void* base,
+                const uint8* pointer,
+                const uint64 length);
+    virtual ~WinFileView();
+};
+
 class WinFile : public CommonFile
 {
     public:
 #if UseFStreamOverWinAPI
     std::fstream* handle;
+    std::string   path;  // Stream doesn't expose native handle, file is reopened for mapping
 #else
     HANDLE handle;
 #endif
@@ -38,6 +50,10 @@ class WinFile : public CommonFile
                       volatile void* buffer,
                       uint64* readBytes = nullptr); // Reads part of file
 
+    virtual FileView* map(const uint64 offset,
+                          const uint64 size,
+                          const MapHint hint = MapHint::Sequential); // Maps part of file to memory
+
     virtual bool write(const uint64 size,
                        void* buffer);            // Writes block of data to file
     virtual bool write(const uint64 offset,
@@ -45,7 +61,7 @@ class WinFile : public CommonFile
                        void* buffer);            // Writes to file at specified location
 
 #if UseFStreamOverWinAPI
-    WinFile(std::fstream* handle);
+    WinFile(std::fstream* handle, const std::string& path);
 #else
     WinFile(HANDLE handle);
 #endif
@@ -14,6 +14,8 @@
 #include "core/utilities/parser.h"
 
 #include <cassert>
+#include <math.h>
+#include <string.h>
 
 namespace en
 {
@@ -46,83 +48,83 @@ bool Parser::position(uint64 newOffset)
 
 bool Parser::read(std::string& word, bool& eol)
 {
+    std::string_view view;
+    bool found = read(view, eol);
+    word.assign(view.data(), view.size());
+    return found;
+}
+
+bool Parser::readLine(std::string& line)
+{
+    std::string_view view;
+    bool found = readLine(view);
+    line.assign(view.data(), view.size());
+    return found;
+}
+
+bool Parser::read(std::string_view& word, bool& eol)
+{
+    // Clean passed parameters
+    word = std::string_view();
+    eol  = false;
+
     // Check if offset is in range
     if (offset >= size)
     {
         return false;
     }
 
-    // Clean passed parameters
-    word.erase();
-    eol = false;
+    // Skip separators preceding the word, but stop at EOL
+    while(offset < size && !isCharacter(buffer[offset]) && !isEol(buffer[offset]))
+    {
+        offset++;
+    }
 
-    // Try to extract first word from given location
-    uint8 byte = 0;
-    bool found = false;
-    for(;;)
+    uint64 begin = offset;
+    while(offset < size && isCharacter(buffer[offset]))
     {
-        byte = buffer[offset++];
+        offset++;
+    }
 
-        if (isCharacter(byte))
-        {
-            word.push_back(byte);
-            found = true;
-        }
-        else
-        if (isEol(byte))
-        {
-            eol = true;
-            break;
-        }
-        else
-        if (found)
-        {
-            // If current byte is neither character nor EOL, but word 
-            // parsing already started, this indicates end of word.
-            break;
-        }
+    word = std::string_view(reinterpret_cast<const char*>(buffer + begin), static_cast<size_t>(offset - begin));
 
-        if (offset >= size)
-        {
-            break;
-        }
+    // Byte terminating the word is consumed
+    if (offset < size)
+    {
+        eol = isEol(buffer[offset]);
+        offset++;
     }
 
-    return found;
+    return !word.empty();
 }
 
-bool Parser::readLine(std::string& line)
+bool Parser::readLine(std::string_view& line)
 {
+    // Clean passed parameters
+    line = std::string_view();
+
     // Check if offset is in range
     if (offset >= size)
     {
         return false;
     }
 
-    // Clean passed parameters
-    line.erase();
-
-    // Try to extract first line from given location
-    uint8 byte = 0;
+    uint64 begin = offset;
     bool found = false;
-    for(;;)
+    for(; offset < size && !isEol(buffer[offset]); ++offset)
     {
-        byte = buffer[offset++];
-        if (isEol(byte))
-        {
-            break;
-        }
-
-        if (isCharacter(byte))
+        if (isCharacter(buffer[offset]))
         {
             found = true;
         }
+    }
 
-        line.push_back(byte);
-        if (offset >= size)
-        {
-            break;
-        }
+    line = std::string_view(reinterpret_cast<const char*>(buffer + begin), static_cast<size_t>(offset - begin));
+
+    // EOL is consumed
+    if (offset < size)
+    {
+        offset++;
     }
 
     return found;
@@ -136,9 +138,10 @@ bool Parser::skipToNextLine(void)
         return false;
     }
 
-    bool found = false;
+    // If previous read consumed EOL, offset is already in next line
+    bool found = (offset > 0) && isEol(buffer[offset - 1]);
     uint8 byte = 0;
-    for(;;)
+    for(; offset < size; ++offset)
     {
         byte = buffer[offset];
 
@@ -159,8 +162,6 @@ bool Parser::skipToNextLine(void)
                 break;
             }
         }
-
-        offset++;
     }
 
     return true;
@@ -209,6 +210,11 @@ bool isEol(uint8 input)
     return false;
 }
 
+bool isNull(uint8 input)
+{
+    return input == 0;
+}
+
 bool isInteger(const char* text, const uint32 length)
 {
     // Integer notation:
@@ -373,4 +379,238 @@ bool isFloat(const char* text, const uint32 length)
     return false;
 }
 
+// Returns true if all eight characters are decimal digits
+static inline bool eightDigits(const uint64 chunk)
+{
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+// Converts eight decimal digits to their value at once (SWAR). Characters
+// are loaded in memory order, so this requires Little-Endian CPU.
+static inline uint32 parseEightDigits(uint64 chunk)
+{
+    chunk -= 0x3030303030303030ULL;
+    chunk  = (chunk * 10) + (chunk >> 8);
+    chunk  = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+              (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return static_cast<uint32>(chunk);
+}
+
+// Appends decimal digits to mantissa, until it holds 19 significant digits
+// (max that always fits in 64 bits). Returns count of appended digits.
+static uint32 appendDigits(const char*& cursor, const char* end, uint64& mantissa, uint32& digits)
+{
+    uint32 appended = 0;
+    while(end - cursor >= 8 && digits + 8 <= 19)
+    {
+        uint64 chunk;
+        memcpy(&chunk, cursor, 8);
+        if (!eightDigits(chunk))
+        {
+            break;
+        }
+
+        mantissa  = mantissa * 100000000ULL + parseEightDigits(chunk);
+        cursor   += 8;
+        digits   += 8;
+        appended += 8;
+    }
+
+    for(; cursor < end && isCypher(*cursor) && digits < 19; ++cursor)
+    {
+        mantissa = mantissa * 10 + static_cast<uint64>(*cursor - '0');
+        digits++;
+        appended++;
+    }
+
+    return appended;
+}
+
+// Skips decimal digits, returns their count
+static uint32 skipDigits(const char*& cursor, const char* end)
+{
+    uint32 skipped = 0;
+    for(; cursor < end && isCypher(*cursor); ++cursor)
+    {
+        skipped++;
+    }
+
+    return skipped;
+}
+
+// Parses optional sign, returns true if it's negative
+static bool parseSign(const char*& cursor, const char* end)
+{
+    if (cursor < end && (*cursor == '-' || *cursor == '+'))
+    {
+        return *(cursor++) == '-';
+    }
+
+    return false;
+}
+
+static const char* parseInteger(const char* text, const char* end, uint64& value, bool& negative, const bool allowSign)
+{
+    const char* cursor = text;
+    negative = allowSign ? parseSign(cursor, end) : false;
+
+    value = 0;
+    const char* digits = cursor;
+    for(; cursor < end && isCypher(*cursor); ++cursor)
+    {
+        value = value * 10 + static_cast<uint64>(*cursor - '0');
+    }
+
+    // Sign without digits is not a number
+    if (cursor == digits)
+    {
+        value    = 0;
+        negative = false;
+        return text;
+    }
+
+    return cursor;
+}
+
+const char* parseNumber(const char* text, const char* end, uint32& value)
+{
+    uint64 result;
+    bool   negative;
+    const char* cursor = parseInteger(text, end, result, negative, false);
+    value = static_cast<uint32>(result);
+    return cursor;
+}
+
+const char* parseNumber(const char* text, const char* end, uint64& value)
+{
+    bool negative;
+    return parseInteger(text, end, value, negative, false);
+}
+
+const char* parseNumber(const char* text, const char* end, sint32& value)
+{
+    uint64 result;
+    bool   negative;
+    const char* cursor = parseInteger(text, end, result, negative, true);
+    value = negative ? -static_cast<sint32>(result) : static_cast<sint32>(result);
+    return cursor;
+}
+
+const char* parseNumber(const char* text, const char* end, sint64& value)
+{
+    uint64 result;
+    bool   negative;
+    const char* cursor = parseInteger(text, end, result, negative, true);
+    value = negative ? -static_cast<sint64>(result) : static_cast<sint64>(result);
+    return cursor;
+}
+
+const char* parseNumber(const char* text, const char* end, double& value)
+{
+    // Powers of ten that are exactly representable in double
+    static const double power[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    // Floating point notation:
+    //
+    // [-/+][cccc][.cccc][e/E[-/+]cccc]
+    //
+    const char* cursor = text;
+    bool negative = parseSign(cursor, end);
+
+    // Leading zeros are not significant digits
+    const char* begin = cursor;
+    while(cursor < end && *cursor == '0')
+    {
+        cursor++;
+    }
+
+    // Integer part (digits past precision of mantissa only scale it)
+    uint64 mantissa = 0;
+    uint32 digits   = 0;
+    sint32 exponent = 0;
+    appendDigits(cursor, end, mantissa, digits);
+    exponent += static_cast<sint32>(skipDigits(cursor, end));
+    bool number = (cursor > begin);
+
+    // Fractional part
+    if (cursor < end && *cursor == '.')
+    {
+        const char* fraction = ++cursor;
+        if (mantissa == 0)
+        {
+            while(cursor < end && *cursor == '0')
+            {
+                cursor++;
+                exponent--;
+            }
+        }
+
+        exponent -= static_cast<sint32>(appendDigits(cursor, end, mantissa, digits));
+        skipDigits(cursor, end);
+        number |= (cursor > fraction);
+    }
+
+    if (!number)
+    {
+        value = 0.0;
+        return text;
+    }
+
+    // Optional exponent (ignored if there are no digits after it)
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+    {
+        const char* marker = cursor++;
+        bool negativeExponent = parseSign(cursor, end);
+        if (cursor < end && isCypher(*cursor))
+        {
+            sint32 scale = 0;
+            for(; cursor < end && isCypher(*cursor); ++cursor)
+            {
+                if (scale < 100000)
+                {
+                    scale = scale * 10 + (*cursor - '0');
+                }
+            }
+
+            exponent += negativeExponent ? -scale : scale;
+        }
+        else
+        {
+            cursor = marker;
+        }
+    }
+
+    // Mantissa with up to 15 digits and small exponent are both exact in
+    // double, so single multiplication or division rounds correctly.
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0)
+    {
+        uint32 scale = static_cast<uint32>(exponent < 0 ? -exponent : exponent);
+
+        // Factor itself would overflow for the smallest numbers
+        if (exponent < -300)
+        {
+            result /= 1e300;
+            scale  -= 300;
+        }
+
+        double factor = (scale <= 22) ? power[scale] : pow(10.0, static_cast<double>(scale));
+        result = (exponent < 0) ? result / factor : result * factor;
+    }
+
+    value = negative ? -result : result;
+    return cursor;
+}
+
+const char* parseNumber(const char* text, const char* end, float& value)
+{
+    double result;
+    const char* cursor = parseNumber(text, end, result);
+    value = static_cast<float>(result);
+    return cursor;
+}
+
 } // en
@@ -404,8 +404,8 @@ void CommonInput::forwardEvent(Event* event)
 {
     if (task[event->type])
     {
-        // Spawn task to handle this event
-        Scheduler->run(task[event->type], (void*)event);
+        // Spawn task to handle this event (input is latency critical)
+        Scheduler->run(task[event->type], (void*)event, nullptr, false, TaskPriority::High);
     }
     else
     {
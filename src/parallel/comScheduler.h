@@ -15,87 +15,56 @@
 
 #include "core/parallel/thread.h"
 #include "core/parallel/fiber.h"
-#include "core/parallel/mutex.h" // temp for MPSC. Also used by TaskScheduler
+#include "core/parallel/mutex.h"
 
 #include "core/utilities/poolAllocator.h"
 #include "core/memory/alignedAllocator.h"
 #include "memory/circularQueue.h"
 #include "memory/workStealingDeque.h"
+#include "memory/mpscQueue.h"
+#include "memory/concurrentPoolAllocator.h"
+#include "parallel/profiler.h"
 
-namespace en
-{
-
-// TEMP Implementation !!!! DIRTY SHIT FIXME!!!
-template<typename T>
-class MPSCDeque
-{
-    private:
-    Mutex                lockPush;  // Ensures producers won't collide, this is low frequency container so we don't care for now
-    WorkStealingDeque<T> container; // Will be used in reverse order so that consumer steals wihout locking
+#include <vector>
 
-    public:
-    // First element starting address is always aligned to page size (4KB).
-    // When deque is growing, it's size is doubling until reaching doubleSizeUntil
-    // size in bytes. After that, it always grows by that size, until reaching
-    // maxCapacity.
-    MPSCDeque(const uint32 capacity,                               // In entries
-              const uint32 maxCapacity,                            // In entries
-              const uint32 doubleSizeUntil = PoolDoublingBarrier); // In bytes
-
-    DequeResult take(T& value);   // Called only by consumer thread
-    void        push(T value);    // Called by producer threads
-};
-
-// CompileTimeSizeReporting( MPSCDeque<void*> );
-static_assert(sizeof(MPSCDeque<void*>) == 56, "en::MPSCDeque<void*> size mismatch!");
-
-template<typename T>
-MPSCDeque<T>::MPSCDeque(const uint32 capacity,                     // In entries
-                        const uint32 maxCapacity,                  // In entries
-                        const uint32 doubleSizeUntil) :
-    lockPush(),
-    container(capacity, maxCapacity, doubleSizeUntil)
-{
-}
-
-template<typename T>
-void MPSCDeque<T>::push(T value)
-{
-    // Pushing elements to deque by multiple producers is guarded with mutex
-    // critical section. Thats fine because threads pushing tasks will be IO
-    // threads so they can be stalled for a moment in case of concurrent access.
-    // It's more important that Worker thread consuming those elements won't ever
-    // block.
-    lockPush.lock();
-    container.push(value);
-    lockPush.unlock();
-}
-
-template<typename T>
-DequeResult MPSCDeque<T>::take(T& value)
+namespace en
 {
-    // Non-blocking try to take something from this queue
-    return container.steal(value);
-}
-// TEMP Implementation !!!! DIRTY SHIT FIXME!!!
-
-
 
-
-
-// Container keeping all neccessary information about given task
-struct Task
+// Container keeping all neccessary information about given task. It is
+// aligned to cache line, as it's passed between threads.
+struct cachealign Task
 {
+    std::atomic<Task*> next;      // Intrusive link used by MPSC queues
+    union {
     TaskFunction function;        // Function to execute
+    TaskParallelFunction parallelFunction; // Function to execute for each sub-range (parallel task)
+    };
     TaskState*   state;           // Task current state
     void*        data;            // Data to process
+    uint32v2     range;           // Range of items left to process (parallel task)
+    uint32       grain;           // Max count of items processed by single call (parallel task)
     uint64       localState : 1;  // If true, pointed state is local, and
                                   // needs to be released after task is finished
-  //uint64       locked     : 1;  // Locked to current worker thread, migration is forbidden
-    uint64                  : 63; // Padding to 32 bytes
+    uint64       locked     : 1;  // Locked to worker thread that started it, migration is forbidden
+    uint64       parallel   : 1;  // Range of task can be split, and processed in parallel
+    uint64       priority   : 2;  // Priority class (TaskPriority)
+    uint64       pool       : 16; // Index of worker which pools task (and its local
+                                  // state) were allocated from, or ExternalPool
+    uint64                  : 43;
 };
 
-static_assert(sizeof(Task) == 32, "en::Task size mismatch!");
+static_assert(sizeof(Task) == 64, "en::Task size mismatch!");
+
+// Tasks submitted by threads that are not part of Thread-Pool are allocated
+// from separate pools shared by all such threads.
+constexpr uint32 ExternalPool = 0xFFFF;
+
+// Reasons for which worker thread is parked (can be combined). Parked worker
+// sleeps until other thread wakes it up, because of one of those reasons.
+constexpr uint32 ParkedForTasks  = 1; // Worker can execute new task (or resume unblocked fiber)
+constexpr uint32 ParkedForFibers = 2; // Worker is bound to its fiber, until task it waits for finishes
+
+class TaskScheduler;
 
 // Each worker has it's own pool of fibers and tasks to minimize amount of
 // communication between threads (and CPU cores they are assigned to).
@@ -103,61 +72,76 @@ struct Worker
 {
     // Tasks local to this worker thread
    
-    MPSCDeque<Task*>          queueOfIncomingTasks;      ///< Tasks submitted for execution by IO threads
-    MPSCDeque<Task*>          queueOfIncomingLocalTasks; ///< Tasks submitted for execution on this worker CPU core (locked)
+    MPSCQueue<Task>           queueOfIncomingTasks;      ///< Tasks submitted for execution by IO threads
+    MPSCQueue<Task>           queueOfIncomingLocalTasks; ///< Tasks submitted for execution on this worker CPU core (locked)
 
     // Tasks that can be executed on any worker
 
-    WorkStealingDeque<Task*>  queueOfTasks;        ///< Tasks ready and waiting to be executed
+    WorkStealingDeque<Task*>  queueOfTasks[TaskPriorities]; ///< Tasks ready and waiting to be executed (per priority class)
 
     // Fibers that can be executed on any worker (migration of tasks in progress)
 
-  //WorkStealingDeque<Fiber*> queueOfTasksStalled; ///< Tasks that are paused (as control was switched to resume execution of other task)
-  //WorkStealingDeque<Fiber*> queueOfTasksWaiting; ///< Tasks that are waiting for other work to finish (or IO event)
-  
-    // Fibers local to this worker thread
-   
-    // [WWWWWWWWW][E][RRRRRRRRRRRRRRR]
-    // W - Waiting Fibers
-    // E - Currently executing Fiber (starts to wait, resumes, or picks new task)
-    // R - Ready Fibers, waiting
-    //
-    Fiber** localFibers;
-  //std::unique_ptr<Fiber>*   localFibers;        ///< Pool of local Fibers (array of pointers to platform dependent objects)
-    uint32                    currentFiber;       ///< Pointer to fiber currently executing on this worker thread
-    uint32                    fibers;             ///< Count of fibers managed by this worker thread
-      
-      
+    MPSCQueue<Fiber>          queueOfIncomingFibers; ///< Unblocked fibers resumed by other threads, or locked to this worker
+    WorkStealingDeque<Fiber*> queueOfFibers;         ///< Unblocked fibers waiting to be resumed (can be stolen)
+    WorkStealingDeque<Fiber*> freeFibers;            ///< Fibers not executing any task (can be stolen)
+
+    // Fibers are created by each worker thread, but once started, they are
+    // passed between workers. Fiber waiting for other task is not stored by
+    // any worker, but by state of that task (see TaskScheduler::wait).
+
+    Fiber**                   localFibers;        ///< Pool of fibers created by this worker thread
+    uint32                    fibers;             ///< Count of fibers created by this worker thread
+    Fiber*                    threadFiber;        ///< Worker thread converted to fiber (resumed only on termination)
+    Fiber*                    currentFiber;       ///< Fiber currently executing on this worker thread
+
+    // Fiber that was switched from is released by fiber switched to, so that
+    // no other worker will resume it while its stack is still in use.
+    Fiber*                    previousFiber;      ///< Fiber that was executing before last switch (or nullptr)
+    TaskState*                previousFiberWaits; ///< Task that previous fiber waits for (nullptr if it's free)
+
     std::unique_ptr<Thread>   thread;      // Worker thread handle
-    std::atomic<bool>         sleeping;    // Indicates if given worker thread is sleeping
+    std::atomic<uint32>       parked;      // Reasons for which worker thread is parked (0 if it's running)
       
-    // TODO: Both Fibers and Tasks can migrate between worker threads.
-    //       Thus thread-safe pool allocator implementation is required
-    //       to ensure that they can be freed from other thread (as well
-    //       as allocaed from other thread, when IO threads push tasks
-    //       for execution from outside).
-    //       At the same time Fiber is of unknown size (as it is platform
-    //       dependent) and thus it's impossible to have pool allocator
-    //       based on generic interface class. It would need to know backing
-    //       type, and then scheduler class itself would be platform dependent.
-    //       Thus it is better to keep Fibers as array of pointers to them.
-    //
-    //PoolAllocator<Fiber>      fibers; // Local pool of fibers (they may be exchanged with other workers)
-    //PoolAllocator<Task>       tasks;  // Local pool of tasks
+    // Tasks (and their local states) are allocated from pools of worker thread
+    // that submits them, but can be released by any other worker that finished
+    // their execution (through remote free list).
+    ConcurrentPoolAllocator<Task>      tasks;  // Local pool of tasks
+    ConcurrentPoolAllocator<TaskState> states; // Local pool of task states
 
     uint32 index;                     // Index of worker thread in the pool
+    uint32 core;                      // Logical CPU core worker thread is pinned to (InvalidCoreID if it's not pinned)
+
+    // Workers steal from each other starting from the closest ones in CPU
+    // topology (SMT sibling, then shared last level cache, then the same NUMA
+    // node, then remote ones). Start within each group is randomized, so that
+    // idle workers don't all probe the same victim.
+    uint64  seed;                     // State of private pseudo-random numbers generator
+    uint32* victim;                   // Other workers, ordered by distance in CPU topology
+    uint32  victimTier[4];            // End of victims sharing physical core, last level cache, NUMA node, and of all victims
+
+    uint32  skipped[TaskPriorities];  // Times local tasks of given priority were passed over for higher priority ones
 
-    Worker(const uint32 index, const uint32 fibers);
+
+#if defined(EN_PROFILER)
+    WorkerProfiler profiler;          // Timeline and counters of this worker thread events
+#endif
+
+    Worker(TaskScheduler* scheduler, const uint32 index, const uint32 fibers);
    ~Worker();
+
+    uint32 randomNumber(void);                                        // Called only by owner thread
+    uint32 victimAt(const uint32 order, const uint32 rotation) const; // Worker to steal from, at given position of steal sweep
 };
 
 // CompileTimeSizeReporting( Worker );
-static_assert(sizeof(Worker) == 192, "en::Worker size mismatch!");  // 336 padded to 384
+#if !defined(EN_PROFILER)
+static_assert(sizeof(Worker) == 1280, "en::Worker size mismatch!");
+#endif
 
 class TaskScheduler : public parallel::Interface
 {
     private:
-    Mutex lockAllocator;                 // PoolAllocator of ain thread tasks is not thread-safe
+    Mutex lockAllocator;                 // Only one external thread at a time can allocate from external pools
 
     public:
     uint32 workerThreads;                // Count of threads in Thread-Pool
@@ -165,27 +149,77 @@ class TaskScheduler : public parallel::Interface
                                          // (all workers have consecutive ID's).
     Worker** worker;                     // Array of worker thread states
   //std::unique_ptr<Worker>* worker;
+    uint32 fibersPerWorker;              // Count of fibers created by each worker thread
     std::atomic<bool> executing;         // Synchronizes start of worker threads execution
+    std::atomic<bool> terminating;       // Scheduler is being destroyed (possibly before workers started)
+    std::vector<uint32> workerOfCore;    // Worker pinned to each logical CPU core (InvalidWorkerId if there is none)
     std::atomic<bool> appQuit;           // Signals to main thread that application finished teardown on it's side
 
+    cachealign std::atomic<uint32> parkedWorkers; // Count of parked worker threads (read by each task submission)
+    cachealign std::atomic<uint32> highPriorityTasks; // Count of queued High priority tasks (hint for workers picking lower priority ones)
+
     // Tasks submitted for execution by IO threads
-    MPSCDeque<Task*>    queueOfMainThreadTasks; // Separate queue of tasks for execution on main thread
+    MPSCQueue<Task>     queueOfMainThreadTasks; // Separate queue of tasks for execution on main thread
 
     //CircularQueue<Task*> mainThreadQueue; // Separate queue of tasks to execute by main thread
-    PoolAllocator<Task>  mainThreadTasks;
+
+    // Pools of tasks submitted by main thread and IO threads
+    ConcurrentPoolAllocator<Task>      externalTasks;
+    ConcurrentPoolAllocator<TaskState> externalStates;
 
 
 
     TaskScheduler(const uint32 workerThreads, const uint32 fibersPerWorker);
 
+    Task* allocateTask(TaskFunction function,    // Allocates task from pools of given worker,
+                       void* data,               // or external pools if it's InvalidWorkerId
+                       TaskState* state,         // (and acquires its state)
+                       const uint32 thisWorker);
+    void  releaseTask(Task* task,                // Releases task (and its local state) to pools
+                      const uint32 thisWorker);  // it was allocated from
+    void  submit(Task* task,                     // Queues task for execution by any worker, and
+                 const uint32 thisWorker);       // wakes up parked one
+    void  execute(Task* task);                   // Executes task (splitting parallel task range)
+
+    void  park(Worker& workerState,              // Parks calling worker thread, until it's woken
+               const uint32 reasons);            // up for one of given reasons
+    bool  unparkable(Worker& workerState,        // Checks if parked worker thread has reason to
+                     const uint32 reasons);      // resume (new work, unblocked fiber, shutdown)
+    void  wakeUp(const uint32 reason,            // Wakes up to given count of workers parked for
+                 const uint32 count,             // given reason, starting search from given worker
+                 const uint32 firstWorker);
+    bool  wakeUp(Worker& workerState,            // Wakes up given worker, if it's parked for given
+                 const uint32 reason);           // reason
+    bool  registerWaiter(TaskState* state,       // Registers fiber waiting for given task, returns
+                         Fiber* fiber);          // false if it's already finished
+    void  releaseState(TaskState* state,         // Releases task state, and resumes fibers waiting
+                       const uint32 thisWorker); // for it if task is finished
+    void  resume(Fiber* fiber,                   // Makes unblocked fiber available for execution
+                 const uint32 thisWorker);
+    void   shareIncomingTasks(Worker& workerState); // Moves tasks submitted by IO threads to this worker
+                                                 // queues, so that other workers can steal them
+    Task*  localTask(Worker& workerState);       // Takes task from this worker queues, or nullptr
+    Task*  stealTask(Worker& workerState,        // Steals task of given priority from other worker,
+                     const uint32 priority);     // or nullptr
+    Fiber* fiberFromIndex(const uint32 index);   // Fiber with given index (of all workers fibers)
+    Fiber* fiberToResume(Worker& workerState);   // Takes unblocked fiber from this worker, or nullptr
+    Fiber* stealFiber(Worker& workerState);      // Steals unblocked fiber from other worker, or nullptr
+    Fiber* freeFiber(Worker& workerState);       // Takes free fiber (local or stolen), or nullptr
+    uint32 switchFiber(Worker& workerState,      // Switches from current fiber to given one. Current
+                       Fiber* fiber,             // fiber is released by the other one (as waiting
+                       TaskState* waitsFor);     // for given task, or as free one if nullptr).
+                                                 // Returns worker on which current fiber resumed
+    uint32 finishSwitch(void);                   // Called first after each switch, returns current worker
+
     virtual uint32 workers(void) const;
 
     virtual uint32 currentWorkerId(void) const;   // Id of first worker thread
 
     virtual void run(TaskFunction function,            // Task to execute
                      void* data = nullptr,             // Data to be processed by task
-                     TaskState* state = nullptr);      // State to use, so that caller can synchronize
-                                                       // Task execution can migrate between CPU cores
+                     TaskState* state = nullptr,       // State to use, so that caller can synchronize
+                     bool lockToCore = false,          // Specify if task execution can migrate between CPU cores
+                     TaskPriority priority = TaskPriority::Normal); // Priority class of task
 
     virtual void runOnMainThread(TaskFunction function,      // Task to execute
                                  void* data = nullptr,       // Data to be processed by task
@@ -197,15 +231,21 @@ class TaskScheduler : public parallel::Interface
                              void* data = nullptr,        // Data to be processed by task
                              TaskState* state = nullptr); // State to use, so that caller can synchronize
 
-  //virtual void run(TaskParallelFunction function, // Task to execute
-  //                 void* taskData = nullptr,      // Data to be processed by task
-  //                 uint32v2 range,                // Task range, allows splitting task and execution in parallel
-  //                 TaskState* state = nullptr,    // State to use, so that caller can synchronize (optional)
-  //                 bool lockToCore = false);      // Specify if task execution can migrate between CPU cores
+    virtual void run(TaskParallelFunction function,    // Task to execute for each sub-range
+                     void* data,                       // Data to be processed by task
+                     const uint32v2 range,             // Task range, allows splitting task and execution in parallel
+                     TaskState* state = nullptr,       // State to use, so that caller can synchronize
+                     const uint32 grain = 0,           // Max count of items processed by single call
+                     bool lockToCore = false,          // Specify if task execution can migrate between CPU cores
+                     TaskPriority priority = TaskPriority::Normal); // Priority class of task (and all its parts)
 
     virtual void wait(TaskState* state);        // Waits until given task finishes
 
-  //void resumeStalledWorkers(const uint32 thisWorker); // Wakes worker thread, if one of its fibers can be resumed
+    virtual void issue(TaskState* state);       // Marks asynchronous request as in flight
+    virtual void complete(TaskState* state);    // Marks asynchronous request as completed
+
+    virtual SchedulerCounters counters(const uint32 worker = InvalidWorkerId) const;
+    virtual bool saveTrace(const std::string& filename) const;
 
     virtual void processMainThreadTasks(void);  // Will process all tasks that should be executed on main thread.
                                                 // Main thread should call it each time it processes events from OS.
@@ -0,0 +1,158 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Thread-Pool Scheduler profiler.
+ Requirements: none
+ Description : Records timeline of events of each worker thread (tasks
+               execution, stealing, parking, fibers switching) in fixed
+               size ring buffer, and counts them. Ring buffer and counters
+               are written only by owning worker thread, so recording is
+               just few stores. Timelines can be exported to Chrome trace
+               event format (chrome://tracing, ui.perfetto.dev).
+               Compiled in only when EN_PROFILER is defined.
+
+*/
+
+#include "parallel/profiler.h"
+
+#if defined(EN_PROFILER)
+
+#include "assert.h"
+
+#include "utilities/strings.h"
+#include "utilities/timer.h"
+
+#include <stdio.h>
+
+namespace en
+{
+
+static_assert(ProfilerRecords > 0 && (ProfilerRecords & (ProfilerRecords - 1)) == 0, "Profiler ring buffer size needs to be power of two!");
+
+WorkerProfiler::WorkerProfiler() :
+    records(new ProfilerRecord[ProfilerRecords]),
+    recorded(0)
+{
+    for(uint32 i=0; i<underlyingType(ProfilerCounter::Count); ++i)
+    {
+        counter[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+WorkerProfiler::~WorkerProfiler()
+{
+    delete [] records;
+}
+
+void WorkerProfiler::record(const ProfilerEvent type, const uint64 value)
+{
+    // Only owner thread writes, so there is no need for atomic increment.
+    // Release ensures that record is complete, before exporting thread sees it.
+    uint64 index = std::atomic_load_explicit(&recorded, std::memory_order_relaxed);
+
+    ProfilerRecord& entry = records[index & (ProfilerRecords - 1)];
+    entry.time  = currentTime().nanoseconds();
+    entry.value = value;
+    entry.type  = type;
+
+    std::atomic_store_explicit(&recorded, index + 1, std::memory_order_release);
+}
+
+void WorkerProfiler::count(const ProfilerCounter name)
+{
+    std::atomic<uint64>& entry = counter[underlyingType(name)];
+    std::atomic_store_explicit(&entry, std::atomic_load_explicit(&entry, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint64 WorkerProfiler::value(const ProfilerCounter name) const
+{
+    return std::atomic_load_explicit(&counter[underlyingType(name)], std::memory_order_relaxed);
+}
+
+void WorkerProfiler::trace(std::string& json, const uint32 worker) const
+{
+    uint64 last  = std::atomic_load_explicit(&recorded, std::memory_order_acquire);
+    uint64 first = last > ProfilerRecords ? last - ProfilerRecords : 0;
+
+    std::string thread = ",\"pid\":0,\"tid\":" + stringFrom(worker) + "}";
+
+    // Oldest events were overwritten, so some slices may end without being
+    // started in exported range. Those are skipped to keep timeline nested.
+    uint32 depth = 0;
+    char   timestamp[32];
+    char   address[32];
+    for(uint64 i=first; i<last; ++i)
+    {
+        const ProfilerRecord& entry = records[i & (ProfilerRecords - 1)];
+
+        // Chrome trace timestamps are in microseconds
+        snprintf(timestamp, sizeof(timestamp), "%.3f", static_cast<double>(entry.time) / 1000.0);
+
+        std::string event;
+        switch(entry.type)
+        {
+            case ProfilerEvent::TaskBegin:
+                snprintf(address, sizeof(address), "0x%llx", static_cast<unsigned long long>(entry.value));
+                event = "{\"name\":\"Task\",\"ph\":\"B\",\"args\":{\"function\":\"" + std::string(address) + "\"}";
+                depth++;
+                break;
+
+            case ProfilerEvent::TaskResume:
+                event = "{\"name\":\"Task\",\"ph\":\"B\",\"args\":{\"resumed\":true}";
+                depth++;
+                break;
+
+            case ProfilerEvent::Park:
+                event = "{\"name\":\"Parked\",\"ph\":\"B\"";
+                depth++;
+                break;
+
+            case ProfilerEvent::TaskEnd:
+            case ProfilerEvent::TaskSuspend:
+            case ProfilerEvent::Unpark:
+                if (depth == 0)
+                {
+                    continue;
+                }
+
+                event = "{\"ph\":\"E\"";
+                depth--;
+                break;
+
+            case ProfilerEvent::TaskSteal:
+                event = "{\"name\":\"Steal task\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"from\":" + stringFrom(entry.value) + "}";
+                break;
+
+            case ProfilerEvent::StealAbort:
+                event = "{\"name\":\"Steal abort\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"from\":" + stringFrom(entry.value) + "}";
+                break;
+
+            case ProfilerEvent::FiberSteal:
+                event = "{\"name\":\"Steal fiber\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"from\":" + stringFrom(entry.value) + "}";
+                break;
+
+            case ProfilerEvent::FiberSwitch:
+                event = "{\"name\":\"Fiber switch\",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"fiber\":" + stringFrom(entry.value) + "}";
+                break;
+
+            default:
+                assert( 0 );
+                continue;
+        }
+
+        if (json.back() != '[')
+        {
+            json += ",\n";
+        }
+
+        json += event;
+        json += ",\"ts\":";
+        json += timestamp;
+        json += thread;
+    }
+}
+
+} // en
+
+#endif
@@ -0,0 +1,100 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Thread-Pool Scheduler profiler.
+ Requirements: none
+ Description : Records timeline of events of each worker thread (tasks
+               execution, stealing, parking, fibers switching) in fixed
+               size ring buffer, and counts them. Ring buffer and counters
+               are written only by owning worker thread, so recording is
+               just few stores. Timelines can be exported to Chrome trace
+               event format (chrome://tracing, ui.perfetto.dev).
+               Compiled in only when EN_PROFILER is defined.
+
+*/
+
+#ifndef ENG_PARALLEL_PROFILER
+#define ENG_PARALLEL_PROFILER
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "parallel/scheduler.h"
+#include "utilities/utilities.h"
+
+#include <atomic>
+#include <string>
+
+namespace en
+{
+
+enum class ProfilerEvent : uint32
+{
+    TaskBegin = 0,  // Value: task function address
+    TaskEnd       ,
+    TaskSuspend   , // Fiber executing task waits for other task
+    TaskResume    , // Fiber executing task was resumed
+    TaskSteal     , // Value: index of worker that task was stolen from
+    StealAbort    , // Value: index of worker that steal lost race on
+    FiberSteal    , // Value: index of worker that fiber was stolen from
+    FiberSwitch   , // Value: index of fiber that worker switched to
+    Park          ,
+    Unpark        ,
+};
+
+enum class ProfilerCounter : uint32
+{
+    TasksExecuted = 0,
+    TasksStolen      ,
+    StealAborts      ,
+    FibersResumed    ,
+    FibersStolen     ,
+    FiberSwitches    ,
+    Parks            ,
+    Count
+};
+
+struct ProfilerRecord
+{
+    uint64        time;   // Timestamp in nanoseconds
+    uint64        value;  // Event specific value
+    ProfilerEvent type;
+    uint32        padding;
+};
+
+static_assert(sizeof(ProfilerRecord) == 24, "en::ProfilerRecord size mismatch!");
+
+constexpr uint32 ProfilerRecords = 65536; // Events kept per worker (power of two)
+
+class WorkerProfiler
+{
+    private:
+    ProfilerRecord*     records;   // Ring buffer of recent events
+    std::atomic<uint64> recorded;  // Count of events recorded since start
+    std::atomic<uint64> counter[underlyingType(ProfilerCounter::Count)];
+
+    public:
+    WorkerProfiler();
+   ~WorkerProfiler();
+
+    void record(const ProfilerEvent type, const uint64 value = 0); // Called only by owner thread
+    void count(const ProfilerCounter name);                          // Called only by owner thread
+    uint64 value(const ProfilerCounter name) const;                  // Can be called by any thread
+
+    // Appends events from ring buffer to Chrome trace events array. Events
+    // recorded while exporting may be torn, so it's best to export when
+    // workers are idle.
+    void trace(std::string& json, const uint32 worker) const;
+};
+
+} // en
+
+#if defined(EN_PROFILER)
+#define profilerEvent(workerState, type, value) (workerState).profiler.record(ProfilerEvent::type, (uint64)(value))
+#define profilerCount(workerState, name)        (workerState).profiler.count(ProfilerCounter::name)
+#else
+#define profilerEvent(workerState, type, value)
+#define profilerCount(workerState, name)
+#endif
+
+#endif
@@ -9,13 +9,14 @@
 */
 
 #include "core/log/log.h"
+#include "core/storage.h"
 #include "platform/system.h"
 #include "parallel/comScheduler.h"
 
-#include "utilities/random.h"
-
 #include "core/parallel/thread.h"
 
+#include <vector>
+
 // TODO: gcc/macOS only?
 #include <emmintrin.h>   // _mm_pause()
 
@@ -56,15 +57,25 @@ namespace en
 // TODO: Check if task local state is needed, or can it be completly skipped.
 
 
+constexpr uint64 TaskCountMask   = 0xFFFFFFFF; // Part of TaskState value storing count of unfinished tasks
+
 TaskState::TaskState() :
-    SharedAtomic()
+    value(0)
 {
+    assert( (uint64)(&value) % cacheline == 0 );
 }
 
 void TaskState::acquire(void)
 {
-    // Performs atomic pre-increment. Equivalent to fetch_add(1) + 1
-    value++;
+    // Performs atomic pre-increment. If state is reused after task was finished,
+    // list of fibers that were waiting for it is cleared at the same time.
+    uint64 currentValue = std::atomic_load_explicit(&value, std::memory_order_relaxed);
+    uint64 desired      = 0;
+    do
+    {
+        desired = ((currentValue & TaskCountMask) == 0) ? 1 : currentValue + 1;
+    }
+    while(!std::atomic_compare_exchange_weak_explicit(&value, &currentValue, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
 }
 
 void TaskState::release(void)
@@ -75,8 +86,8 @@ void TaskState::release(void)
 
 bool TaskState::finished(void)
 {
-    uint32 currentValue = std::atomic_load_explicit(&value, std::memory_order_relaxed);
-    if (currentValue == 0)
+    uint64 currentValue = std::atomic_load_explicit(&value, std::memory_order_relaxed);
+    if ((currentValue & TaskCountMask) == 0)
     {
         return true;
     }
@@ -144,8 +155,10 @@ constexpr uint32 WorkerThreadFibers    = 128;
 constexpr uint32 WorkerThreadTasks     = 256;
 constexpr uint32 MaxWorkerThreadFibers = 256;
 constexpr uint32 MaxWorkerThreadTasks  = 1024;
-constexpr uint32 MainThreadTasks       = 64;
-constexpr uint32 MaxMainThreadTasks    = 256;
+constexpr uint32 PoolTasks             = 1024;    // Initial capacity of each pool of tasks (and their states)
+constexpr uint32 MaxPoolTasks          = 65536;   // Tasks in flight allocated from single pool (only reserves address space)
+constexpr uint32 ParallelChunksPerWorker = 8;     // Default count of chunks per worker, that parallel task range is split to
+constexpr uint32 StarvationLimit       = 32;      // Times lower priority local task can be passed over, before it's started anyway
 
 void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker);
 
@@ -153,18 +166,29 @@ void fiberFunction(void* data)
 {
     assert( data );
     
-    uint32 thisWorker = *(uint32*)(data);
+    TaskScheduler& scheduler = *(TaskScheduler*)(data);
+
+    // Fiber starts executing on worker thread that switched to it, which may
+    // be different than the one that created it.
+    uint32 thisWorker = scheduler.finishSwitch();
 
-    schedulingFunction(*(TaskScheduler*)(en::Scheduler.get()), thisWorker);
+    // Never returns, on termination fiber switches back to worker thread
+    schedulingFunction(scheduler, thisWorker);
 }
 
 void* workerFunction(Thread* thread)
 {
     TaskScheduler& scheduler = *(TaskScheduler*)(thread->state());
    
-    // Wait until scheduler finished initialization of all threads
-    while(!scheduler.executing.load(std::memory_order_relaxed))
+    // Wait until scheduler finished initialization of all threads. Scheduler
+    // may be also destroyed before this thread noticed that it started.
+    while(!scheduler.executing.load(std::memory_order_acquire))
     {
+        if (scheduler.terminating.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
         _mm_pause();
     }
    
@@ -182,72 +206,173 @@ void* workerFunction(Thread* thread)
     workerState.thread->name(threadName);
    
     // Finish initialization of worker thread state, by converting it to fiber
-    workerState.localFibers[0] = convertToFiber(FiberStackSize, MaxFiberStackSize);
-   
-    // Start executing tasks
-    schedulingFunction(scheduler, thisWorker);
-    
+    workerState.threadFiber = convertToFiber(FiberStackSize, MaxFiberStackSize);
+
+    // Worker thread fiber is not executing tasks, as it cannot migrate to
+    // other worker threads. Instead it switches to first fiber of this worker,
+    // and is resumed only once scheduler terminates.
+    switchToFiber(*workerState.threadFiber, *workerState.currentFiber);
+
+    // <===================== PAUSE / RESUME ==========================>
+
     // TODO: Worker thread cleanup
     
     // Worker thread function is not returning anything
     return nullptr;
 }
 
-Worker::Worker(const uint32 _index, const uint32 _fibers) :
-    queueOfIncomingTasks(WorkerThreadTasks, MaxWorkerThreadTasks),
-    queueOfIncomingLocalTasks(WorkerThreadTasks, MaxWorkerThreadTasks),
-    queueOfTasks(WorkerThreadTasks, MaxWorkerThreadTasks),
-  //queueOfTasksStalled(WorkerThreadFibers, MaxWorkerThreadFibers),
-  //queueOfTasksWaiting(WorkerThreadFibers, MaxWorkerThreadFibers),
+Worker::Worker(TaskScheduler* scheduler, const uint32 _index, const uint32 _fibers) :
+    queueOfIncomingTasks(),
+    queueOfIncomingLocalTasks(),
+    queueOfTasks{ { WorkerThreadTasks, MaxWorkerThreadTasks },
+                  { WorkerThreadTasks, MaxWorkerThreadTasks },
+                  { WorkerThreadTasks, MaxWorkerThreadTasks } },
+    queueOfIncomingFibers(),
+    queueOfFibers(scheduler->workerThreads * _fibers, scheduler->workerThreads * _fibers),
+    freeFibers(scheduler->workerThreads * _fibers, scheduler->workerThreads * _fibers),
     localFibers(nullptr),
-    currentFiber(0),
     fibers(_fibers),
+    threadFiber(nullptr),
+    currentFiber(nullptr),
+    previousFiber(nullptr),
+    previousFiberWaits(nullptr),
     thread(nullptr),
-    sleeping(false),
-    index(_index)
-{
-    // Allocate pool of fibers
-    // (all except of fiber 0 which will be init by converting worker thread to it)
-    // Pointer to Worker thread local state is directly passed to fibers. That is
-    // fine as the moment worker thread will terminate, all fibers should terminate
-    // already anyway (in fact any fiber terminating will terminate worker thread).
+    parked(0),
+    tasks(PoolTasks, MaxPoolTasks, alignof(Task)),
+    states(PoolTasks, MaxPoolTasks, cacheline),
+    index(_index),
+    core(InvalidCoreID),
+    seed((static_cast<uint64>(_index) + 1) * 0x9E3779B97F4A7C15ULL),
+    victim(nullptr),
+    victimTier{0, 0, 0, 0},
+    skipped{0, 0, 0}
+{
+    // Allocate pool of fibers. Fibers can migrate between workers, so queues
+    // holding them are able to store all fibers of all workers (address space
+    // is reserved upfront, so that queues never grow).
+    // Pointer to scheduler is directly passed to fibers, as worker thread that
+    // will execute them is known only once they are started.
    
     //localFibers = new std::unique_ptr<Fiber>[fibers];
     localFibers = new Fiber*[fibers];
    
-    for(uint32 i=1; i<fibers; ++i)
+    for(uint32 i=0; i<fibers; ++i)
     {
-        // By the time this code executes, worker "index" field is initialized
-        localFibers[i] = createFiber(fiberFunction, (void*)&index, FiberStackSize, MaxFiberStackSize);
+        localFibers[i] = createFiber(fiberFunction, (void*)scheduler, FiberStackSize, MaxFiberStackSize);
+        localFibers[i]->index  = index * fibers + i;
+        localFibers[i]->worker = index;
+
+        // Worker thread is not started yet, so it's safe to push on its behalf
+        if (i > 0)
+        {
+            freeFibers.push(localFibers[i]);
+        }
     }
+
+    // First fiber is reserved for worker thread to start with (so that it
+    // cannot be stolen before worker thread starts)
+    currentFiber = localFibers[0];
 }
 
 Worker::~Worker()
 {
     // Release worker thread fibers
-    // (except of Fiber 0 which represent original worker thread).
-    for(uint32 i=1; i<fibers; ++i)
+    // (Fiber representing original worker thread is not part of the pool).
+    for(uint32 i=0; i<fibers; ++i)
     {
-        localFibers[i] = nullptr;
+        localFibers[i]->~Fiber();
+        deallocate<Fiber>(localFibers[i]);
     }
 
     // Release fibers pool
     delete [] localFibers;
 
+    // Worker thread already terminated, so fiber it was converted to can be
+    // released as well.
+    if (threadFiber)
+    {
+        threadFiber->~Fiber();
+        deallocate<Fiber>(threadFiber);
+    }
+
+    delete [] victim;
+
     // Release thread object
     thread = nullptr;
 }
 
-TaskScheduler::TaskScheduler(const uint32 _workerThreads, const uint32 fibersPerWorker) :
+uint32 Worker::randomNumber(void)
+{
+    // Xorshift64* (state is never zero)
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return static_cast<uint32>((seed * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+uint32 Worker::victimAt(const uint32 order, const uint32 rotation) const
+{
+    assert( order < victimTier[3] );
+
+    // Victims at the same distance are visited starting from random one
+    uint32 first = 0;
+    for(uint32 i=0; i<3; ++i)
+    {
+        if (order < victimTier[i])
+        {
+            return victim[first + (order - first + rotation) % (victimTier[i] - first)];
+        }
+
+        first = victimTier[i];
+    }
+
+    return victim[first + (order - first + rotation) % (victimTier[3] - first)];
+}
+
+// Distance between logical cores in CPU topology (0 - SMT siblings, 1 - shared
+// last level cache, 2 - the same NUMA node, 3 - remote or unknown).
+static uint32 coresDistance(const CoreTopology& a, const CoreTopology& b)
+{
+    if (a.physicalCore == b.physicalCore)
+    {
+        return 0;
+    }
+
+    if (a.cache == b.cache)
+    {
+        return 1;
+    }
+
+    if (a.node == b.node)
+    {
+        return 2;
+    }
+
+    return 3;
+}
+
+TaskScheduler::TaskScheduler(const uint32 _workerThreads, const uint32 _fibersPerWorker) :
     workerThreads(_workerThreads),
     firstWorkerId(0),
     worker(nullptr),
+    fibersPerWorker(_fibersPerWorker),
     executing(false),
+    terminating(false),
     appQuit(false),
-    queueOfMainThreadTasks(MainThreadTasks, MaxMainThreadTasks),
+    parkedWorkers(0),
+    highPriorityTasks(0),
+    queueOfMainThreadTasks(),
   //mainThreadQueue(MaxMainThreadTasks),
-    mainThreadTasks(MainThreadTasks, MaxMainThreadTasks)
+    externalTasks(PoolTasks, MaxPoolTasks, alignof(Task)),
+    externalStates(PoolTasks, MaxPoolTasks, cacheline)
 {    
+    // Index of worker owning task pools is stored in 16 bits of each task
+    assert( workerThreads < ExternalPool );
+
+    // Index of each fiber + 1 needs to fit in 32 bits of task state
+    assert( static_cast<uint64>(workerThreads) * fibersPerWorker < 0xFFFFFFFF );
+
+
     // Name main thread for debugging purposes
     std::string threadName("MainThread");
     setThreadName(threadName);
@@ -263,7 +388,67 @@ TaskScheduler::TaskScheduler(const uint32 _workerThreads, const uint32 fibersPer
         //new (&worker[i]) Worker(i, fibersPerWorker);
         //worker[i] = std::unique_ptr<Worker>(new Worker(i, fibersPerWorker));
         worker[i] = allocate<Worker>(1, cacheline);
-        new (worker[i]) Worker(i, fibersPerWorker);
+        new (worker[i]) Worker(this, i, fibersPerWorker);
+    }
+
+    // Each worker thread is assigned to separate logical CPU core, from the
+    // ones this process is allowed to execute on (it may be restricted to
+    // subset of them by cpuset of container, taskset, etc.). Execution mask
+    // can describe only first 64 cores, workers above that, or above count
+    // of available cores, are left for OS to distribute.
+    std::vector<uint32> cores = availableCores();
+    for(uint32 i=0; i<workerThreads && i<cores.size(); ++i)
+    {
+        if (cores[i] < 64)
+        {
+            worker[i]->core = cores[i];
+            if (workerOfCore.size() <= cores[i])
+            {
+                workerOfCore.resize(cores[i] + 1, InvalidWorkerId);
+            }
+
+            workerOfCore[cores[i]] = i;
+        }
+    }
+
+    // Order other workers by their distance in CPU topology, so that work is
+    // stolen from the closest ones first. Workers that are not pinned, or
+    // are on cores with unknown location, are remote to all others.
+    std::vector<CoreTopology> topology(workerThreads);
+    std::vector<uint8> located(workerThreads, 0);
+    for(uint32 i=0; i<workerThreads; ++i)
+    {
+        if (worker[i]->core != InvalidCoreID)
+        {
+            located[i] = coreTopology(worker[i]->core, topology[i]) ? 1 : 0;
+        }
+    }
+
+    for(uint32 i=0; i<workerThreads; ++i)
+    {
+        Worker& workerState = *worker[i];
+        workerState.victim = new uint32[max(workerThreads - 1, 1U)];
+
+        uint32 victims = 0;
+        for(uint32 distance=0; distance<4; ++distance)
+        {
+            for(uint32 j=0; j<workerThreads; ++j)
+            {
+                if (j == i)
+                {
+                    continue;
+                }
+
+                uint32 workersDistance = (located[i] && located[j]) ? coresDistance(topology[i], topology[j]) : 3;
+                if (workersDistance == distance)
+                {
+                    workerState.victim[victims] = j;
+                    victims++;
+                }
+            }
+
+            workerState.victimTier[distance] = victims;
+        }
     }
 
     // Spawn worker threads (they will be spinning until execution flag is not set)
@@ -271,12 +456,13 @@ TaskScheduler::TaskScheduler(const uint32 _workerThreads, const uint32 fibersPer
     {
         worker[i]->thread = startThread(workerFunction, static_cast<void*>(this));
 
-        // Each worker thread is assigned to separate CPU core (physical or logical
-        // depending on if Hyper-Threading cores are used) and cannot migrate between
-        // those CPU cores.
-        uint64 executionMask = 0;
-        setBit(executionMask, static_cast<uint64>(i));
-        worker[i]->thread->executeOn(executionMask);
+        // Pinned worker thread cannot migrate between CPU cores
+        if (worker[i]->core != InvalidCoreID)
+        {
+            uint64 executionMask = 0;
+            setBit(executionMask, static_cast<uint64>(worker[i]->core));
+            worker[i]->thread->executeOn(executionMask);
+        }
     }
 
     // Store ID of first worker thread. Implementation requires that all worker
@@ -300,6 +486,8 @@ TaskScheduler::~TaskScheduler()
     //       means that main thread events loop was ended. By that time all tasks
     //       should be drained properly.
     //
+    // Workers that didn't notice start of execution yet, exit immediately.
+    std::atomic_store_explicit(&terminating, true, std::memory_order_release);
     std::atomic_store_explicit(&executing, false, std::memory_order_release);
 
     // Wait until all worker threads are done
@@ -320,11 +508,14 @@ TaskScheduler::~TaskScheduler()
 
     deallocate<Worker>(worker);
     //*/
+    // Releasing worker threads also releases their ID's, as system may reuse
+    // handles of terminated threads for new ones.
     for(uint32 i=0; i<workerThreads; ++i)
     {
-        worker[i] = nullptr;
+        worker[i]->~Worker();
+        deallocate<Worker>(worker[i]);
     }
-    delete worker;
+    delete [] worker;
 }
 
 void TaskScheduler::shutdown(void)
@@ -378,364 +569,910 @@ void TaskScheduler::runOnCore(const uint16 core,
    // Very good description of different types of Producer-Consumer Queues:
    // http://www.1024cores.net/home/lock-free-algorithms/queues
 
-void TaskScheduler::run(TaskFunction function,
-                        void* data,
-                        TaskState* state)
+Task* TaskScheduler::allocateTask(TaskFunction function,
+                                  void* data,
+                                  TaskState* state,
+                                  const uint32 thisWorker)
 {
-    // Allocate task ( TODO: from a pool? )
-  //Task* task = worker[thisWorker].tasks.allocate();
-    Task* task = new Task();
-    
-    // Init task state
-    task->function   = function;
-    task->data       = data;
-    task->state      = state;
-    task->localState = false;
-    if (!task->state)
+    Task*      task       = nullptr;
+    TaskState* localState = nullptr;
+
+    if (thisWorker == InvalidWorkerId)
     {
-        // When dynamically allocated, ensure that it is aligned to cache line
-        task->state = allocate<TaskState>(1, cacheline);
-        new (task->state) TaskState();
-        task->localState = true;
+        // Threads that are not part of Thread-Pool share external pools. They
+        // are allowed to block, so it's fine to serialize them on allocation.
+        // Worker threads releasing their tasks are never blocked.
+        lockAllocator.lock();
+        task = externalTasks.allocate();
+        if (!state)
+        {
+            localState = externalStates.allocate();
+        }
+        lockAllocator.unlock();
     }
-    
-    task->state->acquire();
-
-    uint32 threadId = currentThreadId();
-    
-    // Check for special case when Task is being added by external thread not 
-    // being part of Thread-Pool (for e.g. main thread or IO thread pushes task 
-    // to handle incoming event).
-    if (threadId < firstWorkerId || (firstWorkerId + workerThreads - 1) < threadId)
+    else
     {
-        // Add task to worker thread, that executes on current CPU core. This way
-        // we're guaranteed that this worker thread execution is paused. It could 
-        // be paused when it was executing task, or in rare case, when it was in
-        // the middle of pushing (or grabing) task from queue.
-        uint32 selectedWorker = firstWorkerId + currentCoreId();
-        
-        // If there is less worker threads than CPU cores (for e.g. Scheduler is
-        // reduced to one worker thread for debugging purposes), push this task 
-        // on first worker thread. This is fine, as long as MPSC queue is used
-        // to accept external tasks.
-        if (selectedWorker >= workerThreads)
+        // Worker thread is the only one allocating from its own pools
+        Worker& workerState = *worker[thisWorker];
+        task = workerState.tasks.allocate();
+        if (!state)
         {
-            selectedWorker = 0;
+            localState = workerState.states.allocate();
         }
-
-        // Due to above, tasks from IO threads are always pushed on separate MPSC
-        // queue, that needs to be at least non-blocking for worker thread that is
-        // it's consumer. 
-      
-        // Queue task for execution
-        worker[selectedWorker]->queueOfIncomingTasks.push(task);
-        
-        // Selected worker thread may be sleeping, in such case wake it up
-        worker[selectedWorker]->thread->wakeUp();
-
-        return;
     }
-    
-    uint32 thisWorker = threadId - firstWorkerId;
-        
-    // Queue task for execution
-    worker[thisWorker]->queueOfTasks.push(task);
-}
 
-void TaskScheduler::runOnMainThread(TaskFunction function,
-                                    void* data,
-                                    TaskState* state,
-                                    bool immediately)
-{
-    // PoolAllocator is not thread safe
-    lockAllocator.lock();
-    Task* task = mainThreadTasks.allocate();
     assert( task );
-    lockAllocator.unlock();
     
     // Init task state
     task->function   = function;
     task->data       = data;
     task->state      = state;
     task->localState = false;
+    task->locked     = false;
+    task->parallel   = false;
+    task->priority   = underlyingType(TaskPriority::Normal);
+    task->pool       = (thisWorker == InvalidWorkerId) ? ExternalPool : thisWorker;
     if (!task->state)
     {
-        // When dynamically allocated, ensure that it is aligned to cache line
-        task->state = allocate<TaskState>(1, cacheline);
-        new (task->state) TaskState();
+        // Pool entries are aligned to cache line
+        assert( localState );
+        new (localState) TaskState();
+        task->state      = localState;
         task->localState = true;
     }
     
     task->state->acquire();
 
-    // Queue task for execution on main thread
-    queueOfMainThreadTasks.push(task);
+    return task;
+}
 
-    if (immediately)
+void TaskScheduler::releaseTask(Task* task, const uint32 thisWorker)
+{
+    assert( task );
+
+    // Task (and its local state) is released to pools of worker that allocated it.
+    // Shared state is never accessed, as it may be already destroyed. If
+    // it's current worker, this is done without any synchronization. Otherwise
+    // it is pushed on remote free lists, and owner will reclaim it later.
+    if (task->pool == thisWorker)
     {
-        // Wake up main thread, so that it can process this task immediately
-        wakeUpMainThread();
+        Worker& workerState = *worker[thisWorker];
+        if (task->localState)
+        {
+            workerState.states.deallocate(*task->state);
+        }
+
+        workerState.tasks.deallocate(*task);
+        return;
     }
-}
 
-void TaskScheduler::runOnWorker(const uint32 selectedWorker,             
-                                TaskFunction function,           
-                                void* data,            
-                                TaskState* state) 
-{
-    assert( selectedWorker < workerThreads );
+    ConcurrentPoolAllocator<Task>*      tasks  = &externalTasks;
+    ConcurrentPoolAllocator<TaskState>* states = &externalStates;
+    if (task->pool != ExternalPool)
+    {
+        assert( task->pool < workerThreads );
+        tasks  = &worker[task->pool]->tasks;
+        states = &worker[task->pool]->states;
+    }
 
-    // Allocate task ( TODO: from a pool? )
-    Task* task = new Task();
-    
-    // Init task state
-    task->function   = function;
-    task->data       = data;
-    task->state      = state;
-    task->localState = false;
-    if (!task->state)
+    if (task->localState)
     {
-        // When dynamically allocated, ensure that it is aligned to cache line
-        task->state = allocate<TaskState>(1, cacheline);
-        new (task->state) TaskState();
-        task->localState = true;
+        states->deallocateRemote(*task->state);
     }
-    
-    task->state->acquire();
-    
-    // Queue task for execution on given worker thread
-    worker[selectedWorker]->queueOfIncomingLocalTasks.push(task);
-    
-    // Selected worker thread may be sleeping, in such case wake it up
-    worker[selectedWorker]->thread->wakeUp();
-    
-    return;
-}
 
-/*
+    tasks->deallocateRemote(*task);
+}
 
-// This method is removed in favor of worker threads waking up periodically
-// to check if their stalled Fibers can be resumed. This ensures that in
-// normal conditions, worker threads won't need to do costly iteration over
-// stalled fibers of each sleeping worker to manually woke it.
+// Parking protocol:
 //
-// The drawback here is, that in such situation worker thread won't wake up
-// immediately after one of it's fibers is unblocked, but will sleep until
-// current sleep period elapses.
+// Worker thread that has nothing to do, announces for which reasons it could
+// resume (in "parked" field), then checks once again if any of them is not
+// already satisfied, and only then goes to sleep. Thread making work available
+// (pushing task, or finishing task that fiber waits for) first publishes it,
+// then checks if any worker is parked for that reason. Both sides separate
+// those steps with full memory barrier, so at least one of them will notice
+// the other (Dekker style, the same as in eventcount). Waking thread claims
+// parked worker by clearing its "parked" field, so each worker is woken up
+// only once, and only as many workers are woken up as there is new work.
+// Thread wake-up signal is sticky, so it won't be lost if it is sent before
+// worker starts to sleep (it may only cause spurious wake-up later).
 //
-// Currently there are no metrics to guide which solution is more desired,
-// thus solution that minimizes cross-thread data sharing is choosed.
-// This method can be introduced back in the future, if needed.
-
-void TaskScheduler::resumeStalledWorkers(const uint32 skipWorker)
+// See also:
+// https://www.1024cores.net/home/lock-free-algorithms/eventcounts
+//
+void TaskScheduler::park(Worker& workerState, const uint32 reasons)
 {
-    // Iterate over all worker threads (optionally skiping selected one), and
-    // for each worker, check rare condition in which it went to sleep, waiting
-    // for any of it's fibers to get unblocked. If indeed at least one of them
-    // is no longer blocked, wake up such worker thread manually to resume it's
-    // execution. It's a corner case when worker threads are under-utilized.
-    for(uint32 i=0; i<workerThreads; ++i)
+    assert( reasons );
+
+    profilerEvent(workerState, Park, reasons);
+    profilerCount(workerState, Parks);
+
+    std::atomic_store_explicit(&workerState.parked, reasons, std::memory_order_seq_cst);
+    std::atomic_fetch_add_explicit(&parkedWorkers, 1U, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while(!unparkable(workerState, reasons))
     {
-        if (i == skipWorker)
-        {
-            continue;
-        }
-       
-        // It is crucial to enter this code only for threads that marked themselves
-        // as sleeping. This way in normal conditions, this loop will exit quickly,
-        // and will scale down to N atomic loads, where N is count of workers.
-        if (worker[i].sleeping.load(std::memory_order_relaxed))
-        {
-            // This is not the only place where sleeping workers can be woken up.
-           
-            // Try to lock selected sleeping worker for analyzing list of it's waiting
-            // fibers, without colliding with other worker threads trying to analyze
-            // it (or mentioned worker itself, if it would be woken up by other thread).
-            worker[i].lock.lock();
-    
-            // This thread is now allowed to analyze selected worker queue of stalled
-            // Fibers. Before doing that, ensure that other worker thread didn't woke
-            // up selected worker already.
-            if (worker[i].sleeping.load(std::memory_order_relaxed))
-            {
-                // Check if this worker has fibers that could be resumed
-                // and thus, if it should be woken up.
-                for(uint32 f=0; f<worker[i].fibers; ++f)
-                {
-                   
-                    TaskState* state = worker[i].localFibers[f]->waitingForTask;
-                    if (!state)
-                    {
-                        continue;
-                    }
-                   
-                    if (state->finished())   // <- Potential Race Condition! (TaskState may be already released)
-                    {
-                        // Wake this thread up and proceed to the next one
-                        worker[i].thread->wakeUp();
- 
-                        break;
-                    }
-                }
-            }
-    
-            // Leave critical section
-            worker[i].lock.unlock();
-        }
-    }
-}
-//*/
+        workerState.thread->sleep();
 
-void TaskScheduler::wait(TaskState* state)
-{
-    // Current implementation assumes that Fibers never migrate between Workers
-    // (so idle worker won't be able to steal waiting fiber that could be resumed).
-    // Above assumption is enough to ensure that management of fibers list is
-    // thread safe, as this list will always be modified by single fiber of that
-    // worker at a time. Other workers can iterate over that list and check 
-    // fiber states only when given worker is sleeping (to wake it up).
-    assert( state );
-    
-    uint32 threadId = currentThreadId();
-    
-    // Check for special case when external thread, that is not part of Thread-Pool 
-    // tries to wait on Task (for e.g. main thread or IO thread). 
-    assert( threadId >= firstWorkerId && threadId < (firstWorkerId + workerThreads) );
+        // <===================== SLEEP / WAKEUP ==========================>
 
-    uint32 thisWorker = threadId - firstWorkerId;
+        // Worker was claimed by waking thread
+        if (std::atomic_load_explicit(&workerState.parked, std::memory_order_acquire) == 0)
+        {
+            break;
+        }
 
-    Worker& workerState = *worker[thisWorker];
+        // Otherwise it was spurious wake-up (left from previous claim)
+    }
 
-    Fiber* fiber = workerState.localFibers[workerState.currentFiber]; //.get();
+    std::atomic_store_explicit(&workerState.parked, 0U, std::memory_order_relaxed);
+    std::atomic_fetch_sub_explicit(&parkedWorkers, 1U, std::memory_order_relaxed);
 
-    // This fiber is now waiting for some task to finish
-    fiber->waitingForTask = state;
+    profilerEvent(workerState, Unpark, 0);
+}
 
-    // Move this fiber from Executing state to Waiting state, by moving Current
-    // marker to first Ready fiber. This worker thread will try to switch to
-    // newly selected current fiber, unless it will find other Waiting fiber to
-    // resume (or untill all fibers are now in Waiting state).
-    workerState.currentFiber++;
+bool TaskScheduler::unparkable(Worker& workerState, const uint32 reasons)
+{
+    if (!std::atomic_load_explicit(&executing, std::memory_order_acquire))
+    {
+        return true;
+    }
 
-    // Execute scheduling loop, until task scheduler terminates
-    bool isExecuting = std::atomic_load_explicit(&executing, std::memory_order_relaxed);
-    while(isExecuting)
+    if (reasons & ParkedForTasks)
     {
-        // This loop executes in one of Waiting fibers, but Current marker is 
-        // already pointing on first Ready fiber.
+        if (!workerState.queueOfIncomingTasks.empty() ||
+            !workerState.queueOfIncomingLocalTasks.empty() ||
+            !workerState.queueOfIncomingFibers.empty())
+        {
+            return true;
+        }
 
-        // Iterate over waiting fibers, if any of them can be resumed do that
-        for(uint32 i=0; i<workerState.currentFiber; ++i)
+        // Any task or unblocked fiber that can be stolen
+        for(uint32 i=0; i<workerThreads; ++i)
         {
-            Fiber* waitingFiber = workerState.localFibers[i]; //.get();
-            assert( waitingFiber->waitingForTask );
-        
-            if (waitingFiber->waitingForTask->finished())
+            if (!worker[i]->queueOfFibers.empty())
             {
-                // If selected fiber is somewhere inside of sub-group of Waiting 
-                // fibers, switch it with last one on the list (one before current).
-                if (i < (workerState.currentFiber - 1))
+                return true;
+            }
+
+            for(uint32 priority=0; priority<TaskPriorities; ++priority)
+            {
+                if (!worker[i]->queueOfTasks[priority].empty())
                 {
-                    Fiber* temp = workerState.localFibers[workerState.currentFiber - 1];
-                    workerState.localFibers[workerState.currentFiber - 1] = workerState.localFibers[i];
-                    workerState.localFibers[i] = temp;
-                   
-                    //workerState.localFibers[workerState.currentFiber - 1].swap(workerState.localFibers[i]);
+                    return true;
                 }
-        
-                // Move selected fiber from Waiting state to Executing, by 
-                // decreasing count of fibers that are in Waiting state
-                workerState.currentFiber--;
-        
-                // Resume selected fiber
-                switchToFiber(*fiber, *waitingFiber);
-        
-                // <===================== PAUSE / RESUME ==========================>
-        
-                // This fiber is just resumed. It means that it was moved from 
-                // Waiting state to Executing state and task state that it was
-                // waiting for is finished.
-                assert( fiber->waitingForTask->finished() );
-        
-                fiber->waitingForTask = nullptr;
-        
-                // Resume execution
-                return;
             }
         }
-        
-        // All waiting fibers of this worker thread, are waiting for some work to 
-        // finish, that is executing on other worker threads. If there are available
-        // fibers in Ready state, switch to one, to let it execute other task in
-        // the meantime.
-        if (workerState.currentFiber < MaxWorkerThreadFibers)
-        {
-            Fiber* readyFiber = workerState.localFibers[workerState.currentFiber]; //.get();
-
-            // Resume fiber ready to pick new task
-            switchToFiber(*fiber, *readyFiber);
-
-            // <===================== PAUSE / RESUME ==========================>
+    }
 
-            // This fiber is just resumed. It means that it was moved from 
-            // Waiting state to Executing state and task state that it was
-            // waiting for is finished.
-            assert( fiber->waitingForTask->finished() );
-        
-            fiber->waitingForTask = nullptr;
-        
-            // Resume execution
-            return;
+    if (reasons & ParkedForFibers)
+    {
+        if (std::atomic_load_explicit(&workerState.currentFiber->signaled, std::memory_order_acquire))
+        {
+            return true;
         }
-        else
+
+        // Tasks submitted by IO threads to this worker, which need to be
+        // shared with other workers (see wait)
+        if (!workerState.queueOfIncomingTasks.empty())
         {
-            // All fibers of this worker thread are blocked waiting for task
-            // that is executing on other worker thread (blocked directly or
-            // indirectly one on another). This worker thread will go to sleep, 
-            // until it will be woken up by other thread (once one of blocking 
-            // tasks will finish, unblocking one of the fibers).
-            workerState.sleeping.store(true, std::memory_order_release);
-           
-            // Sleep for 1ms. Then wake up and check if any Fiber can be
-            // resumed. This is corner case that happens only on under-utilized
-            // configurations.
-            workerState.thread->sleepFor(Time(1000000));
-
-            // <===================== SLEEP / WAKEUP ==========================>
-
-            workerState.sleeping.store(false, std::memory_order_release);
-           
-            // This worker thread was just woken up. This mean that one of fibers
-            // in Waiting state is unblocked, and can resume execution. Check if 
-            // its not current fiber.
-            if (fiber->waitingForTask->finished())
-            {
-                fiber->waitingForTask = nullptr;
-        
-                // Move current fiber from Waiting state to Executing, by decreasing
-                // count of fibers that are in Waiting state.
-                workerState.currentFiber--;
+            return true;
+        }
+    }
 
-                // Resume execution
-                return;
-            }
+    return false;
+}
 
-            // Worker thread is resumed, so there is some fiber to wake up, but 
-            // it's not this one. Loop will repeat to find that fiber.
+bool TaskScheduler::wakeUp(Worker& workerState, const uint32 reason)
+{
+    uint32 reasons = std::atomic_load_explicit(&workerState.parked, std::memory_order_seq_cst);
+    while(reasons & reason)
+    {
+        // Claim parked worker, so that no other thread will try to wake it up
+        if (std::atomic_compare_exchange_weak_explicit(&workerState.parked, &reasons, 0U, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            workerState.thread->wakeUp();
+            return true;
         }
-        
-        isExecuting = std::atomic_load_explicit(&executing, std::memory_order_relaxed);
     }
 
-    // If code execution reached this point, it means that Scheduler terminates
-    // immediately. All waiting tasks are trashed, and thread will terminate 
-    // immediately.
-
-    // TODO: Terminate worker thread and all active fibers
+    return false;
 }
 
-// Core scheduler function. Executes between Tasks and decides which Fiber
-// should execute next, which Task to execute and how worker thread should
+void TaskScheduler::wakeUp(const uint32 reason, const uint32 count, const uint32 firstWorker)
+{
+    uint32 woken = 0;
+    for(uint32 i=0; i<workerThreads && woken < count; ++i)
+    {
+        uint32 index = (firstWorker + i) % workerThreads;
+        if (wakeUp(*worker[index], reason))
+        {
+            woken++;
+        }
+    }
+}
+
+Fiber* TaskScheduler::fiberFromIndex(const uint32 index)
+{
+    assert( index < workerThreads * fibersPerWorker );
+    return worker[index / fibersPerWorker]->localFibers[index % fibersPerWorker];
+}
+
+// Waiting fibers:
+//
+// Fiber waiting for task is not kept by any worker. Instead, it is pushed on
+// single linked list of fibers waiting for that task, which head is stored in
+// task state, together with count of unfinished tasks (so that both can be
+// modified with single atomic operation). Thread that finishes the task takes
+// whole list, and makes each fiber available for execution again. Unblocked
+// fiber is pushed on queue of that thread, so that it can be resumed by it or
+// stolen by any idle worker (fiber migrates between worker threads). Fibers
+// locked to their worker thread are passed back to it.
+//
+// Fiber cannot be registered as waiting while it's still executing, as other
+// worker could resume it while its stack is still in use. Therefore it's
+// registered by fiber that current worker switched to, right after switch.
+//
+bool TaskScheduler::registerWaiter(TaskState* state, Fiber* fiber)
+{
+    uint64 waiter  = static_cast<uint64>(fiber->index + 1) << 32;
+    uint64 current = std::atomic_load_explicit(&state->value, std::memory_order_relaxed);
+    uint64 desired = 0;
+    do
+    {
+        if ((current & TaskCountMask) == 0)
+        {
+            return false;
+        }
+
+        // Link with fibers already waiting for that task
+        uint32 head = static_cast<uint32>(current >> 32);
+        fiber->nextWaiter = head ? fiberFromIndex(head - 1) : nullptr;
+
+        desired = waiter | (current & TaskCountMask);
+    }
+    while(!std::atomic_compare_exchange_weak_explicit(&state->value, &current, desired, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+    return true;
+}
+
+void TaskScheduler::releaseState(TaskState* state, const uint32 thisWorker)
+{
+    // Single atomic operation returns both count and waiters. State cannot be
+    // accessed after it, as waiting fiber may resume and destroy it.
+    uint64 previous = std::atomic_fetch_sub_explicit(&state->value, static_cast<uint64>(1), std::memory_order_seq_cst);
+    assert( (previous & TaskCountMask) > 0 );
+    if ((previous & TaskCountMask) != 1)
+    {
+        return;
+    }
+
+    uint32 waiter = static_cast<uint32>(previous >> 32);
+    Fiber* fiber  = waiter ? fiberFromIndex(waiter - 1) : nullptr;
+    while(fiber)
+    {
+        // Next waiter is read before fiber is resumed, as from that moment
+        // it may start waiting for other task.
+        Fiber* next = fiber->nextWaiter;
+        resume(fiber, thisWorker);
+        fiber = next;
+    }
+}
+
+void TaskScheduler::resume(Fiber* fiber, const uint32 thisWorker)
+{
+    // Worker that fiber was executing on is read before fiber is published,
+    // as it may be resumed immediately after that.
+    uint32 fiberWorker = fiber->worker;
+    assert( fiberWorker < workerThreads );
+
+    // Fiber is still executing on its worker thread, which is parked until
+    // task it waits for is finished (see wait).
+    if (fiber->bound)
+    {
+        std::atomic_store_explicit(&fiber->signaled, true, std::memory_order_seq_cst);
+        wakeUp(*worker[fiberWorker], ParkedForFibers);
+        return;
+    }
+
+    // Fiber locked to its worker thread is always passed back to it. Threads
+    // that are not part of Thread-Pool pass fiber to worker it was paused on.
+    if (fiber->locked || thisWorker == InvalidWorkerId)
+    {
+        worker[fiberWorker]->queueOfIncomingFibers.push(fiber);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeUp(*worker[fiberWorker], ParkedForTasks);
+        return;
+    }
+
+    // Otherwise it can be resumed by this worker, or stolen by any other
+    worker[thisWorker]->queueOfFibers.push(fiber);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (std::atomic_load_explicit(&parkedWorkers, std::memory_order_relaxed) > 0)
+    {
+        wakeUp(ParkedForTasks, 1, thisWorker + 1);
+    }
+}
+
+Fiber* TaskScheduler::fiberToResume(Worker& workerState)
+{
+    Fiber* fiber = nullptr;
+
+    // Fibers passed back to this worker thread
+    if (workerState.queueOfIncomingFibers.take(fiber) == DequeResult::Success)
+    {
+        return fiber;
+    }
+
+    // Fibers unblocked by this worker thread
+    if (workerState.queueOfFibers.take(fiber) == DequeResult::Success)
+    {
+        return fiber;
+    }
+
+    return nullptr;
+}
+
+// Lower priority tasks waiting in local queues were passed over, for task of
+// given priority.
+static void passOver(Worker& workerState, const uint32 priority)
+{
+    workerState.skipped[priority] = 0;
+    for(uint32 lower=priority+1; lower<TaskPriorities; ++lower)
+    {
+        if (!workerState.queueOfTasks[lower].empty())
+        {
+            workerState.skipped[lower]++;
+        }
+    }
+}
+
+void TaskScheduler::shareIncomingTasks(Worker& workerState)
+{
+    // Only this worker can take from its incoming queue. Tasks are moved to
+    // local queues of their priority, from which they can be stolen.
+    uint32 shared = 0;
+    Task* incoming = nullptr;
+    while(workerState.queueOfIncomingTasks.take(incoming) == DequeResult::Success)
+    {
+        workerState.queueOfTasks[incoming->priority].push(incoming);
+        shared++;
+    }
+
+    if (shared)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeUp(ParkedForTasks, shared, workerState.index + 1);
+    }
+}
+
+Task* TaskScheduler::localTask(Worker& workerState)
+{
+    Task* task = nullptr;
+
+    // Starvation guard: lower priority task that was passed over too many
+    // times, is started even if there is higher priority work.
+    for(uint32 priority=TaskPriorities-1; priority>0; --priority)
+    {
+        if (workerState.skipped[priority] >= StarvationLimit)
+        {
+            workerState.skipped[priority] = 0;
+
+            DequeResult result = DequeResult::Abort;
+            while(result == DequeResult::Abort)
+            {
+                result = workerState.queueOfTasks[priority].take(task);
+            }
+
+            if (result == DequeResult::Success)
+            {
+                return task;
+            }
+        }
+    }
+
+    // Strict priority order
+    for(uint32 priority=0; priority<TaskPriorities; ++priority)
+    {
+        // High priority tasks queued by other workers are started before
+        // local lower priority ones.
+        if (priority == underlyingType(TaskPriority::Normal) &&
+            std::atomic_load_explicit(&highPriorityTasks, std::memory_order_relaxed) > 0)
+        {
+            task = stealTask(workerState, underlyingType(TaskPriority::High));
+            if (task)
+            {
+                passOver(workerState, underlyingType(TaskPriority::High));
+                return task;
+            }
+        }
+
+        DequeResult result = DequeResult::Abort;
+        while(result == DequeResult::Abort)
+        {
+            result = workerState.queueOfTasks[priority].take(task);
+        }
+
+        if (result == DequeResult::Success)
+        {
+            passOver(workerState, priority);
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+Task* TaskScheduler::stealTask(Worker& workerState, const uint32 priority)
+{
+    Task* task = nullptr;
+
+    uint32 rotation = workerState.randomNumber();
+    for(uint32 i=0; i<workerThreads - 1; ++i)
+    {
+        uint32 workerId = workerState.victimAt(i, rotation);
+
+        // If stealing won't succeed first time, try again (unless queue is empty)
+        DequeResult result = DequeResult::Abort;
+        while(result == DequeResult::Abort)
+        {
+            result = worker[workerId]->queueOfTasks[priority].steal(task);
+            if (result == DequeResult::Abort)
+            {
+                profilerEvent(workerState, StealAbort, workerId);
+                profilerCount(workerState, StealAborts);
+            }
+        }
+
+        if (result == DequeResult::Success)
+        {
+            assert( task );
+            profilerEvent(workerState, TaskSteal, workerId);
+            profilerCount(workerState, TasksStolen);
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+Fiber* TaskScheduler::stealFiber(Worker& workerState)
+{
+    Fiber* fiber = nullptr;
+
+    uint32 rotation = workerState.randomNumber();
+    for(uint32 i=0; i<workerThreads - 1; ++i)
+    {
+        uint32 workerId = workerState.victimAt(i, rotation);
+
+        DequeResult result = DequeResult::Abort;
+        while(result == DequeResult::Abort)
+        {
+            result = worker[workerId]->queueOfFibers.steal(fiber);
+            if (result == DequeResult::Abort)
+            {
+                profilerEvent(workerState, StealAbort, workerId);
+                profilerCount(workerState, StealAborts);
+            }
+        }
+
+        if (result == DequeResult::Success)
+        {
+            profilerEvent(workerState, FiberSteal, workerId);
+            profilerCount(workerState, FibersStolen);
+            return fiber;
+        }
+    }
+
+    return nullptr;
+}
+
+Fiber* TaskScheduler::freeFiber(Worker& workerState)
+{
+    Fiber* fiber = nullptr;
+    if (workerState.freeFibers.take(fiber) == DequeResult::Success)
+    {
+        return fiber;
+    }
+
+    // Free fibers are left on worker threads that resumed fibers of other
+    // workers. If this worker run out of them, it takes them back.
+    uint32 rotation = workerState.randomNumber();
+    for(uint32 i=0; i<workerThreads - 1; ++i)
+    {
+        uint32 workerId = workerState.victimAt(i, rotation);
+
+        DequeResult result = DequeResult::Abort;
+        while(result == DequeResult::Abort)
+        {
+            result = worker[workerId]->freeFibers.steal(fiber);
+        }
+
+        if (result == DequeResult::Success)
+        {
+            return fiber;
+        }
+    }
+
+    return nullptr;
+}
+
+uint32 TaskScheduler::switchFiber(Worker& workerState, Fiber* fiber, TaskState* waitsFor)
+{
+    assert( fiber );
+    assert( fiber != workerState.currentFiber );
+
+    Fiber* current = workerState.currentFiber;
+
+    workerState.previousFiber      = current;
+    workerState.previousFiberWaits = waitsFor;
+    workerState.currentFiber       = fiber;
+
+    profilerEvent(workerState, FiberSwitch, fiber->index);
+    profilerCount(workerState, FiberSwitches);
+
+    switchToFiber(*current, *fiber);
+
+    // <===================== PAUSE / RESUME ==========================>
+
+    return finishSwitch();
+}
+
+uint32 TaskScheduler::finishSwitch(void)
+{
+    // Fiber may be resumed on different worker thread than the one it was
+    // paused on, so current worker is determined again.
+    uint32 thisWorker = currentThreadId() - firstWorkerId;
+    assert( thisWorker < workerThreads );
+
+    Worker& workerState = *worker[thisWorker];
+
+    Fiber* fiber = workerState.currentFiber;
+    assert( !fiber->locked || fiber->worker == thisWorker );
+    fiber->worker = thisWorker;
+
+    // Release fiber that this worker was executing before the switch
+    Fiber* previous = workerState.previousFiber;
+    if (previous)
+    {
+        workerState.previousFiber = nullptr;
+
+        TaskState* state = workerState.previousFiberWaits;
+        if (state)
+        {
+            // Previous fiber is not using its stack anymore, so it can be
+            // registered as waiting. If task finished in the meantime, fiber
+            // can be resumed immediately.
+            if (!registerWaiter(state, previous))
+            {
+                resume(previous, thisWorker);
+            }
+        }
+        else
+        {
+            workerState.freeFibers.push(previous);
+        }
+    }
+
+    return thisWorker;
+}
+
+void TaskScheduler::submit(Task* task, const uint32 thisWorker)
+{
+    // Counted before task is visible to other workers, so that counter
+    // cannot underflow when task is taken.
+    if (task->priority == underlyingType(TaskPriority::High))
+    {
+        std::atomic_fetch_add_explicit(&highPriorityTasks, 1U, std::memory_order_relaxed);
+    }
+
+    // Check for special case when Task is being added by external thread not 
+    // being part of Thread-Pool (for e.g. main thread or IO thread pushes task 
+    // to handle incoming event).
+    if (thisWorker == InvalidWorkerId)
+    {
+        // Add task to worker thread, that executes on current CPU core. This way
+        // we're guaranteed that this worker thread execution is paused. It could 
+        // be paused when it was executing task, or in rare case, when it was in
+        // the middle of pushing (or grabing) task from queue.
+        uint32 core = currentCoreId();
+        uint32 selectedWorker = core < workerOfCore.size() ? workerOfCore[core] : InvalidWorkerId;
+        
+        // If there is no worker thread pinned to this CPU core (for e.g. Scheduler
+        // is reduced to one worker thread for debugging purposes), push this task 
+        // on first worker thread. This is fine, as long as MPSC queue is used
+        // to accept external tasks.
+        if (selectedWorker == InvalidWorkerId)
+        {
+            selectedWorker = 0;
+        }
+
+        // Due to above, tasks from IO threads are always pushed on separate MPSC
+        // queue, that needs to be at least non-blocking for worker thread that is
+        // it's consumer. 
+      
+        // Queue task for execution
+        worker[selectedWorker]->queueOfIncomingTasks.push(task);
+        
+        // Selected worker thread may be parked, in such case wake it up. It
+        // may be also bound to fiber waiting for other task, in which case it
+        // only passes this task to other workers (see wait), as it may be the
+        // task it waits for.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeUp(*worker[selectedWorker], ParkedForTasks | ParkedForFibers);
+
+        return;
+    }
+    
+    // Queue task for execution
+    worker[thisWorker]->queueOfTasks[task->priority].push(task);
+
+    // Task can be stolen by any worker, so if some are parked, wake up one
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (std::atomic_load_explicit(&parkedWorkers, std::memory_order_relaxed) > 0)
+    {
+        wakeUp(ParkedForTasks, 1, thisWorker + 1);
+    }
+}
+
+void TaskScheduler::run(TaskFunction function,
+                        void* data,
+                        TaskState* state,
+                        bool lockToCore,
+                        TaskPriority priority)
+{
+    uint32 thisWorker = currentWorkerId();
+
+    // Allocate task from this worker pools (or pools shared by external threads)
+    Task* task = allocateTask(function, data, state, thisWorker);
+    task->locked   = lockToCore;
+    task->priority = underlyingType(priority);
+
+    submit(task, thisWorker);
+}
+
+void TaskScheduler::run(TaskParallelFunction function,
+                        void* data,
+                        const uint32v2 range,
+                        TaskState* state,
+                        const uint32 grain,
+                        bool lockToCore,
+                        TaskPriority priority)
+{
+    assert( function );
+    if (range.count == 0)
+    {
+        return;
+    }
+
+    uint32 thisWorker = currentWorkerId();
+
+    Task* task = allocateTask(nullptr, data, state, thisWorker);
+    task->parallelFunction = function;
+    task->range            = range;
+    task->grain            = grain;
+    task->parallel         = true;
+    task->locked           = lockToCore;
+    task->priority         = underlyingType(priority);
+
+    // By default range is split to few chunks per worker, so that there is
+    // enough of them to balance the load, but splitting cost is amortized.
+    if (task->grain == 0)
+    {
+        task->grain = max(1U, range.count / (workerThreads * ParallelChunksPerWorker));
+    }
+
+    submit(task, thisWorker);
+}
+
+void TaskScheduler::execute(Task* task)
+{
+    if (!task->parallel)
+    {
+        task->function(task->data);
+        return;
+    }
+
+    // Lazy binary splitting:
+    //
+    // Range is processed in chunks of grain size. Before each chunk, worker
+    // checks if its queue of tasks is empty. If it is, other workers could
+    // have stolen everything (or were idle), so remaining range is split in
+    // half and second half is queued for stealing. Otherwise splitting would
+    // only add overhead, as there is still work that other workers can take.
+    // This way range is split only as much as it's needed to balance the load.
+    //
+    // See also:
+    // A. Tzannes, G. C. Caragea, R. Barua, U. Vishkin
+    // "Lazy Binary-Splitting: A Run-Time Adaptive Work-Stealing Scheduler"
+    //
+    uint32 first = task->range.base;
+    uint32 end   = task->range.base + task->range.count;
+    while(first < end)
+    {
+        uint32 count = end - first;
+        if (count > task->grain)
+        {
+            // Fiber could have migrated to other worker, if previous chunk waited for other task
+            uint32 thisWorker = currentThreadId() - firstWorkerId;
+            assert( thisWorker < workerThreads );
+
+            if (worker[thisWorker]->queueOfTasks[task->priority].empty())
+            {
+                uint32 middle = first + count / 2;
+
+                // All parts share state of original task, unless it was local.
+                // In such case each part has its own (nobody is waiting for it).
+                Task* split = allocateTask(nullptr, task->data, task->localState ? nullptr : task->state, thisWorker);
+                split->parallelFunction = task->parallelFunction;
+                split->range            = uint32v2(middle, end - middle);
+                split->grain            = task->grain;
+                split->parallel         = true;
+                split->locked           = task->locked;
+                split->priority         = task->priority;
+
+                submit(split, thisWorker);
+
+                end = middle;
+                continue;
+            }
+        }
+
+        uint32 last = first + min(task->grain, count);
+        task->parallelFunction(task->data, uint32v2(first, last - first));
+        first = last;
+    }
+}
+
+void TaskScheduler::runOnMainThread(TaskFunction function,
+                                    void* data,
+                                    TaskState* state,
+                                    bool immediately)
+{
+    Task* task = allocateTask(function, data, state, currentWorkerId());
+
+    // Queue task for execution on main thread
+    queueOfMainThreadTasks.push(task);
+
+    if (immediately)
+    {
+        // Wake up main thread, so that it can process this task immediately
+        wakeUpMainThread();
+    }
+}
+
+void TaskScheduler::runOnWorker(const uint32 selectedWorker,             
+                                TaskFunction function,           
+                                void* data,            
+                                TaskState* state) 
+{
+    assert( selectedWorker < workerThreads );
+
+    Task* task = allocateTask(function, data, state, currentWorkerId());
+
+    // Fiber executing this task cannot migrate to other worker thread
+    task->locked = true;
+    
+    // Queue task for execution on given worker thread
+    worker[selectedWorker]->queueOfIncomingLocalTasks.push(task);
+    
+    // Selected worker thread may be parked, in such case wake it up
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wakeUp(*worker[selectedWorker], ParkedForTasks);
+    
+    return;
+}
+
+void TaskScheduler::wait(TaskState* state)
+{
+    assert( state );
+    
+    uint32 threadId = currentThreadId();
+    
+    // Check for special case when external thread, that is not part of Thread-Pool 
+    // tries to wait on Task (for e.g. main thread or IO thread). 
+    assert( threadId >= firstWorkerId && threadId < (firstWorkerId + workerThreads) );
+
+    // If task is already finished, there is nothing to wait for
+    if (state->finished())
+    {
+        return;
+    }
+
+    uint32 thisWorker = threadId - firstWorkerId;
+
+    Worker& workerState = *worker[thisWorker];
+
+    Fiber* fiber = workerState.currentFiber;
+
+    // This fiber is now waiting for some task to finish
+    fiber->waitingForTask = state;
+
+    // Switch to unblocked fiber if there is any, otherwise to free one, that
+    // will execute other tasks in the meantime. This fiber will be registered
+    // as waiting after the switch, and once task is finished, it will be
+    // resumed by first worker thread that has nothing else to do (or by this
+    // worker thread, if fiber is locked to it).
+    Fiber* nextFiber = fiberToResume(workerState);
+    if (nextFiber)
+    {
+        profilerCount(workerState, FibersResumed);
+    }
+    else
+    {
+        nextFiber = freeFiber(workerState);
+    }
+
+    if (nextFiber)
+    {
+        profilerEvent(workerState, TaskSuspend, 0);
+
+        uint32 resumedOn = switchFiber(workerState, nextFiber, state);
+
+        // <===================== PAUSE / RESUME ==========================>
+
+        profilerEvent(*worker[resumedOn], TaskResume, 0);
+        (void)resumedOn;
+
+        // This fiber is just resumed (possibly on other worker thread) which
+        // means that task it was waiting for is finished.
+        assert( fiber->waitingForTask->finished() );
+
+        fiber->waitingForTask = nullptr;
+        return;
+    }
+
+    // All fibers are in use (directly or indirectly waiting one for another).
+    // This fiber stays on its worker thread, which is parked until thread
+    // finishing the task will signal it.
+    fiber->bound = true;
+    std::atomic_store_explicit(&fiber->signaled, false, std::memory_order_relaxed);
+    if (registerWaiter(state, fiber))
+    {
+        while(!std::atomic_load_explicit(&fiber->signaled, std::memory_order_acquire))
+        {
+            if (!std::atomic_load_explicit(&executing, std::memory_order_acquire))
+            {
+                // Scheduler terminates immediately. All waiting tasks are
+                // trashed, and worker thread is resumed so that it can exit.
+                switchToFiber(*fiber, *workerState.threadFiber);
+            }
+
+            // Worker doesn't execute new tasks while it's bound, so tasks
+            // submitted to it by IO threads are passed to other workers
+            shareIncomingTasks(workerState);
+
+            park(workerState, ParkedForFibers);
+        }
+    }
+
+    fiber->bound          = false;
+    fiber->waitingForTask = nullptr;
+}
+
+void TaskScheduler::issue(TaskState* state)
+{
+    assert( state );
+
+    // Request is counted as one more unfinished task
+    state->acquire();
+}
+
+void TaskScheduler::complete(TaskState* state)
+{
+    assert( state );
+
+    // Completion is usually reported by thread that is not part of Thread-Pool
+    // (I/O thread), in which case resumed fibers are passed back to workers
+    // they were paused on.
+    releaseState(state, currentWorkerId());
+}
+
+// Core scheduler function. Executes between Tasks and decides which Fiber
+// should execute next, which Task to execute and how worker thread should
 // behave (for e.g. go to sleep).
 void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
 {
@@ -745,161 +1482,118 @@ void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
 #if not defined(EN_PLATFORM_OSX)
     // Verify that thread executes on expected CPU core
     // ( There is no such guarantee on macOS unfortunately )
-    assert( currentCoreId() == workerState->index );
+    assert( workerState->core == InvalidCoreID || currentCoreId() == workerState->core );
 #endif
 
     // Execute main scheduling loop, until task scheduler terminates
     bool executing = std::atomic_load_explicit(&scheduler.executing, std::memory_order_relaxed);
     while(executing)
     {
-        // Iterate over waiting fibers, if any of them can be resumed do that
-        for(uint32 i=0; i<workerState->currentFiber; ++i)
-        {
-            Fiber* waitingFiber = workerState->localFibers[i]; //.get();
-            assert( waitingFiber->waitingForTask );
-        
-            if (waitingFiber->waitingForTask->finished())
-            {
-                Fiber* fiber = workerState->localFibers[workerState->currentFiber]; //.get();
-
-                // If selected fiber is somewhere inside of sub-group of Waiting 
-                // fibers, switch it with last one on the list (one before current).
-                if (i < (workerState->currentFiber - 1))
-                {
-                    Fiber* temp = workerState->localFibers[workerState->currentFiber - 1];
-                    workerState->localFibers[workerState->currentFiber - 1] = workerState->localFibers[i];
-                    workerState->localFibers[i] = temp;
-                   
-                    //workerState->localFibers[workerState->currentFiber - 1].swap(workerState->localFibers[i]);
-                }
-        
-                // Move selected fiber from Waiting state to Executing, by 
-                // decreasing count of fibers that are in Waiting state
-                workerState->currentFiber--;
-        
-                // Resume selected fiber
-                switchToFiber(*fiber, *waitingFiber);
-        
-                // <===================== PAUSE / RESUME ==========================>
-        
-                // This fiber is just resumed. It means that other fiber moved to
-                // Waiting state, and couldn't resume any other fiber from waiting
-                // list. Thus it switched to this one, to try to execute some new 
-                // task in parallel.
-                assert( fiber->waitingForTask == nullptr );
-        
-                // Break iterating over waiting fibers as we already know there
-                // is none to resume. Try to run new task instead.
-                break;
-            }
-        }
+        // Select fiber to resume, or task to execute
 
-        // Select task to execute
-
-        Task* task = nullptr;
-        DequeResult result = DequeResult::Abort;
+        // Check if there are unblocked fibers passed back to this worker, or
+        // unblocked by it (they are resumed before new tasks are started).
+        Fiber* fiber = scheduler.fiberToResume(*workerState);
+        Task*  task  = nullptr;
 
         // A) Check if there are any tasks generated by IO threads
-        while(result == DequeResult::Abort)
+        //    Task is moved to local queue of its priority, so that it's started
+        //    in priority order (and can be stolen by other workers).
+        //    MPSC queue returns Abort only when producer is in the middle of
+        //    pushing. Instead of spinning on it, this worker will look for
+        //    other work, and producer will wake it up once it's done.
+        if (!fiber)
         {
-            result = workerState->queueOfIncomingTasks.take(task);
+            Task* incoming = nullptr;
+            if (workerState->queueOfIncomingTasks.take(incoming) == DequeResult::Success)
+            {
+                workerState->queueOfTasks[incoming->priority].push(incoming);
+            }
         }
 
         // B) Check if there are any tasks, that need to execute on this CPU core 
-        if (!task)
+        if (!fiber)
         {
-            result = DequeResult::Abort;
-            while(result == DequeResult::Abort)
+            Task* local = nullptr;
+            if (workerState->queueOfIncomingLocalTasks.take(local) == DequeResult::Success)
             {
-                result = workerState->queueOfIncomingLocalTasks.take(task);
+                task = local;
             }
         }
 
-        // C) Check if there are any tasks waiting in a local queue
-        //    (generated on this thread, not started yet, can be stolen by other workers)
-        if (!task)
+        // C) Check if there are any tasks waiting in a local queue, in order
+        //    of their priority (generated on this thread, not started yet, can
+        //    be stolen by other workers)
+        if (!fiber && !task)
         {
-            result = DequeResult::Abort;
-            while(result == DequeResult::Abort)
-            {
-                result = workerState->queueOfTasks.take(task);
-            }
+            task = scheduler.localTask(*workerState);
         }
 
-        // D) Check if other workers have paused tasks that can be resumed
+        // D) Check if other workers have unblocked fibers that can be resumed
         //    (resume other worker paused Fiber on this worker)
-        //
-        // TODO: This requires Fibers stealing, so they need to be randomly 
-        //       accessible and available for pick-up by multiple-threads in 
-        //       random order. 
-        //       Single-Producer Multiple-Consumers container is required.
-        //       This complicates system a lot, so for now Fibers cannot be 
-        //       stolen and are kept local to given worker.
-        
-        // E) Try to steal task from other randomly selected worker
-        //    (task generated by other worker, not started yet)
-        if (!task)
+        if (!fiber && !task)
         {
-            // Iterates over all workers starting from randomly selected one, 
-            // trying to steal work from any of them.
-            uint32 startIndex = random(scheduler.workerThreads);
-            for(uint32 i=0; i<scheduler.workerThreads; ++i)
-            {
-                uint32 workerId = (startIndex + i) % scheduler.workerThreads;
-                if (workerId != thisWorker)
-                {
-                    // If stealing won't succeed first time, try again (unless queue is empty)
-                    result = DequeResult::Abort;
-                    while(result == DequeResult::Abort)
-                    {
-                        result = scheduler.worker[workerId]->queueOfTasks.steal(task);
-                    }
-                }
+            fiber = scheduler.stealFiber(*workerState);
+        }
 
-                if (result == DequeResult::Success)
-                {
-                    assert( task );
-                    break;
-                }
-            }
+        // E) Try to steal task from other worker, closest ones first, in order
+        //    of priority (task generated by other worker, not started yet)
+        for(uint32 priority=0; !fiber && !task && priority<TaskPriorities; ++priority)
+        {
+            task = scheduler.stealTask(*workerState, priority);
         }
         
-        // Execute task 
-        if (task && result == DequeResult::Success)
+        if (fiber) // Resume unblocked fiber
         {
-            // Fiber executes task 
-            // (it may be paused during that process, and thread can switch to other one)
-            task->function(task->data);
+            // This fiber becomes free, and will continue scheduling loop
+            // once any worker thread will switch to it.
+            profilerCount(*workerState, FibersResumed);
 
-            // Fiber exits from task function
+            thisWorker  = scheduler.switchFiber(*workerState, fiber, nullptr);
+            workerState = scheduler.worker[thisWorker];
 
-            // Indicate that this thread finished executing task (task state may be 
-            // shared by several tasks, to easily wait for all of them to finish, or 
-            // in future, to allow task splitting for parallel execution).
-            task->state->release();
-           
-            // It's possible that some worker threads went to sleep, as all their
-            // fibers were stalled waiting for some tasks to be finished, and
-            // there were no other tasks to execute or steal. In such corner case
-            // the only way to resume such worker execution, is to manually wake
-            // it up, if one of it's fibers is unblocked.
-            // scheduler.resumeStalledWorkers(thisWorker);
- 
-            // Release task local state (nobody waited on it)
-            if (task->localState)
+            // <===================== PAUSE / RESUME ==========================>
+        }
+        else
+        if (task) // Execute task 
+        {
+            if (task->priority == underlyingType(TaskPriority::High))
             {
-                deallocate<TaskState>(task->state);
+                std::atomic_fetch_sub_explicit(&scheduler.highPriorityTasks, 1U, std::memory_order_relaxed);
             }
-         
-            // Release task container (this doesn't release task state)
-            delete task;
-            
+
+            // Fiber executes task. It may be paused during that process, and
+            // resumed on other worker thread, unless task is locked to worker
+            // that started it.
+            Fiber* current = workerState->currentFiber;
+            current->locked = task->locked;
+
+            profilerEvent(*workerState, TaskBegin, task->function);
+
+            scheduler.execute(task);
+
+            // Fiber exits from task function
+            current->locked = false;
+
             // Determine worker thread on which fiber finished execution
             // (fiber could have migrated between workers during task execution)
             thisWorker = currentThreadId() - scheduler.firstWorkerId;
             workerState = scheduler.worker[thisWorker]; //.get();
+            assert( workerState->currentFiber == current );
+
+            profilerEvent(*workerState, TaskEnd, 0);
+            profilerCount(*workerState, TasksExecuted);
+
+            // Indicate that this thread finished executing task (task state may be 
+            // shared by several tasks, to easily wait for all of them to finish, or 
+            // in future, to allow task splitting for parallel execution). If task
+            // is finished, fibers waiting for it are resumed.
+            scheduler.releaseState(task->state, thisWorker);
+
+            // Release task container and its local state (nobody waited on it)
+            scheduler.releaseTask(task, thisWorker);
         }
-        else // Worker is idle waiting for work (or for it's fibers to be resumed)
+        else // Worker is idle waiting for work
         {
             // If work cannot be stolen from any worker, it means that all workers
             // are executing last task or sleeping waiting for more tasks, or this
@@ -911,16 +1605,9 @@ void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
             executing = std::atomic_load_explicit(&scheduler.executing, std::memory_order_acquire);
             if (executing)
             {
-                workerState->sleeping.store(true, std::memory_order_release);
-               
-                // Sleep for 10ms. Then wake up and check if any Fiber can be
-                // resumed. This is corner case that happens only on under-utilized
-                // configurations.
-                workerState->thread->sleepFor(Time(10000000));
-               
-                // <===================== SLEEP / WAKEUP ==========================>
-               
-                workerState->sleeping.store(false, std::memory_order_release);
+                // Worker is parked until new task is available, or some fiber
+                // is unblocked.
+                scheduler.park(*workerState, ParkedForTasks);
             }
         }
 
@@ -928,7 +1615,9 @@ void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
         executing = std::atomic_load_explicit(&scheduler.executing, std::memory_order_relaxed);
     }
 
-    // TODO: Worker thread is terminating, cleanup
+    // Scheduler terminates. Fibers waiting for other tasks are trashed, and
+    // worker thread is resumed so that it can exit.
+    switchToFiber(*workerState->currentFiber, *workerState->threadFiber);
 
     return nullptr;
 }
@@ -937,6 +1626,7 @@ void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
 
 
 
+
 // Select fiber to switch to (if one of wating ones can be resumed) or pick
 // other task from the queue of waiting ones. If there are no other fibers, 
 // nor tasks to switch to, go to sleep. 
@@ -958,40 +1648,84 @@ void* schedulingFunction(TaskScheduler& scheduler, uint32 thisWorker)
 
 
 
-void TaskScheduler::processMainThreadTasks(void)
+SchedulerCounters TaskScheduler::counters(const uint32 selectedWorker) const
 {
-    Task* task = nullptr;
-    DequeResult result = queueOfMainThreadTasks.take(task);
-    while(result != DequeResult::Empty)
-    { 
-        if (result == DequeResult::Success)
+    SchedulerCounters result = {};
+
+#if defined(EN_PROFILER)
+    for(uint32 i=0; i<workerThreads; ++i)
+    {
+        if (selectedWorker != InvalidWorkerId && selectedWorker != i)
         {
-            // Execute task
-            task->function(task->data);
-            
-            // Mark task as done
-            task->state->release();
-            
-            // Release completed task
-            if (task->localState)
-            {
-                deallocate<TaskState>(task->state);
-            }
+            continue;
+        }
 
-            // Task is raw data so doesn't need to call explicitly destructor
-            mainThreadTasks.deallocate(*task);
+        const WorkerProfiler& profiler = worker[i]->profiler;
+        result.tasksExecuted += profiler.value(ProfilerCounter::TasksExecuted);
+        result.tasksStolen   += profiler.value(ProfilerCounter::TasksStolen);
+        result.stealAborts   += profiler.value(ProfilerCounter::StealAborts);
+        result.fibersResumed += profiler.value(ProfilerCounter::FibersResumed);
+        result.fibersStolen  += profiler.value(ProfilerCounter::FibersStolen);
+        result.fiberSwitches += profiler.value(ProfilerCounter::FiberSwitches);
+        result.parks         += profiler.value(ProfilerCounter::Parks);
+    }
+#else
+    (void)selectedWorker;
+#endif
+
+    return result;
+}
+
+bool TaskScheduler::saveTrace(const std::string& filename) const
+{
+#if defined(EN_PROFILER)
+    std::string json = "{\"traceEvents\":[";
+
+    for(uint32 i=0; i<workerThreads; ++i)
+    {
+        // Name timeline of each worker thread
+        if (json.back() != '[')
+        {
+            json += ",\n";
         }
 
-        // Try to query next task from the queue
-        result = queueOfMainThreadTasks.take(task);
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + stringFrom(i) + ",\"args\":{\"name\":\"Worker" + stringFrom(i) + "\"}}";
+
+        worker[i]->profiler.trace(json, i);
+    }
+
+    json += "],\"displayTimeUnit\":\"ns\"}\n";
+
+    std::unique_ptr<storage::File> file(Storage->open(filename, storage::Write));
+    if (!file)
+    {
+        enLog << "ERROR: Cannot create scheduler trace file: " << filename << std::endl;
+        return false;
+    }
+
+    return file->write(json.size(), (void*)json.data());
+#else
+    (void)filename;
+    return false;
+#endif
+}
+
+void TaskScheduler::processMainThreadTasks(void)
+{
+    // Abort means that producer is in the middle of pushing next task. It will
+    // be processed on next call, instead of spinning on it.
+    Task* task = nullptr;
+    while(queueOfMainThreadTasks.take(task) == DequeResult::Success)
+    { 
+        // Execute task
+        task->function(task->data);
+        
+        // Mark task as done
+        releaseState(task->state, InvalidWorkerId);
+        
+        // Release completed task (main thread is not owning any pool)
+        releaseTask(task, InvalidWorkerId);
     }
-   
-    // It's possible that some worker threads went to sleep, as all their
-    // fibers were stalled waiting for some tasks to be finished, and
-    // there were no other tasks to execute or steal. In such corner case
-    // the only way to resume such worker execution, is to manually wake
-    // it up, if one of it's fibers is unblocked.
-    // resumeStalledWorkers(InvalidWorkerId);
 }
 
 
@@ -0,0 +1,217 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Task Graph
+ Requirements: none
+ Description : Graph of tasks with dependencies between them, that can be
+               compiled once and executed by Scheduler many times (for e.g.
+               each frame). Task is started automatically as soon as all its
+               predecessors are finished (as continuation), so no fiber needs
+               to block in wait() between stages of the graph. Executing
+               compiled graph performs no memory allocations.
+
+*/
+
+#include "parallel/taskGraph.h"
+
+#include "assert.h"
+
+#include "core/memory/alignedAllocator.h"
+#include "parallel/scheduler.h"
+
+namespace en
+{
+
+TaskGraph::TaskGraph(const uint32 _capacity) :
+    nodes(nullptr),
+    capacity(_capacity),
+    count(0),
+    successor(nullptr),
+    root(nullptr),
+    roots(0),
+    compiled(false),
+    state(nullptr),
+    edge()
+{
+    assert( capacity > 0 );
+
+    nodes = allocate<TaskGraphNode>(capacity, cacheline);
+    root  = new uint32[capacity];
+}
+
+TaskGraph::~TaskGraph()
+{
+    for(uint32 i=0; i<count; ++i)
+    {
+        nodes[i].~TaskGraphNode();
+    }
+
+    deallocate<TaskGraphNode>(nodes);
+    delete [] successor;
+    delete [] root;
+}
+
+uint32 TaskGraph::add(TaskFunction function, void* data, bool lockToCore)
+{
+    assert( function );
+    assert( count < capacity );
+
+    TaskGraphNode* node = new (&nodes[count]) TaskGraphNode();
+    node->function       = function;
+    node->data           = data;
+    node->graph          = this;
+    node->firstSuccessor = 0;
+    node->successors     = 0;
+    node->predecessors   = 0;
+    node->pending.store(0, std::memory_order_relaxed);
+    node->locked         = lockToCore;
+
+    compiled = false;
+    return count++;
+}
+
+void TaskGraph::depend(const uint32 task, const uint32 predecessor)
+{
+    assert( task < count );
+    assert( predecessor < count );
+    assert( task != predecessor );
+
+    edge.push_back(uint32v2(predecessor, task));
+    compiled = false;
+}
+
+bool TaskGraph::compile(void)
+{
+    // Successors of each node are stored in one array, one after another.
+    // First count them, then calculate where each node list starts.
+    for(uint32 i=0; i<count; ++i)
+    {
+        nodes[i].successors   = 0;
+        nodes[i].predecessors = 0;
+    }
+
+    for(auto& dependency : edge)
+    {
+        nodes[dependency.x].successors++;
+        nodes[dependency.y].predecessors++;
+    }
+
+    uint32 offset = 0;
+    for(uint32 i=0; i<count; ++i)
+    {
+        nodes[i].firstSuccessor = offset;
+        offset += nodes[i].successors;
+        nodes[i].successors = 0;
+    }
+
+    delete [] successor;
+    successor = new uint32[edge.size() > 0 ? edge.size() : 1];
+    for(auto& dependency : edge)
+    {
+        TaskGraphNode& node = nodes[dependency.x];
+        successor[node.firstSuccessor + node.successors] = dependency.y;
+        node.successors++;
+    }
+
+    roots = 0;
+    for(uint32 i=0; i<count; ++i)
+    {
+        if (nodes[i].predecessors == 0)
+        {
+            root[roots] = i;
+            roots++;
+        }
+    }
+
+    // Graph needs to be acyclic, otherwise some tasks would never start.
+    // Verify that by visiting all nodes in topological order (Kahn).
+    std::vector<uint32> pending(count);
+    std::vector<uint32> ready(root, root + roots);
+    for(uint32 i=0; i<count; ++i)
+    {
+        pending[i] = nodes[i].predecessors;
+    }
+
+    uint32 visited = 0;
+    while(!ready.empty())
+    {
+        TaskGraphNode& node = nodes[ready.back()];
+        ready.pop_back();
+        visited++;
+
+        for(uint32 i=0; i<node.successors; ++i)
+        {
+            uint32 index = successor[node.firstSuccessor + i];
+            pending[index]--;
+            if (pending[index] == 0)
+            {
+                ready.push_back(index);
+            }
+        }
+    }
+
+    compiled = (visited == count);
+    return compiled;
+}
+
+void TaskGraph::run(TaskState* _state)
+{
+    assert( compiled );
+
+    state = _state;
+
+    // All counters are reset before any task starts, as finishing root task
+    // decreases counters of its successors. Scheduler publishes them to
+    // worker threads together with submitted tasks.
+    for(uint32 i=0; i<count; ++i)
+    {
+        nodes[i].pending.store(nodes[i].predecessors, std::memory_order_relaxed);
+    }
+
+    for(uint32 i=0; i<roots; ++i)
+    {
+        TaskGraphNode& node = nodes[root[i]];
+        Scheduler->run(execute, &node, state, node.locked);
+    }
+}
+
+void TaskGraph::execute(void* data)
+{
+    TaskGraphNode* node  = (TaskGraphNode*)(data);
+    TaskGraph&     graph = *node->graph;
+
+    // Fiber executing locked task cannot migrate, so it can execute any
+    // successor. Otherwise only successors that are not locked.
+    bool lockedFiber = node->locked;
+
+    while(node)
+    {
+        node->function(node->data);
+
+        // Release successors. First one that is ready is executed directly by
+        // this task (as continuation), remaining ones are submitted to the
+        // Scheduler. Graph state is acquired by each submitted task, while
+        // this task is still holding it, so it cannot finish prematurely.
+        TaskGraphNode* continuation = nullptr;
+        for(uint32 i=0; i<node->successors; ++i)
+        {
+            TaskGraphNode& next = graph.nodes[graph.successor[node->firstSuccessor + i]];
+            if (std::atomic_fetch_sub_explicit(&next.pending, 1U, std::memory_order_acq_rel) == 1)
+            {
+                if (!continuation && (!next.locked || lockedFiber))
+                {
+                    continuation = &next;
+                }
+                else
+                {
+                    Scheduler->run(execute, &next, graph.state, next.locked);
+                }
+            }
+        }
+
+        node = continuation;
+    }
+}
+
+} // en
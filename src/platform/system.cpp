@@ -22,6 +22,15 @@
 #include <sys/sysctl.h>
 #endif
 
+#if defined(EN_PLATFORM_LINUX)
+#include "core/parallel/thread.h"
+#include <algorithm>
+#include <assert.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+
 #if defined(EN_PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -47,6 +56,8 @@ Context::Context() :
     system(OSX),
 #elif defined(EN_PLATFORM_WINDOWS)
     system(Windows),
+#elif defined(EN_PLATFORM_LINUX)
+    system(Linux),
 #else
     system(Unknown)   // Compile time assert !
 #endif
@@ -67,6 +78,41 @@ Context::Context() :
     assert( ret == 0 );
 #endif
 
+#if defined(EN_PLATFORM_LINUX)
+    // Query count of logical cores this process can execute on (it may be
+    // restricted to subset of them by cpuset of container, taskset, etc.)
+    std::vector<uint32> cores = availableCores();
+    assert( !cores.empty() );
+    logicalCores  = static_cast<uint32>(cores.size());
+    physicalCores = 0;
+
+    // Each physical core is counted once, by the logical core that is listed
+    // first in its SMT siblings list (or by first available one, if the first
+    // sibling is outside of process execution mask).
+    for(uint32 i : cores)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", i);
+
+        FILE* file = fopen(path, "r");
+        if (!file)
+        {
+            physicalCores++;
+            continue;
+        }
+
+        uint32 firstSibling = i;
+        if (fscanf(file, "%u", &firstSibling) != 1 ||
+            firstSibling == i ||
+            !std::binary_search(cores.begin(), cores.end(), firstSibling))
+        {
+            physicalCores++;
+        }
+
+        fclose(file);
+    }
+#endif
+
 #if defined(EN_PLATFORM_WINDOWS)
     SYSTEM_INFO si;
     GetSystemInfo(&si);
@@ -130,6 +176,9 @@ Context::Context() :
    
 #elif defined(EN_PLATFORM_WINDOWS)
     platform = PC;
+
+#elif defined(EN_PLATFORM_LINUX)
+    platform = PC;
     
 #else
     assert(0);
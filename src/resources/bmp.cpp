@@ -11,12 +11,13 @@
 
 #include "core/storage.h"
 #include "core/log/log.h"
+#include "core/memory/alignedAllocator.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
 #include "resources/bmp.h"
 
-#include "core/rendering/device.h"
 
+#include <assert.h>
+#include <string.h>
 #include <string>
 
 #define PageSize 4096
@@ -152,7 +153,7 @@ static_assert(sizeof(DIBHeaderV5) == 124, "en::bmp::DIBHeaderV5 size mismatch!")
 alignToDefault
 
 // Reads first 4KB page of BMP file, and decodes it's header to TextureState and ColorSpace.
-bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+bool readMetadata(const uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
 {
     // Check if file has minimum required size
     uint32 minimumFileSize = sizeof(Header) + sizeof(DIBHeaderV2Win);
@@ -163,7 +164,7 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
 
     // Read file header
-    Header& header = *reinterpret_cast<Header*>(buffer);
+    const Header& header = *reinterpret_cast<const Header*>(buffer);
     if (header.signature != 0x4D42)
     {
         enLog << "ERROR: BMP file header signature is incorrect!\n";
@@ -176,12 +177,13 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
 
     // Detect present DIB header version based on it's size
-    uint32 headerSize = *reinterpret_cast<uint32*>(buffer + sizeof(Header));
+    uint32 headerSize;
+    memcpy(&headerSize, buffer + sizeof(Header), sizeof(uint32));
 
     // Check if image is not compressed
     if (headerSize >= sizeof(DIBHeaderV3))
     {
-        DIBHeaderV3& DIBHeader = *reinterpret_cast<DIBHeaderV3*>(buffer + sizeof(Header));
+        const DIBHeaderV3& DIBHeader = *reinterpret_cast<const DIBHeaderV3*>(buffer + sizeof(Header));
         if (DIBHeader.compression != None)
         {
             enLog << "ERROR: Compressed BMP files are not supported!\n";
@@ -205,7 +207,7 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     // Determine texture resolution
     if (headerSize == sizeof(DIBHeaderV2Win))
     {
-        DIBHeaderV2Win& DIBHeader = *reinterpret_cast<DIBHeaderV2Win*>(buffer + sizeof(Header));
+        const DIBHeaderV2Win& DIBHeader = *reinterpret_cast<const DIBHeaderV2Win*>(buffer + sizeof(Header));
 
         settings.width  = DIBHeader.width;
         settings.height = DIBHeader.height < 0 ? -DIBHeader.height : DIBHeader.height;
@@ -213,16 +215,16 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     else
     if (headerSize >= sizeof(DIBHeaderV3))
     {
-        DIBHeaderV3& DIBHeader = *reinterpret_cast<DIBHeaderV3*>(buffer + sizeof(Header));
+        const DIBHeaderV3& DIBHeader = *reinterpret_cast<const DIBHeaderV3*>(buffer + sizeof(Header));
 
         settings.width  = DIBHeader.width;
         settings.height = DIBHeader.height < 0 ? -DIBHeader.height : DIBHeader.height;
     }
 
     // Determine stored texel format
-    if (headerSize >= sizeof(DIBHeaderV2Win))
+    if (headerSize == sizeof(DIBHeaderV2Win))
     {
-        DIBHeaderV2Win& DIBHeader = *reinterpret_cast<DIBHeaderV2Win*>(buffer + sizeof(Header));
+        const DIBHeaderV2Win& DIBHeader = *reinterpret_cast<const DIBHeaderV2Win*>(buffer + sizeof(Header));
 
         if (DIBHeader.bpp == 24)
         {
@@ -237,15 +239,20 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
     if (headerSize >= sizeof(DIBHeaderV3))
     {
-        DIBHeaderV3& DIBHeader = *reinterpret_cast<DIBHeaderV3*>(buffer + sizeof(Header));
+        const DIBHeaderV3& DIBHeader = *reinterpret_cast<const DIBHeaderV3*>(buffer + sizeof(Header));
 
+        if (DIBHeader.bpp == 24)
+        {
+            settings.format = gpu::Format::BGR_8;
+        }
+        else
         if (DIBHeader.bpp == 32)
         {
             settings.format = gpu::Format::BGRA_8;
         }
         else
         {
-            // 16bpp formats are not supported
+            // 1, 4, 8, 16 bpp formats are not supported
             enLog << "ERROR: Unsupported BMP bits per pixel:" << DIBHeader.bpp << "!\n";
             return false;
         }
@@ -260,121 +267,144 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     return true;
 }
 
-bool load(
-    const std::string& filename,
-    uint8* const destination,
-    const uint32 width,
-    const uint32 height,
-    const gpu::Format format,
-    const gpu::ImageMemoryAlignment alignment,
-    const bool invertHorizontal)
+storage::File* open(const std::string& filename)
 {
     using namespace en::storage;
-    using namespace en::gpu;
 
     // Open file 
     File* file = Storage->open(filename);
     if (!file)
     {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return false;
-        }
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
     }
 
+    return file;
+}
 
-    // ### Read file metadata
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
 
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
     // Read file first 4KB into single 4KB memory page
-    uint32 readSize = min(file->size(), PageSize);
+    uint32 readSize = static_cast<uint32>(min(file->size(), uint64(PageSize)));
     uint8* buffer = allocate<uint8>(readSize, PageSize);
     file->read(0, readSize, buffer);
+    delete file;
 
-    // Read file properties
-    TextureState settings;
-    ColorSpace colorSpace; // TODO: Determine file Color Space and compare with expected
     bool success = readMetadata(buffer, readSize, settings, colorSpace);
 
     // Free temporary 4KB memory page
     deallocate<uint8>(buffer);
+    return success;
+}
 
-    if (!success)
+bool load(
+    const std::string& filename,
+    uint8* const destination,
+    const uint32 width,
+    const uint32 height,
+    const gpu::Format format,
+    const gpu::ImageMemoryAlignment alignment,
+    const bool invertHorizontal)
+{
+    using namespace en::storage;
+    using namespace en::gpu;
+
+    File* file = open(filename);
+    if (!file)
     {
-        delete file;
         return false;
     }
 
-    // Verify that file matches expected properties
-    if ((settings.width  != width)  ||
-        (settings.height != height) ||
-        (settings.format != format))
+    // Map whole file to memory, so that rows are copied directly
+    // from OS page cache (without reading file to memory first).
+    uint64 fileSize = file->size();
+    FileView* view = file->map(0u, fileSize, MapHint::Sequential);
+    if (!view)
     {
+        enLog << "ERROR: Couldn't read file to memory.\n";
         delete file;
         return false;
     }
 
+    const uint8* content = view->data();
 
-    // ### Read file to memory
 
+    // ### Read file metadata
 
-    // Read whole file at once to memory. 
-    // Size aligned to multiple of 4KB Page Size, and allocated at such boundary (can be memory mapped).
-    uint64 fileSize = file->size();
-    uint64 roundedSize = roundUp(fileSize, PageSize);
-    uint8* content = allocate<uint8>(roundedSize, PageSize);
-    if (!file->read(content))
+
+    // Read file properties
+    TextureState settings;
+    ColorSpace colorSpace; // TODO: Determine file Color Space and compare with expected
+    uint32 readSize = static_cast<uint32>(min(fileSize, uint64(PageSize)));
+    if (!readMetadata(content, readSize, settings, colorSpace))
     {
-        enLog << "ERROR: Couldn't read file to memory.\n";
-        deallocate<uint8>(content);
+        delete view;
         delete file;
         return false;
     }
 
-    // Release file handle and work on copy in memory
-    delete file;
+    // Verify that file matches expected properties
+    uint32 texelSize = settings.format == Format::BGRA_8 ? 4 : 3;
+    if ((settings.width  != width)  ||
+        (settings.height != height) ||
+        (settings.format != format) ||
+        (alignment.texelPitch() != texelSize))
+    {
+        delete view;
+        delete file;
+        return false;
+    }
 
 
-    // ### Parse and decompress file 
+    // ### Copy rows
 
 
-    // Calculate size of raw data to read
-    uint32 dataSize = 0;
-    uint32 headerSize = *reinterpret_cast<uint32*>(content + sizeof(Header));
-    if (headerSize >= sizeof(DIBHeaderV3))
+    // Rows are stored from bottom to top, unless height is negative.
+    // Each of them is padded to multiple of 4 bytes.
+    bool topDown = false;
+    uint32 headerSize;
+    memcpy(&headerSize, content + sizeof(Header), sizeof(uint32));
+    if (headerSize == sizeof(DIBHeaderV2Win))
     {
-        DIBHeaderV3& DIBHeader = *reinterpret_cast<DIBHeaderV3*>(content + sizeof(Header));
-        dataSize = DIBHeader.size;
+        topDown = reinterpret_cast<const DIBHeaderV2Win*>(content + sizeof(Header))->height < 0;
     }
     else
+    if (headerSize >= sizeof(DIBHeaderV3))
     {
-        dataSize = settings.surfaceSize(0);
+        topDown = reinterpret_cast<const DIBHeaderV3*>(content + sizeof(Header))->height < 0;
     }
 
-    // Verify that data is correct
-    Header& header = *reinterpret_cast<Header*>(content);
-    if ( (header.size != fileSize) ||
-         (header.dataOffset + dataSize > header.size) )
+    const Header& header = *reinterpret_cast<const Header*>(content);
+    uint32 rowSize   = width * texelSize;
+    uint32 srcPitch  = roundUp(rowSize, 4u);
+    uint32 dstPitch  = alignment.rowPitch(width);
+    if (header.dataOffset + static_cast<uint64>(srcPitch) * height > fileSize)
     {
         enLog << "ERROR: File or its header is corrupted.\n";
-        deallocate<uint8>(content);
+        delete view;
+        delete file;
         return false;
     }
-    if (dataSize != alignment.surfaceSize(settings.width, settings.height))
+
+    topDown = topDown != invertHorizontal;
+    const uint8* src = content + header.dataOffset;
+    for(uint32 y=0; y<height; ++y)
     {
-        enLog << "ERROR: Data layout in memory is not matching expected layout in destination.\n";
-        deallocate<uint8>(content);
-        return false;
+        uint32 row = topDown ? y : height - y - 1;
+        memcpy(destination + static_cast<uint64>(row) * dstPitch, src + static_cast<uint64>(y) * srcPitch, rowSize);
     }
 
-    // Copy data
-    memcpy(destination, content + header.dataOffset, dataSize);
-
-    // Release temporary data
-    deallocate<uint8>(content);
+    delete view;
+    delete file;
     return true;
 }
 
@@ -394,13 +424,9 @@ bool save(
     File* file = Storage->open(filename, en::storage::Write);
     if (!file)
     {
-        file = Storage->open(en::ResourcesContext.path.screenshots + filename, en::storage::Write);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.screenshots + filename << std::endl;
-            enLog << "ERROR: Cannot create such file!\n";
-            return false;
-        }
+        enLog << filename << std::endl;
+        enLog << "ERROR: Cannot create such file!\n";
+        return false;
     }
 
     uint32 headersSize = sizeof(Header) + sizeof(DIBHeaderV2Win);
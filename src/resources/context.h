@@ -146,6 +146,28 @@ class FontImp : public Font
    ~FontImp();
 };
 
+// Material declared in MTL library. Library is parsed once, while
+// textures are loaded when material is requested for the first time.
+struct MaterialEntry
+{
+    std::string albedo;       // Names of textures referenced by material
+    std::string normal;
+    std::string displacement;
+    std::string opacity;
+    Material    material;     // Material with loaded textures
+    bool        resolved;     // Textures of material were loaded
+
+    MaterialEntry();
+};
+
+struct MaterialLibrary
+{
+    bool valid;               // Library file was found and read
+    std::map<std::string, MaterialEntry> materials;
+
+    MaterialLibrary();
+};
+
 struct Context
 {
     struct Storage
@@ -201,6 +223,7 @@ struct Context
     std::map<std::string, std::shared_ptr<FontImp> >       fonts;
     std::map<std::string, std::shared_ptr<Model> >         models;
     std::map<std::string, Material>            materials;
+    std::map<std::string, MaterialLibrary>     libraries;      // Parsed MTL files
     std::map<std::string, std::unique_ptr<gpu::Texture> >  textures;
     std::map<std::string, std::shared_ptr<audio::Sample> > sounds;
 
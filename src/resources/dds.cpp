@@ -10,18 +10,18 @@
 
 #include "core/storage.h"
 #include "core/log/log.h"
+#include "core/memory/alignment.h"
 #include "core/rendering/texture.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
 #include "resources/dds.h"
 
-#include "core/rendering/device.h"
 
 #if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
 #include "zlib.h"
 #endif
 using namespace en::gpu;
 
+#include <string.h>
 #include <string>
 
 namespace en
@@ -68,11 +68,6 @@ namespace dds
 // DDS_HEADER_DXT10.miscFlag
 #define DDS_RESOURCE_MISC_TEXTURECUBE 0x00000004
 
-#if defined(EN_PLATFORM_OSX)
-#define DWORD uint32
-#define UINT  uint32
-#endif
-
 typedef enum D3D10_RESOURCE_DIMENSION 
 { 
     D3D10_RESOURCE_DIMENSION_UNKNOWN    = 0,
@@ -252,33 +247,33 @@ alignTo(1)
 // 32 bytes
 struct DDS_PIXELFORMAT 
 {
-    DWORD dwSize;
-    DWORD dwFlags;
-    DWORD dwFourCC;
-    DWORD dwRGBBitCount;
-    DWORD dwRBitMask;
-    DWORD dwGBitMask;
-    DWORD dwBBitMask;
-    DWORD dwABitMask;
+    uint32 dwSize;
+    uint32 dwFlags;
+    uint32 dwFourCC;
+    uint32 dwRGBBitCount;
+    uint32 dwRBitMask;
+    uint32 dwGBitMask;
+    uint32 dwBBitMask;
+    uint32 dwABitMask;
 };
 
 // 124 bytes in total
 typedef struct 
 {
-    DWORD           dwSize;
-    DWORD           dwFlags;
-    DWORD           dwHeight;
-    DWORD           dwWidth;
-    DWORD           dwPitchOrLinearSize;
-    DWORD           dwDepth;
-    DWORD           dwMipMapCount;
-    DWORD           dwReserved1[11];
+    uint32          dwSize;
+    uint32          dwFlags;
+    uint32          dwHeight;
+    uint32          dwWidth;
+    uint32          dwPitchOrLinearSize;
+    uint32          dwDepth;
+    uint32          dwMipMapCount;
+    uint32          dwReserved1[11];
     DDS_PIXELFORMAT ddspf;
-    DWORD           dwCaps;
-    DWORD           dwCaps2;
-    DWORD           dwCaps3;
-    DWORD           dwCaps4;
-    DWORD           dwReserved2;
+    uint32          dwCaps;
+    uint32          dwCaps2;
+    uint32          dwCaps3;
+    uint32          dwCaps4;
+    uint32          dwReserved2;
 } DDS_HEADER;
    
 // 20 bytes
@@ -286,12 +281,16 @@ typedef struct
 {
     DXGI_FORMAT              dxgiFormat;
     D3D10_RESOURCE_DIMENSION resourceDimension;
-    UINT                     miscFlag;
-    UINT                     arraySize;
-    UINT                     miscFlags2;
+    uint32                   miscFlag;
+    uint32                   arraySize;
+    uint32                   miscFlags2;
 } DDS_HEADER_DXT10;
 alignToDefault
 
+static_assert(sizeof(DDS_PIXELFORMAT) == 32, "en::dds::DDS_PIXELFORMAT size mismatch!");
+static_assert(sizeof(DDS_HEADER) == 124, "en::dds::DDS_HEADER size mismatch!");
+static_assert(sizeof(DDS_HEADER_DXT10) == 20, "en::dds::DDS_HEADER_DXT10 size mismatch!");
+
 bool DetermineTextureType(DDS_HEADER& header, DDS_HEADER_DXT10* header10, gpu::TextureType& type)
 {
     using namespace en::gpu;
@@ -592,33 +591,33 @@ bool DetectTextureFormat(DDS_HEADER& header, DDS_HEADER_DXT10* header10, Format&
     return false;
 }
 
-std::shared_ptr<gpu::Texture> load(const std::string& filename)
+storage::File* open(const std::string& filename)
 {
     using namespace en::storage;
-    using namespace en::gpu;
-    //assert( Gpu.screen.created() );
-
-    uint64 offset = 0;
 
     // Open file
     File* file = Storage->open(filename);
     if (!file)
     {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return std::shared_ptr<gpu::Texture>(nullptr);
-        }
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
     }
+
+    return file;
+}
+
+// Reads DDS headers and determines texture parameters. Offset is set to 
+// location of first surface.
+bool readHeader(storage::File* file, gpu::TextureState& settings, uint64& offset)
+{
+    offset = 0;
  
     // Verify minimum file size
     if (file->size() < 128)
     {
         enLog << "ERROR: DDS file size is incorrect, file corrupted!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        return false;
     }
 
     // Verify DDS file signature 'DDS ' -> 0x20534444
@@ -627,8 +626,7 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
     if (signature != 0x20534444)
     {
         enLog << "ERROR: DDS file header signature is incorrect!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        return false;
     }   
 
     // Verify file header struct size
@@ -638,8 +636,7 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
     if (headerSize != 124)
     {
         enLog << "ERROR: DDS file header size is incorrect!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        return false;
     }
 
     // Read default file header, and check if additional DX10/DX11 
@@ -657,8 +654,7 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
             if (file->size() < 148)
             {
                 enLog << "ERROR: DDS file size is incorrect, file corrupted!\n";
-                delete file;
-                return std::shared_ptr<gpu::Texture>(nullptr);
+                return false;
             }
 
             file->read(offset, 20, &header10);
@@ -672,8 +668,7 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
     if (!DetermineTextureType(header, (supportArrays ? &header10 : nullptr), type))
     {
         enLog << "ERROR: DDS texture type unsupported!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        return false;
     }
 
     // Determine texture format stored in DDS
@@ -681,12 +676,11 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
     if (!DetectTextureFormat(header, (supportArrays ? &header10 : nullptr), format))
     {
         enLog << "ERROR: DDS texture format unsupported!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        return false;
     }
 
     // Determine texture state
-    TextureState settings;
+    settings = TextureState();
     settings.type   = type;
     settings.format = format;
     settings.width  = static_cast<uint16>(header.dwWidth);
@@ -720,73 +714,138 @@ std::shared_ptr<gpu::Texture> load(const std::string& filename)
         settings.layers *= 6;
     }
 
-    // Create texture in GPU
-    std::unique_ptr<gpu::Texture> texture(en::ResourcesContext.defaults.enHeapTextures->createTexture(settings));
-    if (!texture)
+    return true;
+}
+
+// Location of surface in file. Layers are stored one after another, each
+// with its whole mip-map chain. 3D textures store all depth slices of each
+// mip-map one after another instead.
+uint64 surfaceOffset(const gpu::TextureState& settings, uint64 offset, const uint32 mipmap, const uint32 layer)
+{
+    if (settings.type == TextureType::Texture3D)
+    {
+        for(uint32 i=0; i<mipmap; ++i)
+        {
+            offset += static_cast<uint64>(settings.surfaceSize(i)) * settings.mipDepth(i);
+        }
+
+        return offset + static_cast<uint64>(layer) * settings.surfaceSize(mipmap);
+    }
+
+    uint64 chainSize = 0;
+    for(uint32 i=0; i<settings.mipmaps; ++i)
     {
-        enLog << "ERROR: Cannot create texture in GPU!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>(nullptr);
+        chainSize += settings.surfaceSize(i);
     }
 
-    // Load layers and mipmaps of texture to GPU
-    for(uint32 layer=0; layer<settings.layers; ++layer)
+    offset += layer * chainSize;
+    for(uint32 i=0; i<mipmap; ++i)
     {
-        uint32 mipDepth = settings.type == TextureType::Texture3D ? settings.layers : 1;
-        for(uint32 mipmap=0; mipmap<settings.mipmaps; ++mipmap)
-        {
-            for(uint32 slice=0; slice<mipDepth; ++slice)
-            {
-                // Stream given surface from file to GPU memory
-                uint64 surfaceSize = texture->size(mipmap);
-            
-                // Create staging buffer
-                std::unique_ptr<gpu::Buffer> staging(en::ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, static_cast<uint32>(surfaceSize)));
-                if (!staging)
-                {
-                    enLog << "ERROR: Cannot create staging buffer!\n";
-                    delete file;
-                    return texture;
-                }
+        offset += settings.surfaceSize(i);
+    }
 
-                // Read texture to temporary buffer
-                volatile void* ptr = staging->map();
-                file->read(offset, static_cast<uint32>(surfaceSize), ptr);
-                staging->unmap();
-          
-                // TODO: In future distribute transfers to different queues in the same queue type family
-                gpu::QueueType type = gpu::QueueType::Universal;
-                if (Graphics->primaryDevice()->queues(gpu::QueueType::Transfer) > 0u)
-                {
-                   type = gpu::QueueType::Transfer;
-                }
+    return offset;
+}
 
-                // Copy data from staging buffer to final texture
-                std::shared_ptr<gpu::CommandBuffer> command = Graphics->primaryDevice()->createCommandBuffer(type);
-                command->start();
-                command->copy(*staging, 0u, settings.rowSize(mipmap), *texture, mipmap, slice);
-                command->commit();
-            
-                // TODO:
-                // here return completion handler callback !!! (no waiting for completion)
-                // - this callback destroys CommandBuffer object
-                // - destroys staging buffer
-                //
-                // Till it's done, wait for completion:
-            
-                command->waitUntilCompleted();
-                command = nullptr;
-                staging = nullptr;
-
-                offset += surfaceSize;
-            }
+// Copies rows of surface (or rows of compressed blocks) from file to destination
+bool readSurface(storage::File* file, 
+                 const gpu::TextureState& settings, 
+                 const uint64 offset, 
+                 const uint32 mipmap, 
+                 const uint32 layer, 
+                 uint8* const destination, 
+                 const gpu::ImageMemoryAlignment alignment)
+{
+    using namespace en::storage;
+
+    uint64 location = surfaceOffset(settings, offset, mipmap, layer);
+    uint32 size     = settings.surfaceSize(mipmap);
+    if (location + size > file->size())
+    {
+        enLog << "ERROR: DDS file size is incorrect, file corrupted!\n";
+        return false;
+    }
 
-            mipDepth = max(1U, mipDepth >> 1);
+    uint32 rows     = settings.rowsCount(mipmap);
+    uint32 rowSize  = settings.rowSize(mipmap);
+    uint32 rowPitch = roundUp(rowSize, alignment.rowAlignment());
+
+    // Tightly packed surface is read at once
+    if (rowPitch == rowSize)
+    {
+        return file->read(location, size, destination);
+    }
+
+    FileView* view = file->map(location, size, MapHint::Sequential);
+    if (!view)
+    {
+        enLog << "ERROR: Cannot read DDS file!\n";
+        return false;
+    }
+
+    const uint8* src = view->data();
+    for(uint32 y=0; y<rows; ++y)
+    {
+        memcpy(destination + static_cast<uint64>(y) * rowPitch, src + static_cast<uint64>(y) * rowSize, rowSize);
+    }
+
+    delete view;
+    return true;
+}
+
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
+
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
+
+    uint64 offset = 0;
+    bool success = readHeader(file, settings, offset);
+    delete file;
+
+    // Transfer function is part of texel format
+    colorSpace = ColorSpaceLinear;
+    return success;
+}
+
+bool load(const std::string& filename,
+          const uint32 mipmap,
+          const uint32 layer,
+          uint8* const destination,
+          const gpu::ImageMemoryAlignment alignment)
+{
+    using namespace en::storage;
+
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
+
+    TextureState settings;
+    uint64 offset = 0;
+    bool success = readHeader(file, settings, offset);
+    if (success)
+    {
+        uint32 layers = settings.type == TextureType::Texture3D ? settings.mipDepth(mipmap) : settings.layers;
+        if (mipmap >= settings.mipmaps ||
+            layer  >= layers)
+        {
+            enLog << "ERROR: DDS file doesn't contain requested surface!\n";
+            success = false;
+        }
+        else
+        {
+            success = readSurface(file, settings, offset, mipmap, layer, destination, alignment);
         }
-    }	
+    }
 
     delete file;
-    return texture;
+    return success;
 }
 
 } // en::dds
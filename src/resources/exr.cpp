@@ -12,17 +12,25 @@
 #include "core/storage.h"
 #include "core/log/log.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
 #include "resources/exr.h"
 
-#include "core/rendering/device.h"
 
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
+#include "parallel/scheduler.h"
+
+#if defined(EN_PLATFORM_LINUX) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
 #include "zlib.h"
 #endif
 
+#if defined(EN_ARCHITECTURE_X64)
+#include <emmintrin.h>
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <string>
+#include <vector>
 
 namespace en
 {
@@ -160,72 +168,1087 @@ bool CheckError(sint32 code)
     {
         enLog << "Error: Zlib cannot read chunk!\n";
     }
-    else
-    if (code == Z_STREAM_ERROR)
+    else
+    if (code == Z_STREAM_ERROR)
+    {
+        enLog << "Error: Zlib invalid compression level!\n";
+    }
+    else
+    if (code == Z_DATA_ERROR)
+    {
+        enLog << "Error: Zlib invalid or incomplete chunk!\n";
+    }
+    else
+    if (code == Z_MEM_ERROR)
+    {
+        enLog << "Error: Zlib reports out of memory!\n";
+    }
+    else
+    if (code == Z_BUF_ERROR)
+    {
+        enLog << "Error: Zlib output buffer is to small!\n";
+    }
+    else
+    if (code == Z_VERSION_ERROR)
+    {
+        enLog << "Error: Zlib version mismatch!\n";
+    }
+    else
+    {
+        enLog << "Error: Zlib unknown error code " << code << "!\n";
+    }
+
+    return true;
+}
+
+// Chunks of image are decoded in parallel by worker threads. Each worker
+// reuses its own decompression state and buffers for all chunks it decodes.
+
+// PIZ Huffman coding
+constexpr uint32 HuffmanEncodingBits = 16;
+constexpr uint32 HuffmanEncodingSize = (1 << HuffmanEncodingBits) + 1; // Count of symbols (including run-length symbol)
+constexpr uint32 HuffmanDecodingBits = 14;                             // Codes up to that length are decoded with single lookup
+constexpr uint32 HuffmanDecodingSize = 1 << HuffmanDecodingBits;
+constexpr uint32 HuffmanDecodingMask = HuffmanDecodingSize - 1;
+constexpr uint32 ShortZeroCodeRun    = 59;                             // Code lengths of 59-62 encode runs of 2-5 zero lengths
+constexpr uint32 LongZeroCodeRun     = 63;                             // Code length of 63 is followed by 8 bit length of zero lengths run
+constexpr uint32 ShortestLongRun     = 2 + LongZeroCodeRun - ShortZeroCodeRun;
+constexpr uint32 MaxCodeLength       = 58;
+
+// PIZ wavelet transform
+constexpr uint32 BitmapSize          = 8192;                           // Bitmap of 16 bit values present in chunk
+
+struct HuffmanDecoder
+{
+    uint32 length;  // Length of short code (0 if entry holds long codes)
+    uint32 literal; // Symbol of short code, or count of long codes
+    uint32 first;   // Index of first long code in table of long codes
+};
+
+struct Scratch
+{
+    z_stream stream;                     // Inflate state (reset before each chunk)
+    bool     initialized;                // Inflate state was initialized
+    std::vector<uint8>  buffer;          // Decompressed chunk, with planar lines
+    std::vector<uint8>  temp;            // Intermediate output of codecs
+    std::vector<uint64> codes;           // Huffman canonical codes (PIZ)
+    std::vector<HuffmanDecoder> table;   // Huffman decoding table (PIZ)
+    std::vector<uint32> longCodes;       // Symbols of codes longer than decoding bits (PIZ)
+    std::vector<uint16> lut;             // Reverse lookup of wavelet values (PIZ)
+
+    Scratch();
+   ~Scratch();
+};
+
+Scratch::Scratch() :
+    initialized(false)
+{
+}
+
+Scratch::~Scratch()
+{
+    if (initialized)
+    {
+        inflateEnd(&stream);
+    }
+}
+
+// Reverts byte delta predictor and splits interleaved halves of chunk, that
+// ZIP and RLE compressions apply to data before compressing it.
+void reconstruct(uint8* data, uint8* output, const uint64 size)
+{
+    for(uint64 i=1; i<size; ++i)
+    {
+        data[i] = static_cast<uint8>(data[i - 1] + data[i] - 128);
+    }
+
+    const uint8* first  = data;
+    const uint8* second = data + (size + 1) / 2;
+    uint64 i = 0;
+    for(; i+1<size; i+=2)
+    {
+        output[i]     = *first++;
+        output[i + 1] = *second++;
+    }
+    if (i < size)
+    {
+        output[i] = *first;
+    }
+}
+
+// Negative count is followed by that many literal bytes, positive one by
+// single byte repeated count + 1 times.
+bool decompressRLE(const uint8* input, const uint64 size, uint8* output, const uint64 expected)
+{
+    const uint8* end = input + size;
+    uint64 written = 0;
+    while(input < end)
+    {
+        sint8 count = static_cast<sint8>(*input++);
+        if (count < 0)
+        {
+            uint64 literals = static_cast<uint64>(-count);
+            if (literals > static_cast<uint64>(end - input) ||
+                literals > expected - written)
+            {
+                return false;
+            }
+
+            memcpy(output + written, input, literals);
+            input   += literals;
+            written += literals;
+        }
+        else
+        {
+            uint64 repeat = static_cast<uint64>(count) + 1;
+            if (input == end ||
+                repeat > expected - written)
+            {
+                return false;
+            }
+
+            memset(output + written, *input++, repeat);
+            written += repeat;
+        }
+    }
+
+    return written == expected;
+}
+
+bool decompressZIP(Scratch& scratch, const uint8* input, const uint64 size, uint8* output, const uint64 expected)
+{
+    if (!scratch.initialized)
+    {
+        scratch.stream.zalloc   = Z_NULL;
+        scratch.stream.zfree    = Z_NULL;
+        scratch.stream.opaque   = Z_NULL;
+        scratch.stream.next_in  = Z_NULL;
+        scratch.stream.avail_in = 0;
+        if (CheckError(inflateInit(&scratch.stream)))
+        {
+            enLog << "Error: Cannot initialize Zlib decompressor!\n";
+            return false;
+        }
+
+        scratch.initialized = true;
+    }
+    else
+    {
+        inflateReset(&scratch.stream);
+    }
+
+    scratch.stream.next_in   = const_cast<uint8*>(input);    // Compressed data
+    scratch.stream.avail_in  = static_cast<uInt>(size);      // Size of compressed data
+    scratch.stream.next_out  = output;                       // Output destination
+    scratch.stream.avail_out = static_cast<uInt>(expected);  // Available space for uncompressed data
+
+    sint32 ret = inflate(&scratch.stream, Z_FINISH);
+    if (ret != Z_STREAM_END ||
+        scratch.stream.total_out != expected)
+    {
+        CheckError(ret);
+        enLog << "Error: Cannot decompress using ZLIB!\n";
+        return false;
+    }
+
+    return true;
+}
+
+// Reads bits from input, most significant bit first
+struct BitReader
+{
+    uint64       buffer; // Bits read from input
+    sint32       bits;   // Count of bits not consumed yet
+    const uint8* input;
+    const uint8* end;
+    bool         overrun;
+
+    BitReader(const uint8* input, const uint8* end);
+    uint64 read(const uint32 count);
+};
+
+BitReader::BitReader(const uint8* _input, const uint8* _end) :
+    buffer(0),
+    bits(0),
+    input(_input),
+    end(_end),
+    overrun(false)
+{
+}
+
+uint64 BitReader::read(const uint32 count)
+{
+    while(bits < static_cast<sint32>(count))
+    {
+        buffer <<= 8;
+        if (input < end)
+        {
+            buffer |= *input++;
+        }
+        else
+        {
+            overrun = true;
+        }
+        bits += 8;
+    }
+
+    bits -= count;
+    return (buffer >> bits) & ((1ull << count) - 1);
+}
+
+// Code lengths are stored in 6 bits, with runs of zero lengths packed.
+// Canonical codes are generated from them, and stored as (code << 6) | length.
+bool readHuffmanCodes(Scratch& scratch, BitReader& reader, uint32 first, const uint32 last)
+{
+    uint64* codes = scratch.codes.data();
+    memset(codes, 0, sizeof(uint64) * HuffmanEncodingSize);
+
+    for(; first<=last; ++first)
+    {
+        if (reader.input >= reader.end && reader.bits < 6)
+        {
+            return false;
+        }
+
+        uint64 length = reader.read(6);
+        codes[first] = length;
+        if (length == LongZeroCodeRun)
+        {
+            uint32 run = static_cast<uint32>(reader.read(8)) + ShortestLongRun;
+            if (first + run > last + 1)
+            {
+                return false;
+            }
+
+            memset(codes + first, 0, sizeof(uint64) * run);
+            first += run - 1;
+        }
+        else
+        if (length >= ShortZeroCodeRun)
+        {
+            uint32 run = static_cast<uint32>(length) - ShortZeroCodeRun + 2;
+            if (first + run > last + 1)
+            {
+                return false;
+            }
+
+            memset(codes + first, 0, sizeof(uint64) * run);
+            first += run - 1;
+        }
+    }
+
+    // Count codes of each length, and assign first code to each length
+    uint64 count[MaxCodeLength + 1] = { 0 };
+    for(uint32 i=0; i<HuffmanEncodingSize; ++i)
+    {
+        count[codes[i]]++;
+    }
+
+    uint64 code = 0;
+    for(sint32 i=MaxCodeLength; i>0; --i)
+    {
+        uint64 next = (code + count[i]) >> 1;
+        count[i] = code;
+        code = next;
+    }
+
+    for(uint32 i=0; i<HuffmanEncodingSize; ++i)
+    {
+        uint64 length = codes[i];
+        if (length > 0)
+        {
+            codes[i] = length | (count[length]++ << 6);
+        }
+    }
+
+    return true;
+}
+
+// Codes up to decoding bits long are decoded with single lookup, longer ones
+// are searched in list of codes sharing the same prefix.
+bool buildHuffmanTable(Scratch& scratch, const uint32 first, const uint32 last)
+{
+    const uint64*   codes = scratch.codes.data();
+    HuffmanDecoder* table = scratch.table.data();
+    memset(table, 0, sizeof(HuffmanDecoder) * HuffmanDecodingSize);
+
+    // Short codes fill all entries starting with them, long codes are counted
+    uint32 longCodes = 0;
+    for(uint32 i=first; i<=last; ++i)
+    {
+        uint64 code   = codes[i] >> 6;
+        uint32 length = static_cast<uint32>(codes[i] & 63);
+        if (code >> length)
+        {
+            return false;
+        }
+
+        if (length > HuffmanDecodingBits)
+        {
+            HuffmanDecoder& entry = table[code >> (length - HuffmanDecodingBits)];
+            if (entry.length)
+            {
+                return false;
+            }
+
+            entry.literal++;
+            longCodes++;
+        }
+        else
+        if (length)
+        {
+            HuffmanDecoder* entry = table + (code << (HuffmanDecodingBits - length));
+            for(uint64 j=1ull << (HuffmanDecodingBits - length); j>0; --j, ++entry)
+            {
+                if (entry->length || entry->literal)
+                {
+                    return false;
+                }
+
+                entry->length  = length;
+                entry->literal = i;
+            }
+        }
+    }
+
+    // Long codes are stored in lists per prefix
+    uint32 offset = 0;
+    for(uint32 i=0; i<HuffmanDecodingSize; ++i)
+    {
+        if (!table[i].length)
+        {
+            table[i].first   = offset;
+            offset          += table[i].literal;
+            table[i].literal = 0;
+        }
+    }
+
+    scratch.longCodes.resize(longCodes);
+    for(uint32 i=first; i<=last; ++i)
+    {
+        uint64 code   = codes[i] >> 6;
+        uint32 length = static_cast<uint32>(codes[i] & 63);
+        if (length > HuffmanDecodingBits)
+        {
+            HuffmanDecoder& entry = table[code >> (length - HuffmanDecodingBits)];
+            scratch.longCodes[entry.first + entry.literal] = i;
+            entry.literal++;
+        }
+    }
+
+    return true;
+}
+
+// Emits decoded symbol. Run-length symbol is followed by 8 bit count of
+// repetitions of previous symbol.
+forceinline bool emitSymbol(const uint32 symbol, const uint32 runLengthSymbol, uint64& buffer, sint32& bits, const uint8*& input, const uint8* end, uint16*& output, const uint16* begin, const uint16* last)
+{
+    if (symbol == runLengthSymbol)
+    {
+        if (bits < 8)
+        {
+            if (input >= end)
+            {
+                return false;
+            }
+
+            buffer = (buffer << 8) | *input++;
+            bits  += 8;
+        }
+
+        bits -= 8;
+        uint32 count = static_cast<uint8>(buffer >> bits);
+        if (output + count > last ||
+            output == begin)
+        {
+            return false;
+        }
+
+        uint16 value = output[-1];
+        while(count-- > 0)
+        {
+            *output++ = value;
+        }
+    }
+    else
+    {
+        if (output >= last)
+        {
+            return false;
+        }
+
+        *output++ = static_cast<uint16>(symbol);
+    }
+
+    return true;
+}
+
+bool decodeHuffman(const Scratch& scratch, const uint8* input, const uint64 lengthInBits, const uint32 runLengthSymbol, uint16* output, const uint64 count)
+{
+    const uint64*         codes = scratch.codes.data();
+    const HuffmanDecoder* table = scratch.table.data();
+    const uint16* begin = output;
+    const uint16* last  = output + count;
+    const uint8*  end   = input + (lengthInBits + 7) / 8;
+
+    uint64 buffer = 0;
+    sint32 bits   = 0;
+    while(input < end)
+    {
+        buffer = (buffer << 8) | *input++;
+        bits  += 8;
+
+        while(bits >= static_cast<sint32>(HuffmanDecodingBits))
+        {
+            const HuffmanDecoder& entry = table[(buffer >> (bits - HuffmanDecodingBits)) & HuffmanDecodingMask];
+            if (entry.length)
+            {
+                bits -= entry.length;
+                if (!emitSymbol(entry.literal, runLengthSymbol, buffer, bits, input, end, output, begin, last))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                // Search for long code with that prefix
+                uint32 j = 0;
+                for(; j<entry.literal; ++j)
+                {
+                    uint32 symbol = scratch.longCodes[entry.first + j];
+                    sint32 length = static_cast<sint32>(codes[symbol] & 63);
+                    while(bits < length && input < end)
+                    {
+                        buffer = (buffer << 8) | *input++;
+                        bits  += 8;
+                    }
+
+                    if (bits >= length &&
+                        (codes[symbol] >> 6) == ((buffer >> (bits - length)) & ((1ull << length) - 1)))
+                    {
+                        bits -= length;
+                        if (!emitSymbol(symbol, runLengthSymbol, buffer, bits, input, end, output, begin, last))
+                        {
+                            return false;
+                        }
+
+                        break;
+                    }
+                }
+
+                if (j == entry.literal)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Remaining codes are shorter than decoding bits (padding bits are dropped)
+    sint32 padding = (8 - static_cast<sint32>(lengthInBits & 7)) & 7;
+    buffer >>= padding;
+    bits    -= padding;
+    while(bits > 0)
+    {
+        const HuffmanDecoder& entry = table[(buffer << (HuffmanDecodingBits - bits)) & HuffmanDecodingMask];
+        if (!entry.length ||
+            static_cast<sint32>(entry.length) > bits)
+        {
+            return false;
+        }
+
+        bits -= entry.length;
+        if (!emitSymbol(entry.literal, runLengthSymbol, buffer, bits, input, end, output, begin, last))
+        {
+            return false;
+        }
+    }
+
+    return output == last;
+}
+
+bool decompressHuffman(Scratch& scratch, const uint8* input, const uint64 size, uint16* output, const uint64 count)
+{
+    if (size == 0)
+    {
+        return count == 0;
+    }
+
+    // Header: first and last symbol, table length, data length in bits
+    if (size < 20)
+    {
+        return false;
+    }
+
+    uint32 first = 0;
+    uint32 last  = 0;
+    uint32 bits  = 0;
+    memcpy(&first, input,      4);
+    memcpy(&last,  input + 4,  4);
+    memcpy(&bits,  input + 12, 4);
+    if (first >= HuffmanEncodingSize ||
+        last  >= HuffmanEncodingSize ||
+        first > last)
+    {
+        return false;
+    }
+
+    scratch.codes.resize(HuffmanEncodingSize);
+    scratch.table.resize(HuffmanDecodingSize);
+
+    BitReader reader(input + 20, input + size);
+    if (!readHuffmanCodes(scratch, reader, first, last) ||
+        reader.overrun ||
+        !buildHuffmanTable(scratch, first, last))
+    {
+        return false;
+    }
+
+    const uint8* data = reader.input;
+    if (bits > 8 * static_cast<uint64>(input + size - data))
+    {
+        return false;
+    }
+
+    return decodeHuffman(scratch, data, bits, last, output, count);
+}
+
+// Wavelet basis for 14 bit values
+forceinline void waveletDecode14(const uint16 l, const uint16 h, uint16& a, uint16& b)
+{
+    sint16 ls = static_cast<sint16>(l);
+    sint16 hs = static_cast<sint16>(h);
+    sint32 hi = hs;
+    sint32 ai = ls + (hi & 1) + (hi >> 1);
+    a = static_cast<uint16>(static_cast<sint16>(ai));
+    b = static_cast<uint16>(static_cast<sint16>(ai - hi));
+}
+
+// Wavelet basis for 16 bit values (modulo arithmetic)
+forceinline void waveletDecode16(const uint16 l, const uint16 h, uint16& a, uint16& b)
+{
+    sint32 m  = l;
+    sint32 d  = h;
+    sint32 bb = (m - (d >> 1)) & 0xFFFF;
+    sint32 aa = (d + bb - 0x8000) & 0xFFFF;
+    b = static_cast<uint16>(bb);
+    a = static_cast<uint16>(aa);
+}
+
+template<bool Bits14>
+forceinline void waveletDecode(const uint16 l, const uint16 h, uint16& a, uint16& b)
+{
+    if (Bits14)
+    {
+        waveletDecode14(l, h, a, b);
+    }
+    else
+    {
+        waveletDecode16(l, h, a, b);
+    }
+}
+
+// Reverts 2D Haar wavelet transform of nx x ny values, stored with given
+// distance between values in row (ox) and between rows (oy).
+template<bool Bits14>
+void waveletDecode(uint16* in, const sint32 nx, const sint32 ox, const sint32 ny, const sint32 oy)
+{
+    sint32 n = nx > ny ? ny : nx;
+    sint32 p = 1;
+    while(p <= n)
+    {
+        p <<= 1;
+    }
+
+    p >>= 1;
+    sint32 p2 = p;
+    p >>= 1;
+
+    while(p >= 1)
+    {
+        uint16* py  = in;
+        uint16* ey  = in + oy * (ny - p2);
+        sint32  oy1 = oy * p;
+        sint32  oy2 = oy * p2;
+        sint32  ox1 = ox * p;
+        sint32  ox2 = ox * p2;
+        uint16  i00, i01, i10, i11;
+
+        for(; py <= ey; py += oy2)
+        {
+            uint16* px = py;
+            uint16* ex = py + ox * (nx - p2);
+            for(; px <= ex; px += ox2)
+            {
+                uint16* p01 = px  + ox1;
+                uint16* p10 = px  + oy1;
+                uint16* p11 = p10 + ox1;
+
+                waveletDecode<Bits14>(*px,  *p10, i00, i10);
+                waveletDecode<Bits14>(*p01, *p11, i01, i11);
+                waveletDecode<Bits14>(i00, i01, *px,  *p01);
+                waveletDecode<Bits14>(i10, i11, *p10, *p11);
+            }
+
+            // Odd column
+            if (nx & p)
+            {
+                uint16* p10 = px + oy1;
+                waveletDecode<Bits14>(*px, *p10, i00, *p10);
+                *px = i00;
+            }
+        }
+
+        // Odd line
+        if (ny & p)
+        {
+            uint16* px = py;
+            uint16* ex = py + ox * (nx - p2);
+            for(; px <= ex; px += ox2)
+            {
+                uint16* p01 = px + ox1;
+                waveletDecode<Bits14>(*px, *p01, i00, *p01);
+                *px = i00;
+            }
+        }
+
+        p2 = p;
+        p >>= 1;
+    }
+}
+
+// PIZ: values are remapped to dense range (using bitmap of present values),
+// transformed with wavelet per channel and Huffman compressed. Output has
+// the same planar lines layout as other compressions.
+bool decompressPIZ(Scratch& scratch, const uint8* input, const uint64 size, uint8* output, const uint64 expected, const uint32 width, const uint32 lines, const uint32 channels, const uint32 channelSize)
+{
+    const uint8* end = input + size;
+    if (size < 4)
+    {
+        return false;
+    }
+
+    uint16 minNonZero = 0;
+    uint16 maxNonZero = 0;
+    memcpy(&minNonZero, input,     2);
+    memcpy(&maxNonZero, input + 2, 2);
+    input += 4;
+    if (maxNonZero >= BitmapSize)
+    {
+        return false;
+    }
+
+    uint8 bitmap[BitmapSize];
+    memset(bitmap, 0, BitmapSize);
+    if (minNonZero <= maxNonZero)
+    {
+        uint32 length = maxNonZero - minNonZero + 1;
+        if (length > static_cast<uint64>(end - input))
+        {
+            return false;
+        }
+
+        memcpy(bitmap + minNonZero, input, length);
+        input += length;
+    }
+
+    // Reverse lookup table from dense range to original values
+    scratch.lut.resize(1 << 16);
+    uint16* lut = scratch.lut.data();
+    uint32 k = 0;
+    for(uint32 i=0; i<(1 << 16); ++i)
+    {
+        if (i == 0 || (bitmap[i >> 3] & (1 << (i & 7))))
+        {
+            lut[k++] = static_cast<uint16>(i);
+        }
+    }
+    uint16 maxValue = static_cast<uint16>(k - 1);
+    for(; k<(1 << 16); ++k)
+    {
+        lut[k] = 0;
+    }
+
+    // Huffman compressed data
+    if (static_cast<uint64>(end - input) < 4)
+    {
+        return false;
+    }
+
+    uint32 length = 0;
+    memcpy(&length, input, 4);
+    input += 4;
+    if (length > static_cast<uint64>(end - input))
+    {
+        return false;
+    }
+
+    uint64 count = expected / 2;
+    scratch.temp.resize(expected);
+    uint16* values = reinterpret_cast<uint16*>(scratch.temp.data());
+    if (!decompressHuffman(scratch, input, length, values, count))
+    {
+        return false;
+    }
+
+    // Each channel is stored as separate block of lines, with
+    // wavelet applied to each 16 bit part of samples separately.
+    uint32 words = channelSize / 2;
+    uint64 channelWords = static_cast<uint64>(width) * lines * words;
+    for(uint32 c=0; c<channels; ++c)
+    {
+        uint16* start = values + c * channelWords;
+        for(uint32 j=0; j<words; ++j)
+        {
+            if (maxValue < (1 << 14))
+            {
+                waveletDecode<true>(start + j, width, words, lines, width * words);
+            }
+            else
+            {
+                waveletDecode<false>(start + j, width, words, lines, width * words);
+            }
+        }
+    }
+
+    for(uint64 i=0; i<count; ++i)
+    {
+        values[i] = lut[values[i]];
+    }
+
+    // Rearrange to planar lines
+    uint64 lineWords = static_cast<uint64>(width) * words;
+    uint16* out = reinterpret_cast<uint16*>(output);
+    for(uint32 y=0; y<lines; ++y)
+    {
+        for(uint32 c=0; c<channels; ++c)
+        {
+            memcpy(out, values + c * channelWords + y * lineWords, lineWords * 2);
+            out += lineWords;
+        }
+    }
+
+    return true;
+}
+
+#if defined(EN_ARCHITECTURE_X64)
+// Interleave planes of samples, several texels at a time.
+// Return count of processed texels.
+uint32 interleave16x2(const uint16* const* plane, uint16* out, const uint32 width)
+{
+    uint32 x = 0;
+    for(; x+8<=width; x+=8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[0] + x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[1] + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2),     _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 8), _mm_unpackhi_epi16(a, b));
+    }
+
+    return x;
+}
+
+uint32 interleave16x4(const uint16* const* plane, uint16* out, const uint32 width)
+{
+    uint32 x = 0;
+    for(; x+8<=width; x+=8)
+    {
+        __m128i a   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[0] + x));
+        __m128i b   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[1] + x));
+        __m128i c   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[2] + x));
+        __m128i d   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[3] + x));
+        __m128i ab0 = _mm_unpacklo_epi16(a, b);
+        __m128i ab1 = _mm_unpackhi_epi16(a, b);
+        __m128i cd0 = _mm_unpacklo_epi16(c, d);
+        __m128i cd1 = _mm_unpackhi_epi16(c, d);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4),      _mm_unpacklo_epi32(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 8),  _mm_unpackhi_epi32(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), _mm_unpacklo_epi32(ab1, cd1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 24), _mm_unpackhi_epi32(ab1, cd1));
+    }
+
+    return x;
+}
+
+uint32 interleave32x2(const uint32* const* plane, uint32* out, const uint32 width)
+{
+    uint32 x = 0;
+    for(; x+4<=width; x+=4)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[0] + x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[1] + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2),     _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 4), _mm_unpackhi_epi32(a, b));
+    }
+
+    return x;
+}
+
+uint32 interleave32x4(const uint32* const* plane, uint32* out, const uint32 width)
+{
+    uint32 x = 0;
+    for(; x+4<=width; x+=4)
+    {
+        __m128i a   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[0] + x));
+        __m128i b   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[1] + x));
+        __m128i c   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[2] + x));
+        __m128i d   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane[3] + x));
+        __m128i ab0 = _mm_unpacklo_epi32(a, b);
+        __m128i ab1 = _mm_unpackhi_epi32(a, b);
+        __m128i cd0 = _mm_unpacklo_epi32(c, d);
+        __m128i cd1 = _mm_unpackhi_epi32(c, d);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4),      _mm_unpacklo_epi64(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 4),  _mm_unpackhi_epi64(ab0, cd0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 8),  _mm_unpacklo_epi64(ab1, cd1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 12), _mm_unpackhi_epi64(ab1, cd1));
+    }
+
+    return x;
+}
+#endif
+
+// Converts planar line (each channel stored separately, in alphabetical
+// order) to interleaved texels, with channels placed at given slots.
+template<typename T>
+void interleave(const uint8* planar, uint8* output, const uint32 width, const uint32 channels, const uint32* slot)
+{
+    const T* plane[4];
+    for(uint32 c=0; c<channels; ++c)
+    {
+        plane[slot[c]] = reinterpret_cast<const T*>(planar) + c * width;
+    }
+
+    T* out = reinterpret_cast<T*>(output);
+    if (channels == 1)
+    {
+        memcpy(out, plane[0], width * sizeof(T));
+        return;
+    }
+
+    uint32 x = 0;
+#if defined(EN_ARCHITECTURE_X64)
+    if (sizeof(T) == 2)
+    {
+        if (channels == 2) x = interleave16x2(reinterpret_cast<const uint16* const*>(plane), reinterpret_cast<uint16*>(out), width);
+        if (channels == 4) x = interleave16x4(reinterpret_cast<const uint16* const*>(plane), reinterpret_cast<uint16*>(out), width);
+    }
+    else
+    {
+        if (channels == 2) x = interleave32x2(reinterpret_cast<const uint32* const*>(plane), reinterpret_cast<uint32*>(out), width);
+        if (channels == 4) x = interleave32x4(reinterpret_cast<const uint32* const*>(plane), reinterpret_cast<uint32*>(out), width);
+    }
+#endif
+
+    for(; x<width; ++x)
+    {
+        for(uint32 c=0; c<channels; ++c)
+        {
+            out[x * channels + c] = plane[c][x];
+        }
+    }
+}
+
+struct Decoder
+{
+    const uint8* content;            // Mapped file
+    uint64       fileSize;
+    uint64       table;              // Location of chunks offsets table
+    uint32       part;               // Decoded part
+    bool         multiPart;          // Chunks start with part number
+    uint32       compression;
+    uint32       width;
+    uint32       height;
+    uint32       top;                // Coordinate of first line of data window
+    uint32       channels;
+    uint32       channelSize;        // Size of single sample (2 or 4 bytes)
+    uint32       slot[4];            // Location of each channel in texel
+    uint32       blockLines;         // Lines stored in single chunk
+    std::atomic<bool>* decoded;      // Set for each block of lines, once chunk storing it is decoded
+    uint8*       destination;        // Decoded image
+    uint32       rowPitch;           // Distance between lines in destination
+    bool         invertHorizontal;   // Image is stored with lines in reversed order
+    std::vector<Scratch> scratch;    // Per worker thread state
+    std::atomic<bool>    failed;     // Set if any of chunks is corrupted
+};
+
+bool decodeChunk(Decoder& decoder, Scratch& scratch, const uint32 index)
+{
+    // Location of chunk
+    uint64 offset = 0;
+    memcpy(&offset, decoder.content + decoder.table + static_cast<uint64>(index) * 8, 8);
+
+    uint32 header = decoder.multiPart ? 12 : 8;
+    if (offset > decoder.fileSize ||
+        header > decoder.fileSize - offset)
+    {
+        return false;
+    }
+
+    if (decoder.multiPart)
+    {
+        uint32 partNumber = 0;
+        memcpy(&partNumber, decoder.content + offset, 4);
+        offset += 4;
+        if (partNumber != decoder.part)
+        {
+            return false;
+        }
+    }
+
+    uint32 line = 0;
+    uint32 size = 0;
+    memcpy(&line, decoder.content + offset,     4);
+    memcpy(&size, decoder.content + offset + 4, 4);
+    offset += 8;
+    if (size > decoder.fileSize - offset)
     {
-        enLog << "Error: Zlib invalid compression level!\n";
+        return false;
     }
-    else
-    if (code == Z_DATA_ERROR)
+
+    // Range of lines stored in chunk (last one may have less lines)
+    uint32 first = line - decoder.top;
+    if (first >= decoder.height ||
+        first % decoder.blockLines)
     {
-        enLog << "Error: Zlib invalid or incomplete chunk!\n";
+        return false;
     }
-    else
-    if (code == Z_MEM_ERROR)
+
+    // There is one chunk per block of lines, so if no block is stored
+    // twice, all lines of image are covered.
+    uint32 block = first / decoder.blockLines;
+    if (std::atomic_exchange_explicit(&decoder.decoded[block], true, std::memory_order_relaxed))
     {
-        enLog << "Error: Zlib reports out of memory!\n";
+        return false;
     }
-    else
-    if (code == Z_BUF_ERROR)
+
+    uint32 lines    = min(decoder.blockLines, decoder.height - first);
+    uint64 lineSize = static_cast<uint64>(decoder.width) * decoder.channels * decoder.channelSize;
+    uint64 expected = lines * lineSize;
+
+    // Chunks that wouldn't get smaller are stored uncompressed
+    const uint8* input  = decoder.content + offset;
+    const uint8* planar = input;
+    if (size == expected)
     {
-        enLog << "Error: Zlib output buffer is to small!\n";
+        // Samples in chunk need to be aligned to be read directly
+        if (reinterpret_cast<uintptr_t>(input) % decoder.channelSize)
+        {
+            scratch.buffer.resize(expected);
+            memcpy(scratch.buffer.data(), input, expected);
+            planar = scratch.buffer.data();
+        }
     }
     else
-    if (code == Z_VERSION_ERROR)
     {
-        enLog << "Error: Zlib version mismatch!\n";
+        scratch.buffer.resize(expected);
+        planar = scratch.buffer.data();
+
+        bool success = false;
+        if (decoder.compression == RLE)
+        {
+            scratch.temp.resize(expected);
+            success = decompressRLE(input, size, scratch.temp.data(), expected);
+            if (success)
+            {
+                reconstruct(scratch.temp.data(), scratch.buffer.data(), expected);
+            }
+        }
+        else
+        if (decoder.compression == ZIPS ||
+            decoder.compression == ZIP)
+        {
+            scratch.temp.resize(expected);
+            success = decompressZIP(scratch, input, size, scratch.temp.data(), expected);
+            if (success)
+            {
+                reconstruct(scratch.temp.data(), scratch.buffer.data(), expected);
+            }
+        }
+        else
+        if (decoder.compression == PIZ)
+        {
+            success = decompressPIZ(scratch, input, size, scratch.buffer.data(), expected, decoder.width, lines, decoder.channels, decoder.channelSize);
+        }
+
+        if (!success)
+        {
+            return false;
+        }
     }
-    else
+
+    // Interleave channels directly into destination
+    for(uint32 y=0; y<lines; ++y)
     {
-        enLog << "Error: Zlib unknown error code " << code << "!\n";
+        uint32 dstLine = decoder.invertHorizontal ? decoder.height - (first + y) - 1 : first + y;
+        uint8* output  = decoder.destination + static_cast<uint64>(dstLine) * decoder.rowPitch;
+        if (decoder.channelSize == 2)
+        {
+            interleave<uint16>(planar + y * lineSize, output, decoder.width, decoder.channels, decoder.slot);
+        }
+        else
+        {
+            interleave<uint32>(planar + y * lineSize, output, decoder.width, decoder.channels, decoder.slot);
+        }
     }
 
     return true;
 }
 
-std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
+void taskDecodeChunks(void* data, uint32v2 range)
 {
-    using namespace en::storage;
+    Decoder& decoder = *reinterpret_cast<Decoder*>(data);
 
-    // Open image file
-    File* file = Storage->open(filename);
-    if (!file)
+    uint32 worker = 0;
+    if (decoder.scratch.size() > 1)
+    {
+        worker = Scheduler->currentWorkerId();
+    }
+
+    Scratch& scratch = decoder.scratch[worker];
+    for(uint32 i=range.base; i<(range.base + range.count); ++i)
     {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
+        if (decoder.failed.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (!decodeChunk(decoder, scratch, i))
         {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return std::shared_ptr<gpu::Texture>();
+            decoder.failed.store(true, std::memory_order_relaxed);
+            return;
         }
     }
-   
+}
+
+// Rank of channel in texel, based on its name (or name of layer channel)
+uint32 channelRank(const std::string& name)
+{
+    std::string::size_type dot = name.rfind('.');
+    std::string channel = (dot == std::string::npos) ? name : name.substr(dot + 1);
+    if (channel == "R" || channel == "r") return 0;
+    if (channel == "G" || channel == "g") return 1;
+    if (channel == "B" || channel == "b") return 2;
+    if (channel == "A" || channel == "a") return 3;
+    return 4;
+}
+
+// Reads headers of all parts stored in file. Offset is set to location of
+// chunks offsets table that follows them.
+bool readHeaders(storage::File* file, Header& header, std::vector<PartHeader>& headers, uint64& offset)
+{
     // Read file header
-    Header header;
     file->read(0, sizeof(Header), &header);
     if (header.signature != 0x01312F76)
     {
         enLog << "ERROR: EXR file header signature incorrect!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        return false;
     }
    
     // TODO: Support multi-part types
     if (header.multiPart)
     {
         enLog << "ERROR: EXR multi-part files are not supported!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        return false;
     }
 
     // If Single Part, determine part type
@@ -254,14 +1277,12 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     if (singlePartType != ScanLineImage)
     {
         enLog << "ERROR: Engine supports only scan lined EXR images!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        return false;
     }
 
     // Read Part Headers
-    std::vector<PartHeader> headers;
     bool readingHeaders = true;
-    uint64 offset = sizeof(Header);
+    offset = sizeof(Header);
     uint32 maxChars = header.longNames ? 255 : 31;
     while(readingHeaders)
     { 
@@ -427,351 +1448,318 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     {
         headers[0].type = singlePartType;
     }
-  
-    // Read parts
-    for(uint32 part=0; part<headers.size(); ++part)
+
+    return true;
+}
+
+// Determines texture parameters of given part. Returns false if it's not
+// supported by the engine.
+bool readSettings(const PartHeader& part, gpu::TextureState& settings)
+{
+    // Check if compression is supported (lossy ones are not)
+    if ( part.compression != None &&
+         part.compression != RLE  &&
+         part.compression != ZIPS &&
+         part.compression != ZIP  &&
+         part.compression != PIZ )
     {
-        // Check if compression is supported
-        if ( headers[part].compression != None &&
-             headers[part].compression != ZIP )
-        {
-            if (headers[part].compression == RLE)   enLog << "ERROR: Engine doesn't supports EXR images with RLE compression!\n";
-            if (headers[part].compression == ZIPS)  enLog << "ERROR: Engine doesn't supports EXR images with ZIPS compression!\n";
-            if (headers[part].compression == PIZ)   enLog << "ERROR: Engine doesn't supports EXR images with PIZ compression!\n";
-            if (headers[part].compression == PXR24) enLog << "ERROR: Engine doesn't supports EXR images with PXR24 compression!\n";
-            if (headers[part].compression == B44)   enLog << "ERROR: Engine doesn't supports EXR images with B44 compression!\n";
-            if (headers[part].compression == B44A)  enLog << "ERROR: Engine doesn't supports EXR images with B44A compression!\n";
-            enLog << "       Can't load part " << part << " from file.\n";
-            continue;
-        }
+        if (part.compression == PXR24) enLog << "ERROR: Engine doesn't supports EXR images with PXR24 compression!\n";
+        if (part.compression == B44)   enLog << "ERROR: Engine doesn't supports EXR images with B44 compression!\n";
+        if (part.compression == B44A)  enLog << "ERROR: Engine doesn't supports EXR images with B44A compression!\n";
+        return false;
+    }
 
-        // Check if standard data window
-        if ( headers[part].dataWindow.x      != headers[part].displayWindow.x      ||
-             headers[part].dataWindow.y      != headers[part].displayWindow.y      ||
-             headers[part].dataWindow.width  != headers[part].displayWindow.width  ||
-             headers[part].dataWindow.height != headers[part].displayWindow.height )
-        {
-            enLog << "ERROR: Engine doesn't supports clipping data window to display window!\n";
-            enLog << "       Can't load part " << part << " from file.\n";
-            continue;
-        }
+    // Check if standard data window
+    if ( part.dataWindow.x      != part.displayWindow.x      ||
+         part.dataWindow.y      != part.displayWindow.y      ||
+         part.dataWindow.width  != part.displayWindow.width  ||
+         part.dataWindow.height != part.displayWindow.height )
+    {
+        enLog << "ERROR: Engine doesn't supports clipping data window to display window!\n";
+        return false;
+    }
 
-        // Determine texture parameters
-        gpu::TextureState settings;
-        settings.width  = headers[part].displayWindow.width;
-        settings.height = headers[part].displayWindow.height;
+    // Determine texture parameters
+    settings.width  = part.dataWindow.width  - part.dataWindow.x;
+    settings.height = part.dataWindow.height - part.dataWindow.y;
 
-        // Set texture type
-        if ( headers[part].type == ScanLineImage || 
-             headers[part].type == TiledImage )
-        {
-            settings.type = gpu::TextureType::Texture2D;
-        }
-        if ( headers[part].type == DeepScanLine || 
-             headers[part].type == DeepTile )
-        {
-            settings.type   = gpu::TextureType::Texture3D;
-            settings.layers = headers[part].maxSamplesPerPixel;
-        }
-      
-        // Determine texture format to use. At this stage,
-        // it doesn't matter what chnnels really represent.
-        // It only matters what format they are all stored in.
-        // Channels are stored in alphabetical order anyway.
-        // We can order them in GPU memory the way we want.
-        bool correct = false;
-        if (headers[part].channels == 1)
-        {
-            if (headers[part].channel[0].type == 0) { settings.format = gpu::Format::R_32_u;  correct = true; }
-            if (headers[part].channel[0].type == 1) { settings.format = gpu::Format::R_16_hf; correct = true; }
-            if (headers[part].channel[0].type == 2) { settings.format = gpu::Format::R_32_f;  correct = true; }
-        }
-        if (headers[part].channels == 2)
+    // Set texture type
+    if ( part.type == ScanLineImage || 
+         part.type == TiledImage )
+    {
+        settings.type = gpu::TextureType::Texture2D;
+    }
+    if ( part.type == DeepScanLine || 
+         part.type == DeepTile )
+    {
+        settings.type   = gpu::TextureType::Texture3D;
+        settings.layers = part.maxSamplesPerPixel;
+    }
+  
+    // Determine texture format to use. At this stage,
+    // it doesn't matter what chnnels really represent.
+    // It only matters what format they are all stored in.
+    // Channels are stored in alphabetical order anyway.
+    // We can order them in GPU memory the way we want.
+    bool correct = false;
+    if (part.channels == 1)
+    {
+        if (part.channel[0].type == 0) { settings.format = gpu::Format::R_32_u;  correct = true; }
+        if (part.channel[0].type == 1) { settings.format = gpu::Format::R_16_hf; correct = true; }
+        if (part.channel[0].type == 2) { settings.format = gpu::Format::R_32_f;  correct = true; }
+    }
+    if (part.channels == 2)
+    {
+        if (part.channel[0].type == part.channel[1].type)
         {
-            if (headers[part].channel[0].type == headers[part].channel[1].type)
-            {
-                if (headers[part].channel[0].type == 0) { settings.format = gpu::Format::RG_32_u;  correct = true; }
-                if (headers[part].channel[0].type == 1) { settings.format = gpu::Format::RG_16_hf; correct = true; }
-                if (headers[part].channel[0].type == 2) { settings.format = gpu::Format::RG_32_f;  correct = true; }
-                correct = true;
-            }
+            if (part.channel[0].type == 0) { settings.format = gpu::Format::RG_32_u;  correct = true; }
+            if (part.channel[0].type == 1) { settings.format = gpu::Format::RG_16_hf; correct = true; }
+            if (part.channel[0].type == 2) { settings.format = gpu::Format::RG_32_f;  correct = true; }
+            correct = true;
         }
-        if (headers[part].channels == 3)
+    }
+    if (part.channels == 3)
+    {
+        if ( (part.channel[0].type == part.channel[1].type) &&
+             (part.channel[1].type == part.channel[2].type) )
         {
-            if ( (headers[part].channel[0].type == headers[part].channel[1].type) &&
-                 (headers[part].channel[1].type == headers[part].channel[2].type) )
-            {
-                if (headers[part].channel[0].type == 0) { settings.format = gpu::Format::RGB_32_u;  correct = true; }
-                if (headers[part].channel[0].type == 1) { settings.format = gpu::Format::RGB_16_hf; correct = true; }
-                if (headers[part].channel[0].type == 2) { settings.format = gpu::Format::RGB_32_f;  correct = true; }
-                correct = true;
-            }
+            if (part.channel[0].type == 0) { settings.format = gpu::Format::RGB_32_u;  correct = true; }
+            if (part.channel[0].type == 1) { settings.format = gpu::Format::RGB_16_hf; correct = true; }
+            if (part.channel[0].type == 2) { settings.format = gpu::Format::RGB_32_f;  correct = true; }
+            correct = true;
         }
-        if (headers[part].channels == 4)
+    }
+    if (part.channels == 4)
+    {
+        if ( (part.channel[0].type == part.channel[1].type) &&
+             (part.channel[1].type == part.channel[2].type) &&
+             (part.channel[2].type == part.channel[3].type) )
         {
-            if ( (headers[part].channel[0].type == headers[part].channel[1].type) &&
-                 (headers[part].channel[1].type == headers[part].channel[2].type) &&
-                 (headers[part].channel[2].type == headers[part].channel[3].type) )
-            {
-                if (headers[part].channel[0].type == 0) { settings.format = gpu::Format::RGBA_32_u;  correct = true; }
-                if (headers[part].channel[0].type == 1) { settings.format = gpu::Format::RGBA_16_hf; correct = true; }
-                if (headers[part].channel[0].type == 2) { settings.format = gpu::Format::RGBA_32_f;  correct = true; }
-                correct = true;
-            }
+            if (part.channel[0].type == 0) { settings.format = gpu::Format::RGBA_32_u;  correct = true; }
+            if (part.channel[0].type == 1) { settings.format = gpu::Format::RGBA_16_hf; correct = true; }
+            if (part.channel[0].type == 2) { settings.format = gpu::Format::RGBA_32_f;  correct = true; }
+            correct = true;
         }
+    }
 
-        // Unsupported mixed channel formats
-        if (!correct)
-        {
-            enLog << "ERROR: Engine doesn't supports EXR images with mixed channel format!\n";
-            enLog << "       Can't load part " << part << " from file.\n";
-            continue;
-        }
+    // Unsupported mixed channel formats
+    if (!correct)
+    {
+        enLog << "ERROR: Engine doesn't supports EXR images with mixed channel format!\n";
+        return false;
+    }
 
-        // Check that data is contiguous in memory.
-        correct = true;
-        for(uint32 i=0; i<headers[part].channels; ++i)
+    // Check that data is contiguous in memory.
+    correct = true;
+    for(uint32 i=0; i<part.channels; ++i)
+    {
+        if ( part.channel[i].xSampling != 1 ||
+             part.channel[i].ySampling != 1 )
         {
-            if ( headers[part].channel[i].xSampling != 1 ||
-                 headers[part].channel[i].ySampling != 1 )
-            {
-                correct = false;
-                break;
-            }
+            correct = false;
+            break;
         }
+    }
 
-        // Unsupported data layout
-        if (!correct)
-        {
-            enLog << "ERROR: Engine supports only contiguous data layout for channes!\n";
-            enLog << "       Can't load part " << part << " from file.\n";
-            continue;
-        }
+    // Unsupported data layout
+    if (!correct)
+    {
+        enLog << "ERROR: Engine supports only contiguous data layout for channes!\n";
+        return false;
+    }
    
-        // Create texture in gpu
-        std::unique_ptr<gpu::Texture> texture(en::ResourcesContext.defaults.enHeapTextures->createTexture(settings));
-        if (!texture)
-        {
-            enLog << "ERROR: Cannot create texture in GPU!\n";
-            continue;
-        }
-      
-        // Single part files can have missing chunkCount field.
-        // In such situation chunks count needs to be computed.
-        sint32 chunks = headers[part].chunkCount;
-        if (chunks == -1)
-        {
-            if (headers[part].type == ScanLineImage)
-            {
-                if (headers[part].compression < 3)
-                {
-                    chunks = headers[part].dataWindow.height;
-                }
-                else
-                if (headers[part].compression == ZIP   ||
-                    headers[part].compression == PXR24 )
-                {
-                    chunks = (headers[part].dataWindow.height / 16) + ( headers[part].dataWindow.height % 16 ? 1 : 0);
-                }
-                else
-                {
-                    chunks = (headers[part].dataWindow.height / 32) + ( headers[part].dataWindow.height % 16 ? 1 : 0);
-                }
-            }
 
-            // TODO: Determine chunks count for other types
-            // - dataWindow
-            // - tileDesc
-            // - compression
-            assert( chunks != -1 );
-        }
+    return true;
+}
 
-        // Calculate block size
-        uint32 channelSize = headers[part].channel[0].type % 2 ? 2 : 4;
-        uint32 pixelSize   = headers[part].channels * channelSize;
-        uint32 blocksize   = headers[part].dataWindow.width * pixelSize * 64; // Allocate 2 times te maxium required block size to give room for INFLATE 
-        uint32 blockLines  = 1;
-        if (headers[part].type == ScanLineImage)
-        {
-            if ( headers[part].compression == ZIP   ||
-                 headers[part].compression == PXR24 )
-            {
-                blockLines = 16;
-            }
-            else
-            if ( headers[part].compression > 3 )
-            {
-                blockLines = 32;
-            }
+storage::File* open(const std::string& filename)
+{
+    using namespace en::storage;
 
-            //blocksize = headers[part].dataWindow.width * blockLines * pixelSize;
-        }
+    // Open image file
+    File* file = Storage->open(filename);
+    if (!file)
+    {
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
+    }
 
-        // TODO: Determine block size for other types
+    return file;
+}
 
-        // Read offset table
-        uint64* offsets = new uint64[chunks];
-        for(uint32 i=0; i<chunks; ++i)
-        {
-            file->read(offset, 8, &offsets[i]); 
-            offset += 8;
-        }
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
 
-        // Decompress texture
-      
-        // For now on it will require 2 copies File > Transfer > Texture (in future , mmap file directly to Transfer)
-        uint8* dst = new uint8[texture->size()];
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
-        // Read data
-        for(uint32 i=0; i<chunks; ++i)
-        {
-            uint32 line;
-            uint32 size;
-            offset = offsets[i];
+    Header header;
+    std::vector<PartHeader> headers;
+    uint64 offset = 0;
+    bool success = readHeaders(file, header, headers, offset) &&
+                   readSettings(headers[0], settings);
+    delete file;
 
-            // Read chunk header
-            if (header.multiPart)
-            {
-                uint32 partNumber;
-                file->read(offset, 4, &partNumber); 
-                offset += 4;
-                assert(partNumber == part);
-            }
-            file->read(offset, 4, &line); 
-            offset += 4;
-            file->read(offset, 4, &size);
-            offset += 4;
+    // EXR images always store linear values
+    colorSpace = gpu::ColorSpace::ColorSpaceLinear;
+    return success;
+}
 
-            // Last block has less lines
-            if (i + 1 == chunks)
-            {
-                blockLines = headers[part].dataWindow.height - ((chunks - 1) * blockLines);
-            }
+bool load(const std::string& filename,
+          uint8* const destination,
+          const uint32 width,
+          const uint32 height,
+          const gpu::Format format,
+          const gpu::ImageMemoryAlignment alignment,
+          const bool invertHorizontal)
+{
+    using namespace en::storage;
 
-            if (headers[part].compression == None)
-            {
-            }
-            else
-            if (headers[part].compression == ZIP)
-            {
-                // Read compressed data from disk
-                uint8* input = new uint8[size];
-                file->read(offset, size, input);
-            
-                // Uncompress data to temporary buffer
-                uint8* output = new uint8[blocksize];
-            
-                // Create zlib stream structure
-                z_stream stream;
-                stream.zalloc    = Z_NULL;
-                stream.zfree     = Z_NULL;
-                stream.opaque    = Z_NULL;
-                stream.next_in   = input;     // Compressed data
-                stream.avail_in  = size;      // Size of compressed data
-                stream.avail_out = blocksize; // Available space for uncompressed data
-                stream.next_out  = output;    // Output destination
-            
-                // Decompress data from IDAT chunks to 'inflated' buffer
-                if (CheckError(inflateInit(&stream)))
-                {
-                    enLog << "Error: Cannot initialize Zlib decompressor!\n";
-                    delete file;
-                    delete [] input;
-                    delete [] output;
-                    return std::shared_ptr<gpu::Texture>(nullptr);
-                }
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
-                sint32 ret = 0;
-                ret = inflate(&stream, Z_FINISH);
-                if (ret != Z_STREAM_END)
-                {
-                    CheckError(ret);
-                    enLog << "Error: Cannot decompress using ZLIB!\n";
-                    delete file;
-                    delete [] input;
-                    delete [] output;
-                    return std::shared_ptr<gpu::Texture>(nullptr);
-                }
-                inflateEnd(&stream);
-                delete [] input;
-            
-                // Reorder uncompressed data to final buffer
-                uint32 srcLineSize = headers[part].dataWindow.width * headers[part].channels * channelSize;
-                for(uint32 y=0; y<blockLines; ++y)
-                {
-                    for(uint32 x=0; x<headers[part].dataWindow.width; ++x)
-                    {
-                        for(uint32 c=0; c<headers[part].channels; ++c)
-                        {
-                            uint32 dstLine = headers[part].dataWindow.height - (line + y) - 1;
-                            uint8* srcPtr = output + (y * srcLineSize) + (c * headers[part].dataWindow.width * channelSize) + (x * channelSize); 
-                            uint8* dstPtr = dst + (dstLine * srcLineSize) + (x * headers[part].channels * channelSize) + (c * channelSize);
-                            memcpy(dstPtr, srcPtr, channelSize);
-                        }
-                    }
-                }
+    // Only first part of file is decoded
+    Header header;
+    std::vector<PartHeader> headers;
+    uint64 offset = 0;
+    gpu::TextureState settings;
+    if (!readHeaders(file, header, headers, offset) ||
+        !readSettings(headers[0], settings))
+    {
+        delete file;
+        return false;
+    }
 
-                delete [] output;
-            }
-            else
-            {
-                assert(0);
-                // Unsupported compression type
-            }
-        }
+    const PartHeader& part = headers[0];
 
-        delete [] offsets;
+    // Verify that file matches expected properties
+    uint32 channels    = part.channels;
+    uint32 channelSize = part.channel[0].type == 1 ? 2 : 4;
+    if ( (settings.width  != width)  ||
+         (settings.height != height) ||
+         (settings.format != format) ||
+         (alignment.texelPitch() != channels * channelSize) )
+    {
+        delete file;
+        return false;
+    }
 
-        // Create staging buffer
-        std::unique_ptr<gpu::Buffer> staging(en::ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, texture->size()));
-        if (!staging)
-        {
-            enLog << "ERROR: Cannot create staging buffer!\n";
-            delete file;
-            return texture;
-        }
+    // Single part files can have missing chunkCount field.
+    // In such situation chunks count needs to be computed.
+    uint32 blockLines = 1;
+    if (part.compression == ZIP)
+    {
+        blockLines = 16;
+    }
+    else
+    if (part.compression == PIZ)
+    {
+        blockLines = 32;
+    }
+
+    uint32 blocks = (height + blockLines - 1) / blockLines;
+    sint32 chunks = part.chunkCount;
+    if (chunks == -1)
+    {
+        chunks = static_cast<sint32>(blocks);
+    }
 
-        // Read texture to temporary buffer
-        volatile void* ptr = staging->map();
-        memcpy((void*)ptr, dst, texture->size());
-        staging->unmap();
+    // Each block of lines is stored in exactly one chunk
+    if (chunks <= 0 ||
+        static_cast<uint32>(chunks) != blocks)
+    {
+        enLog << "ERROR: EXR file is corrupted, chunks count doesn't match image height!\n";
+        delete file;
+        return false;
+    }
 
-        delete [] dst;
-      
-        // TODO: Now blit from staging to texture
-        uint32 mipmap = 0u;
-        uint32 slice  = 0u;
-   
-        // TODO: In future distribute transfers to different queues in the same queue type family
-        gpu::QueueType type = gpu::QueueType::Universal;
-        if (Graphics->primaryDevice()->queues(gpu::QueueType::Transfer) > 0u)
-        {
-            type = gpu::QueueType::Transfer;
-        }
+    // TODO: Determine chunks count and block size for other types
+    // - dataWindow
+    // - tileDesc
+    // - compression
 
-        // Copy data from staging buffer to final texture
-        std::shared_ptr<gpu::CommandBuffer> command = Graphics->primaryDevice()->createCommandBuffer(type);
-        command->start();
-        command->copy(*staging, 0u, settings.rowSize(mipmap), *texture, mipmap, slice);
-        command->commit();
-   
-        // TODO:
-        // here return completion handler callback !!! (no waiting for completion)
-        // - this callback destroys CommandBuffer object
-        // - destroys staging buffer
-        //
-        // Till it's done, wait for completion:
-   
-        command->waitUntilCompleted();
-        command = nullptr;
-        staging = nullptr;
+    // Channels are stored in alphabetical order, while
+    // texels store them in RGBA order (if names allow).
+    uint32 order[4] = { 0, 1, 2, 3 };
+    std::stable_sort(order, order + channels, [&](const uint32 a, const uint32 b)
+    {
+        return channelRank(part.channel[a].name) < channelRank(part.channel[b].name);
+    });
 
+    // Map whole file, chunks are decoded in place
+    FileView* view = file->map(0u, file->size(), MapHint::Sequential);
+    if (!view ||
+        offset + static_cast<uint64>(chunks) * 8 > view->size())
+    {
+        enLog << "ERROR: EXR file is corrupted, chunks offsets table is truncated!\n";
+        delete view;
         delete file;
-        return texture;   // TODO: Rework for multipart files!
+        return false;
+    }
+
+    // Decompress chunks directly to destination
+    std::vector< std::atomic<bool> > decoded(blocks);
+    for(uint32 i=0; i<blocks; ++i)
+    {
+        decoded[i].store(false, std::memory_order_relaxed);
     }
 
+    Decoder decoder;
+    decoder.content          = view->data();
+    decoder.fileSize         = view->size();
+    decoder.table            = offset;
+    decoder.part             = 0;
+    decoder.multiPart        = header.multiPart;
+    decoder.compression      = part.compression;
+    decoder.width            = width;
+    decoder.height           = height;
+    decoder.top              = part.dataWindow.y;
+    decoder.channels         = channels;
+    decoder.channelSize      = channelSize;
+    decoder.blockLines       = blockLines;
+    decoder.decoded          = decoded.data();
+    decoder.destination      = destination;
+    decoder.rowPitch         = alignment.rowPitch(width);
+    decoder.invertHorizontal = invertHorizontal;
+    decoder.failed           = false;
+    for(uint32 i=0; i<channels; ++i)
+    {
+        decoder.slot[order[i]] = i;
+    }
+
+    // Chunks are decoded in parallel if called from worker thread
+    if (Scheduler && Scheduler->currentWorkerId() != InvalidWorkerId)
+    {
+        decoder.scratch.resize(Scheduler->workers());
+
+        TaskState state;
+        Scheduler->run(taskDecodeChunks, &decoder, uint32v2(0u, static_cast<uint32>(chunks)), &state, 1u);
+        Scheduler->wait(&state);
+    }
+    else
+    {
+        decoder.scratch.resize(1);
+        taskDecodeChunks(&decoder, uint32v2(0u, static_cast<uint32>(chunks)));
+    }
+
+    delete view;
     delete file;
-    return std::shared_ptr<gpu::Texture>(nullptr);
+
+    if (decoder.failed)
+    {
+        enLog << "ERROR: EXR file is corrupted, cannot decode image chunks!\n";
+        return false;
+    }
+
+    return true;
 }
 
 } // en::exr 
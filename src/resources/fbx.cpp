@@ -942,15 +942,34 @@ std::vector<en::resources::Mesh> LoadMesh(FbxMesh* fbxMesh)
         }
     }
 
-    // Optimize indexes order for Post-Transform Vertex Cache Size
-    //
-    // TODO: Enable Forsyth only for format conversion, building final optimized mesh
-    //
-    //for(uint32 mesh=0; mesh<numMeshes; ++mesh)
-    //   Forsyth::optimize(unpackedMesh[mesh].indexes, 
-    //                     unpackedMesh[mesh].optimized, 
-    //                     unpackedMesh[mesh].vertices.size());
-    //
+    // Optimize indexes order for Post-Transform Vertex Cache Size, reorder
+    // clusters of triangles to reduce overdraw, and then reorder vertices
+    // in order in which they are fetched.
+    for(uint32 mesh=0; mesh<numMeshes; ++mesh)
+    {
+        UnpackedMesh& srcMesh = unpackedMesh[mesh];
+        uint32 vertexes = static_cast<uint32>(srcMesh.vertices.size());
+
+        Forsyth::Statistics before = Forsyth::analyze(srcMesh.indexes, vertexes);
+        Forsyth::optimize(srcMesh.indexes, srcMesh.optimized, vertexes);
+
+        std::vector<float3> positions(vertexes);
+        for(uint32 vertice=0; vertice<vertexes; ++vertice)
+        {
+            const FbxVector4& position = fbxVertices[ srcMesh.vertices[vertice].position ];
+            positions[vertice] = float3(static_cast<float>(position[0]), static_cast<float>(position[1]), static_cast<float>(position[2]));
+        }
+
+        Forsyth::optimizeOverdraw(srcMesh.optimized, positions);
+
+        std::vector<uint32> remap;
+        vertexes = Forsyth::optimizeVertexFetch(srcMesh.optimized, remap, vertexes);
+        Forsyth::remapVertices(srcMesh.vertices, remap, vertexes);
+
+        Forsyth::Statistics after = Forsyth::analyze(srcMesh.optimized, vertexes);
+        enLog << "Mesh " << srcMesh.name << ": ACMR " << before.acmr << " -> " << after.acmr 
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    }
 
     // Optimization TODO: Generate triangle stripes here
 
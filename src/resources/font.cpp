@@ -214,7 +214,7 @@ std::shared_ptr<en::resources::Font> loadFont(const std::string& filename)
     uint32 characters;
     uint32 id = 0;
    
-    std::string line, word, command, value;
+    std::string_view word, command, value;
     bool eol = false;
     while(!text.end())
     {
@@ -227,31 +227,31 @@ std::shared_ptr<en::resources::Font> loadFont(const std::string& filename)
         {
             while(text.read(word, eol))
             {
-                std::size_t found = word.find("=");
-                if (found != std::string::npos)
+                std::size_t found = word.find('=');
+                if (found != std::string_view::npos)
                 {
                     command = word.substr(0, found);
                     value   = word.substr(found+1);
 
                     if (command == "lineHeight")
                     {
-                        font->height = static_cast<float>(stringTo<uint32>(value));
+                        font->height = static_cast<float>(parseNumber<uint32>(value));
                     }
                     else
                     if (command == "scaleW")
                     {
-                        texWidth  = static_cast<float>(stringTo<uint32>(value));
+                        texWidth  = static_cast<float>(parseNumber<uint32>(value));
                     }
                     else
                     if (command == "scaleH")
                     {
-                        texHeight = static_cast<float>(stringTo<uint32>(value));
+                        texHeight = static_cast<float>(parseNumber<uint32>(value));
                         font->height /= texHeight;
                     }
                     else
                     if (command == "pages")
                     {
-                        assert(stringTo<uint32>(value) == 1);
+                        assert(parseNumber<uint32>(value) == 1);
                     }
 
                     // if (command == "packed")
@@ -274,20 +274,20 @@ std::shared_ptr<en::resources::Font> loadFont(const std::string& filename)
         {
             while(text.read(word, eol))
             {
-                std::size_t found = word.find("=");
-                if (found != std::string::npos)
+                std::size_t found = word.find('=');
+                if (found != std::string_view::npos)
                 {
                     command = word.substr(0, found);
                     value   = word.substr(found+1);
 
                     if (command == "id")
                     {
-                        assert(stringTo<uint32>(value) == 0);
+                        assert(parseNumber<uint32>(value) == 0);
                     }
                     else
                     if (command == "file")
                     {
-                        std::string name = value.substr(1, value.length()-2);
+                        std::string name(value.substr(1, value.length()-2));
                         font->resource = Resources.load.texture(name);
                         if (!font->resource)
                         {
@@ -310,15 +310,15 @@ std::shared_ptr<en::resources::Font> loadFont(const std::string& filename)
         {
             while(text.read(word, eol))
             {
-                std::size_t found = word.find("=");
-                if (found != std::string::npos)
+                std::size_t found = word.find('=');
+                if (found != std::string_view::npos)
                 {
                     command = word.substr(0, found);
                     value   = word.substr(found+1);
 
                     if (command == "count")
                     {
-                        characters = stringTo<uint32>(value);
+                        characters = parseNumber<uint32>(value);
                     }
                 }
 
@@ -334,55 +334,55 @@ std::shared_ptr<en::resources::Font> loadFont(const std::string& filename)
         {
             while(text.read(word, eol))
             {
-                std::size_t found = word.find("=");
-                if (found != std::string::npos)
+                std::size_t found = word.find('=');
+                if (found != std::string_view::npos)
                 {
                     command = word.substr(0, found);
                     value   = word.substr(found+1);
 
                     if (command == "id")
                     {
-                        id = stringTo<uint32>(value);
+                        id = parseNumber<uint32>(value);
                     }
                     else
                     if (command == "x")
                     {
-                        font->table[id].position.x = static_cast<float>(stringTo<uint32>(value)) / texWidth;
+                        font->table[id].position.x = static_cast<float>(parseNumber<uint32>(value)) / texWidth;
                     }
                     else
                     if (command == "y")
                     {
-                        font->table[id].position.y = (1.0f - static_cast<float>(stringTo<uint32>(value))) / texHeight;
+                        font->table[id].position.y = (1.0f - static_cast<float>(parseNumber<uint32>(value))) / texHeight;
                     }
                     else
                     if (command == "width")
                     {
-                        font->table[id].width      = static_cast<float>(stringTo<uint32>(value)) / texWidth;
+                        font->table[id].width      = static_cast<float>(parseNumber<uint32>(value)) / texWidth;
                     }
                     else
                     if (command == "height")
                     {
-                        font->table[id].height     = static_cast<float>(stringTo<uint32>(value)) / texHeight;
+                        font->table[id].height     = static_cast<float>(parseNumber<uint32>(value)) / texHeight;
                     }
                     else
                     if (command == "xoffset")
                     {
-                        font->table[id].offset.x   = static_cast<float>(stringTo<sint32>(value)) / texWidth;
+                        font->table[id].offset.x   = static_cast<float>(parseNumber<sint32>(value)) / texWidth;
                     }
                     else
                     if (command == "yoffset")
                     {
-                        font->table[id].offset.y   = static_cast<float>(stringTo<sint32>(value)) / texHeight;
+                        font->table[id].offset.y   = static_cast<float>(parseNumber<sint32>(value)) / texHeight;
                     }
                     else
                     if (command == "xadvance")
                     {
-                        font->table[id].advance    = static_cast<float>(stringTo<uint32>(value)) / texWidth;
+                        font->table[id].advance    = static_cast<float>(parseNumber<uint32>(value)) / texWidth;
                     }
                     else
                     if (command == "page")
                     {
-                        assert(stringTo<uint32>(value) == 0);
+                        assert(parseNumber<uint32>(value) == 0);
                     }
 
                     // if (command == "chnl")
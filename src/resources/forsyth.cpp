@@ -1,7 +1,7 @@
 /*
 
  Ngine v5.0
- 
+
  Module      : Forsyth algorithm
  Visibility  : Engine internal code
  Requirements: none
@@ -11,308 +11,491 @@
 
 */
 
+#include <assert.h>
 #include <math.h>
+#include <string.h>
 
-#include "core/rendering/device.h"
+#include "utilities/utilities.h"
+#include "utilities/gpcpu/gpcpu.h"
 #include "resources/forsyth.h"
 
-#if !defined(EN_PLATFORM_OSX)
-
-
-//namespace en
-//{
-//   namespace Forsyth
-//   {
-//   // TODO: It should be possible to change algorithm 
-//   //       constants through config file to allow 
-//   //       automatic search for optimal values without
-//   //       code recompilation.
-//   const float CacheDecayPower   = 1.50f;
-//   const float LastTriScore      = 0.75f;
-//   const float ValenceBoostScale = 2.0f;
-//   const float ValenceBoostPower = 0.5f;
-//
-//   // Precomputed scores
-//   float precomputedCacheScore[32];   // GpuContext.support.postTransformVertexCacheSize
-//   float precomputedValenceScore[64];
-//
-//   struct Vertex
-//          {
-//          float  score;       // Vertex score 
-//          uint32 triangles;   // Offset in array, to the beginning of list 
-//                              // with triangle indexes used by this vertex
-//          uint16 count;       // Count of triangles that uses this vertex
-//          uint16 uses;        // Count of triangles that still need to use this vertex
-//          uint8  position;    // Position in simulated post transform vertex cache (255 outside)
-//          uint8  oldPosition; // Position in previous state of simulated cache 
-//
-//          Vertex();
-//          };
-//
-//   struct Triangle
-//          {
-//          float  score;       // Triangle score (sum of vertexes scores)
-//          uint16 vertex[3];   // Indexes to triangle vertexes
-//          bool   added;       // Is it added to the indices list already?
-//          };
-//
-//   Vertex::Vertex() :
-//      score(0.0f),
-//      triangles(0),
-//      count(0),
-//      uses(0),
-//      position(255),
-//      oldPosition(255)
-//   {
-//   }
-//
-//   // Should be used once to precompute scores for
-//   // given post transform vertex cache size.
-//   float VertexCacheScore(uint8 position, uint8 size)
-//   {
-//   // First three positions are occupied by vertexes
-//   // that were used in the last triangle, so all of
-//   // them have the same score because order in which
-//   // they compose triangle is irrelevant.
-//   if (position < 3)
-//      return LastTriScore;
-//   
-//   // Be sure that proper values were passed
-//   assert(position < size);
-//   
-//   // Higher position in cache equals to better score
-//   float score = 1.0f - static_cast<float>((position - 3) / (size - 3));
-//   return powf(score, CacheDecayPower);
-//   }
-//
-//   float VertexValenceScore(uint16 faces)
-//   {
-//   // Vertexes that are no more needed have negative score.
-//   if (faces == 0)
-//      return -1.0f;
-//   
-//   // Current valence score depends on number of triangles, 
-//   // that still need this vertex. Vertexes that are needed
-//   // by small amount of triangles are favored and receive
-//   // higher scores. This allows to faster get rid of rarely
-//   // used vertexes.
-//   float valenceBoost = powf(static_cast<float>(faces), -ValenceBoostPower);
-//   return ValenceBoostScale * valenceBoost;
-//   }
-//
-//   float VertexScore(uint16 faces, uint8 position)
-//   {
-//   // Check if vertex is still needed
-//   if (faces == 0)
-//      return -1.0f;
-//   
-//   float score = 0.0f;
-//   if (position < Graphics->primaryDevice()->support.postTransformVertexCacheSize)
-//      score += precomputedCacheScore[position];
-//   
-//   if (faces < 64)
-//      score += precomputedValenceScore[faces];
-//   else
-//      score += VertexValenceScore(faces);
-//   
-//   return score;
-//   }
-//
-//   void optimize(const vector<uint32>& input, vector<uint32>& output, uint32 vertexes)
-//   {
-//   for(uint8 i=0; i<GpuContext.support.postTransformVertexCacheSize; ++i)
-//      precomputedCacheScore[i] = VertexCacheScore(i, GpuContext.support.postTransformVertexCacheSize);
-//   
-//   for(uint16 i=0; i<64; ++i)
-//      precomputedValenceScore[i] = VertexValenceScore(i);
-//   
-//   
-//   vector<Vertex> vertices;  // Array of vertex description structures
-//   vector<uint32> triangles; // Set of Arrays per vertex with indices of triangles that use it
-//   
-//   vertices.resize(vertexes);
-//   
-//   // Compute faces count per vertex
-//   for(uint32 i=0; i<input.size(); ++i)
-//      {
-//      uint32 index = input[i];
-//      assert(index < vertexes);
-//      vertices[index].count++;
-//      }
-//   
-//   // Create arrays of triangle indices per vertex      
-//   uint32 offset = 0;
-//   for(uint32 i=0; i<vertexes; ++i)
-//      {
-//      Vertex& vertex   = vertices[i];
-//      vertex.score     = VertexScore(vertex.count, vertex.position);
-//      vertex.triangles = offset;
-//      offset += vertex.count;
-//      vertex.count     = 0;
-//      vertex.uses      = 0;
-//      }
-//   triangles.resize(offset);
-//   
-//   // Fill that array with data
-//   for(uint32 i=0; i<input.size(); i+=3)
-//      for(uint32 j=0; j<3; ++j)
-//         {
-//         Vertex& vertex = vertices[input[i+j]];
-//         triangles[vertex.triangles + vertex.count] = i;
-//         vertex.count++;
-//         }
-//   
-//   // To this point all that could be done during read of OBJ file
-//   
-//   vector<bool> processed; // Array of markers if given triangle was already processed
-//   processed.resize(input.size());
-//   
-//   // Simulated LRU Post-Transform Vertex Cache
-//   uint32 cache[32]; // GpuContext.support.postTransformVertexCacheSize
-//   uint8  cacheEntries = 0;
-//   
-//   // Previous state of simulated cache
-//   uint32 oldCache[32]; //GpuContext.support.postTransformVertexCacheSize
-//   uint8  oldCacheEntries = 0;
-//   
-//   // Clear caches 
-//   memset(cache, 0, GpuContext.support.postTransformVertexCacheSize * sizeof(uint32));
-//   memset(oldCache, 0, GpuContext.support.postTransformVertexCacheSize * sizeof(uint32));
-//   
-//   uint32 bestFace = 0;
-//   float bestScore = -1.0f;
-//   
-//   const float maxValenceScore = VertexScore(1, 255) * 3.0f;  // ?
-//   
-//   for(uint32 i=0; i<input.size(); i+=3)
-//      {
-//      if (bestScore < 0.0f)
-//         // Choose triangle with highest score as a new starting point,
-//         // because vertices in the cache won't be used any more, and 
-//         // are not needed by unprocessed triangles that left
-//         for(uint32 face=0; face<input.size(); face+=3)
-//            if (!processed[face])
-//               {
-//               // Calculate triangle score
-//               float score = 0.0f;
-//               for(uint32 v=0; v<3; ++v)
-//                  score += vertices[input[face + v]].score;
-//   
-//               if (score > bestScore)
-//                  {
-//                  bestScore = score;
-//                  bestFace  = face;
-//   
-//                  assert(bestScore <= maxValenceScore);  // ?
-//                  if (bestScore >= maxValenceScore)      // ?
-//                     break;                              // ?
-//                  }
-//               }
-//      processed[bestFace] = true;
-//   
-//      // Add triangle vertices to cache and seve them in output list
-//      for(uint32 v=0; v<3; ++v)
-//         {
-//         uint32 index = input[bestFace + v];
-//         output[i + v] = index;
-//   
-//         Vertex& vertex = vertices[index];
-//   
-//         // If vertex is not already in updated cache, add it 
-//         if (vertex.position >= cacheEntries)
-//            {
-//            vertex.position = cacheEntries;
-//            cache[cacheEntries++] = index;
-//      
-//            // If this was last triangle that was using that vertex
-//            // there is no need to reorder it's triangles list.
-//            if (vertex.count == 1)
-//               {
-//               --vertex.count;
-//               continue;
-//               }
-//            }
-//    
-//         // Moves index of currently processed triangle to the end of the triangles 
-//         // list for specified vertex, and decreases count of that list. In result
-//         // vertex has information only about triangles that haven't been processed
-//         // yet.
-//         assert(vertex.count > 0);
-//         for(uint32 j=0; j<vertex.count; ++j)
-//             if (triangles[vertex.triangles + j] == bestFace)
-//                {
-//                uint32 end = vertex.triangles + vertex.count - 1;
-//                triangles[vertex.triangles + j] = triangles[end];
-//                triangles[end] = bestFace;
-//                break;
-//                }
-//         --vertex.count;
-//   
-//         // Calculate new vertex score
-//         vertex.score = VertexScore(vertex.count, vertex.position);
-//         }
-//   
-//      // Vertices of currently processed triangle are moved to the
-//      // beginning of the cache to simulate LRU policy. If new 
-//      // vertices were used, last recently used ones will fall out
-//      // of cache.
-//      for(uint8 pos=0; pos<oldCacheEntries; ++pos)
-//         {
-//         Vertex& vertex = vertices[oldCache[pos]];
-//   
-//         // If vertex is not already in cache, add it 
-//         // and recalculate its score.
-//         if (vertex.position >= cacheEntries)
-//            {
-//            vertex.position = cacheEntries;
-//            cache[cacheEntries++] = oldCache[pos];
-//            vertex.score = VertexScore(vertex.count, vertex.position);
-//            }
-//   
-//         if (cacheEntries == GpuContext.support.postTransformVertexCacheSize)
-//            break;
-//         }
-//   
-//      // find the best scoring triangle in the current cache (including up to 3 that were just evicted)
-//      bestScore = -1.0f;
-//      for(uint32 pos=0; pos<cacheEntries; ++pos)
-//         {
-//         Vertex& vertex = vertices[cache[pos]];
-//   
-//         // Save current vertice cache state as previous one
-//         vertex.oldPosition = vertex.position;
-//         vertex.position    = 255;
-//   
-//         // From all triangles that still need to use current
-//         // vertices in cache, find the best triangle to process
-//         for(uint32 j=0; j<vertex.count; ++j)
-//            {
-//            uint32 face = triangles[vertex.triangles + j];
-//   
-//            // Calculate triangle score
-//            float score = 0.0f;
-//            for(uint32 v=0; v<3; ++v)
-//               score += vertices[input[face + v]].score;
-//           
-//            if (score > bestScore)
-//               {
-//               bestScore = score;
-//               bestFace  = face;
-//               }
-//            }
-//         }
-//        
-//      // Save current cache state as previous one
-//      memcpy(oldCache, cache, GpuContext.support.postTransformVertexCacheSize * sizeof(uint32));
-//      oldCacheEntries = min(cacheEntries, (uint8)GpuContext.support.postTransformVertexCacheSize);
-//   
-//      // Clear current cache state
-//      memset(cache, 0, GpuContext.support.postTransformVertexCacheSize * sizeof(uint32));
-//      cacheEntries = 0;
-//      }
-//   }
-//
-//   }
-//}
-
-#endif
+#include <algorithm>
+
+namespace en
+{
+namespace Forsyth
+{
+
+// TODO: It should be possible to change algorithm
+//       constants through config file to allow
+//       automatic search for optimal values without
+//       code recompilation.
+const float CacheDecayPower   = 1.50f;
+const float LastTriScore      = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+constexpr uint32 MaxValence    = 64;
+constexpr uint32 InvalidFace   = 0xFFFFFFFF;
+constexpr sint32 OutsideCache  = -1;
+
+// Precomputed scores, last cache entry is used for vertices outside of cache
+struct Scores
+{
+    float cache[MaxCacheSize + 1];
+    float valence[MaxValence + 1];
+
+    Scores(const uint32 cacheSize);
+
+    forceinline float vertex(const sint32 position, const uint32 faces) const
+    {
+        // Vertices that are no more needed are never scored again
+        if (faces == 0)
+        {
+            return -1.0f;
+        }
+
+        return cache[position < 0 ? MaxCacheSize : position] + valence[faces < MaxValence ? faces : MaxValence];
+    }
+};
+
+Scores::Scores(const uint32 cacheSize)
+{
+    assert( cacheSize > 3 && cacheSize <= MaxCacheSize );
+
+    for(uint32 position=0; position<MaxCacheSize; ++position)
+    {
+        // First three positions are occupied by vertexes
+        // that were used in the last triangle, so all of
+        // them have the same score because order in which
+        // they compose triangle is irrelevant. Higher
+        // position in cache equals to better score.
+        if (position < 3)
+        {
+            cache[position] = LastTriScore;
+        }
+        else
+        if (position < cacheSize)
+        {
+            float score = 1.0f - static_cast<float>(position - 3) / static_cast<float>(cacheSize - 3);
+            cache[position] = powf(score, CacheDecayPower);
+        }
+        else
+        {
+            cache[position] = 0.0f;
+        }
+    }
+    cache[MaxCacheSize] = 0.0f;
+
+    // Current valence score depends on number of triangles,
+    // that still need this vertex. Vertexes that are needed
+    // by small amount of triangles are favored and receive
+    // higher scores. This allows to faster get rid of rarely
+    // used vertexes.
+    valence[0] = 0.0f;
+    for(uint32 faces=1; faces<=MaxValence; ++faces)
+    {
+        valence[faces] = ValenceBoostScale * powf(static_cast<float>(faces), -ValenceBoostPower);
+    }
+}
+
+void optimize(const std::vector<uint32>& input, std::vector<uint32>& output, const uint32 vertexes, const uint32 cacheSize)
+{
+    assert( input.size() % 3 == 0 );
+    assert( input.size() / 3 < InvalidFace );
+
+    uint32 faces = static_cast<uint32>(input.size() / 3);
+    output.resize(input.size());
+    if (faces == 0)
+    {
+        return;
+    }
+
+    Scores scores(cacheSize);
+
+    // Count faces using each vertex
+    std::vector<uint32> live(vertexes, 0);
+    for(uint32 i=0; i<input.size(); ++i)
+    {
+        assert( input[i] < vertexes );
+        live[input[i]]++;
+    }
+
+    // Create arrays of faces using each vertex, faces that were
+    // already emitted are moved past the live part of the array
+    std::vector<uint32> offset(vertexes);
+    uint32 total = 0;
+    for(uint32 i=0; i<vertexes; ++i)
+    {
+        offset[i] = total;
+        total += live[i];
+    }
+
+    std::vector<uint32> adjacency(total);
+    std::vector<uint32> filled(vertexes, 0);
+    for(uint32 face=0; face<faces; ++face)
+    {
+        for(uint32 j=0; j<3; ++j)
+        {
+            uint32 vertex = input[face * 3 + j];
+            adjacency[offset[vertex] + filled[vertex]++] = face;
+        }
+    }
+
+    // Initial scores
+    std::vector<float> vertexScore(vertexes);
+    for(uint32 i=0; i<vertexes; ++i)
+    {
+        vertexScore[i] = scores.vertex(OutsideCache, live[i]);
+    }
+
+    std::vector<float> faceScore(faces);
+    std::vector<bool>  emitted(faces, false);
+    uint32 current   = 0;
+    float  bestScore = -1.0f;
+    for(uint32 face=0; face<faces; ++face)
+    {
+        const uint32* index = &input[face * 3];
+        faceScore[face] = vertexScore[index[0]] + vertexScore[index[1]] + vertexScore[index[2]];
+        if (faceScore[face] > bestScore)
+        {
+            bestScore = faceScore[face];
+            current   = face;
+        }
+    }
+
+    // Simulated LRU Post-Transform Vertex Cache. During update it
+    // can temporarily hold three more vertices, that fall out of it.
+    uint32 cache[MaxCacheSize + 3];
+    uint32 newCache[MaxCacheSize + 3];
+    uint32 cacheEntries = 0;
+
+    uint32 cursor = 0;
+    for(uint32 i=0; i<faces; ++i)
+    {
+        // If there are no more triangles using vertices in cache,
+        // continue from next not emitted triangle in input order.
+        if (current == InvalidFace)
+        {
+            while(emitted[cursor])
+            {
+                cursor++;
+            }
+
+            current = cursor;
+        }
+
+        const uint32* index = &input[current * 3];
+        output[i * 3 + 0] = index[0];
+        output[i * 3 + 1] = index[1];
+        output[i * 3 + 2] = index[2];
+        emitted[current] = true;
+
+        // Vertices of currently processed triangle are moved to the
+        // beginning of the cache to simulate LRU policy. If new
+        // vertices were used, last recently used ones will fall out
+        // of cache.
+        uint32 newEntries = 0;
+        newCache[newEntries++] = index[0];
+        newCache[newEntries++] = index[1];
+        newCache[newEntries++] = index[2];
+        for(uint32 j=0; j<cacheEntries; ++j)
+        {
+            uint32 vertex = cache[j];
+            if (vertex != index[0] &&
+                vertex != index[1] &&
+                vertex != index[2])
+            {
+                newCache[newEntries++] = vertex;
+            }
+        }
+
+        // Moves emitted triangle to the end of the triangles list of its
+        // vertices, so that they have information only about triangles
+        // that haven't been processed yet.
+        for(uint32 j=0; j<3; ++j)
+        {
+            uint32  vertex = index[j];
+            uint32* list   = &adjacency[offset[vertex]];
+            uint32  count  = live[vertex];
+            for(uint32 k=0; k<count; ++k)
+            {
+                if (list[k] == current)
+                {
+                    list[k] = list[count - 1];
+                    list[count - 1] = current;
+                    break;
+                }
+            }
+
+            assert( live[vertex] > 0 );
+            live[vertex]--;
+        }
+
+        // Update scores of vertices that changed position in cache,
+        // including the ones that just fell out of it, and scores of
+        // triangles that still use them.
+        for(uint32 j=0; j<newEntries; ++j)
+        {
+            uint32 vertex   = newCache[j];
+            sint32 position = j < cacheSize ? static_cast<sint32>(j) : OutsideCache;
+
+            float score = scores.vertex(position, live[vertex]);
+            float delta = score - vertexScore[vertex];
+            vertexScore[vertex] = score;
+
+            const uint32* list = &adjacency[offset[vertex]];
+            for(uint32 k=0; k<live[vertex]; ++k)
+            {
+                faceScore[list[k]] += delta;
+            }
+        }
+
+        // Find the best scoring triangle using vertices in cache
+        cacheEntries = min(newEntries, cacheSize);
+        current   = InvalidFace;
+        bestScore = -1.0f;
+        for(uint32 j=0; j<cacheEntries; ++j)
+        {
+            uint32 vertex = newCache[j];
+            cache[j] = vertex;
+
+            const uint32* list = &adjacency[offset[vertex]];
+            for(uint32 k=0; k<live[vertex]; ++k)
+            {
+                uint32 face = list[k];
+                if (faceScore[face] > bestScore)
+                {
+                    bestScore = faceScore[face];
+                    current   = face;
+                }
+            }
+        }
+    }
+}
+
+// Simulated FIFO Post-Transform Vertex Cache. Vertex is present in it, if
+// less than cacheSize vertices were transformed since it was transformed.
+struct FIFOCache
+{
+    std::vector<uint32> timestamp;
+    uint32 time;
+    uint32 size;
+
+    FIFOCache(const uint32 vertexes, const uint32 cacheSize) :
+        timestamp(vertexes, 0),
+        time(cacheSize + 1),
+        size(cacheSize)
+    {
+    }
+
+    forceinline uint32 process(const uint32* index)
+    {
+        uint32 misses = 0;
+        for(uint32 i=0; i<3; ++i)
+        {
+            if (time - timestamp[index[i]] > size)
+            {
+                timestamp[index[i]] = time++;
+                misses++;
+            }
+        }
+
+        return misses;
+    }
+
+    forceinline void flush(void)
+    {
+        time += size + 1;
+    }
+};
+
+struct Cluster
+{
+    uint32 first;  // First triangle
+    uint32 faces;  // Triangles count
+    float  sortKey;
+};
+
+void optimizeOverdraw(std::vector<uint32>& indexes, const std::vector<float3>& positions, const float threshold, const uint32 cacheSize)
+{
+    assert( indexes.size() % 3 == 0 );
+
+    uint32 faces    = static_cast<uint32>(indexes.size() / 3);
+    uint32 vertexes = static_cast<uint32>(positions.size());
+    if (faces == 0)
+    {
+        return;
+    }
+
+    // Hard boundaries are placed where vertex cache optimizer started new
+    // strip of triangles (all vertices of triangle missed the cache).
+    std::vector<uint32> hard;
+    FIFOCache cache(vertexes, cacheSize);
+    for(uint32 face=0; face<faces; ++face)
+    {
+        if (cache.process(&indexes[face * 3]) == 3)
+        {
+            hard.push_back(face);
+        }
+    }
+    hard.push_back(faces);
+
+    // Soft boundaries split hard clusters further, at points where
+    // ACMR of new cluster (starting with cold cache) is not worse
+    // than ACMR of whole hard cluster scaled by threshold.
+    std::vector<Cluster> clusters;
+    for(uint32 i=0; i+1<hard.size(); ++i)
+    {
+        uint32 start = hard[i];
+        uint32 end   = hard[i + 1];
+
+        cache.flush();
+        uint32 misses = 0;
+        for(uint32 face=start; face<end; ++face)
+        {
+            misses += cache.process(&indexes[face * 3]);
+        }
+
+        float limit = threshold * static_cast<float>(misses) / static_cast<float>(end - start);
+
+        cache.flush();
+        misses = 0;
+        uint32 first = start;
+        for(uint32 face=start; face<end; ++face)
+        {
+            misses += cache.process(&indexes[face * 3]);
+            if ((face + 1 == end) ||
+                (static_cast<float>(misses) / static_cast<float>(face + 1 - first) <= limit))
+            {
+                Cluster cluster = { first, face + 1 - first, 0.0f };
+                clusters.push_back(cluster);
+
+                cache.flush();
+                misses = 0;
+                first  = face + 1;
+            }
+        }
+    }
+
+    // Calculate area weighted centroid and normal of each cluster
+    std::vector<float3> centroids(clusters.size());
+    std::vector<float3> normals(clusters.size());
+    float3 meshCentroid(0.0f, 0.0f, 0.0f);
+    float  meshArea = 0.0f;
+    for(uint32 i=0; i<clusters.size(); ++i)
+    {
+        float3 centroid(0.0f, 0.0f, 0.0f);
+        float3 normal(0.0f, 0.0f, 0.0f);
+        float  area = 0.0f;
+        for(uint32 face=clusters[i].first; face<clusters[i].first+clusters[i].faces; ++face)
+        {
+            const float3& a = positions[indexes[face * 3 + 0]];
+            const float3& b = positions[indexes[face * 3 + 1]];
+            const float3& c = positions[indexes[face * 3 + 2]];
+
+            float3 faceNormal = cross(b - a, c - a);
+            float  faceArea   = faceNormal.length();
+
+            centroid += (a + b + c) * (faceArea / 3.0f);
+            normal   += faceNormal;
+            area     += faceArea;
+        }
+
+        if (area > 0.0f)
+        {
+            centroid /= area;
+        }
+
+        centroids[i] = centroid;
+        normals[i]   = normal;
+        meshCentroid += centroid * area;
+        meshArea     += area;
+    }
+
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing outward from mesh center, are potentially
+    // occluding other ones, so they should be drawn first.
+    for(uint32 i=0; i<clusters.size(); ++i)
+    {
+        float length = normals[i].length();
+        clusters[i].sortKey = length > 0.0f ? dot(centroids[i] - meshCentroid, normals[i]) / length : 0.0f;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+    {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32> output(indexes.size());
+    uint32 offset = 0;
+    for(const Cluster& cluster : clusters)
+    {
+        uint32 count = cluster.faces * 3;
+        memcpy(&output[offset], &indexes[cluster.first * 3], count * sizeof(uint32));
+        offset += count;
+    }
+
+    indexes.swap(output);
+}
+
+uint32 optimizeVertexFetch(std::vector<uint32>& indexes, std::vector<uint32>& remap, const uint32 vertexes)
+{
+    remap.assign(vertexes, UnusedVertex);
+
+    uint32 count = 0;
+    for(uint32 i=0; i<indexes.size(); ++i)
+    {
+        uint32& index = indexes[i];
+        assert( index < vertexes );
+        if (remap[index] == UnusedVertex)
+        {
+            remap[index] = count++;
+        }
+
+        index = remap[index];
+    }
+
+    return count;
+}
+
+Statistics analyze(const std::vector<uint32>& indexes, const uint32 vertexes, const uint32 cacheSize)
+{
+    Statistics result = { 0.0f, 0.0f };
+
+    uint32 faces = static_cast<uint32>(indexes.size() / 3);
+    if (faces == 0)
+    {
+        return result;
+    }
+
+    FIFOCache cache(vertexes, cacheSize);
+    uint32 misses = 0;
+    for(uint32 face=0; face<faces; ++face)
+    {
+        misses += cache.process(&indexes[face * 3]);
+    }
+
+    // Count of vertices referenced by triangles
+    std::vector<bool> used(vertexes, false);
+    uint32 referenced = 0;
+    for(uint32 i=0; i<indexes.size(); ++i)
+    {
+        if (!used[indexes[i]])
+        {
+            used[indexes[i]] = true;
+            referenced++;
+        }
+    }
+
+    result.acmr = static_cast<float>(misses) / static_cast<float>(faces);
+    result.atvr = static_cast<float>(misses) / static_cast<float>(referenced);
+    return result;
+}
+
+} // en::Forsyth
+} // en
@@ -11,16 +11,16 @@
 
 #include "core/storage.h"
 #include "core/log/log.h"
+#include "core/memory/alignedAllocator.h"
 #include "core/utilities/parser.h"
 #include "utilities/utilities.h"
 #include "utilities/strings.h"
-#include "resources/context.h"
 #include "resources/hdr.h"
 
 #include "core/types/half.h"
 
-#include "core/rendering/device.h"
 
+#include <string.h>
 #include <cstddef>
 #include <string>
 
@@ -37,12 +37,12 @@ enum Compression
 };
       
 // Decompress RGBA shared exponent to float RGB
-float3 decompress(uint8* color)
+float3 decompress(const uint8* color)
 {
     float3 out;
    
-    // If color[4] == 0 return black
-    if (color[4] != 0)
+    // If exponent == 0 return black
+    if (color[3] != 0)
     {
         double f = ldexp(1.0, static_cast<sint32>(color[3]) - (128 + 8));
         out.r = static_cast<float>((static_cast<double>(color[0]) + 0.5) * f);
@@ -53,24 +53,10 @@ float3 decompress(uint8* color)
     return out;
 }
 
-std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
+// Reads header of HDR file, and resolution of stored image. 
+// Offset is set to location of first scanline.
+bool readHeader(storage::File* file, uint32& width, uint32& height, uint64& offset)
 {
-    using namespace en::storage;
-    using namespace en::gpu;
-
-    // Open image file
-    File* file = Storage->open(filename);
-    if (!file)
-    {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return std::shared_ptr<gpu::Texture>();
-        }
-    }
-   
     // Read file header
     char header[11];
     header[10] = 0;
@@ -78,22 +64,19 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     if (!file->read(0, 10, &header))
     {
         enLog << "ERROR: Not HDR file!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        return false;
     }
     if (strcmp(radiance, header) != 0)
     {
         enLog << "ERROR: HDR file header signature incorrect!\n";
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        return false;
     }
 
-
     Compression compression = Unknown;
     float exposure;
 
     // Read parameters
-    uint32 offset = 0;
+    offset = 0;
     uint32 read = 0;
     std::string line;
     for(;;)
@@ -127,12 +110,16 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     }
 
     // TODO: Add support for XYZ color space conversion to RGB
-    assert(compression == RLE_RGBA);
+    if (compression != RLE_RGBA)
+    {
+        enLog << "ERROR: Only HDR files with RGBE texels are supported!\n";
+        return false;
+    }
 
     // Read image size and orientation
     std::string word;
-    uint32 width  = 0;
-    uint32 height = 0;
+    width  = 0;
+    height = 0;
     bool columnOrder = false;
     bool posX = false;
     bool posY = false;
@@ -140,6 +127,11 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     // First Axis
     read = file->readWord(offset, 256, word);
     offset += (read + 1);
+    if (word.size() < 2)
+    {
+        enLog << "ERROR: HDR file resolution is incorrect!\n";
+        return false;
+    }
     if ((word[1] == 'Y') && (word[0] == '+')) posY = true;
     if (word[1] == 'X')
     {
@@ -162,6 +154,11 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     // Second Axis
     read = file->readWord(offset, 256, word);
     offset += (read + 1);
+    if (word.size() < 2)
+    {
+        enLog << "ERROR: HDR file resolution is incorrect!\n";
+        return false;
+    }
     if ((word[1] == 'Y') && (word[0] == '+')) posY = true;
     if ((word[1] == 'X') && (word[0] == '+')) posX = true;
  
@@ -177,140 +174,109 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
         width  = stringTo<uint32>(word);
     }
 
-    // Check if data is really compressed with RLE
-    bool rle = false;
-    uint64 rawSize = width * height * 4;
-    if ( (file->size() - offset) != rawSize)
+    if (width == 0 || height == 0)
     {
-        rawSize = file->size() - offset;
-        rle = true;
+        enLog << "ERROR: HDR file resolution is incorrect!\n";
+        return false;
     }
 
-    // Read raw data to memory
-    uint8* raw = allocate<uint8>(static_cast<uint32>(rawSize), cacheline);
-    if (!file->read(offset, static_cast<uint32>(rawSize), raw))
+    return true;
+}
+
+// Texture is compressed using RLE one scan line at a time
+// http://radsite.lbl.gov/radiance/refer/Notes/picture_format.html
+// http://paulbourke.net/dataformats/pic/
+// Decodes single scanline to RGBE texels, returns false if data is corrupted.
+bool decodeScanline(const uint8*& raw, const uint8* end, uint8* data, const uint32 length)
+{
+    // First texel in scanline determines compression method used.
+    bool oldCompression = false;
+    if ( (length < 8 || length > 0x7FFF) ||
+         (end - raw < 4) ||
+         (raw[0] != 2) )
     {
-        enLog << "ERROR: Cannot read HDR file to memory!\n";
-        deallocate<uint8>(raw);
-        delete file;
-        return std::shared_ptr<gpu::Texture>();
+        oldCompression = true;
     }
 
-    // Texture is compressed using RLE one scan line at a time
-    // http://radsite.lbl.gov/radiance/refer/Notes/picture_format.html
-    // http://paulbourke.net/dataformats/pic/
-    // Data stores texels in OpenGL friendly +Y +X order 
-    uint8* data = allocate<uint8>(width * height * 4, cacheline);
-    memset(data, 0, width * height * 4);
-    uint32 lines = height;
-    uint32 length = width;
-    uint64 rawOffset = 0;
-    for(uint32 scanline=0; scanline<lines; ++scanline)
+    uint32 texel = 0;
+    if (!oldCompression)
     {
-        // First texel in scanline determines compression method used.
-        bool oldCompression = false;
-        uint8 r = raw[rawOffset];
-        uint8 g, b, e;
-        if ( (length < 8 || length > 0x7FFF) ||
-             (r != 2) )
+        uint8 r = raw[0];
+        uint8 g = raw[1];
+        uint8 b = raw[2];
+        uint8 e = raw[3];
+        raw += 4;
+
+        if (g != 2 || b & 128)
         {
             oldCompression = true;
+
+            // Write texel to output
+            data[0] = r;
+            data[1] = g;
+            data[2] = b;
+            data[3] = e;
+            texel++;
         }
+    }
 
-        uint32 texel=0;
-        if (!oldCompression)
+    if (oldCompression)
+    {
+        // Decompress scanline using old RLE method
+        sint32 shift = 0;
+        while(texel < length)
         {
-            rawOffset++;
-            g = raw[rawOffset++];
-            b = raw[rawOffset++];
-            e = raw[rawOffset++];
-
-            if (g != 2 || b & 128)
+            if (end - raw < 4)
             {
-                oldCompression = true;
-            
-                // Calculate destination offset in texture
-                uint32 x, y;
-                x = texel;                 // Pixels already read in row
-                y = lines  - scanline - 1; // Destination row
-
-                // Write texel to output
-                data[(y*width + x)*4 + 0] = r;
-                data[(y*width + x)*4 + 1] = g;
-                data[(y*width + x)*4 + 2] = b;
-                data[(y*width + x)*4 + 3] = e;
-                texel++;
+                return false;
             }
-        }
-
-        if (oldCompression)
-        {
-            // Decompress scanline using old RLE method
-            sint32 shift = 0;
-            for(; texel<length; )
-            {         
-                // Read RAW texel
-                uint8 r = raw[rawOffset++];
-                uint8 g = raw[rawOffset++];
-                uint8 b = raw[rawOffset++];
-                uint8 e = raw[rawOffset++];
-
-                // Calculate destination offset in texture
-                uint32 x, y;
-                x = texel;                 // Pixels already read in row
-                y = lines  - scanline - 1; // Destination row
 
-                // Write texel to output
-                data[(y*width + x)*4 + 0] = r;
-                data[(y*width + x)*4 + 1] = g;
-                data[(y*width + x)*4 + 2] = b;
-                data[(y*width + x)*4 + 3] = e;
-
-                // If RGB == 1, this means that exponent stores information
-                // about how many times given texel should be repeated. If
-                // next texels also contait RGB == 1, this means that repeating
-                // count of texels is greater than 255, and it is divided into
-                // several texels, each storing next 8 bits of the total number
-                // for which texels should be shifted.
-                if (r == 1 && g == 1 && b == 1)
+            // Read RAW texel
+            uint8 r = raw[0];
+            uint8 g = raw[1];
+            uint8 b = raw[2];
+            uint8 e = raw[3];
+            raw += 4;
+
+            // If RGB == 1, this means that exponent stores information
+            // about how many times given texel should be repeated. If
+            // next texels also contait RGB == 1, this means that repeating
+            // count of texels is greater than 255, and it is divided into
+            // several texels, each storing next 8 bits of the total number
+            // for which texels should be shifted.
+            if (r == 1 && g == 1 && b == 1 && texel > 0)
+            {
+                uint64 repeat = static_cast<uint64>(e) << shift;
+                if (repeat > length - texel)
                 {
-                    uint32 repeat = static_cast<sint32>(e) << shift;
-
-                    // We will repeat last texel value N times
-                    r = raw[rawOffset - 8];
-                    g = raw[rawOffset - 7];
-                    b = raw[rawOffset - 6];
-                    e = raw[rawOffset - 5];
-
-                    for(uint32 i=0; i<repeat; ++i)
-                    {
-                        // Calculate destination offset in texture
-                        uint32 x, y;
-                        x = texel;                 // Pixels already read in row
-                        y = lines  - scanline - 1; // Destination row
-                  
-                        // Write texel to output
-                        data[(y*width + x)*4 + 0] = r;
-                        data[(y*width + x)*4 + 1] = g;
-                        data[(y*width + x)*4 + 2] = b;
-                        data[(y*width + x)*4 + 3] = e;
-                        texel++;
-                    }
-
-                    shift += 8;
+                    return false;
                 }
-                else
+
+                // We will repeat last texel value N times
+                for(uint32 i=0; i<repeat; ++i)
                 {
-                    shift = 0;
+                    memcpy(data + texel * 4, data + (texel - 1) * 4, 4);
                     texel++;
                 }
 
-                assert( texel <= length );
+                shift += 8;
             }
+            else
+            {
+                // Write texel to output
+                data[texel * 4 + 0] = r;
+                data[texel * 4 + 1] = g;
+                data[texel * 4 + 2] = b;
+                data[texel * 4 + 3] = e;
 
-            continue;
+                shift = 0;
+                texel++;
+            }
         }
 
+        return true;
+    }
+
     // Decompress using new method.
     // Each channel of RGBE texels is stored as separate
     // array, first RRRR, then GGG etc. Each arrray is
@@ -324,174 +290,180 @@ std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
     {
         for(uint32 texel=0; texel<length;)
         {  
+            if (raw == end)
+            {
+                return false;
+            }
+
             // Read control byte
             bool decompress = false;
-            uint8 repeat = raw[rawOffset++];
+            uint8 repeat = *raw++;
             if (repeat > 128)
             {
                 decompress = true;
                 repeat &= 0x7F;
             }
 
-            uint8 value = 0;
-            for(uint32 i=0; i<repeat; ++i)
+            if (repeat == 0 ||
+                repeat > length - texel ||
+                (end - raw) < (decompress ? 1 : repeat))
+            {
+                return false;
+            }
+
+            if (decompress)
             {
-                // If just copying data, read following bytes
-                if (!decompress || i == 0)
+                uint8 value = *raw++;
+                for(uint32 i=0; i<repeat; ++i)
                 {
-                    value = raw[rawOffset++];
+                    data[(texel + i) * 4 + channel] = value;
                 }
-
-                // Calculate destination offset in texture
-                uint32 x, y;
-                x = texel;                 // Pixels already read in row
-                y = lines  - scanline - 1; // Destination row
-               
-                // Write texel current channel value to output
-                data[(y*width + x)*4 + channel] = value;
-                texel++;
             }
-
-            assert( texel <= length );
+            else
+            {
+                for(uint32 i=0; i<repeat; ++i)
+                {
+                    data[(texel + i) * 4 + channel] = raw[i];
+                }
+                raw += repeat;
             }
+
+            texel += repeat;
         }
     }
 
-    deallocate<uint8>(raw);
+    return true;
+}
 
-    // Determine texture parameters
-    TextureState settings;
-    settings.width  = width;
-    settings.height = height;
-    settings.format = Format::RGB_16_hf; // What about FormatEBGR_5_9_9_9_f ?
-    settings.type   = TextureType::Texture2D;
-
-    // Create texture in gpu
-    std::unique_ptr<Texture> texture(en::ResourcesContext.defaults.enHeapTextures->createTexture(settings));
-    if (!texture)
-    {
-        enLog << "ERROR: Cannot create texture in GPU!\n";
-        delete file;
-        return std::shared_ptr<Texture>(nullptr);
-    }
-   
-    // Create staging buffer
-    uint32 stagingSize = texture->size();
-    std::unique_ptr<gpu::Buffer> staging(en::ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, stagingSize));
-    if (!staging)
+storage::File* open(const std::string& filename)
+{
+    using namespace en::storage;
+
+    // Open image file
+    File* file = Storage->open(filename);
+    if (!file)
     {
-        enLog << "ERROR: Cannot create staging buffer!\n";
-        delete file;
-        return std::shared_ptr<Texture>(nullptr);
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
     }
 
-   // Recompress texture directly to gpu memory
-   //uint16* dst = reinterpret_cast<uint16*>(texture.map());
-   //for(uint32 texel=0; texel<(height * width); ++texel)
-   //   {
-   //   //uint16 mR = static_cast<uint16>(data[texel*4 + 0]);
-   //   //uint16 mG = static_cast<uint16>(data[texel*4 + 1]);
-   //   //uint16 mB = static_cast<uint16>(data[texel*4 + 2]);
-   //   //uint16 e  = static_cast<uint16>(data[texel*4 + 3]);
-  
-   //   float3 flo = decompress(&data[texel*4]);
-   //   half hR(flo.r);
-   //   half hG(flo.g);
-   //   half hB(flo.b);
-   //   dst[texel*3 + 0] = hR.value;
-   //   dst[texel*3 + 1] = hG.value;
-   //   dst[texel*3 + 2] = hB.value;
+    return file;
+}
 
-   //   // Uncompress RGBE to 3 half's
-   //   //dst[texel*3 + 0] = ((e << 10) + mB);
-   //   //dst[texel*3 + 1] = ((e << 10) + mG);
-   //   //dst[texel*3 + 2] = ((e << 10) + mR);
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
+    using namespace en::gpu;
 
-   //   // TODO: RGBE_8 to RGB_16_hf
-   //   }
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
+    uint32 width  = 0;
+    uint32 height = 0;
+    uint64 offset = 0;
+    bool success = readHeader(file, width, height, offset);
+    delete file;
 
-   //float3* dst = reinterpret_cast<float3*>(texture.map());
-   //for(uint32 texel=0; texel<(height * width); ++texel)
-   //   {
-   //   float3 flo = decompress(&data[texel*4]);
-   //   dst[texel] = flo;
-   //   }
+    if (!success)
+    {
+        return false;
+    }
 
+    // Determine texture parameters
+    settings.type    = TextureType::Texture2D;
+    settings.format  = Format::RGB_16_hf; // What about FormatEBGR_5_9_9_9_f ?
+    settings.usage   = TextureUsage::Read;
+    settings.width   = width;
+    settings.height  = height;
+    settings.layers  = 1;
+    settings.mipmaps = 1;
+    settings.samples = 1;
+
+    // Radiance files store linear values
+    colorSpace = ColorSpace::ColorSpaceLinear;
+    return true;
+}
 
-   // OK!
-   //float3* dst = reinterpret_cast<float3*>(texture.map());
-   //for(uint32 texel=0; texel<(height * width); ++texel)
-   //   {
-   //   float3 flo; // = decompress(&data[texel*4]);
+bool load(const std::string& filename,
+          uint8* const destination,
+          const uint32 width,
+          const uint32 height,
+          const gpu::Format format,
+          const gpu::ImageMemoryAlignment alignment,
+          const bool invertHorizontal)
+{
+    using namespace en::storage;
+    using namespace en::gpu;
 
-   //   float e = powf( 2.0f, static_cast<float>(data[texel*4+3] - 128) );
-   //   flo.r = (static_cast<float>(data[texel*4])   / 256.0f) * e;
-   //   flo.g = (static_cast<float>(data[texel*4+1]) / 256.0f) * e;
-   //   flo.b = (static_cast<float>(data[texel*4+2]) / 256.0f) * e;
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
-   //   dst[texel] = flo;
-   //   }
+    // Verify that file matches expected properties
+    uint32 fileWidth  = 0;
+    uint32 fileHeight = 0;
+    uint64 offset     = 0;
+    if ( !readHeader(file, fileWidth, fileHeight, offset) ||
+         (fileWidth  != width)  ||
+         (fileHeight != height) ||
+         (format != Format::RGB_16_hf) ||
+         (alignment.texelPitch() != 6) )
+    {
+        delete file;
+        return false;
+    }
 
-    volatile uint16* dst = reinterpret_cast<volatile uint16*>(staging->map());
-    for(uint32 texel=0; texel<(height * width); ++texel)
+    // Map scanlines, so that they are decompressed directly from OS page cache
+    uint64 fileSize = file->size();
+    FileView* view = nullptr;
+    if (offset < fileSize)
     {
-      //uint16 mR = static_cast<uint16>(data[texel*4 + 0]);
-      //uint16 mG = static_cast<uint16>(data[texel*4 + 1]);
-      //uint16 mB = static_cast<uint16>(data[texel*4 + 2]);
-      //uint16 e  = static_cast<uint16>(data[texel*4 + 3]);
-     
-      //// Uncompress RGBE to 3 half's
-      //dst[texel*3 + 0] = ((e << 10) + mB);
-      //dst[texel*3 + 1] = ((e << 10) + mG);
-      //dst[texel*3 + 2] = ((e << 10) + mR);
-
-
-      // Use Decompress or below
-      float3 flo  = decompress(&data[texel*4]); 
-      
-      //float e = powf( 2.0f, static_cast<float>(data[texel*4+3] - 128) );
-      //flo.r = (static_cast<float>(data[texel*4])   / 256.0f) * e;
-      //flo.g = (static_cast<float>(data[texel*4+1]) / 256.0f) * e;
-      //flo.b = (static_cast<float>(data[texel*4+2]) / 256.0f) * e;
-
-        half hR(flo.r);
-        half hG(flo.g);
-        half hB(flo.b);
-        dst[texel*3 + 0] = hR.value;
-        dst[texel*3 + 1] = hG.value;
-        dst[texel*3 + 2] = hB.value;
+        view = file->map(offset, fileSize - offset, MapHint::Sequential);
+    }
+    if (!view)
+    {
+        enLog << "ERROR: Cannot read HDR file to memory!\n";
+        delete file;
+        return false;
     }
 
-    staging->unmap();
-    
-    // TODO: In future distribute transfers to different queues in the same queue type family
-    gpu::QueueType type = gpu::QueueType::Universal;
-    if (Graphics->primaryDevice()->queues(gpu::QueueType::Transfer) > 0u)
+    // Data stores texels in OpenGL friendly +Y +X order. Each scanline is
+    // decompressed to RGBE texels, that are converted to half floats.
+    const uint8* raw = view->data();
+    const uint8* end = raw + view->size();
+    uint8* data = allocate<uint8>(width * 4, cacheline);
+    uint32 rowPitch = alignment.rowPitch(width);
+    bool success = true;
+    for(uint32 scanline=0; scanline<height; ++scanline)
     {
-        type = gpu::QueueType::Transfer;
+        if (!decodeScanline(raw, end, data, width))
+        {
+            enLog << "ERROR: HDR file is corrupted!\n";
+            success = false;
+            break;
+        }
+
+        uint32 y = invertHorizontal ? height - scanline - 1 : scanline;
+        uint16* dst = reinterpret_cast<uint16*>(destination + static_cast<uint64>(y) * rowPitch);
+        for(uint32 x=0; x<width; ++x)
+        {
+            float3 color = decompress(&data[x * 4]);
+            dst[x * 3 + 0] = half(color.r).value;
+            dst[x * 3 + 1] = half(color.g).value;
+            dst[x * 3 + 2] = half(color.b).value;
+        }
     }
 
-    // Copy data from staging buffer to final texture
-    std::shared_ptr<gpu::CommandBuffer> command = Graphics->primaryDevice()->createCommandBuffer(type);
-    command->start();
-    command->copy(*staging, 0u, settings.rowSize(0u), *texture, 0u, 0u);
-    command->commit();
-   
-   // TODO:
-   // here return completion handler callback !!! (no waiting for completion)
-   // - this callback destroys CommandBuffer object
-   // - destroys staging buffer
-   //
-   // Till it's done, wait for completion:
-   
-    command->waitUntilCompleted();
-    command = nullptr;
-    staging = nullptr;
-   
     deallocate<uint8>(data);
+    delete view;
     delete file;
-    return texture;
+    return success;
 }
 
 } // en::hdr
@@ -18,17 +18,30 @@
 
 namespace en
 {
+namespace resources
+{
+
+MaterialEntry::MaterialEntry() :
+    resolved(false)
+{
+}
+
+MaterialLibrary::MaterialLibrary() :
+    valid(false)
+{
+}
+
+} // en::resources
+
 namespace mtl
 {
 
-bool load(const std::string& filename, const std::string& name, en::resources::Material& material)
+// Parses whole MTL file in single pass, gathering names of
+// textures referenced by each material declared in it.
+static bool parse(const std::string& filename, en::resources::MaterialLibrary& library)
 {
     using namespace en::storage;
 
-    // Try to reuse already loaded material
-    //if (ResourcesContext.materials.find(name) != ResourcesContext.materials.end())
-    //   return ResourcesContext.materials[name];
-
     // Open MTL file 
     File* file = Storage->open(filename);
     if (!file)
@@ -38,7 +51,7 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
         {
             enLog << en::ResourcesContext.path.materials + filename << std::endl;
             enLog << "ERROR: There is no such file!\n";
-            return false; //en::resources::Material();
+            return false;
         }
     }
 
@@ -50,15 +63,16 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
     {
         enLog << "ERROR: Not enough memory!\n";
         delete file;
-        return false; //en::resources::Material();
+        return false;
     }
    
     // Read file to buffer and close file
     if (!file->read(buffer))
     {
         enLog << "ERROR: Cannot read whole mtl file!\n";
+        delete [] buffer;
         delete file;
-        return false; //en::resources::Material();
+        return false;
     }    
     delete file;
    
@@ -115,11 +129,11 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
     // WA: Ensure that the same texture is not used twice as ambient and diffuse map.
     std::string AmbientMapName;
 
-    // Search for specified material in file
+    // Gather all materials declared in file
+    en::resources::MaterialEntry* material = nullptr;
     std::string command;
     std::string word;
     bool eol = false;
-    bool found = false;
     while(!text.end())
     {
         // Read commands until it is end of file
@@ -128,31 +142,18 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
             continue;
         }
 
-        // Material name
+        // Material name, all following commands describe this material
+        // until next one. Only first declaration of given name is used.
         if (command == "newmtl")
         {
             if (!eol && text.read(word, eol))    
             { 
-                // If material is still not found, check if 
-                // this is it's searched declaration.
-                if (!found)
-                {
-                    if (word == name)
-                    {
-                        found = true;
-                    }
-                }
-                else
-                // If material was already found and parsed,
-                // this is declaration of next material which
-                // means that the parsing is finished.
-                {
-                    break;
-                }
+                auto result = library.materials.emplace(word, en::resources::MaterialEntry());
+                material = result.second ? &result.first->second : nullptr;
             }
         }
 
-        if (found)
+        if (material)
         {
             // Ambient texture
             if (command == "map_Ka")
@@ -213,7 +214,7 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
                     //    }
                     //}
 
-                    material.albedo = en::Resources.load.texture(word);
+                    material->albedo = word;
 
                     //resources::MaterialSampler parameter;
                     //parameter.handle = material->program.sampler(string("enDiffuseMap"));
@@ -277,7 +278,7 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
                         text.read(word, eol);
                     }
 
-                    material.normal = en::Resources.load.texture(word);
+                    material->normal = word;
 
 /*                  resources::MaterialSampler parameter;
                     parameter.handle = material->program.sampler(string("enNormalMap"));
@@ -306,7 +307,7 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
                         text.read(word, eol);
                     }
 
-                    material.displacement = en::Resources.load.texture(word);
+                    material->displacement = word;
 
 /*                  resources::MaterialSampler parameter;
                     parameter.handle = material->program.sampler(string("enDisplacementMap"));
@@ -334,7 +335,7 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
                         text.read(word, eol);
                     }
 
-                    material.opacity = en::Resources.load.texture(word);
+                    material->opacity = word;
 
 /*                  resources::MaterialSampler parameter;
                     parameter.handle = material->program.sampler(string("enAlphaMap"));
@@ -521,19 +522,70 @@ bool load(const std::string& filename, const std::string& name, en::resources::M
     //      }         
     //   }
 
+    library.valid = true;
+    return true;
+}
+
+// Returns library parsed from given MTL file. Each file is parsed only
+// once, and its materials are shared by all models referencing it.
+static en::resources::MaterialLibrary& library(const std::string& filename)
+{
+    auto it = ResourcesContext.libraries.find(filename);
+    if (it != ResourcesContext.libraries.end())
+    {
+        return it->second;
+    }
+
+    // Libraries that cannot be read are remembered as well,
+    // so that they are not searched again for each material.
+    en::resources::MaterialLibrary& library = ResourcesContext.libraries[filename];
+    parse(filename, library);
+    return library;
+}
+
+bool load(const std::string& filename, const std::string& name, en::resources::Material& material)
+{
+    en::resources::MaterialLibrary& source = library(filename);
+    if (!source.valid)
+    {
+        return false;
+    }
+
     // If material was not found in this file return nothing
-    if (!found)
+    auto it = source.materials.find(name);
+    if (it == source.materials.end())
     {
         enLog << "Error! Material \"" << name << "\" was not found in file: " << filename << " !\n";
-        //ResourcesContext.storage.materials.free(material);
-        return false; //en::resources::Material();
+        return false;
     }
 
-    //// Update list of loaded materials
-    //ResourcesContext.materials.insert(pair<string, en::resources::Material>(name, material));
+    // Textures are loaded when material is used for the first time
+    en::resources::MaterialEntry& entry = it->second;
+    if (!entry.resolved)
+    {
+        entry.material.name = name;
+        if (!entry.albedo.empty())
+        {
+            entry.material.albedo = en::Resources.load.texture(entry.albedo);
+        }
+        if (!entry.normal.empty())
+        {
+            entry.material.normal = en::Resources.load.texture(entry.normal);
+        }
+        if (!entry.displacement.empty())
+        {
+            entry.material.displacement = en::Resources.load.texture(entry.displacement);
+        }
+        if (!entry.opacity.empty())
+        {
+            entry.material.opacity = en::Resources.load.texture(entry.opacity);
+        }
+
+        entry.resolved = true;
+    }
 
-    // Return material interface
-    return true; //en::resources::Material(material);
+    material = entry.material;
+    return true;
 }
 
 } // en::mtl
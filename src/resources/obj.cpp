@@ -13,6 +13,7 @@
 #include "core/log/log.h"
 #include "core/rendering/device.h"
 #include "core/utilities/parser.h"
+#include "parallel/scheduler.h"
 #include "utilities/strings.h"
 #include "utilities/gpcpu/gpcpu.h"
 #include "resources/context.h" 
@@ -20,6 +21,11 @@
 #include "resources/obj.h"     
 #include "resources/mtl.h"     
 
+#include <algorithm>
+#include <string.h>
+#include <string_view>
+#include <unordered_map>
+
 namespace en
 {
 namespace obj
@@ -29,13 +35,23 @@ bool optimizeIndexSize  = true;   // Reduces index size UInt -> UShort -> UByte
 
 bool optimizeIndexOrder = true;   // Optimizes indexes order for Post-Transform Vertex Cache Size
 
+bool optimizeOverdraw   = true;   // Reorders clusters of triangles to reduce overdraw (requires optimizeIndexOrder)
+
+constexpr uint64 MinChunkSize      = 1024 * 1024; // Files are split to chunks parsed in parallel, but not smaller than that
+constexpr uint32 ChunksPerWorker   = 4;           // Allows balancing chunks with different content
+
 struct Vertex
 {
     uint32 position; // Position
     uint32 uv;       // Texture Coordinate
     uint32 normal;   // Normal vector
     
-    bool operator ==(const Vertex& b);
+    bool operator ==(const Vertex& b) const;
+};
+
+struct VertexHash
+{
+    size_t operator ()(const Vertex& vertex) const;
 };
 
 struct Face
@@ -62,56 +78,422 @@ struct Mesh
     bool                normals;   // Does mesh contain normal vectors
 };
 
-bool Vertex::operator ==(const Vertex& b)
+// Commands that change state of primitive assembly, need to be executed in
+// file order, so while parsing chunk of file they are recorded together with
+// count of faces that preceded them.
+enum class CommandType : uint8
+{
+    Group    = 0,  // g
+    Library     ,  // mtllib
+    Material    ,  // usemtl
+    CoordW      ,  // vt with third component
+};
+
+struct Command
+{
+    CommandType type;
+    uint64      face;  // Count of faces in chunk that were parsed before command
+    std::string name;
+};
+
+// Line aligned part of file, parsed independently from other chunks. Faces
+// reference vertex attributes by their location in whole file, so chunks can
+// be merged by simply appending them.
+struct Chunk
+{
+    const char*          begin;
+    const char*          end;
+    std::vector<float3>  vertices;    // Vertices
+    std::vector<float3>  normals;     // Normals
+    std::vector<float3>  coordinates; // Texture coordinates
+    std::vector<Vertex>  corners;     // Corners of all faces
+    std::vector<uint32>  faces;       // Count of corners of each face
+    std::vector<Command> commands;    // State changes
+};
+
+bool Vertex::operator ==(const Vertex& b) const
 {
-    return !memcmp(this, &b, 12); // 12 = sizeof(obj::Vertex)
+    return position == b.position &&
+           uv       == b.uv       &&
+           normal   == b.normal;
 }
 
-Vertex parseVertex(std::string& word)
+size_t VertexHash::operator ()(const Vertex& vertex) const
+{
+    // Indexes are packed and mixed with SplitMix64 finalizer
+    uint64 value = (static_cast<uint64>(vertex.position) << 32) ^ (static_cast<uint64>(vertex.uv) << 16) ^ vertex.normal;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    value =  value ^ (value >> 31);
+    return static_cast<size_t>(value);
+}
+
+// Returns next word in current line, or empty view at end of line. EOL is
+// not consumed.
+static std::string_view readWord(const char*& cursor, const char* end)
+{
+    while(cursor < end && !isCharacter(*cursor) && !isEol(*cursor))
+    {
+        cursor++;
+    }
+
+    const char* begin = cursor;
+    while(cursor < end && isCharacter(*cursor))
+    {
+        cursor++;
+    }
+
+    return std::string_view(begin, static_cast<size_t>(cursor - begin));
+}
+
+// Moves cursor to beginning of next line
+static void skipLine(const char*& cursor, const char* end)
+{
+    const char* eol = reinterpret_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+    cursor = eol ? eol + 1 : end;
+}
+
+// Parses three components of vertex attribute (missing ones are zero)
+static float3 readFloat3(const char*& cursor, const char* end)
+{
+    float component[3] = { 0.0f, 0.0f, 0.0f };
+    for(uint32 i=0; i<3; ++i)
+    {
+        std::string_view word = readWord(cursor, end);
+        if (word.empty())
+        {
+            break;
+        }
+
+        component[i] = parseNumber<float>(word);
+    }
+
+    return float3(component);
+}
+
+// Parses face corner in one of forms: v, v/t, v//n, v/t/n
+static Vertex parseVertex(std::string_view word)
 {
     Vertex vertex;
     size_t s1 = word.find('/');
-    size_t s2 = word.find('/',s1+1);
-   
+    size_t s2 = (s1 != std::string_view::npos) ? word.find('/', s1 + 1) : std::string_view::npos;
+
     // There is always vertex id
-    if (s1 != std::string::npos)
+    vertex.position = parseNumber<uint32>(word);
+
+    // If there is no number just after first slash, there is no Tex Coord
+    vertex.uv = 0;
+    if (s1 != std::string_view::npos)
     {
-        vertex.position = stringTo<uint32>(word.substr(0,s1));
+        vertex.uv = parseNumber<uint32>(word.substr(s1 + 1));
+    }
+
+    // If there is no second slash there is no Normal
+    vertex.normal = 0;
+    if (s2 != std::string_view::npos)
+    {
+        vertex.normal = parseNumber<uint32>(word.substr(s2 + 1));
+    }
+
+    return vertex;
+}
+
+static void parseChunk(Chunk& chunk)
+{
+    // Assume average line length, to minimise relocations during growth
+    uint64 lines = static_cast<uint64>(chunk.end - chunk.begin) / 32;
+    chunk.vertices.reserve(static_cast<size_t>(lines / 2));
+    chunk.corners.reserve(static_cast<size_t>(lines));
+    chunk.faces.reserve(static_cast<size_t>(lines / 2));
+
+    const char* cursor = chunk.begin;
+    const char* end    = chunk.end;
+    while(cursor < end)
+    {
+        std::string_view command = readWord(cursor, end);
+        if (command.empty())
+        {
+            skipLine(cursor, end);
+            continue;
+        }
+
+        // Handle vertices
+        if (command == "v")
+        {
+            chunk.vertices.push_back(readFloat3(cursor, end));
+        }
+        else
+        // Handle normals
+        if (command == "vn")
+        {
+            chunk.normals.push_back(readFloat3(cursor, end));
+        }
+        else
+        // Handle texture coordinates
+        if (command == "vt")
+        {
+            float3 coord = readFloat3(cursor, end);
+            if (coord.w != 0.0f)
+            {
+                chunk.commands.push_back(Command{ CommandType::CoordW, chunk.faces.size(), std::string() });
+            }
+
+            chunk.coordinates.push_back(coord);
+        }
+        else
+        // Primitive Assembly
+        if (command == "f")
+        {
+            uint32 corners = 0;
+            for(std::string_view word = readWord(cursor, end); !word.empty(); word = readWord(cursor, end))
+            {
+                chunk.corners.push_back(parseVertex(word));
+                corners++;
+            }
+
+            chunk.faces.push_back(corners);
+        }
+        else
+        // Create next mesh description
+        if (command == "g")
+        {
+            chunk.commands.push_back(Command{ CommandType::Group, chunk.faces.size(), std::string(readWord(cursor, end)) });
+        }
+        else
+        // Add materials library to the list
+        if (command == "mtllib")
+        {
+            std::string_view word = readWord(cursor, end);
+            if (!word.empty())
+            {
+                chunk.commands.push_back(Command{ CommandType::Library, chunk.faces.size(), std::string(word) });
+            }
+        }
+        else
+        // Set current material
+        if (command == "usemtl")
+        {
+            std::string_view word = readWord(cursor, end);
+            if (!word.empty())
+            {
+                chunk.commands.push_back(Command{ CommandType::Material, chunk.faces.size(), std::string(word) });
+            }
+        }
+
+        // Skip not relevant part of the line
+        skipLine(cursor, end);
+    }
+}
+
+static void parseChunks(void* data, uint32v2 range)
+{
+    Chunk* chunk = reinterpret_cast<Chunk*>(data);
+    for(uint32 i=range.base; i<range.base+range.count; ++i)
+    {
+        parseChunk(chunk[i]);
+    }
+}
+
+// Assembles meshes from parsed chunks, executing their commands in file order
+class Assembler
+{
+    public:
+    std::vector<float3>& vertices;
+    std::vector<float3>& normals;
+    std::vector<float3>& coordinates;
+    std::vector<std::string>& libraries;
+    std::vector<en::obj::Mesh>& meshes;
+    std::vector<en::resources::Material>& materials;
+
+    en::obj::Mesh* mesh;                                 // Current mesh
+    std::string material;                                // Current material
+    std::unordered_map<Vertex, uint32, VertexHash> unique; // Location of each unique vertex in current mesh
+
+    Assembler(std::vector<float3>& vertices,
+              std::vector<float3>& normals,
+              std::vector<float3>& coordinates,
+              std::vector<std::string>& libraries,
+              std::vector<en::obj::Mesh>& meshes,
+              std::vector<en::resources::Material>& materials);
+
+    void startMesh(void);
+    void execute(const Command& command);
+    void addFace(const Vertex* corner, const uint32 corners);
+    void merge(const Chunk& chunk);
+};
+
+Assembler::Assembler(std::vector<float3>& _vertices,
+                     std::vector<float3>& _normals,
+                     std::vector<float3>& _coordinates,
+                     std::vector<std::string>& _libraries,
+                     std::vector<en::obj::Mesh>& _meshes,
+                     std::vector<en::resources::Material>& _materials) :
+    vertices(_vertices),
+    normals(_normals),
+    coordinates(_coordinates),
+    libraries(_libraries),
+    meshes(_meshes),
+    materials(_materials),
+    mesh(nullptr),
+    material("default")
+{
+    // Model always has minimum one mesh
+    startMesh();
+    mesh->name = "default";
+}
+
+void Assembler::startMesh(void)
+{
+    meshes.push_back(en::obj::Mesh());
+    mesh = &meshes[meshes.size() - 1];
+
+    // Fill mesh descriptor with default data
+    mesh->material = material;
+    mesh->vertices.reserve(8192);
+    mesh->indexes.reserve(8192);
+    mesh->optimized.reserve(8192);
+    mesh->coords   = false;
+    mesh->coordW   = false;
+    mesh->normals  = false;
+
+    unique.clear();
+}
+
+void Assembler::execute(const Command& command)
+{
+    if (command.type == CommandType::Group)
+    {
+        // If model specifies mesh before any face
+        // occurence, current mesh is not needed and
+        // it can be reused.
+        if (mesh->indexes.size() > 0)
+        {
+            startMesh();
+        }
+
+        if (!command.name.empty())
+        {
+            mesh->name = command.name;
+        }
     }
     else
+    if (command.type == CommandType::Library)
     {
-        vertex.position = stringTo<uint32>(word);
+        // Prevent from adding the same library more than once
+        if (std::find(libraries.begin(), libraries.end(), command.name) == libraries.end())
+        {
+            libraries.push_back(command.name);
+        }
     }
+    else
+    if (command.type == CommandType::Material)
+    {
+        material = command.name;
 
-    // First slash needs to be present, and there need to be 
-    // number just after it, otherwise there is no Tex Coord
-    vertex.uv = 0;
-    // (case: v/t)
-    if ( (s1 != std::string::npos) &&
-         (s2 == std::string::npos) &&
-         ((s1+1) < word.length()) )
+        // Prevent from adding the same material more than once
+        bool found = false;
+        for(uint32 i=0; i<materials.size(); ++i)
+        {
+            if (materials[i].name == material)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        // Add new material to the list
+        if (!found)
+        {
+            en::resources::Material entry;
+            entry.name = material;
+            materials.push_back(entry);
+        }
+
+        // Mesh should specify material before any 
+        // face will occur or use previous material
+        // for whole mesh.
+        if (mesh->indexes.size() == 0)
+        {
+            mesh->material = material;
+        }
+    }
+    else
+    if (command.type == CommandType::CoordW)
     {
-        vertex.uv = stringTo<uint32>(word.substr(s1+1));
+        mesh->coordW = true;
     }
-    // (case: v/t/n)
-    if ( (s1 != std::string::npos) &&
-         (s2 != std::string::npos) &&
-         ((s1+1) < s2) )
+}
+
+void Assembler::addFace(const Vertex* corner, const uint32 corners)
+{
+    // Points and lines are not part of triangle mesh
+    if (corners < 3)
     {
-        vertex.uv = stringTo<uint32>(word.substr(s1+1,s2-s1-1));
+        return;
     }
 
-    // Case v//n is allowed and is implicitly handled above.
+    uint64 first = mesh->indexes.size();
+    for(uint32 i=0; i<corners; ++i)
+    {
+        const Vertex& vertex = corner[i];
 
-    // If there is no second slash there is no Normal
-    // (cases: v and v/t)
-    vertex.normal = 0;
-    if (s2 != std::string::npos)
+        // Check presence of texture coordinates and normals
+        if (vertex.uv) // TODO: What about 0 indexes?
+        {
+            mesh->coords = true;
+        }
+
+        if (vertex.normal) // TODO: What about 0 indexes?
+        {
+            mesh->normals = true;
+        }
+
+        // First triangle is generated from first three
+        // vertices of the face. If there is more of them,
+        // face is divided into triangles on a basis of
+        // triangle fan.
+        if (i >= 3)
+        {
+            uint32 indexA = mesh->indexes[first];
+            uint32 indexB = mesh->indexes[mesh->indexes.size() - 1];
+            mesh->indexes.push_back(indexA);
+            mesh->indexes.push_back(indexB);
+        }
+
+        // Reuse vertex if it already exist, otherwise add it to vertex array
+        auto result = unique.emplace(vertex, static_cast<uint32>(mesh->vertices.size()));
+        if (result.second)
+        {
+            mesh->vertices.push_back(vertex);
+        }
+
+        mesh->indexes.push_back(result.first->second);
+    }
+}
+
+void Assembler::merge(const Chunk& chunk)
+{
+    vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+    normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    coordinates.insert(coordinates.end(), chunk.coordinates.begin(), chunk.coordinates.end());
+
+    const Vertex* corner  = chunk.corners.data();
+    uint64        command = 0;
+    for(uint64 face=0; face<chunk.faces.size(); ++face)
     {
-        vertex.normal = stringTo<uint32>(word.substr(s2+1));
+        for(; command<chunk.commands.size() && chunk.commands[command].face == face; ++command)
+        {
+            execute(chunk.commands[command]);
+        }
+
+        addFace(corner, chunk.faces[face]);
+        corner += chunk.faces[face];
     }
 
-    return vertex;
+    for(; command<chunk.commands.size(); ++command)
+    {
+        execute(chunk.commands[command]);
+    }
 }
 
 // Creates scene model
@@ -143,33 +525,58 @@ std::shared_ptr<en::resources::Model> load(const std::string& filename, const st
         }
     }
    
-    // Allocate temporary buffer for file content ( 4GB max size! )
+    // Map whole file, text is parsed directly from it
     uint64 size = file->size();
-    uint8* buffer = nullptr;
-    buffer = new uint8[static_cast<uint32>(size)];
-    if (!buffer)
-    {
-        enLog << "ERROR: Not enough memory!\n";
-        delete file;
-        return std::shared_ptr<en::resources::Model>(nullptr);
-    }
-   
-    // Read file to buffer and close file
-    if (!file->read(buffer))
+    FileView* view = file->map(0u, size, MapHint::Sequential);
+    if (!view)
     {
         enLog << "ERROR: Cannot read whole obj file!\n";
         delete file;
         return std::shared_ptr<en::resources::Model>(nullptr);
-    }    
-    delete file;
+    }
 
 
     // Step 1 - Parsing the file
 
 
-    // Create parser to quickly process text from file
-    Parser parser(buffer, size);
-   
+    // File is split to line aligned chunks, that are parsed in parallel
+    uint32 workers = 1;
+    bool   onWorker = Scheduler && Scheduler->currentWorkerId() != InvalidWorkerId;
+    if (onWorker)
+    {
+        workers = Scheduler->workers();
+    }
+
+    uint32 count = static_cast<uint32>(std::min(static_cast<uint64>(workers * ChunksPerWorker), size / MinChunkSize + 1));
+
+    const char* text = reinterpret_cast<const char*>(view->data());
+    std::vector<Chunk> chunks(count);
+    const char* begin = text;
+    for(uint32 i=0; i<count; ++i)
+    {
+        const char* end = text + size;
+        if (i + 1 < count)
+        {
+            end = std::max(begin, text + (size * (i + 1)) / count);
+            skipLine(end, text + size);
+        }
+
+        chunks[i].begin = begin;
+        chunks[i].end   = end;
+        begin = end;
+    }
+
+    if (count > 1 && onWorker)
+    {
+        TaskState state;
+        Scheduler->run(parseChunks, chunks.data(), uint32v2(0, count), &state, 1);
+        Scheduler->wait(&state);
+    }
+    else
+    {
+        parseChunks(chunks.data(), uint32v2(0, count));
+    }
+
     // Temporary data
     std::vector<float3> vertices;             // Vertices
     std::vector<float3> normals;              // Normals
@@ -178,278 +585,33 @@ std::shared_ptr<en::resources::Model> load(const std::string& filename, const st
     std::vector<en::obj::Mesh> meshes;        // Meshes
     std::vector<en::resources::Material> materials; // Materials
 
-    // Reserve memory for incoming data, to minimise
-    // occurences of possible relocations during 
-    // vectors growth
-    vertices.reserve(16384);
-    normals.reserve(16384);
-    coordinates.reserve(16384);
+    uint64 vertexCount = 0;
+    uint64 normalCount = 0;
+    uint64 coordCount  = 0;
+    for(const Chunk& chunk : chunks)
+    {
+        vertexCount += chunk.vertices.size();
+        normalCount += chunk.normals.size();
+        coordCount  += chunk.coordinates.size();
+    }
+
+    vertices.reserve(static_cast<size_t>(vertexCount));
+    normals.reserve(static_cast<size_t>(normalCount));
+    coordinates.reserve(static_cast<size_t>(coordCount));
     meshes.reserve(16);
     materials.reserve(32);
 
-    // Model always has minimum one mesh
-    meshes.push_back(en::obj::Mesh());
-
-    // Current mesh and material handles
-    en::obj::Mesh* mesh = &meshes[meshes.size() - 1];
-    std::string material = "default";
-
-    // Fill first mesh descriptor with default data
-    mesh->name     = "default";
-    mesh->material = material;
-    mesh->vertices.reserve(8192);
-    mesh->indexes.reserve(8192);
-    mesh->optimized.reserve(8192);
-    mesh->coords   = false;
-    mesh->coordW   = false;
-    mesh->normals  = false;
-
-    // Collects geometry primitives data that will
-    // be used to generate final meshes and perform
-    // primitives assembly into unoptimized meshes
-    std::string command;
-    std::string word;
-    bool eol = false;
-    while(!parser.end())
+    // Merges chunks in file order, and performs primitives assembly
+    // into unoptimized meshes, reusing identical vertices
+    Assembler assembler(vertices, normals, coordinates, libraries, meshes, materials);
+    for(Chunk& chunk : chunks)
     {
-        // Read commands until it is end of file
-        if (!parser.read(command, eol))
-        {
-            continue;
-        }
-   
-        // Handle vertices
-        if (command == "v")
-        {
-            float3 vertex(0.0f, 0.0f, 0.0f);
-            if (!eol && parser.read(word, eol))
-            {
-                // TODO: Verify that "word" contains string representation of float. Otherwise fail file parsing. Do it for all 3 components.
-                vertex.x = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                vertex.y = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                vertex.z = stringTo<float>(word);
-            }
-            vertices.push_back(vertex);
-        }
-        else
-        // Handle normals
-        if (command == "vn")
-        {
-            float3 normal(0.0f, 0.0f, 0.0f);
-            if (!eol && parser.read(word, eol))
-            {
-                // TODO: Verify that "word" contains string representation of float. Otherwise fail file parsing. Do it for all 3 components.
-                normal.x = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                normal.y = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                normal.z = stringTo<float>(word);
-            }
-            normals.push_back(normal);
-        }
-        else
-        // Handle texture coordinates
-        if (command == "vt")
-        {
-            float3 coord(0.0f, 0.0f, 0.0f);
-            if (!eol && parser.read(word, eol))
-            {
-                // TODO: Verify that "word" contains string representation of float. Otherwise fail file parsing. Do it for all 3 components.
-                coord.u = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                coord.v = stringTo<float>(word);
-            }
-            if (!eol && parser.read(word, eol))
-            {
-                coord.w = stringTo<float>(word);
-                if (mesh->coordW == false)
-                {
-                    if (coord.w != 0.0)
-                    {
-                        mesh->coordW = true;
-                    }
-                }
-            }
-            coordinates.push_back(coord);
-        }
-        else
-        // Create next mesh description
-        if (command == "g")
-        {
-            // If model specifies mesh before any face
-            // occurence, default mesh is not needed and
-            // it can be reused.
-            if (mesh->indexes.size() == 0)
-            {
-                if (!eol && parser.read(word, eol))
-                {
-                    mesh->name = word;
-                }
-            }
-            else
-            {
-                // Push new mesh description on the stack
-                meshes.push_back(en::obj::Mesh());  // TODO: Shouldn't it be: new Mesh() ???
-                mesh = &meshes[meshes.size() - 1];
-
-                // Fill mesh descriptor with default data
-                if (!eol && parser.read(word, eol))
-                {
-                    mesh->name = word;
-                }
-                mesh->material = material;
-                mesh->vertices.reserve(8192);
-                mesh->indexes.reserve(8192);
-                mesh->optimized.reserve(8192);
-                mesh->coords   = false;
-                mesh->coordW   = false;
-                mesh->normals  = false;
-            }
-        }
-        else
-        // Add materials library to the list
-        if (command == "mtllib")
-        {
-            if (!eol && parser.read(word, eol))
-            {
-                // Prevent from adding the same library more than once
-                bool found = false;
-                for(uint32 i=0; i<libraries.size(); ++i)
-                {
-                    if (libraries[i] == word)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-   
-                // Add new library to the list
-                if (!found)
-                {
-                    libraries.push_back(word);
-                }
-            }
-        }
-        else
-        // Set current material
-        if (command == "usemtl")
-        {
-            if (!eol && parser.read(word, eol))
-            {
-                material = word;
-   
-                // Prevent from adding the same material more than once
-                bool found = false;
-                for(uint32 i=0; i<materials.size(); ++i)
-                {
-                    if (materials[i].name == word)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-   
-                // Add new material to the list
-                if (!found)
-                {
-                    //obj::Material material;
-                    en::resources::Material material;
-                    material.name   = word;
-                    //material.handle = NULL;
-                    materials.push_back(material);
-                }
-   
-                // Mesh should specify material before any 
-                // face will occur or use previous material
-                // for whole mesh.
-                if (mesh->indexes.size() == 0)
-                {
-                    mesh->material = material;
-                }
-            }
-        }
-        else
-        // Primitive Assembly
-        if (command == "f")
-        {
-            uint32 counter = 0;
-            while(!eol)
-            {
-                if (parser.read(word, eol))
-                {
-                    en::obj::Vertex vertex = en::obj::parseVertex(word);
-                   
-                    // Check presence of texture coordinates
-                    if (mesh->coords == false)
-                    {
-                        if (vertex.uv) // TODO: What about 0 indexes?
-                        {
-                            mesh->coords = true;
-                        }
-                    }
-
-                    // Check presence of normals
-                    if (mesh->normals == false)
-                    {
-                        if (vertex.normal) // TODO: What about 0 indexes?
-                        {
-                            mesh->normals = true;
-                        }
-                    }
-                   
-                    // First triangle is generated from first three
-                    // vertices of the face. If there is more of them,
-                    // face is divided into triangles on a basis of
-                    // triangle fan.
-                    if (counter == 3)
-                    {
-                        uint64 size   = mesh->indexes.size();
-                        uint32 indexA = mesh->indexes[size-3];
-                        uint32 indexB = mesh->indexes[size-1];
-                        mesh->indexes.push_back(indexA);
-                        mesh->indexes.push_back(indexB);
-                        counter = 2;
-                    }
-   
-                    // Try to reuse vertex if it already exist
-                    bool found = false;
-                    for(uint32 i=0; i<mesh->vertices.size(); ++i)
-                    {
-                        if (mesh->vertices[i] == vertex)
-                        {
-                            mesh->indexes.push_back(i);
-                            found = true;
-                            break;
-                        }
-                    }
-
-                    // If vertex is new, add it to vertex array
-                    if (!found)
-                    {
-                        mesh->indexes.push_back(static_cast<uint32>(mesh->vertices.size()));
-                        mesh->vertices.push_back(vertex);
-                    }
-   
-                    counter++;
-                }
-            }
-        }
-   
-        // Skip not relevant part of the line
-        parser.skipToNextLine();       
+        assembler.merge(chunk);
+        chunk = Chunk();
     }
+
+    delete view;
+    delete file;
  
  
     // Step 2 - Generating final model
@@ -511,6 +673,34 @@ std::shared_ptr<en::resources::Model> load(const std::string& filename, const st
         assert( srcMesh.indexes.size() < 0xFFFFFFFF );
         uint32 vertexes = static_cast<uint32>(srcMesh.vertices.size());
         uint32 indexes  = static_cast<uint32>(srcMesh.indexes.size());
+
+        // Optimize indexes order for Post-Transform Vertex Cache Size,
+        // then reorder vertices in order in which they are fetched
+        if (en::obj::optimizeIndexOrder)
+        {
+            Forsyth::Statistics before = Forsyth::analyze(srcMesh.indexes, vertexes);
+            Forsyth::optimize(srcMesh.indexes, srcMesh.optimized, vertexes);
+
+            if (en::obj::optimizeOverdraw)
+            {
+                std::vector<float3> positions(vertexes);
+                for(uint32 j=0; j<vertexes; ++j)
+                {
+                    positions[j] = vertices[srcMesh.vertices[j].position - 1];
+                }
+
+                Forsyth::optimizeOverdraw(srcMesh.optimized, positions);
+            }
+
+            std::vector<uint32> remap;
+            vertexes = Forsyth::optimizeVertexFetch(srcMesh.optimized, remap, vertexes);
+            Forsyth::remapVertices(srcMesh.vertices, remap, vertexes);
+            srcMesh.indexes.swap(srcMesh.optimized);
+
+            Forsyth::Statistics after = Forsyth::analyze(srcMesh.indexes, vertexes);
+            enLog << "Mesh " << srcMesh.name << ": ACMR " << before.acmr << " -> " << after.acmr 
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+        }
       
         // Create geometry buffer
         gpu::Formatting formatting;
@@ -731,14 +921,7 @@ std::shared_ptr<en::resources::Model> load(const std::string& filename, const st
             formatting.column[j] = gpu::Attribute::None;
         }
 
-        // Optimize indexes order for Post-Transform Vertex Cache Size
         void* srcIndex = &srcMesh.indexes[0];
-        if (en::obj::optimizeIndexOrder)
-        {
-            srcMesh.optimized.resize(indexes, 0);
-            //Forsyth::optimize(srcMesh.indexes, srcMesh.optimized, vertexes);
-            srcIndex = &srcMesh.optimized[0];
-        }
    
         // Optimize size of Index Buffer
         bool compressed = false;
@@ -815,6 +998,8 @@ std::shared_ptr<en::resources::Model> load(const std::string& filename, const st
         en::resources::Mesh mesh;
 
         // TODO: Refactor to new Model description
+        //       Levels of detail can be then generated with Simplify::generateLevels,
+        //       and appended to index buffer (each LOD mesh referencing its range).
         //mesh.name              = srcMesh.name;
         //mesh.material          = srcMaterial;
         //mesh.geometry.buffer   = vertexBuffer;
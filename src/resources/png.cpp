@@ -10,14 +10,13 @@
 
 #include "core/storage.h"
 #include "core/log/log.h"
+#include "core/memory/alignedAllocator.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
 #include "resources/png.h"
 
-#include "core/rendering/device.h"
 using namespace en::gpu;           // For RAM -> VRAM transfer
 
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
+#if defined(EN_PLATFORM_LINUX) || defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
 #include "zlib.h"
 #endif
 
@@ -31,6 +30,8 @@ using namespace en::parallel;
 #endif
 
 #include <string>
+#include <assert.h>
+#include <string.h>
 
 namespace en
 {
@@ -180,198 +181,212 @@ uint8 Paeth(sint16 a, sint16 b, sint16 c)
     return static_cast<uint8>(c);
 }
 
-struct DecodeState
+// Lines are decompressed and unfiltered in bands of at least that size. This
+// way unfiltering of one band overlaps with decompression of the next one.
+constexpr uint32 BandSize = 256 * 1024;
+
+// Range of decompressed lines to unfilter
+struct UnfilterState
 {
-    uint32 startLine;      // Cannot be decoded with Paeth !
+    uint32 startLine;      // First line to decode
     uint32 lines;          // Lines to decode
     uint32 texelSize;      //
-    uint32 width;          //
+    uint32 lineSize;       // Size of line without filter type
+    uint32 rowPitch;       // Distance between lines in output buffer
     uint32 height;         // Image height
-    uint32 linePadding;    // Padding after each line in output buffer
-    uint8* input;          // Input buffer
+    const uint8* input;    // Input buffer (each line starts with filter type)
     uint8* output;         // Output buffer
     bool invertHorizontal; // Should invert the image ?
 };
 
-/* Deprecated in favor of new Fiber based scheduler. Remove once implementation is verified.
-
-class Worker : public Task
-{ 
-    private:
-    uint32 startLine;      // Cannot be decoded with Paeth !
-    uint32 lines;          // Lines to decode
-    uint32 texelSize;      //
-    uint32 width;          //
-    uint32 height;         // Image height
-    uint32 linePadding;    // Padding after each line in output buffer
-    uint8* input;          // Input buffer
-    uint8* output;         // Output buffer
-    bool invertHorizontal; // Should invert the image ?
-
-    public:  
-    Worker(const DecodeState& state);  
-    void work(void);     
-}; 
-
-Worker::Worker(const DecodeState& state) :
-    startLine(state.startLine),
-    lines(state.lines),
-    texelSize(state.texelSize),
-    width(state.width),
-    height(state.height),
-    linePadding(state.linePadding),
-    input(state.input),
-    output(state.output),
-    invertHorizontal(state.invertHorizontal),
-    Task(new TaskState())
+// Reverts filter of single line. Previous line is nullptr for first line of
+// image, in which case bytes above are treated as zeroes.
+void unfilterLine(const uint8 type, const uint8* in, uint8* out, const uint8* prev, const uint32 texelSize, const uint32 lineSize)
 {
-}
-*/
-
-// TODO: Optimize using memcpy's and SIMD's
-/*
-void Worker::work(void)
-{
-*/
-void taskDecodePNG(void* taskData)
-{
-    DecodeState& state = *(DecodeState*)(taskData);
-
-    // Revert filters line by line
-    uint32 lineSize   = state.width * state.texelSize;
-    uint32 inOffset   = state.startLine * (lineSize + 1);
-    uint32 outOffset  = state.startLine * (lineSize + state.linePadding);
-    uint32 prevOffset = 0;
-    for(uint32 i=state.startLine; i<(state.startLine + state.lines); ++i)
+    // Filter type 0 - None
+    if (type == 0)
     {
-        // Offset to previously decoded line
-        if (i > 0)
+        memcpy(out, in, lineSize);
+    }
+    // Filter type 1 - Sub
+    if (type == 1)
+    {
+        // First pixel adds bytes outside scanline (equal 0) so just copy it
+        for(uint32 j=0; j<texelSize; ++j)
         {
-            prevOffset = (i - 1) * lineSize;
-            if (state.invertHorizontal)
-            {
-                prevOffset = (state.height - i) * lineSize;
-            }
+            out[j] = in[j];
         }
-        if (state.invertHorizontal)
+
+        // Add bytes of previous pixel to reconstruct current one
+        for(uint32 j=texelSize; j<lineSize; ++j)
         {
-            outOffset = (state.height - i - 1) * lineSize;
+            out[j] = in[j] + out[j - texelSize];
         }
-
-        // Detect which type of filter was used for this line
-        uint8 type = state.input[inOffset];
-        inOffset++;
-
-        // Filter type 0 - None
-        if (type == 0)
+    }
+    // Filter type 2 - Up
+    if (type == 2)
+    {
+        // If this is first scanline, above are only zeroes, so just copy it
+        if (!prev)
+        {
+            memcpy(out, in, lineSize);
+        }
+        else
         {
-            for(uint32 j=0; j<lineSize; ++j, ++inOffset, ++outOffset) 
+            // Add bytes of above pixel to reconstruct current one
+            for(uint32 j=0; j<lineSize; ++j)
             {
-                state.output[outOffset] = state.input[inOffset]; 
+                out[j] = in[j] + prev[j];
             }
         }
-        // Filter type 1 - Sub
-        if (type == 1)
+    }
+    // Filter type 3 - Average
+    if (type == 3)
+    {
+        // If this is first scanline, above are only zeroes
+        if (!prev)
         {
-            // First pixel adds bytes outside scanline (equal 0) so just copy it
-            for(uint8 j=0; j<state.texelSize; ++j, ++inOffset, ++outOffset) 
+            // If this is first pixel, average will be zero, so just copy it
+            for(uint32 j=0; j<texelSize; ++j)
             {
-                state.output[outOffset] = state.input[inOffset];
+                out[j] = in[j];
             }
 
-            // Add bytes of previous pixel to reconstruct current one
-            for(uint32 j=state.texelSize; j<lineSize; ++j, ++inOffset, ++outOffset)
+            // Average from A and zero is A divided by two
+            for(uint32 j=texelSize; j<lineSize; ++j)
             {
-                state.output[outOffset] = state.input[inOffset] + state.output[outOffset - state.texelSize];
+                out[j] = in[j] + out[j - texelSize] / 2;
             }
         }
-        // Filter type 2 - Up
-        if (type == 2)
+        else
         {
-            // If this is first scanline, above are only zeroes, so just copy it
-            if (i == 0) 
+            // Average from B and zero is B divided by two
+            for(uint32 j=0; j<texelSize; ++j)
             {
-                for(uint32 j=0; j<lineSize; ++j, ++inOffset, ++outOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset]; 
-                }
+                out[j] = in[j] + prev[j] / 2;
             }
-            else 
+
+            for(uint32 j=texelSize; j<lineSize; ++j)
             {
-                // Add bytes of above pixel to reconstruct current one
-                for(uint32 j=0; j<lineSize; ++j, ++inOffset, ++outOffset, ++prevOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset] + state.output[prevOffset]; 
-                }
+                out[j] = in[j] + ((out[j - texelSize] + prev[j]) / 2);
             }
         }
-        // Filter type 3 - Average
-        if (type == 3)
+    }
+    // Filter type 4 - Paeth
+    if (type == 4)
+    {
+        // If this is first scanline, above are only zeroes
+        if (!prev)
         {
-            // If this is first scanline, above are only zeroes
-            if (i == 0) 
+            // If this is first pixel, previous is zero, so just copy it
+            for(uint32 j=0; j<texelSize; ++j)
             {
-                // If this is first pixel, average will be zero, so just copy it
-                for(uint8 j=0; j<state.texelSize; ++j, ++inOffset, ++outOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset];
-                }
-
-                // Average from A and zero is A divided by two
-                for(uint32 j=state.texelSize; j<lineSize; ++j, ++inOffset, ++outOffset)
-                {
-                    state.output[outOffset] = state.input[inOffset] + state.output[outOffset - state.texelSize] / 2;
-                }
+                out[j] = in[j];
             }
-            else
-            {
-                // Average from B and zero is B divided by two
-                for(uint8 j=0; j<state.texelSize; ++j, ++inOffset, ++outOffset, ++prevOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset] + state.output[prevOffset] / 2;
-                }
 
-                for(uint32 j=state.texelSize; j<lineSize; ++j, ++inOffset, ++outOffset, ++prevOffset)
-                {
-                    state.output[outOffset] = state.input[inOffset] + ((state.output[outOffset - state.texelSize] + state.output[prevOffset]) / 2);
-                }
+            // Do partial Paeth with zeroes
+            for(uint32 j=texelSize; j<lineSize; ++j)
+            {
+                out[j] = in[j] + Paeth(out[j - texelSize], 0, 0);
             }
         }
-        // Filter type 4 - Paeth
-        if (type == 4)
+        else
         {
-            // If this is first scanline, above are only zeroes
-            if (i == 0) 
+            for(uint32 j=0; j<texelSize; ++j)
             {
-                // If this is first pixel, previous is zero, so just copy it
-                for(uint8 j=0; j<state.texelSize; ++j, ++inOffset, ++outOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset];
-                }
-
-                // Do partial Paeth with zeroes
-                for(uint32 j=state.texelSize; j<lineSize; ++j, ++inOffset, ++outOffset)
-                {
-                    state.output[outOffset] = state.input[inOffset] + Paeth(state.output[outOffset - state.texelSize], 0, 0);
-                }
+                out[j] = in[j] + Paeth(0, prev[j], 0);
             }
-            else
-            {
-                for(uint8 j=0; j<state.texelSize; ++j, ++inOffset, ++outOffset, ++prevOffset) 
-                {
-                    state.output[outOffset] = state.input[inOffset] + Paeth(0, state.output[prevOffset], 0);
-                }
 
-                for(uint32 j=state.texelSize; j<lineSize; ++j, ++inOffset, ++outOffset, ++prevOffset)
-                {
-                    state.output[outOffset] = state.input[inOffset] + Paeth(state.output[outOffset - state.texelSize], state.output[prevOffset], state.output[prevOffset - state.texelSize]);
-                }
+            for(uint32 j=texelSize; j<lineSize; ++j)
+            {
+                out[j] = in[j] + Paeth(out[j - texelSize], prev[j], prev[j - texelSize]);
             }
         }
     }
+}
+
+// TODO: Optimize using SIMD's
+void taskUnfilterPNG(void* taskData)
+{
+    UnfilterState& state = *reinterpret_cast<UnfilterState*>(taskData);
+
+    // Revert filters line by line
+    const uint8* prev = nullptr;
+    for(uint32 i=state.startLine; i<(state.startLine + state.lines); ++i)
+    {
+        uint32 row = state.invertHorizontal ? (state.height - i - 1) : i;
+        uint8* out = state.output + static_cast<uint64>(row) * state.rowPitch;
+        const uint8* in = state.input + static_cast<uint64>(i) * (state.lineSize + 1);
+
+        // Previously decoded line (possibly by previous band)
+        if (i > 0)
+        {
+            prev = state.invertHorizontal ? out + state.rowPitch : out - state.rowPitch;
+        }
+
+        // First byte of line specifies which type of filter was used for it
+        unfilterLine(in[0], in + 1, out, prev, state.texelSize, state.lineSize);
+    }
+}
+
+// Decompressed lines are passed in bands for unfiltering. Filters of each
+// line may depend on previous line, so bands need to be processed one after
+// another, but each of them is processed by worker thread in parallel with
+// decompression of the next one.
+class Unfilter
+{
+    public:
+    UnfilterState band;      // Currently processed band
+    TaskState     state;     // Finished once current band is processed
+    uint32        bandLines; // Minimum count of lines in band
+    uint32        available; // Count of lines already passed for unfiltering
+    bool          pipelined; // Bands are processed by worker threads
+
+    Unfilter(const UnfilterState& image);
+    void submit(const uint32 lines, const bool last = false); // Passes for unfiltering lines decompressed so far
+    void finish(void);                                          // Waits until last submitted band is processed
+};
 
-    // Release local state
-    delete (DecodeState*)(taskData);
+Unfilter::Unfilter(const UnfilterState& image) :
+    band(image),
+    bandLines(max(1u, BandSize / (image.lineSize + 1))),
+    available(0),
+    pipelined(Scheduler && Scheduler->currentWorkerId() != InvalidWorkerId)
+{
+}
+
+void Unfilter::submit(const uint32 lines, const bool last)
+{
+    uint32 count = min(lines, band.height) - available;
+    if (count == 0 ||
+        (count < bandLines && !last))
+    {
+        return;
+    }
+
+    // Band depends on last line of previous one
+    finish();
+
+    band.startLine = available;
+    band.lines     = count;
+    available     += count;
+
+    if (pipelined)
+    {
+        Scheduler->run(taskUnfilterPNG, &band, &state, false, TaskPriority::Background);
+    }
+    else
+    {
+        taskUnfilterPNG(&band);
+    }
+}
+
+void Unfilter::finish(void)
+{
+    if (pipelined)
+    {
+        Scheduler->wait(&state);
+    }
 }
 
 #define PageSize 4096
@@ -428,10 +443,9 @@ ColorSpaceInfo::ColorSpaceInfo() :
 
 
 
-// Reads first 4KB page of PNG file, and decodes it's header to TextureState and ColorSpace.
-// If operation is successfull, returns handle to that file, so that engine can continue with
-// it's decompression.
-bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+// Decodes header of PNG file to TextureState and ColorSpace (it's always
+// stored in first 4KB page of file).
+bool readMetadata(const uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
 {
     // Check if file has minimum required size
     uint32 minimumFileSize = sizeof(Header) + sizeof(IHDR);
@@ -442,7 +456,7 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
 
     // Read file signature
-    Header& signature = *reinterpret_cast<Header*>(buffer);
+    const Header& signature = *reinterpret_cast<const Header*>(buffer);
     if ( signature.signature != 0x474E5089 ||
          signature.eof       != 0x0A1A0A0D )
     {
@@ -451,7 +465,7 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
 
     // Read file header
-    IHDR& header = *reinterpret_cast<IHDR*>(buffer + 8);
+    const IHDR& header = *reinterpret_cast<const IHDR*>(buffer + 8);
     if ( header.length != endiannes(uint32(13)) ||
          header.signature != 0x52444849 )
     {
@@ -548,122 +562,28 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     return true;
 }
 
-/*
-void decode(DecodeState& decoder)
-{
-    // If possible revert filters in paraller using several worker threads
-    uint32 cores = Scheduler->workers();
-    if (cores == 1) // TODO: In future add minimum amount of lines, below which we don't use task pool
-    {
-        TaskState* state = Scheduler->run(new Worker(decoder), true); // Execute decoding on current thread
-    }
-    else
-    {
-        // Try to disect image lines between the cores
-        TaskState* state[32]; // Handles of up to 32 simultaneous decoding threads
-
-        decoder.startLine = 0;
-        decoder.lines     = 0;
-
-        uint32 task=0;
-        uint32 linesPerCore = decoder.height / cores;
-        for(; task<cores; ++task)
-        {
-            // Calculate lines range for current core
-            decoder.startLine += decoder.lines;
-            decoder.lines      = linesPerCore;
-
-            // Check if first line of next section is not compressed with pattern
-            // 2,3 or 4. In such situation increase current lines range to prevent
-            // data relation between the thread blocks (these patterns use previous line). 
-            uint8 type = 4;
-            bool lastTask = false;
-            while(type > 1)
-            {
-                // Check if current block is not already reaching end of image
-                uint32 nextLine = decoder.startLine + decoder.lines;
-                if (nextLine >= decoder.height)
-                {
-                    decoder.lines = decoder.height - decoder.startLine;
-                    lastTask = true;
-                    break;
-                }
-
-                // Check if next block will use "Paeth"
-                uint32 inOffset = nextLine * (decoder.width * decoder.texelSize + 1);
-                uint8 type = decoder.input[inOffset];
-                if (type < 2)
-                {
-                    break;
-                }
-
-                decoder.lines++;
-            }
-         
-            // Spawn task to decompress image parts,
-            // starting from last core and ending on this one.
-            state[task] = Scheduler->run(new Worker(decoder), (cores - task - 1), false);
-            if (lastTask) 
-            {
-                break;
-            }
-        }
-
-        // TODO: Fix proper handling of tasks and their state pointers
-        //       If task is deleted by scheduler after it is finished, how to verify it's completion? Who should delete TaskState ? 
-        // Barrier - wait until all threads will finish execution
-        //for(uint8 i=0; i<cores; ++i)
-        //{
-        //    Scheduler.wait(state[cores - i - 1]);
-        //}
-    }
-}
-*/
-
-bool load(const std::string& filename, 
-          uint8* const destination, 
-          const uint32 width, 
-          const uint32 height, 
-          const gpu::Format format, 
-          const gpu::ImageMemoryAlignment alignment, 
-          const bool invertHorizontal)
+// Decodes PNG file content to destination surface. Decompressed lines are
+// unfiltered in bands, while next ones are still being decompressed.
+bool decode(const uint8* content, 
+            const uint64 fileSize,
+            uint8* const destination, 
+            const uint32 width, 
+            const uint32 height, 
+            const gpu::Format format, 
+            const gpu::ImageMemoryAlignment alignment, 
+            const bool invertHorizontal)
 {
-    using namespace en::storage;
     using namespace en::gpu;
 
-    // Open file 
-    File* file = Storage->open(filename);
-    if (!file)
-    {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return false;
-        }
-    }
-
 
     // ### Read file metadata
 
 
-    // Read file first 4KB into single 4KB memory page
-    uint32 readSize = min(file->size(), PageSize);
-    uint8* buffer = allocate<uint8>(readSize, PageSize);
-    file->read(0, readSize, buffer);
-
     // Read file properties
     TextureState settings;
-    ColorSpace colorSpace; // TODO: Determine file Color Space and compare with expected
-    bool success = readMetadata(buffer, readSize, settings, colorSpace);
-
-    // Free temporary 4KB memory page
-    deallocate<uint8>(buffer);
-
-    if (!success)
+    ColorSpace colorSpace = ColorSpaceLinear; // TODO: Determine file Color Space and compare with expected
+    if (!readMetadata(content, static_cast<uint32>(min(fileSize, uint64(PageSize))), settings, colorSpace))
     {
-        delete file;
         return false;
     }
 
@@ -672,28 +592,10 @@ bool load(const std::string& filename,
          (settings.height != height) ||
          (settings.format != format) )
     {
-        delete file;
         return false;
     }
 
-
-    // ### Read file to memory
-
-
-    // Read whole file at once to memory. 
-    // Size aligned to multiple of 4KB Page Size, and allocated at such boundary (can be memory mapped).
-    uint64 fileSize = file->size();
-    uint64 roundedSize = roundUp(fileSize, PageSize);
-    uint8* content = allocate<uint8>(roundedSize, PageSize);
-    if (!file->read(content))
-    {
-        enLog << "ERROR: Couldn't read file to memory.\n";
-        delete file;
-        return false;
-    }
-
-    // Release file handle and work on copy in memory
-    delete file;
+    assert( reinterpret_cast<uint64>(destination) % alignment.surfaceAlignment() == 0 );
 
 
     // ### Parse and decompress file 
@@ -705,32 +607,66 @@ bool load(const std::string& filename,
     uint64 inflateBufferSize = roundUp(alignment.surfaceSize(width, height) + settings.height, PageSize);
     uint8* inflated = allocate<uint8>(inflateBufferSize, PageSize);
 
+    UnfilterState image;
+    image.startLine        = 0;
+    image.lines            = 0;
+    image.texelSize        = gpu::texelSize(settings.format);
+    image.lineSize         = settings.width * image.texelSize;
+    image.rowPitch         = alignment.rowPitch(width);
+    image.height           = settings.height;
+    image.input            = inflated;
+    image.output           = destination;
+    image.invertHorizontal = invertHorizontal;
+
+    // Inflate is performed in slices of band size, so that decompressed
+    // lines are unfiltered as soon as possible.
+    Unfilter unfilter(image);
+    uint64 lineSize  = image.lineSize + 1;
+    uint64 sliceSize = static_cast<uint64>(unfilter.bandLines) * lineSize;
+
     ColorSpaceInfo colorSpaceInfo;
 
     bool firstDataChunk = true;
+    bool streamEnd      = false;
+    bool success        = true;
     z_stream stream;
 
     // Read chunks in loop until all are processed
     uint64 offset = 33;
     uint32 chunkLength = 0;
     Signature signature = static_cast<Signature>(0);
-    while(signature != Signature::IEND)
+    while(success && signature != Signature::IEND)
     {
+        // Chunk length, signature and CRC need to fit in file
+        if (offset + 12 > fileSize)
+        {
+            enLog << "ERROR: PNG file is truncated!\n";
+            success = false;
+            break;
+        }
+
         // Chunk length
-        chunkLength = endiannes(*reinterpret_cast<uint32*>(content + offset));
-        assert( offset + chunkLength <= fileSize );
+        chunkLength = endiannes(*reinterpret_cast<const uint32*>(content + offset));
         offset += 4;
       
         // Chunk signature
-        signature = *reinterpret_cast<Signature*>(content + offset);
+        signature = *reinterpret_cast<const Signature*>(content + offset);
         offset += 4;
+
+        if (chunkLength > fileSize - offset - 4)
+        {
+            enLog << "ERROR: PNG file is truncated!\n";
+            success = false;
+            break;
+        }
       
         // If ending chunk break
         if (signature == Signature::IEND)
         {
             break;
         }
-      
+
+        uint64 chunkEnd = offset + chunkLength;
         switch(signature)
         {
             // Decompress chunk for processing
@@ -740,12 +676,15 @@ bool load(const std::string& filename,
                 // and they cannot be separated by any other type of chunk. Thus
                 // their content could be decompressed at once, if it would be 
                 // copied from inside of the chunks, into continuous memory location.
-                // As file content is already read (or memory-mapped) to memory,
-                // it is better to just decompress each chunk separately on the
-                // fly.
+                // As file content is already memory-mapped, it is better to just 
+                // decompress each chunk separately on the fly.
+                if (streamEnd)
+                {
+                    break;
+                }
 
                 // Init zlib stream structure
-                stream.next_in   = reinterpret_cast<uint8*>(content + offset);       // Compressed data
+                stream.next_in   = const_cast<uint8*>(content + offset);             // Compressed data
                 stream.avail_in  = chunkLength;                                      // Size of compressed data
 
                 // Init decompressor when first data chunk is found
@@ -754,34 +693,49 @@ bool load(const std::string& filename,
                     stream.zalloc    = Z_NULL;
                     stream.zfree     = Z_NULL;
                     stream.opaque    = Z_NULL;
-                    stream.avail_out = inflateBufferSize;             // Available space for uncompressed data
+                    stream.avail_out = 0;
                     stream.next_out  = static_cast<uint8*>(inflated); // Store uncompressed data together with previous IDAT chunks
             
-                    firstDataChunk = false;
                     if (CheckError(inflateInit(&stream)))
                     {
                         enLog << "Error: Cannot initialize Zlib decompressor!\n";
-                        deallocate<uint8>(content);
-                        deallocate<uint8>(inflated);
-                        return false;
+                        success = false;
+                        break;
                     }
+
+                    firstDataChunk = false;
                 }
 
-                // Decompress data from IDAT chunk to 'inflated' buffer
-                sint32 ret = 0;
-                ret = inflate(&stream, Z_NO_FLUSH);
-                if (ret != Z_OK &&
-                    ret != Z_STREAM_END)
+                // Decompress data from IDAT chunk to 'inflated' buffer, slice
+                // after slice, passing each band of lines for unfiltering.
+                do
                 {
-                    CheckError(ret);
-                    enLog << "Error: Cannot decompress using ZLIB!\n";
-                    deallocate<uint8>(content);
-                    deallocate<uint8>(inflated);
-                    return false;
-                }
+                    uint64 decompressed = stream.next_out - inflated;
+                    stream.avail_out = static_cast<uInt>(min(sliceSize, inflateBufferSize - decompressed));
 
-                // Move offset to the end of the chunk
-                offset += chunkLength;
+                    sint32 ret = inflate(&stream, Z_NO_FLUSH);
+                    if (ret == Z_STREAM_END)
+                    {
+                        streamEnd = true;
+                    }
+                    else
+                    if (ret == Z_BUF_ERROR)
+                    {
+                        // No progress possible (output buffer is full)
+                        break;
+                    }
+                    else
+                    if (ret != Z_OK)
+                    {
+                        CheckError(ret);
+                        enLog << "Error: Cannot decompress using ZLIB!\n";
+                        success = false;
+                        break;
+                    }
+
+                    unfilter.submit(static_cast<uint32>((stream.next_out - inflated) / lineSize));
+                }
+                while(!streamEnd && (stream.avail_in > 0 || stream.avail_out == 0));
 
                 break;
             }
@@ -792,13 +746,14 @@ bool load(const std::string& filename,
                 char profile[80];
                 for(uint32 i=0; i<80; ++i)
                 {
-                    profile[i] = *reinterpret_cast<char*>(content + offset);
+                    profile[i] = *reinterpret_cast<const char*>(content + offset);
                     offset++;
                     if (profile[i] == 0)
                     {
                         break;
                     }
                 }
+                profile[79] = 0;
 
                 enLog << "iCCP chunk info:\n";
                 enLog << "Profile name: " << profile << std::endl;
@@ -810,27 +765,27 @@ bool load(const std::string& filename,
             case Signature::cHRM:
             {
                 // Read white base of chrominance 
-                colorSpaceInfo.primaries.whitePoint.x = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.whitePoint.x = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
-                colorSpaceInfo.primaries.whitePoint.y = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.whitePoint.y = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
             
                 // Read red chrominance
-                colorSpaceInfo.primaries.red.x = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.red.x = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
-                colorSpaceInfo.primaries.red.y = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.red.y = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
             
                 // Read green chrominance
-                colorSpaceInfo.primaries.green.x = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.green.x = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
-                colorSpaceInfo.primaries.green.y = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.green.y = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
             
                 // Read blue chrominance
-                colorSpaceInfo.primaries.blue.x = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.blue.x = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
-                colorSpaceInfo.primaries.blue.y = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0f;
+                colorSpaceInfo.primaries.blue.y = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0f;
                 offset += 4;
             
                 enLog << "cHRM chunk info:\n";
@@ -845,7 +800,7 @@ bool load(const std::string& filename,
             // Read gamma chunk
             case Signature::gAMA:
             {
-                colorSpaceInfo.gamma = (float)*reinterpret_cast<uint32*>(content + offset) / 100000.0;
+                colorSpaceInfo.gamma = (float)*reinterpret_cast<const uint32*>(content + offset) / 100000.0;
                 offset += 4;
 
                 enLog << "gAMA chunk info:\n";
@@ -857,128 +812,165 @@ bool load(const std::string& filename,
             // Unsupported chunk
             default:
             {
-                offset += chunkLength;
-
                 break;
             }
         };
 
-        // Skip CRC of current chunk, moving offset to the next one
-        offset += 4;
+        // Skip rest and CRC of current chunk, moving offset to the next one
+        offset = chunkEnd + 4;
     };
 
+    // Unfilter remaining lines
+    if (success && !firstDataChunk)
+    {
+        unfilter.submit(static_cast<uint32>((stream.next_out - inflated) / lineSize), true);
+    }
+
+    if (success)
+    {
+        if (unfilter.available < settings.height)
+        {
+            enLog << "ERROR: PNG file image data is incomplete!\n";
+            success = false;
+        }
+    }
+
     // Close decompressor
-    inflateEnd(&stream);
+    if (!firstDataChunk)
+    {
+        inflateEnd(&stream);
+    }
+
+    // Wait until last band is unfiltered before releasing its input
+    unfilter.finish();
+
+    // Free temporary 'inflate' buffer
+    deallocate<uint8>(inflated);
+    return success;
+}
 
-    // Free file content
-    deallocate<uint8>(content);
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
 
+    // Open file 
+    File* file = Storage->open(filename);
+    if (!file)
+    {
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return false;
+    }
 
-    // ### Decode applied filters
+    // Read file first 4KB into single 4KB memory page
+    uint32 readSize = static_cast<uint32>(min(file->size(), uint64(PageSize)));
+    uint8* buffer = allocate<uint8>(readSize, PageSize);
+    file->read(0, readSize, buffer);
+    delete file;
 
+    bool success = readMetadata(buffer, readSize, settings, colorSpace);
 
-    assert( reinterpret_cast<uint64>(destination) % alignment.surfaceAlignment() == 0 );
+    // Free temporary 4KB memory page
+    deallocate<uint8>(buffer);
+    return success;
+}
 
-/*
-    DecodeState decoder;
-    decoder.startLine        = 0;
-    decoder.lines            = settings.height;
-    decoder.texelSize        = gpu::texelSize(settings.format);
-    decoder.width            = settings.width;
-    decoder.height           = settings.height;
-    decoder.linePadding      = alignment.rowPitch(width) - alignment.rowSize(width);
-    decoder.input            = inflated;
-    decoder.output           = destination;
-    decoder.invertHorizontal = invertHorizontal;
-
-    // Decode decompressed content of PNG file 
-    decode(decoder);
- */
-
-
-
-
-    // All tasks will share this state, thus it can be used to check when all tasks are done
-    TaskState sharedState;
-
-    DecodeState* state = new DecodeState;
-    state->startLine        = 0;
-    state->lines            = 0;  // Will be populated in loop below
-    state->texelSize        = gpu::texelSize(settings.format);
-    state->width            = settings.width;
-    state->height           = settings.height;
-    state->linePadding      = alignment.rowPitch(width) - alignment.rowSize(width);
-    state->input            = inflated;
-    state->output           = destination;
-    state->invertHorizontal = invertHorizontal;
-
-    // If possible, will revert filters in paraller, using several worker threads. 
-    // It will be done by trying to distribute work as equally as possible across
-    // worker threads. Image will be divided into sections having as close amount 
-    // of lines to process as possible. Sections count will be equal to worker
-    // threads to match available CPU cores.
-    uint32 workers = Scheduler->workers();
-    uint32 linesPerCore = state->height / workers;
-    for(uint32 task=0; task<workers; ++task)
-    {
-        // Calculate lines range for current task
-        state->startLine += state->lines;
-        state->lines      = linesPerCore;
-   
-        // Check if first line of next section is not compressed with pattern
-        // 2,3 or 4. In such situation increase current lines range to prevent
-        // data dependency between task blocks (these patterns use previous line). 
-        uint8 type = 4;
-        bool lastTask = false;
-        while(type > 1)
-        {
-            // Check if current block is not already reaching end of image
-            uint32 nextLine = state->startLine + state->lines;
-            if (nextLine >= state->height)
-            {
-                state->lines = state->height - state->startLine;
-                lastTask = true;
-                break;
-            }
-   
-            // Check if next block will use "Paeth"
-            uint32 inOffset = nextLine * (state->width * state->texelSize + 1);
-            uint8 type = state->input[inOffset];
-            if (type < 2)
-            {
-                break;
-            }
-   
-            state->lines++;
-        }
-      
-        // Create state copy for next task
-        DecodeState* temp = nullptr;
-        if (!lastTask)
-        {
-            temp = new DecodeState;
-            memcpy(temp, state, sizeof(DecodeState));
-        }
+bool load(const std::string& filename, 
+          uint8* const destination, 
+          const uint32 width, 
+          const uint32 height, 
+          const gpu::Format format, 
+          const gpu::ImageMemoryAlignment alignment, 
+          const bool invertHorizontal)
+{
+    using namespace en::storage;
 
-        // Spawn task to decompress part of image
-        // TODO: Direct tasks to different workers in the future to directly distribute 
-        //       the work, starting from last core and ending on this one.
-        en::Scheduler->run(taskDecodePNG, (void*)state, &sharedState); // (cores - worker - 1)
-        if (lastTask) 
-        {
-            break;
-        }
+    // Open file 
+    File* file = Storage->open(filename);
+    if (!file)
+    {
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return false;
+    }
 
-        state = temp;
+    // Map whole file to memory, so that its content is decompressed directly
+    // from OS page cache (without copying it first).
+    uint64 fileSize = file->size();
+    FileView* view = file->map(0u, fileSize, MapHint::Sequential);
+    if (!view)
+    {
+        enLog << "ERROR: Couldn't read file to memory.\n";
+        delete file;
+        return false;
     }
 
-    // Wait until all decoding tasks are done
-    // TODO: In future consider passing this task state as output to allow multiple async decompressions
-    en::Scheduler->wait(&sharedState);
+    bool success = decode(view->data(), fileSize, destination, width, height, format, alignment, invertHorizontal);
 
-    // Free temporary 'infalte' buffer
-    deallocate<uint8>(inflated);
-    return true;
+    delete view;
+    delete file;
+    return success;
+}
+
+// Request of asynchronous load (owned by task processing it)
+struct LoadRequest
+{
+    std::string filename;
+    uint8* destination;
+    uint32 width;
+    uint32 height;
+    gpu::Format format;
+    gpu::ImageMemoryAlignment alignment;
+    bool invertHorizontal;
+    bool* result;
+};
+
+void taskLoadPNG(void* taskData)
+{
+    LoadRequest* request = reinterpret_cast<LoadRequest*>(taskData);
+
+    bool success = load(request->filename, 
+                        request->destination, 
+                        request->width, 
+                        request->height, 
+                        request->format, 
+                        request->alignment, 
+                        request->invertHorizontal);
+
+    if (request->result)
+    {
+        *request->result = success;
+    }
+
+    delete request;
+}
+
+void loadAsync(const std::string& filename, 
+               uint8* const destination, 
+               const uint32 width, 
+               const uint32 height, 
+               const gpu::Format format, 
+               const gpu::ImageMemoryAlignment alignment, 
+               TaskState* state,
+               bool* result,
+               const bool invertHorizontal)
+{
+    assert( Scheduler );
+    assert( state );
+
+    LoadRequest* request = new LoadRequest;
+    request->filename         = filename;
+    request->destination      = destination;
+    request->width            = width;
+    request->height           = height;
+    request->format           = format;
+    request->alignment        = alignment;
+    request->invertHorizontal = invertHorizontal;
+    request->result           = result;
+
+    // Each image is decoded by its own task, so that many images can be
+    // decoded at the same time by different worker threads.
+    Scheduler->run(taskLoadPNG, request, state, false, TaskPriority::Background);
 }
 
 } // en::png
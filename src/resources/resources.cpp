@@ -22,6 +22,7 @@
 #include "resources/exr.h"
 #include "resources/hdr.h"
 #include "resources/dds.h"
+#include "resources/tex.h"
 #include "resources/material.h"   
 #include "resources/mtl.h"       
 #include "resources/obj.h"   
@@ -113,6 +114,7 @@ Context::Context()
     fonts.clear();
     models.clear();
     materials.clear();
+    libraries.clear();
 //*/
 
     textures.clear();
@@ -138,6 +140,7 @@ void Context::create(void)
 
     models.clear();
     materials.clear();
+    libraries.clear();
     textures.clear();
 
     // Create default program for materials
@@ -263,6 +266,7 @@ void Context::destroy(void)
 
     models.clear();
     materials.clear();
+    libraries.clear();
     textures.clear();
 
 #if defined(EN_PLATFORM_WINDOWS)
@@ -994,6 +998,7 @@ enum FileExtension
     ExtensionEXR        ,
     ExtensionHDR        ,
     ExtensionPNG        ,
+    ExtensionTEX        ,
     ExtensionTGA        ,
     ExtensionsCount
  };
@@ -1010,6 +1015,8 @@ static const std::pair<std::string, FileExtension> TranslateFileExtension[] =
     { std::string(".HDR"), ExtensionHDR },
     { std::string(".png"), ExtensionPNG },
     { std::string(".PNG"), ExtensionPNG },
+    { std::string(".tex"), ExtensionTEX },
+    { std::string(".TEX"), ExtensionTEX },
     { std::string(".tga"), ExtensionTGA },
     { std::string(".TGA"), ExtensionTGA }
 };
@@ -1086,6 +1093,12 @@ std::shared_ptr<en::gpu::Texture> Interface::Load::texture(const std::string& fi
             break;
         }
 
+        case ExtensionTEX:
+        {
+            texture = tex::load(filename);
+            break;
+        }
+
         case ExtensionTGA:
         {
             // TODO: All that need to be rewritten
@@ -0,0 +1,801 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Mesh simplification
+ Visibility  : Engine internal code
+ Requirements: none
+ Description : Generates levels of detail of 3D model meshes,
+               by collapsing edges with the lowest Quadric
+               Error Metric (Garland and Heckbert).
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "parallel/scheduler.h"
+#include "utilities/utilities.h"
+#include "utilities/gpcpu/gpcpu.h"
+#include "resources/simplify.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace en
+{
+namespace Simplify
+{
+
+constexpr uint32 InvalidVertex  = 0xFFFFFFFF;
+constexpr uint32 MultipleEdges  = 0xFFFFFFFE; // Vertex has more than one open edge
+
+const float BorderWeight = 10.0f; // Weight of planes keeping mesh borders in place
+const float SeamWeight   = 1.0f;  // Weight of planes keeping attribute seams in place
+
+enum class Kind : uint8
+{
+    Manifold = 0, // Interior vertex, can move in any direction
+    Border      , // Vertex on open border, can move only along it
+    Seam        , // Vertex on attribute seam (two split vertices), can move only along it
+    Locked      , // Vertex with complex topology, is never moved
+    Count
+};
+
+// Kind of vertex that can be collapsed onto kind of other vertex
+const bool CanCollapse[underlyingType(Kind::Count)][underlyingType(Kind::Count)] =
+{
+    { true,  true,  true,  true  }, // Manifold -> Any
+    { false, true,  false, true  }, // Border   -> Border, Locked
+    { false, false, true,  true  }, // Seam     -> Seam, Locked
+    { false, false, false, false }, // Locked
+};
+
+// Sum of squared distances to set of weighted planes
+struct Quadric
+{
+    float a00, a11, a22;
+    float a10, a20, a21;
+    float b0,  b1,  b2;
+    float c;
+    float weight;
+
+    Quadric();
+    Quadric(const float3& normal, const float distance, const float weight);
+
+    void  operator+= (const Quadric& b);
+    float error(const float3& position) const;
+};
+
+Quadric::Quadric()
+{
+    memset(this, 0, sizeof(Quadric));
+}
+
+Quadric::Quadric(const float3& normal, const float distance, const float _weight)
+{
+    a00 = _weight * normal.x * normal.x;
+    a11 = _weight * normal.y * normal.y;
+    a22 = _weight * normal.z * normal.z;
+    a10 = _weight * normal.y * normal.x;
+    a20 = _weight * normal.z * normal.x;
+    a21 = _weight * normal.z * normal.y;
+    b0  = _weight * normal.x * distance;
+    b1  = _weight * normal.y * distance;
+    b2  = _weight * normal.z * distance;
+    c   = _weight * distance * distance;
+    weight = _weight;
+}
+
+void Quadric::operator+= (const Quadric& b)
+{
+    a00 += b.a00;
+    a11 += b.a11;
+    a22 += b.a22;
+    a10 += b.a10;
+    a20 += b.a20;
+    a21 += b.a21;
+    b0  += b.b0;
+    b1  += b.b1;
+    b2  += b.b2;
+    c   += b.c;
+    weight += b.weight;
+}
+
+float Quadric::error(const float3& p) const
+{
+    float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+    float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+    float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+
+    float result = rx * p.x + ry * p.y + rz * p.z;
+    result += 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z);
+    result += c;
+    return fabsf(result);
+}
+
+struct Collapse
+{
+    uint32 source;  // Vertex that is removed
+    uint32 target;  // Vertex it is collapsed onto
+    float  error;   // Squared distance
+};
+
+// Lists of elements (neighbour vertices or triangles) for each vertex
+struct Adjacency
+{
+    std::vector<uint32> offset;
+    std::vector<uint32> count;
+    std::vector<uint32> data;
+
+    forceinline const uint32* begin(const uint32 vertex) const { return &data[offset[vertex]]; }
+    forceinline const uint32* end(const uint32 vertex) const   { return &data[offset[vertex]] + count[vertex]; }
+};
+
+class Simplifier
+{
+    public:
+    uint32              vertexCount;
+    std::vector<float3> positions; // Positions scaled to unit cube
+    std::vector<uint32> remap;     // First vertex with the same position
+    std::vector<uint32> wedge;     // Next vertex with the same position (circular list)
+    std::vector<Kind>   kind;      // Kind of each vertex
+    std::vector<uint32> loop;      // Next vertex on border or seam
+    std::vector<Quadric> quadrics; // Quadric of each position (stored at remap[vertex])
+    std::vector<uint32> indexes;   // Current triangle list
+    Adjacency           edges;     // Outgoing half-edges of each vertex
+    Adjacency           triangles; // Triangles using each position
+
+    Simplifier(const Geometry& geometry, const float3* positions);
+
+    void  buildEdges(void);
+    void  buildTriangles(void);
+    bool  hasEdge(const uint32 a, const uint32 b) const;
+    bool  hasPositionEdge(const uint32 a, const uint32 b) const;
+    void  classify(void);
+    void  computeQuadrics(void);
+    void  pickCollapses(std::vector<Collapse>& collapses) const;
+    bool  flips(const uint32 source, const uint32 target) const;
+    float collapse(const std::vector<Collapse>& collapses, const uint32 goal, const float limit);
+};
+
+Simplifier::Simplifier(const Geometry& geometry, const float3* scaled) :
+    vertexCount(geometry.vertexCount),
+    positions(scaled, scaled + geometry.vertexCount),
+    remap(geometry.vertexCount),
+    wedge(geometry.vertexCount),
+    kind(geometry.vertexCount, Kind::Manifold),
+    loop(geometry.vertexCount, InvalidVertex),
+    quadrics(geometry.vertexCount)
+{
+    // Group vertices sharing position
+    if (geometry.positionIds)
+    {
+        std::unordered_map<uint32, uint32> first;
+        first.reserve(geometry.vertexCount);
+        for(uint32 i=0; i<vertexCount; ++i)
+        {
+            remap[i] = first.emplace(geometry.positionIds[i], i).first->second;
+        }
+    }
+    else
+    {
+        for(uint32 i=0; i<vertexCount; ++i)
+        {
+            remap[i] = i;
+        }
+    }
+
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        wedge[i] = i;
+        if (remap[i] != i)
+        {
+            wedge[i] = wedge[remap[i]];
+            wedge[remap[i]] = i;
+        }
+    }
+
+    // Skip degenerate triangles
+    indexes.reserve(geometry.indexCount);
+    for(uint32 i=0; i+2<geometry.indexCount; i+=3)
+    {
+        uint32 a = geometry.indexes[i];
+        uint32 b = geometry.indexes[i + 1];
+        uint32 c = geometry.indexes[i + 2];
+        assert( a < vertexCount && b < vertexCount && c < vertexCount );
+        if (remap[a] != remap[b] &&
+            remap[b] != remap[c] &&
+            remap[a] != remap[c])
+        {
+            indexes.push_back(a);
+            indexes.push_back(b);
+            indexes.push_back(c);
+        }
+    }
+}
+
+void Simplifier::buildEdges(void)
+{
+    edges.offset.resize(vertexCount);
+    edges.count.assign(vertexCount, 0);
+    edges.data.resize(indexes.size());
+
+    for(uint32 i=0; i<indexes.size(); ++i)
+    {
+        edges.count[indexes[i]]++;
+    }
+
+    uint32 offset = 0;
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        edges.offset[i] = offset;
+        offset += edges.count[i];
+        edges.count[i] = 0;
+    }
+
+    for(uint32 i=0; i<indexes.size(); i+=3)
+    {
+        for(uint32 j=0; j<3; ++j)
+        {
+            uint32 a = indexes[i + j];
+            uint32 b = indexes[i + (j + 1) % 3];
+            edges.data[edges.offset[a] + edges.count[a]++] = b;
+        }
+    }
+}
+
+void Simplifier::buildTriangles(void)
+{
+    triangles.offset.resize(vertexCount);
+    triangles.count.assign(vertexCount, 0);
+    triangles.data.resize(indexes.size());
+
+    for(uint32 i=0; i<indexes.size(); ++i)
+    {
+        triangles.count[remap[indexes[i]]]++;
+    }
+
+    uint32 offset = 0;
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        triangles.offset[i] = offset;
+        offset += triangles.count[i];
+        triangles.count[i] = 0;
+    }
+
+    for(uint32 i=0; i<indexes.size(); ++i)
+    {
+        uint32 position = remap[indexes[i]];
+        triangles.data[triangles.offset[position] + triangles.count[position]++] = i / 3;
+    }
+}
+
+bool Simplifier::hasEdge(const uint32 a, const uint32 b) const
+{
+    for(const uint32* i=edges.begin(a); i<edges.end(a); ++i)
+    {
+        if (*i == b)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Checks if any of split vertices of position a, has edge to position b
+bool Simplifier::hasPositionEdge(const uint32 a, const uint32 b) const
+{
+    uint32 vertex = a;
+    do
+    {
+        for(const uint32* i=edges.begin(vertex); i<edges.end(vertex); ++i)
+        {
+            if (remap[*i] == remap[b])
+            {
+                return true;
+            }
+        }
+
+        vertex = wedge[vertex];
+    }
+    while(vertex != a);
+
+    return false;
+}
+
+void Simplifier::classify(void)
+{
+    // Find open half-edges (without opposite one)
+    std::vector<uint32> openIn(vertexCount, InvalidVertex);
+    std::vector<uint32> openOut(vertexCount, InvalidVertex);
+    for(uint32 a=0; a<vertexCount; ++a)
+    {
+        for(const uint32* i=edges.begin(a); i<edges.end(a); ++i)
+        {
+            uint32 b = *i;
+            if (!hasEdge(b, a))
+            {
+                openOut[a] = (openOut[a] == InvalidVertex) ? b : MultipleEdges;
+                openIn[b]  = (openIn[b]  == InvalidVertex) ? a : MultipleEdges;
+            }
+        }
+    }
+
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        if (remap[i] != i)
+        {
+            continue;
+        }
+
+        Kind result = Kind::Locked;
+        if (wedge[i] == i)
+        {
+            // Single vertex, is either in the interior of the mesh, or
+            // on border (having one incoming and one outgoing open edge)
+            if (openIn[i] == InvalidVertex && openOut[i] == InvalidVertex)
+            {
+                result = Kind::Manifold;
+            }
+            else
+            if (openIn[i] < MultipleEdges && openOut[i] < MultipleEdges)
+            {
+                result = Kind::Border;
+            }
+        }
+        else
+        if (wedge[wedge[i]] == i)
+        {
+            // Two split vertices are on seam, if their open edges connect
+            // to the same positions from both sides of the seam
+            uint32 w = wedge[i];
+            uint32 a = openIn[i];
+            uint32 b = openOut[i];
+            uint32 c = openIn[w];
+            uint32 d = openOut[w];
+            if (a < MultipleEdges && b < MultipleEdges &&
+                c < MultipleEdges && d < MultipleEdges &&
+                remap[a] == remap[d] &&
+                remap[b] == remap[c])
+            {
+                result = Kind::Seam;
+            }
+        }
+
+        // Kind is shared by all split vertices
+        uint32 vertex = i;
+        do
+        {
+            kind[vertex] = result;
+            vertex = wedge[vertex];
+        }
+        while(vertex != i);
+    }
+
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        if (kind[i] == Kind::Border || kind[i] == Kind::Seam)
+        {
+            loop[i] = openOut[i];
+        }
+    }
+}
+
+void Simplifier::computeQuadrics(void)
+{
+    for(uint32 i=0; i<indexes.size(); i+=3)
+    {
+        const float3& p0 = positions[indexes[i]];
+        const float3& p1 = positions[indexes[i + 1]];
+        const float3& p2 = positions[indexes[i + 2]];
+
+        float3 normal = cross(p1 - p0, p2 - p0);
+        float  area   = normal.length();
+        if (area == 0.0f)
+        {
+            continue;
+        }
+
+        normal /= area;
+
+        // Plane of triangle, weighted by its area
+        Quadric plane(normal, -dot(normal, p0), area * 0.5f);
+        for(uint32 j=0; j<3; ++j)
+        {
+            quadrics[remap[indexes[i + j]]] += plane;
+        }
+
+        // Open edges are kept in place by planes perpendicular to
+        // triangle. Borders (open in position space) are weighted
+        // more than seams.
+        for(uint32 j=0; j<3; ++j)
+        {
+            uint32 a = indexes[i + j];
+            uint32 b = indexes[i + (j + 1) % 3];
+            if (hasEdge(b, a))
+            {
+                continue;
+            }
+
+            const float3& pa = positions[a];
+            const float3& pb = positions[b];
+
+            float3 edge   = pb - pa;
+            float  length = edge.length();
+            float3 side   = cross(edge, normal);
+            float  sideLength = side.length();
+            if (sideLength == 0.0f)
+            {
+                continue;
+            }
+
+            side /= sideLength;
+
+            float weight = hasPositionEdge(b, a) ? SeamWeight : BorderWeight;
+            Quadric edgePlane(side, -dot(side, pa), length * length * weight);
+            quadrics[remap[a]] += edgePlane;
+            quadrics[remap[b]] += edgePlane;
+        }
+    }
+}
+
+void Simplifier::pickCollapses(std::vector<Collapse>& collapses) const
+{
+    collapses.clear();
+    for(uint32 i=0; i<indexes.size(); i+=3)
+    {
+        for(uint32 j=0; j<3; ++j)
+        {
+            uint32 a = indexes[i + j];
+            uint32 b = indexes[i + (j + 1) % 3];
+            if (remap[a] == remap[b])
+            {
+                continue;
+            }
+
+            // Interior edges are seen from both sides, use only one of them
+            if (a > b && hasEdge(b, a))
+            {
+                continue;
+            }
+
+            Kind ka = kind[a];
+            Kind kb = kind[b];
+            bool ab = CanCollapse[underlyingType(ka)][underlyingType(kb)];
+            bool ba = CanCollapse[underlyingType(kb)][underlyingType(ka)];
+            if (!ab && !ba)
+            {
+                continue;
+            }
+
+            // Vertices on border or seam, can be collapsed only along it
+            if (ka == kb &&
+                (ka == Kind::Border || ka == Kind::Seam) &&
+                loop[a] != b && loop[b] != a)
+            {
+                continue;
+            }
+
+            Quadric quadric = quadrics[remap[a]];
+            quadric += quadrics[remap[b]];
+            float weight = quadric.weight > 0.0f ? quadric.weight : 1.0f;
+
+            Collapse collapse;
+            collapse.source = a;
+            collapse.target = b;
+            collapse.error  = ab ? quadric.error(positions[b]) / weight : 0.0f;
+            if (ba)
+            {
+                float error = quadric.error(positions[a]) / weight;
+                if (!ab || error < collapse.error)
+                {
+                    collapse.source = b;
+                    collapse.target = a;
+                    collapse.error  = error;
+                }
+            }
+
+            collapses.push_back(collapse);
+        }
+    }
+}
+
+// Checks if moving source position onto target, flips any of triangles
+bool Simplifier::flips(const uint32 source, const uint32 target) const
+{
+    uint32 from = remap[source];
+    uint32 to   = remap[target];
+    const float3& destination = positions[target];
+
+    for(const uint32* i=triangles.begin(from); i<triangles.end(from); ++i)
+    {
+        const uint32* triangle = &indexes[*i * 3];
+        uint32 a = remap[triangle[0]];
+        uint32 b = remap[triangle[1]];
+        uint32 c = remap[triangle[2]];
+
+        // Triangles using both vertices are removed
+        if (a == to || b == to || c == to)
+        {
+            continue;
+        }
+
+        // Rotate triangle, so that moved vertex is first
+        if (b == from)
+        {
+            std::swap(a, b);
+            std::swap(b, c);
+        }
+        else
+        if (c == from)
+        {
+            std::swap(a, c);
+            std::swap(b, c);
+        }
+
+        const float3& p1 = positions[b];
+        const float3& p2 = positions[c];
+        float3 before = cross(p1 - positions[a], p2 - positions[a]);
+        float3 after  = cross(p1 - destination, p2 - destination);
+        if (dot(before, after) <= 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Collapses edges in order of increasing error, until goal count of
+// triangles is removed, or error exceeds limit. Returns highest error.
+float Simplifier::collapse(const std::vector<Collapse>& collapses, const uint32 goal, const float limit)
+{
+    std::vector<uint32> target(vertexCount);
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        target[i] = i;
+    }
+
+    // Each position is changed only once per pass
+    std::vector<bool> locked(vertexCount, false);
+
+    float  result  = 0.0f;
+    uint32 removed = 0;
+    for(const Collapse& collapse : collapses)
+    {
+        if (collapse.error > limit || removed >= goal)
+        {
+            break;
+        }
+
+        uint32 source = collapse.source;
+        uint32 from   = remap[source];
+        uint32 to     = remap[collapse.target];
+        if (locked[from] || locked[to])
+        {
+            continue;
+        }
+
+        if (flips(source, collapse.target))
+        {
+            continue;
+        }
+
+        quadrics[to] += quadrics[from];
+
+        // Both split vertices on seam are collapsed onto the other two
+        target[source] = collapse.target;
+        if (kind[source] == Kind::Seam)
+        {
+            target[wedge[source]] = wedge[collapse.target];
+        }
+
+        locked[from] = true;
+        locked[to]   = true;
+        removed += (kind[source] == Kind::Border) ? 1 : 2;
+        result   = std::max(result, collapse.error);
+    }
+
+    if (removed == 0)
+    {
+        return -1.0f;
+    }
+
+    // Reconnect border and seam loops
+    for(uint32 i=0; i<vertexCount; ++i)
+    {
+        uint32 next = loop[i];
+        if (next == InvalidVertex || target[i] != i)
+        {
+            continue;
+        }
+
+        if (target[next] == i)
+        {
+            loop[i] = (loop[next] == InvalidVertex) ? InvalidVertex : target[loop[next]];
+        }
+        else
+        {
+            loop[i] = target[next];
+        }
+    }
+
+    // Remap triangles, and remove the ones that became degenerate
+    uint32 count = 0;
+    for(uint32 i=0; i<indexes.size(); i+=3)
+    {
+        uint32 a = target[indexes[i]];
+        uint32 b = target[indexes[i + 1]];
+        uint32 c = target[indexes[i + 2]];
+        if (remap[a] != remap[b] &&
+            remap[b] != remap[c] &&
+            remap[a] != remap[c])
+        {
+            indexes[count++] = a;
+            indexes[count++] = b;
+            indexes[count++] = c;
+        }
+    }
+
+    indexes.resize(count);
+    return result;
+}
+
+float simplify(const Geometry& geometry, std::vector<uint32>& output, const uint32 targetIndexCount, const float maxError)
+{
+    assert( geometry.indexCount % 3 == 0 );
+
+    if (geometry.indexCount <= targetIndexCount ||
+        geometry.vertexCount == 0)
+    {
+        output.assign(geometry.indexes, geometry.indexes + geometry.indexCount);
+        return 0.0f;
+    }
+
+    // Error is measured relative to mesh extent
+    float3 minimum = geometry.positions[0];
+    float3 maximum = geometry.positions[0];
+    for(uint32 i=1; i<geometry.vertexCount; ++i)
+    {
+        const float3& position = geometry.positions[i];
+        minimum = float3(std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z));
+        maximum = float3(std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z));
+    }
+
+    float extent = std::max(std::max(maximum.x - minimum.x, maximum.y - minimum.y), maximum.z - minimum.z);
+    float scale  = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    std::vector<float3> scaled(geometry.vertexCount);
+    for(uint32 i=0; i<geometry.vertexCount; ++i)
+    {
+        scaled[i] = (geometry.positions[i] - minimum) * scale;
+    }
+
+    Simplifier simplifier(geometry, scaled.data());
+    simplifier.buildEdges();
+    simplifier.classify();
+    simplifier.computeQuadrics();
+
+    float errorLimit = maxError * maxError;
+    float result     = 0.0f;
+
+    std::vector<Collapse> collapses;
+    while(simplifier.indexes.size() > targetIndexCount)
+    {
+        simplifier.buildEdges();
+        simplifier.buildTriangles();
+        simplifier.pickCollapses(collapses);
+        if (collapses.empty())
+        {
+            break;
+        }
+
+        auto cheaper = [](const Collapse& a, const Collapse& b)
+        {
+            return a.error < b.error;
+        };
+
+        // Each pass collapses cheapest edges. Edges much more expensive than
+        // median of needed ones are left for next pass, as after neighbour
+        // collapses cheaper ones may appear. Only edges below that limit
+        // need to be sorted.
+        uint32 goal  = static_cast<uint32>(simplifier.indexes.size() - targetIndexCount) / 3;
+        goal = std::max(goal, 1u);
+        uint32 index = std::min(goal / 2, static_cast<uint32>(collapses.size() - 1));
+        std::nth_element(collapses.begin(), collapses.begin() + index, collapses.end(), cheaper);
+        float  limit = std::min(collapses[index].error * 1.5f, errorLimit);
+
+        auto end = std::partition(collapses.begin(), collapses.end(), [limit](const Collapse& collapse)
+        {
+            return collapse.error <= limit;
+        });
+        collapses.erase(end, collapses.end());
+        std::sort(collapses.begin(), collapses.end(), cheaper);
+
+        float error = simplifier.collapse(collapses, goal, limit);
+        if (error < 0.0f)
+        {
+            break;
+        }
+
+        result = std::max(result, error);
+    }
+
+    output.swap(simplifier.indexes);
+    return sqrtf(result);
+}
+
+struct LevelsTask
+{
+    const Geometry*     meshes;
+    std::vector<Level>* levels;
+    uint32 levelsCount;
+    float  reduction;
+    float  maxError;
+};
+
+void taskGenerateLevels(void* data, uint32v2 range)
+{
+    LevelsTask& task = *reinterpret_cast<LevelsTask*>(data);
+    for(uint32 i=range.base; i<range.base+range.count; ++i)
+    {
+        std::vector<Level>& levels = task.levels[i];
+        levels.clear();
+
+        // Each level is simplified from the previous one
+        Geometry source = task.meshes[i];
+        float    error  = 0.0f;
+        for(uint32 j=1; j<task.levelsCount; ++j)
+        {
+            uint32 target = static_cast<uint32>(source.indexCount / 3 * task.reduction) * 3;
+
+            Level level;
+            level.error = error + simplify(source, level.indexes, target, task.maxError - error);
+
+            // Stop if mesh cannot be simplified further, without exceeding
+            // error limit (level would be too similar to previous one).
+            uint32 count = static_cast<uint32>(level.indexes.size());
+            if (count == 0 ||
+                count > target + (source.indexCount - target) / 2)
+            {
+                break;
+            }
+
+            error = level.error;
+            levels.push_back(std::move(level));
+
+            source.indexes    = levels.back().indexes.data();
+            source.indexCount = count;
+        }
+    }
+}
+
+void generateLevels(const Geometry* meshes, std::vector<Level>* levels, const uint32 count, const uint32 levelsCount, const float reduction, const float maxError)
+{
+    assert( levelsCount > 0 && levelsCount <= 16 );
+    assert( reduction > 0.0f && reduction < 1.0f );
+
+    LevelsTask task;
+    task.meshes      = meshes;
+    task.levels      = levels;
+    task.levelsCount = levelsCount;
+    task.reduction   = reduction;
+    task.maxError    = maxError;
+
+    if (count > 1 && Scheduler && Scheduler->currentWorkerId() != InvalidWorkerId)
+    {
+        TaskState state;
+        Scheduler->run(taskGenerateLevels, &task, uint32v2(0, count), &state, 1);
+        Scheduler->wait(&state);
+    }
+    else
+    {
+        taskGenerateLevels(&task, uint32v2(0, count));
+    }
+}
+
+} // en::Simplify
+} // en
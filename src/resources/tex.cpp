@@ -1,7 +1,7 @@
 /*
 
  Ngine v5.0
- 
+
  Module      : TEX file support
  Requirements: none
  Description : Supports engine proprietary file format
@@ -13,195 +13,445 @@
 #include "core/storage.h"
 #include "core/log/log.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
+#include "resources/tex.h"
 
-#include "core/rendering/device.h"
 
-#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_WINDOWS)
 #include "zlib.h"
-#endif
 
+#include <assert.h>
+#include <string.h>
 #include <string>
+#include <vector>
 
 namespace en
 {
 namespace tex
 {
 
-// TODO: This is draft file. Its storing and loading implementations are drafted but not finished.
-
-struct Header_v1
+// Texture stored in opened file, with validated headers
+struct Content
 {
-    uint32 signature;   // TEX file signature 'ETEX' -> 0x58455445 
-    uint32 version;     // Version of format in which file is stored
-    uint64 filesize;    // Total file size for verification
-    uint32 textures;    // Textures in file
+    storage::File*                       file;
+    gpu::TextureState                    settings;
+    gpu::ColorSpace                      colorSpace;
+    std::vector<TextureSurfaceHeader_v1> surfaces;   // In file order (smallest mip-map first)
 };
 
-struct TextureHeader_v1
+// Count of surfaces in given mip-map (3D textures have less depth slices in
+// each next mip-map)
+uint32 layersCount(const gpu::TextureState& settings, const uint32 mipmap)
 {
-    uint16 compression;  // Compression type used on this texture. If 0, texture can be directly uploaded to GPU
-    uint16 colorSpace;   // Color space
-    uint32 type;         // GPU friendly texture type (enum TextureType)
-    uint32 format;       // GPU friendly texture format (enum TextureFormat)
-    uint16 width;        // Width (mipmap 0)
-    uint16 height;       // Height (mipmap 0)
-    uint16 depth;        // Depth (mipmap 0)
-    uint16 layers;       // Layers
-    uint16 samples;      // Samples (if multisampled)
-                        // Texture surface descriptors array 
-    uint16 surfaces;     // Size
-    uint64 offset;       // Offset in file
-    uint64 name;         // Offset to name null terminated string
-    uint32 length;       // Name length
-};
+    return settings.type == gpu::TextureType::Texture3D ? settings.mipDepth(mipmap) : settings.layers;
+}
 
-struct TextureSurfaceHeader_v1
+storage::File* open(const std::string& filename)
 {
-    uint16 layer;        // Which layer/face of array/3D/cube texture it is
-    uint16 mipmap;       // Which mip-map of texture it is (can load textures with missing mipmaps)
-    uint16 width;        // Width (for validation)
-    uint16 height;       // Height (for validation)
-    uint64 offset;       // Offset in file to surface data
-    uint64 size;         // Size (for validation)
-};
+    using namespace en::storage;
 
+    // Open file
+    File* file = Storage->open(filename);
+    if (!file)
+    {
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
+    }
+
+    return file;
+}
 
-bool save(const gpu::TextureState settings, const uint64 size, const void* data, const std::string& filename)
+// Reads and validates headers of texture stored in file
+bool readHeader(storage::File* file, Content& content)
 {
-    // TODO: Finish
-    return false;
+    using namespace en::gpu;
+
+    content.file = file;
+
+    uint64 filesize = file->size();
+    if (filesize < sizeof(Header_v1) + sizeof(TextureHeader_v1))
+    {
+        enLog << "ERROR: TEX file is too small!\n";
+        return false;
+    }
+
+    Header_v1 header;
+    TextureHeader_v1 texture;
+    if (!file->read(0, sizeof(Header_v1), &header) ||
+        !file->read(sizeof(Header_v1), sizeof(TextureHeader_v1), &texture))
+    {
+        enLog << "ERROR: Cannot read TEX file header!\n";
+        return false;
+    }
+
+    if (header.signature != Signature)
+    {
+        enLog << "ERROR: TEX file header signature is incorrect!\n";
+        return false;
+    }
+    if (header.version != Version)
+    {
+        enLog << "ERROR: TEX file header version is not supported!\n";
+        return false;
+    }
+    if (header.filesize != filesize)
+    {
+        enLog << "ERROR: TEX file size mismatch!\n";
+        return false;
+    }
+    if (header.textures != 1)
+    {
+        enLog << "ERROR: TEX file with more than one texture is not supported!\n";
+        return false;
+    }
+
+    if (texture.type   >= underlyingType(TextureType::Count) ||
+        texture.format >= underlyingType(Format::Count) ||
+        texture.width   == 0 ||
+        texture.height  == 0 ||
+        texture.layers  == 0 ||
+        texture.mipmaps == 0 ||
+        texture.samples == 0)
+    {
+        enLog << "ERROR: TEX file describes unsupported texture!\n";
+        return false;
+    }
+
+    content.settings = TextureState(static_cast<TextureType>(texture.type),
+                                    static_cast<Format>(texture.format),
+                                    static_cast<TextureUsage>(texture.usage),
+                                    texture.width,
+                                    texture.height,
+                                    texture.mipmaps,
+                                    texture.layers,
+                                    texture.samples);
+
+    content.colorSpace = texture.colorSpace == ColorSpaceSRGB ? ColorSpaceSRGB : ColorSpaceLinear;
+
+    // Each surface of each mip-map needs to be stored
+    std::vector<uint32> firstSurface(content.settings.mipmaps);
+    uint32 count = 0;
+    for(uint32 i=0; i<content.settings.mipmaps; ++i)
+    {
+        firstSurface[i] = count;
+        count += layersCount(content.settings, i);
+    }
+
+    uint64 tableSize = static_cast<uint64>(texture.surfaces) * sizeof(TextureSurfaceHeader_v1);
+    if (texture.surfaces != count ||
+        texture.offset + tableSize > filesize)
+    {
+        enLog << "ERROR: TEX file surfaces table is incorrect!\n";
+        return false;
+    }
+
+    content.surfaces.resize(count);
+    if (!file->read(texture.offset, tableSize, &content.surfaces[0]))
+    {
+        enLog << "ERROR: Cannot read TEX file surfaces table!\n";
+        return false;
+    }
+
+    // Table has as many entries as there are surfaces, so if none of them
+    // is duplicated, all surfaces are present
+    std::vector<bool> present(count, false);
+    for(const TextureSurfaceHeader_v1& surface : content.surfaces)
+    {
+        if (surface.mipmap >= content.settings.mipmaps ||
+            surface.layer  >= layersCount(content.settings, surface.mipmap) ||
+            surface.size   != content.settings.surfaceSize(static_cast<uint8>(surface.mipmap)) ||
+            surface.offset + surface.storedSize > filesize ||
+            surface.compression > Compression::Deflate ||
+            (surface.compression == Compression::None && surface.storedSize != surface.size))
+        {
+            enLog << "ERROR: TEX file surface header is incorrect, file corrupted!\n";
+            return false;
+        }
+
+        uint32 index = firstSurface[surface.mipmap] + surface.layer;
+        if (present[index])
+        {
+            enLog << "ERROR: TEX file stores the same surface twice, file corrupted!\n";
+            return false;
+        }
+
+        present[index] = true;
+    }
+
+    return true;
 }
 
-bool save(std::shared_ptr<gpu::Texture> texture, const std::string& filename)
+const TextureSurfaceHeader_v1* findSurface(const Content& content, const uint32 mipmap, const uint32 layer)
 {
-    // TODO: Finish
-    return false;
+    for(const TextureSurfaceHeader_v1& surface : content.surfaces)
+    {
+        if (surface.mipmap == mipmap &&
+            surface.layer  == layer)
+        {
+            return &surface;
+        }
+    }
+
+    return nullptr;
 }
 
-std::unique_ptr<gpu::Texture>* load(const std::string& filename)
+// Copies rows of surface (or rows of compressed blocks) from file mapping to
+// destination, inflating them if needed
+bool readSurface(const Content& content,
+                 const TextureSurfaceHeader_v1& surface,
+                 uint8* const destination,
+                 const gpu::ImageMemoryAlignment alignment)
 {
     using namespace en::storage;
-    using namespace en::gpu;
 
-    // Open image file 
-    File* file = Storage->open(filename);
-    if (!file)
+    uint8  mipmap   = static_cast<uint8>(surface.mipmap);
+    uint32 rows     = content.settings.rowsCount(mipmap);
+    uint32 rowSize  = content.settings.rowSize(mipmap);
+    uint32 rowPitch = roundUp(rowSize, alignment.rowAlignment());
+
+    FileView* view = content.file->map(surface.offset, surface.storedSize, MapHint::Sequential);
+    if (!view)
     {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
+        enLog << "ERROR: Cannot read TEX file!\n";
+        return false;
+    }
+
+    // Compressed surface with padded rows is inflated to temporary buffer
+    std::vector<uint8> inflated;
+    const uint8* source = view->data();
+    if (surface.compression == Compression::Deflate)
+    {
+        uint8* target = destination;
+        if (rowPitch != rowSize)
         {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return nullptr;
+            inflated.resize(surface.size);
+            target = &inflated[0];
         }
+
+        uLongf size = static_cast<uLongf>(surface.size);
+        if (uncompress(target, &size, source, static_cast<uLong>(surface.storedSize)) != Z_OK ||
+            size != surface.size)
+        {
+            enLog << "ERROR: Cannot decompress TEX file surface, file corrupted!\n";
+            delete view;
+            return false;
+        }
+
+        source = target;
     }
- 
-    // Read file signature
-    Header_v1 header;
-    file->read(0, 20, &header);
-    if ( header.signature != 0x58455445 )
+
+    // Tightly packed surface is copied at once
+    if (rowPitch == rowSize)
     {
-        enLog << "ERROR: TEX file header signature is incorrect!\n";
-        delete file;
-        return nullptr;
+        if (source != destination)
+        {
+            memcpy(destination, source, surface.size);
+        }
     }
-    if ( header.version != 1 )
+    else
     {
-        enLog << "ERROR: TEX file header version is not supported!\n";
-        delete file;
-        return nullptr;
+        for(uint32 y=0; y<rows; ++y)
+        {
+            memcpy(destination + static_cast<uint64>(y) * rowPitch, source + static_cast<uint64>(y) * rowSize, rowSize);
+        }
     }
-    if ( header.filesize != file->size() )
+
+    delete view;
+    return true;
+}
+
+bool save(const std::string& filename,
+          const gpu::TextureState& settings,
+          const gpu::ColorSpace colorSpace,
+          const uint8* data,
+          const uint64 size,
+          const bool compress)
+{
+    using namespace en::storage;
+
+    assert( Storage );
+    assert( data );
+
+    // Location of each mip-map in source data
+    std::vector<uint64> source(settings.mipmaps);
+    uint64 expectedSize = 0;
+    uint32 count = 0;
+    for(uint32 i=0; i<settings.mipmaps; ++i)
     {
-        enLog << "ERROR: TEX file size mismatch!\n";
-        delete file;
-        return nullptr;
+        source[i] = expectedSize;
+        expectedSize += static_cast<uint64>(settings.surfaceSize(static_cast<uint8>(i))) * layersCount(settings, i);
+        count += layersCount(settings, i);
     }
-    assert( header.textures );
-  //assert( Gpu.screen.created() );
-
-    // Alllocate textures array
-    TextureHeader_v1* textures = new TextureHeader_v1[header.textures];
-    uint32 datasize = sizeof(TextureHeader_v1) * header.textures;
-    file->read(20, datasize, textures);
-    std::unique_ptr<gpu::Texture>* out = new std::unique_ptr<gpu::Texture>[header.textures];
-
-    // Process textures
-    for(uint32 i=0; i<header.textures; ++i)
-    {
-        // TODO: Add support for custom compressions (like zlib, RLE, etc.)
-        assert( textures[i].compression == 0 );
-
-        // Create texture in GPU 
-        TextureState settings(static_cast<TextureType>(textures[i].type),
-                              static_cast<Format>(textures[i].format),
-                             TextureUsage::Read,  // TODO: Fix it
-                             textures[i].width,
-                             textures[i].height,
-                             1, // TODO: Mipmaps count
-                             textures[i].layers,
-                             textures[i].samples);
-        out[i] = std::unique_ptr<Texture>(en::ResourcesContext.defaults.enHeapTextures->createTexture(settings));
-
-        // TODO: Add proper support for error reporting
-        assert( out[i] );
-
-        // Alllocate surfaces array
-        TextureSurfaceHeader_v1* surfaces = new TextureSurfaceHeader_v1[textures[i].surfaces];
-        uint32 datasize = sizeof(TextureSurfaceHeader_v1) * textures[i].surfaces;
-        file->read(textures[i].offset, datasize, surfaces);
-
-        // Load surfaces of texture (mipmaps, faces, layers)
-        for(uint16 j=0; j<textures[i].surfaces; ++j)
+
+    if (settings.mipmaps == 0 ||
+        expectedSize != size)
+    {
+        enLog << std::string("Size of texture data doesn't match its description, when writing " + filename + "!");
+        return false;
+    }
+
+    File* file = Storage->open(filename, Write);
+    if (!file)
+    {
+        enLog << std::string("Cannot create TEX file " + filename + "!");
+        return false;
+    }
+
+    Header_v1 header;
+    memset(&header, 0, sizeof(Header_v1));
+    header.signature = Signature;
+    header.version   = Version;
+    header.textures  = 1;
+
+    TextureHeader_v1 texture;
+    memset(&texture, 0, sizeof(TextureHeader_v1));
+    texture.offset     = sizeof(Header_v1) + sizeof(TextureHeader_v1);
+    texture.type       = underlyingType(settings.type);
+    texture.format     = underlyingType(settings.format);
+    texture.width      = settings.width;
+    texture.height     = settings.height;
+    texture.layers     = settings.layers;
+    texture.mipmaps    = settings.mipmaps;
+    texture.samples    = settings.samples;
+    texture.colorSpace = static_cast<uint16>(colorSpace);
+    texture.usage      = underlyingType(settings.usage);
+    texture.surfaces   = count;
+
+    std::vector<TextureSurfaceHeader_v1> surfaces(count);
+    memset(&surfaces[0], 0, count * sizeof(TextureSurfaceHeader_v1));
+
+    // Space for headers and surfaces table is reserved, as they are written
+    // once location of all payloads is known. All writes specify offset, as
+    // not every platform appends sequential writes.
+    uint64 tableSize = texture.offset + count * sizeof(TextureSurfaceHeader_v1);
+    uint64 offset    = roundUp(tableSize, static_cast<uint64>(SurfaceAlignment));
+
+    std::vector<uint8> padding(SurfaceAlignment, 0);
+    bool result = true;
+    for(uint64 written=0; result && written<offset; written+=SurfaceAlignment)
+    {
+        result = file->write(written, SurfaceAlignment, &padding[0]);
+    }
+
+    // Smallest mip-maps are stored first, so that texture can be streamed in
+    // by reading file front to back
+    std::vector<uint8> compressed;
+    uint32 index = 0;
+    for(sint32 mipmap=settings.mipmaps-1; result && mipmap>=0; --mipmap)
+    {
+        uint32 surfaceSize = settings.surfaceSize(static_cast<uint8>(mipmap));
+        uint32 layers = layersCount(settings, mipmap);
+        for(uint32 layer=0; result && layer<layers; ++layer)
         {
-            // Create staging buffer
-            std::unique_ptr<gpu::Buffer> staging(en::ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, (uint32)surfaces[j].size));
-            if (!staging)
+            TextureSurfaceHeader_v1& current = surfaces[index++];
+            current.offset      = offset;
+            current.storedSize  = surfaceSize;
+            current.size        = surfaceSize;
+            current.mipmap      = static_cast<uint16>(mipmap);
+            current.layer       = static_cast<uint16>(layer);
+            current.compression = Compression::None;
+
+            const uint8* payload = data + source[mipmap] + static_cast<uint64>(layer) * surfaceSize;
+
+            // Compressed surface is stored only if it saves at least 10% of space
+            if (compress)
             {
-                enLog << "ERROR: Cannot create staging buffer!\n";
-                delete file;
-                return nullptr;
+                uLongf compressedSize = compressBound(static_cast<uLong>(surfaceSize));
+                compressed.resize(static_cast<size_t>(compressedSize));
+                if (compress2(&compressed[0], &compressedSize, payload, static_cast<uLong>(surfaceSize), Z_BEST_COMPRESSION) == Z_OK &&
+                    compressedSize * 10 < static_cast<uint64>(surfaceSize) * 9)
+                {
+                    current.storedSize  = compressedSize;
+                    current.compression = Compression::Deflate;
+                    payload = &compressed[0];
+                }
             }
 
-            // Read texture to temporary buffer
-            volatile void* ptr = staging->map();
-            file->read(surfaces[j].offset, (uint32)surfaces[j].size, ptr);
-            staging->unmap();
- 
-            // TODO: In future distribute transfers to different queues in the same queue type family
-            gpu::QueueType type = gpu::QueueType::Universal;
-            if (Graphics->primaryDevice()->queues(gpu::QueueType::Transfer) > 0u)
+            result = file->write(offset, current.storedSize, const_cast<uint8*>(payload));
+
+            // Each payload starts at page boundary, so it can be mapped
+            uint64 aligned = roundUp(offset + current.storedSize, static_cast<uint64>(SurfaceAlignment));
+            if (result && aligned > offset + current.storedSize)
             {
-                type = gpu::QueueType::Transfer;
+                result = file->write(offset + current.storedSize, aligned - (offset + current.storedSize), &padding[0]);
             }
 
-            // Copy data from staging buffer to final texture
-            std::shared_ptr<gpu::CommandBuffer> command = Graphics->primaryDevice()->createCommandBuffer(type);
-            command->start();
-            command->copy(*staging, 0u, settings.rowSize(surfaces[j].mipmap), *out[i], surfaces[j].mipmap, surfaces[j].layer);
-            command->commit();
-         
-            // TODO:
-            // here return completion handler callback !!! (no waiting for completion)
-            // - this callback destroys CommandBuffer object
-            // - destroys staging buffer
-            //
-            // Till it's done, wait for completion:
-         
-            command->waitUntilCompleted();
-            command = nullptr;
-            staging = nullptr;
+            offset = aligned;
         }
+    }
+
+    header.filesize = offset;
+    if (result)
+    {
+        result = file->write(0, sizeof(Header_v1), &header) &&
+                 file->write(sizeof(Header_v1), sizeof(TextureHeader_v1), &texture) &&
+                 file->write(texture.offset, count * sizeof(TextureSurfaceHeader_v1), &surfaces[0]);
+    }
 
-        delete [] surfaces;
+    delete file;
+
+    if (!result)
+    {
+        enLog << std::string("Error when writing TEX file " + filename + "!");
     }
 
-    delete [] textures;
+    return result;
+}
+
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
+
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
+
+    Content content;
+    bool success = readHeader(file, content);
+    delete file;
+
+    if (success)
+    {
+        settings   = content.settings;
+        colorSpace = content.colorSpace;
+    }
+
+    return success;
+}
+
+bool load(const std::string& filename,
+          const uint32 mipmap,
+          const uint32 layer,
+          uint8* const destination,
+          const gpu::ImageMemoryAlignment alignment)
+{
+    using namespace en::storage;
+
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
+
+    Content content;
+    bool success = readHeader(file, content);
+    if (success)
+    {
+        const TextureSurfaceHeader_v1* surface = findSurface(content, mipmap, layer);
+        if (!surface)
+        {
+            enLog << "ERROR: TEX file doesn't contain requested surface!\n";
+            success = false;
+        }
+        else
+        {
+            success = readSurface(content, *surface, destination, alignment);
+        }
+    }
 
-    // TODO: Add support for more than one texture
     delete file;
-    return out;
+    return success;
 }
 
 } // en::tex
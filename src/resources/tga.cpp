@@ -11,11 +11,12 @@
 
 #include "core/storage.h"
 #include "core/log/log.h"
-#include "core/rendering/device.h"
+#include "core/memory/alignedAllocator.h"
 #include "utilities/utilities.h"
-#include "resources/context.h"
 #include "resources/tga.h"    
 
+#include <string.h>
+
 #define PageSize 4096
 
 namespace en
@@ -61,7 +62,7 @@ struct Header
 alignToDefault
 
 // Reads first 4KB page of TGA file, and decodes it's header to TextureState and ColorSpace.
-bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+bool readMetadata(const uint8* buffer, const uint32 readSize, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
 {
     // Check if file has minimum required size
     uint32 minimumFileSize = sizeof(Header);
@@ -72,7 +73,7 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     }
 
     // Read file header
-    Header& header = *reinterpret_cast<Header*>(buffer);
+    const Header& header = *reinterpret_cast<const Header*>(buffer);
 
     // Check for supported image format
     if (header.format != RGB &&
@@ -121,144 +122,190 @@ bool readMetadata(uint8* buffer, const uint32 readSize, gpu::TextureState& setti
     return true;
 }
 
-bool load(
-    const std::string& filename,
-    uint8* const destination,
-    const uint32 width,
-    const uint32 height,
-    const gpu::Format format,
-    const gpu::ImageMemoryAlignment alignment,
-    const bool invertHorizontal)
+storage::File* open(const std::string& filename)
 {
     using namespace en::storage;
-    using namespace en::gpu;
 
     // Open file 
     File* file = Storage->open(filename);
     if (!file)
     {
-        file = Storage->open(en::ResourcesContext.path.textures + filename);
-        if (!file)
-        {
-            enLog << en::ResourcesContext.path.textures + filename << std::endl;
-            enLog << "ERROR: There is no such file!\n";
-            return false;
-        }
+        enLog << filename << std::endl;
+        enLog << "ERROR: There is no such file!\n";
+        return nullptr;
     }
 
+    return file;
+}
 
-    // ### Read file metadata
+bool readMetadata(const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    using namespace en::storage;
 
+    File* file = open(filename);
+    if (!file)
+    {
+        return false;
+    }
 
     // Read file first 4KB into single 4KB memory page
-    uint32 readSize = min(file->size(), PageSize);
+    uint32 readSize = static_cast<uint32>(min(file->size(), uint64(PageSize)));
     uint8* buffer = allocate<uint8>(readSize, PageSize);
     file->read(0, readSize, buffer);
+    delete file;
 
-    // Read file properties
-    TextureState settings;
-    ColorSpace colorSpace; // TODO: Determine file Color Space and compare with expected
     bool success = readMetadata(buffer, readSize, settings, colorSpace);
 
     // Free temporary 4KB memory page
     deallocate<uint8>(buffer);
+    return success;
+}
 
-    if (!success)
+bool load(
+    const std::string& filename,
+    uint8* const destination,
+    const uint32 width,
+    const uint32 height,
+    const gpu::Format format,
+    const gpu::ImageMemoryAlignment alignment,
+    const bool invertHorizontal)
+{
+    using namespace en::storage;
+    using namespace en::gpu;
+
+    File* file = open(filename);
+    if (!file)
     {
-        delete file;
         return false;
     }
 
-    // Verify that file matches expected properties
-    if ((settings.width  != width) ||
-        (settings.height != height) ||
-        (settings.format != format))
+    // Map whole file to memory, so that its content is decoded directly
+    // from OS page cache (without copying it first).
+    uint64 fileSize = file->size();
+    FileView* view = file->map(0u, fileSize, MapHint::Sequential);
+    if (!view)
     {
+        enLog << "ERROR: Couldn't read file to memory.\n";
         delete file;
         return false;
     }
 
+    const uint8* content = view->data();
 
-    // ### Read file to memory
 
+    // ### Read file metadata
 
-    // Read whole file at once to memory. 
-    // Size aligned to multiple of 4KB Page Size, and allocated at such boundary (can be memory mapped).
-    uint64 fileSize = file->size();
-    uint64 roundedSize = roundUp(fileSize, PageSize);
-    uint8* content = allocate<uint8>(roundedSize, PageSize);
-    if (!file->read(content))
+
+    // Read file properties
+    TextureState settings;
+    ColorSpace colorSpace; // TODO: Determine file Color Space and compare with expected
+    uint32 readSize = static_cast<uint32>(min(fileSize, uint64(PageSize)));
+    if (!readMetadata(content, readSize, settings, colorSpace))
     {
-        enLog << "ERROR: Couldn't read file to memory.\n";
-        deallocate<uint8>(content);
+        delete view;
         delete file;
         return false;
     }
 
-    // Release file handle and work on copy in memory
-    delete file;
+    // Verify that file matches expected properties
+    const Header& header = *reinterpret_cast<const Header*>(content);
+    uint32 texelSize = header.bpp / 8;
+    if ((sizeof(Header) + header.idSize > fileSize) ||
+        (settings.width  != width) ||
+        (settings.height != height) ||
+        (settings.format != format) ||
+        (alignment.texelPitch() != texelSize))
+    {
+        delete view;
+        delete file;
+        return false;
+    }
 
 
     // ### Parse and decompress file 
 
 
-    // Calculate size of raw data to read
-    Header& header = *reinterpret_cast<Header*>(content);
-    uint32 srcOffset = sizeof(Header) + header.idSize;
-    uint32 dataSize  = settings.surfaceSize(0);
+    // Rows are stored from bottom to top, unless origin is in upper-left corner
+    const uint8* src = content + sizeof(Header) + header.idSize;
+    const uint8* end = content + fileSize;
+    uint32 rowSize   = width * texelSize;
+    uint32 rowPitch  = alignment.rowPitch(width);
+    bool   topDown   = header.origin != invertHorizontal;
 
-    // Copy data
+    bool success = true;
     if (header.format == RGB)
     {
-        memcpy(destination, content + srcOffset, dataSize);
+        // Copy data
+        if (static_cast<uint64>(end - src) < static_cast<uint64>(rowSize) * height)
+        {
+            success = false;
+        }
+        else
+        {
+            for(uint32 y=0; y<height; ++y)
+            {
+                uint32 row = topDown ? y : height - y - 1;
+                memcpy(destination + static_cast<uint64>(row) * rowPitch, src + static_cast<uint64>(y) * rowSize, rowSize);
+            }
+        }
     }
     else // Decompress data
     if (header.format == RGB_RLE)
     {
-        uint8  counter;
-        uint32 dstOffset = 0;
-        uint8  texelSize = header.bpp / 8;
-        uint8* texel = new uint8[texelSize];
-
-        while (dstOffset < dataSize)
+        // Packets can span several rows
+        uint32 remaining = 0;
+        bool   repeat    = false;
+        const uint8* texel = nullptr;
+        for(uint32 y=0; y<height && success; ++y)
         {
-            // Read RLE header
-            counter = *reinterpret_cast<uint8*>(content + srcOffset);
-            srcOffset++;
-
-            // Run-length packet
-            if (counter & 0x80)
+            uint32 row = topDown ? y : height - y - 1;
+            uint8* dst = destination + static_cast<uint64>(row) * rowPitch;
+            for(uint32 x=0; x<width; ++x)
             {
-                counter -= 127;
-                memcpy(texel, content + srcOffset, texelSize);
-                srcOffset += texelSize;
-
-                // Repeat given texel N times
-                for(uint8 i=0; i<counter; ++i)
+                // Read RLE header
+                if (remaining == 0)
                 {
-                    memcpy(destination + dstOffset, texel, texelSize);
-                    dstOffset += texelSize;
+                    if (src == end)
+                    {
+                        success = false;
+                        break;
+                    }
+
+                    uint8 counter = *src++;
+                    remaining = (counter & 0x7F) + 1;
+                    repeat    = (counter & 0x80) != 0;
+
+                    // Run-length packet stores single texel repeated N times
+                    uint32 packetSize = repeat ? texelSize : remaining * texelSize;
+                    if (static_cast<uint32>(end - src) < packetSize)
+                    {
+                        success = false;
+                        break;
+                    }
+
+                    texel = src;
+                    src  += packetSize;
                 }
-            }
-            // Non-run-length packet
-            else
-            {
-                counter++;
-                for(uint8 i=0; i<counter; ++i)
+
+                memcpy(dst + x * texelSize, texel, texelSize);
+                if (!repeat)
                 {
-                    memcpy(destination + dstOffset, content + srcOffset, texelSize);
-                    dstOffset += texelSize;
-                    srcOffset += texelSize;
+                    texel += texelSize;
                 }
+
+                remaining--;
             }
         }
+    }
 
-        delete[] texel;
+    if (!success)
+    {
+        enLog << "ERROR: TGA file is corrupted.\n";
     }
 
-    // Release temporary data
-    deallocate<uint8>(content);
-    return true;
+    delete view;
+    delete file;
+    return success;
 }
 
 } // en::tga
@@ -0,0 +1,308 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Textures upload.
+ Requirements: none
+ Description : Creates textures on primary GPU device and uploads to
+               them images decoded by image loaders (through staging
+               buffers). Image decoders don't depend on GPU device nor
+               on Resources Manager, so that they can be used by tools
+               as well. Filenames passed here are searched for in
+               textures directory, if there is no such file at given
+               path.
+
+*/
+
+#include "core/storage.h"
+#include "core/log/log.h"
+#include "core/rendering/device.h"
+#include "utilities/utilities.h"
+#include "resources/context.h"
+#include "resources/hdr.h"
+#include "resources/exr.h"
+#include "resources/dds.h"
+#include "resources/tex.h"
+
+#include <string>
+
+namespace en
+{
+namespace resources
+{
+
+// Image decoding functions (see hdr::readMetadata and hdr::load)
+typedef bool (*ImageMetadataFunction)(const std::string& filename,
+                                      gpu::TextureState& settings,
+                                      gpu::ColorSpace& colorSpace);
+
+typedef bool (*ImageDecodeFunction)(const std::string& filename,
+                                    uint8* const destination,
+                                    const uint32 width,
+                                    const uint32 height,
+                                    const gpu::Format format,
+                                    const gpu::ImageMemoryAlignment alignment,
+                                    const bool invertHorizontal);
+
+// Surface reading function (see dds::load and tex::load)
+typedef bool (*SurfaceDecodeFunction)(const std::string& filename,
+                                      const uint32 mipmap,
+                                      const uint32 layer,
+                                      uint8* const destination,
+                                      const gpu::ImageMemoryAlignment alignment);
+
+static std::string texturePath(const std::string& filename)
+{
+    if (Storage->exist(filename))
+    {
+        return filename;
+    }
+
+    return ResourcesContext.path.textures + filename;
+}
+
+// Count of surfaces in given mip-map (3D textures have less depth slices in
+// each next mip-map)
+static uint32 surfacesCount(const gpu::TextureState& settings, const uint32 mipmap)
+{
+    return settings.type == gpu::TextureType::Texture3D ? settings.mipDepth(static_cast<uint8>(mipmap)) : settings.layers;
+}
+
+static gpu::QueueType transferQueue(gpu::GpuDevice& device)
+{
+    // TODO: In future distribute transfers to different queues in the same queue type family
+    gpu::QueueType type = gpu::QueueType::Universal;
+    if (device.queues(gpu::QueueType::Transfer) > 0u)
+    {
+        type = gpu::QueueType::Transfer;
+    }
+
+    return type;
+}
+
+// Creates texture matching image stored in file, decodes that image directly
+// to staging buffer (in layout required by device), and uploads it to texture.
+static std::shared_ptr<gpu::Texture> uploadImage(const std::string& filename,
+                                                 ImageMetadataFunction metadata,
+                                                 ImageDecodeFunction decode,
+                                                 const bool invertHorizontal)
+{
+    using namespace en::gpu;
+
+    std::string path = texturePath(filename);
+
+    TextureState settings;
+    ColorSpace colorSpace = ColorSpaceLinear;
+    if (!metadata(path, settings, colorSpace))
+    {
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    // Create texture in GPU
+    std::shared_ptr<gpu::Texture> texture(ResourcesContext.defaults.enHeapTextures->createTexture(settings));
+    if (!texture)
+    {
+        enLog << "ERROR: Cannot create texture in GPU!\n";
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    // Create staging buffer, with layout required by device
+    std::shared_ptr<GpuDevice> device = Graphics->primaryDevice();
+    ImageMemoryAlignment alignment = device->textureMemoryAlignment(settings, 0u, 0u);
+    std::unique_ptr<gpu::Buffer> staging(ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, alignment.surfaceSize(settings.width, settings.height)));
+    if (!staging)
+    {
+        enLog << "ERROR: Cannot create staging buffer!\n";
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    // Decode image directly to staging buffer
+    uint8* destination = reinterpret_cast<uint8*>(const_cast<void*>(staging->map()));
+    bool success = decode(path, destination, settings.width, settings.height, settings.format, alignment, invertHorizontal);
+    staging->unmap();
+    if (!success)
+    {
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    // Copy data from staging buffer to final texture
+    std::shared_ptr<gpu::CommandBuffer> command = device->createCommandBuffer(transferQueue(*device));
+    command->start();
+    command->copy(*staging, 0u, alignment.rowPitch(settings.width), *texture, 0u, 0u);
+    command->commit();
+
+    // TODO:
+    // here return completion handler callback !!! (no waiting for completion)
+    // - this callback destroys CommandBuffer object
+    // - destroys staging buffer
+    //
+    // Till it's done, wait for completion:
+
+    command->waitUntilCompleted();
+    return texture;
+}
+
+// Reads all surfaces of given mip-map directly to staging buffers (in layout
+// required by device), and uploads them to texture.
+static bool uploadMipmap(const std::string& path,
+                         const gpu::TextureState& settings,
+                         SurfaceDecodeFunction decode,
+                         gpu::Texture& texture,
+                         const uint32 mipmap)
+{
+    using namespace en::gpu;
+
+    std::shared_ptr<GpuDevice> device = Graphics->primaryDevice();
+    gpu::QueueType queueType = transferQueue(*device);
+
+    uint8  level = static_cast<uint8>(mipmap);
+    uint32 count = surfacesCount(settings, mipmap);
+    for(uint32 layer=0; layer<count; ++layer)
+    {
+        // Create staging buffer, with layout required by device
+        ImageMemoryAlignment alignment = device->textureMemoryAlignment(settings, mipmap, layer);
+        uint32 rowPitch = roundUp(settings.rowSize(level), alignment.rowAlignment());
+        std::unique_ptr<gpu::Buffer> staging(ResourcesContext.defaults.enStagingHeap->createBuffer(gpu::BufferType::Transfer, rowPitch * settings.rowsCount(level)));
+        if (!staging)
+        {
+            enLog << "ERROR: Cannot create staging buffer!\n";
+            return false;
+        }
+
+        // Read surface directly to staging buffer
+        uint8* destination = reinterpret_cast<uint8*>(const_cast<void*>(staging->map()));
+        bool success = decode(path, mipmap, layer, destination, alignment);
+        staging->unmap();
+        if (!success)
+        {
+            return false;
+        }
+
+        // Copy data from staging buffer to final texture
+        std::shared_ptr<gpu::CommandBuffer> command = device->createCommandBuffer(queueType);
+        command->start();
+        command->copy(*staging, 0u, rowPitch, texture, mipmap, layer);
+        command->commit();
+
+        // TODO:
+        // here return completion handler callback !!! (no waiting for completion)
+        // - this callback destroys CommandBuffer object
+        // - destroys staging buffer
+        //
+        // Till it's done, wait for completion:
+
+        command->waitUntilCompleted();
+    }
+
+    return true;
+}
+
+// Creates texture matching one stored in file, and uploads all its surfaces.
+// Mip-maps are uploaded from the largest or from the smallest one.
+static std::shared_ptr<gpu::Texture> uploadTexture(const std::string& filename,
+                                                   ImageMetadataFunction metadata,
+                                                   SurfaceDecodeFunction decode,
+                                                   const bool smallestFirst)
+{
+    using namespace en::gpu;
+
+    std::string path = texturePath(filename);
+
+    TextureState settings;
+    ColorSpace colorSpace = ColorSpaceLinear;
+    if (!metadata(path, settings, colorSpace))
+    {
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    // Create texture in GPU
+    std::shared_ptr<gpu::Texture> texture(ResourcesContext.defaults.enHeapTextures->createTexture(settings));
+    if (!texture)
+    {
+        enLog << "ERROR: Cannot create texture in GPU!\n";
+        return std::shared_ptr<gpu::Texture>(nullptr);
+    }
+
+    for(uint32 i=0; i<settings.mipmaps; ++i)
+    {
+        uint32 mipmap = smallestFirst ? settings.mipmaps - 1u - i : i;
+        if (!uploadMipmap(path, settings, decode, *texture, mipmap))
+        {
+            return std::shared_ptr<gpu::Texture>(nullptr);
+        }
+    }
+
+    return texture;
+}
+
+} // en::resources
+
+namespace hdr
+{
+
+std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
+{
+    return resources::uploadImage(filename, readMetadata, load, true);
+}
+
+} // en::hdr
+
+namespace exr
+{
+
+std::shared_ptr<en::gpu::Texture> load(const std::string& filename)
+{
+    return resources::uploadImage(filename, readMetadata, load, true);
+}
+
+} // en::exr
+
+namespace dds
+{
+
+std::shared_ptr<gpu::Texture> load(const std::string& filename)
+{
+    return resources::uploadTexture(filename, readMetadata, load, false);
+}
+
+} // en::dds
+
+namespace tex
+{
+
+bool upload(const std::string& filename, gpu::Texture& texture, const uint32 mipmap)
+{
+    using namespace en::gpu;
+
+    std::string path = resources::texturePath(filename);
+
+    TextureState settings;
+    ColorSpace colorSpace = ColorSpaceLinear;
+    if (!readMetadata(path, settings, colorSpace))
+    {
+        return false;
+    }
+
+    uint8 level = static_cast<uint8>(mipmap);
+    if (mipmap >= settings.mipmaps ||
+        mipmap >= texture.mipmaps() ||
+        texture.format() != settings.format ||
+        texture.width(level)  != settings.mipWidth(level) ||
+        texture.height(level) != settings.mipHeight(level) ||
+        texture.layers() != settings.layers)
+    {
+        enLog << "ERROR: TEX file mip-map doesn't match destination texture!\n";
+        return false;
+    }
+
+    return resources::uploadMipmap(path, settings, load, texture, mipmap);
+}
+
+std::shared_ptr<gpu::Texture> load(const std::string& filename)
+{
+    // Mip-maps are uploaded in file order
+    return resources::uploadTexture(filename, readMetadata, load, true);
+}
+
+} // en::tex
+} // en
@@ -14,17 +14,71 @@
 #include "utilities/strings.h"
 #include "assert.h"
 
+#include "core/utilities/parser.h"
+
 #if defined(EN_PLATFORM_ANDROID)
 #define sprintf_s sprintf
 #endif
 
-#if defined(EN_PLATFORM_OSX)
+#if defined(EN_PLATFORM_OSX) || defined(EN_PLATFORM_LINUX)
 #define sprintf_s snprintf
 #endif
 
 namespace en
 {
 
+// Skips leading whitespace, as stream extraction did
+template<typename type>
+static type parseString(const std::string& in)
+{
+    const char* text = in.c_str();
+    const char* end  = text + in.size();
+    while(text < end && isWhitespace(*text))
+    {
+        text++;
+    }
+
+    type value;
+    parseNumber(text, end, value);
+    return value;
+}
+
+template<>
+uint32 stringTo<uint32>(const std::string& in)
+{
+    return parseString<uint32>(in);
+}
+
+template<>
+uint64 stringTo<uint64>(const std::string& in)
+{
+    return parseString<uint64>(in);
+}
+
+template<>
+sint32 stringTo<sint32>(const std::string& in)
+{
+    return parseString<sint32>(in);
+}
+
+template<>
+sint64 stringTo<sint64>(const std::string& in)
+{
+    return parseString<sint64>(in);
+}
+
+template<>
+float stringTo<float>(const std::string& in)
+{
+    return parseString<float>(in);
+}
+
+template<>
+double stringTo<double>(const std::string& in)
+{
+    return parseString<double>(in);
+}
+
 std::string stringFrom(uint8 in)
 {
     char buffer[8];
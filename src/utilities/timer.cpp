@@ -28,6 +28,11 @@
 static mach_timebase_info_data_t timebase = { 0, 0 };
 #endif
 
+#if defined(EN_PLATFORM_LINUX)
+#include <time.h>
+#include <errno.h>
+#endif
+
 #if defined(EN_PLATFORM_WINDOWS)
 // More about High-Resolution Time Stamps:
 // https://msdn.microsoft.com/en-us/library/windows/desktop/dn553408(v=vs.85).aspx
@@ -215,7 +220,7 @@ Time currentTime(void)
 {
     Time current;
 
-#if defined(EN_PLATFORM_ANDROID)
+#if defined(EN_PLATFORM_ANDROID) || defined(EN_PLATFORM_LINUX)
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
     current.nanoseconds( (static_cast<uint64>(now.tv_sec) * 1000000000LL) + static_cast<uint64>(now.tv_nsec) );
@@ -251,6 +256,15 @@ void sleepFor(Time time)
     }
     uint64 machAbsoluteTime = mach_absolute_time() + (time.nanoseconds() * timebase.denom) / timebase.numer;
     mach_wait_until(machAbsoluteTime);
+#elif defined(EN_PLATFORM_LINUX)
+    struct timespec interval;
+    interval.tv_sec  = static_cast<time_t>(time.nanoseconds() / 1000000000);
+    interval.tv_nsec = static_cast<long>(time.nanoseconds() % 1000000000);
+
+    // Resume sleeping for remaining time if interrupted by signal
+    while(clock_nanosleep(CLOCK_MONOTONIC, 0, &interval, &interval) == EINTR)
+    {
+    }
 #else
     // TODO: Windows
     assert( 0 );
@@ -266,6 +280,15 @@ void sleepUntil(Time time)
     }
     uint64 machAbsoluteTime = (time.nanoseconds() * timebase.denom) / timebase.numer;
     mach_wait_until(machAbsoluteTime);
+#elif defined(EN_PLATFORM_LINUX)
+    // Absolute time is expressed in CLOCK_MONOTONIC domain, as in currentTime()
+    struct timespec deadline;
+    deadline.tv_sec  = static_cast<time_t>(time.nanoseconds() / 1000000000);
+    deadline.tv_nsec = static_cast<long>(time.nanoseconds() % 1000000000);
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+    {
+    }
 #else
     // TODO: Windows 
 
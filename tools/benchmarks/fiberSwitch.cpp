@@ -0,0 +1,121 @@
+/*
+
+ Ngine v5.0
+ 
+ Module      : Fiber context switch benchmark.
+ Requirements: none
+ Description : Measures cost of switching between two fibers using engine
+               Fiber API, and compares it with raw getcontext/swapcontext
+               ping-pong (which saves and restores signal mask on each
+               switch, and thus enters the kernel).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -Ipublic/include -Isrc
+                   tools/benchmarks/fiberSwitch.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/utilities/timer.cpp -o fiberSwitch
+
+               Define EN_FIBER_UCONTEXT to benchmark ucontext path of
+               engine Fiber API instead of assembly one.
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/parallel/fiber.h"
+#include "utilities/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+using namespace en;
+
+constexpr uint32 Iterations = 10000000;
+constexpr uint32 StackSize  = 64 * 1024;
+
+// Engine Fiber API
+
+struct PingPong
+{
+    Fiber* main;
+    Fiber* worker;
+};
+
+void pingPongFiber(void* data)
+{
+    PingPong& state = *reinterpret_cast<PingPong*>(data);
+    for(;;)
+    {
+        switchToFiber(*state.worker, *state.main);
+    }
+}
+
+double benchmarkFiberAPI(void)
+{
+    PingPong state;
+    state.main   = convertToFiber(StackSize, StackSize);
+    state.worker = createFiber(pingPongFiber, &state, StackSize, StackSize);
+
+    // Warm up (first switch enters fiber function)
+    switchToFiber(*state.main, *state.worker);
+
+    Time start = currentTime();
+    for(uint32 i = 0; i < Iterations; ++i)
+    {
+        switchToFiber(*state.main, *state.worker);
+    }
+    Time end = currentTime();
+
+    // Worker fiber is never finished, it is just abandoned
+    return (double)(end - start).nanoseconds() / (double)(Iterations * 2);
+}
+
+// Raw ucontext
+
+ucontext_t contextMain;
+ucontext_t contextWorker;
+
+void pingPongContext(void)
+{
+    for(;;)
+    {
+        swapcontext(&contextWorker, &contextMain);
+    }
+}
+
+double benchmarkUContext(void)
+{
+    void* stack = malloc(StackSize);
+
+    getcontext(&contextWorker);
+    contextWorker.uc_stack.ss_sp   = stack;
+    contextWorker.uc_stack.ss_size = StackSize;
+    contextWorker.uc_link          = nullptr;
+    makecontext(&contextWorker, pingPongContext, 0);
+
+    swapcontext(&contextMain, &contextWorker);
+
+    Time start = currentTime();
+    for(uint32 i = 0; i < Iterations; ++i)
+    {
+        swapcontext(&contextMain, &contextWorker);
+    }
+    Time end = currentTime();
+
+    free(stack);
+    return (double)(end - start).nanoseconds() / (double)(Iterations * 2);
+}
+
+int main(int argc, char* argv[])
+{
+    double fiberTime   = benchmarkFiberAPI();
+    double contextTime = benchmarkUContext();
+
+    printf("Switches per measurement: %u\n", Iterations * 2);
+    printf("en::switchToFiber     : %8.2f ns per switch\n", fiberTime);
+    printf("swapcontext           : %8.2f ns per switch\n", contextTime);
+    printf("Speedup               : %8.2fx\n", contextTime / fiberTime);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Mesh optimization benchmark.
+ Requirements: none
+ Description : Generates regular grid mesh with given count of quads per
+               side (defaults to 1000), shuffles its triangles, and then
+               optimizes it with:
+
+               - Forsyth      : triangles order for Post-Transform Vertex
+                                Cache
+               - Overdraw     : clusters order, to draw outward facing
+                                triangles first
+               - Vertex fetch : vertices order, matching order of first use
+
+               Reports time of each step, and ACMR / ATVR of triangle list
+               after it, simulated with FIFO cache of 16 and 32 entries.
+               Verifies that optimized mesh still contains all triangles.
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/forsyth.cpp
+                   src/resources/forsyth.cpp
+                   src/utilities/gpcpu/gpcpu.cpp
+                   src/core/types/float2.cpp
+                   src/core/types/float3.cpp
+                   src/core/types/float3x3.cpp
+                   src/core/types/float4.cpp
+                   src/core/types/float4x4.cpp
+                   src/core/types/double3.cpp
+                   src/core/types/double4.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/timer.cpp -o forsyth
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "resources/forsyth.h"
+#include "utilities/timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+using namespace en;
+
+constexpr uint32 GridSize = 1000;
+
+// Triangles sorted by their vertices, to compare meshes
+std::vector<uint64> signature(const std::vector<uint32>& indexes, const std::vector<float3>& positions)
+{
+    std::vector<uint64> result(indexes.size() / 3);
+    for(uint32 i=0; i<result.size(); ++i)
+    {
+        // Positions are on integer grid
+        uint64 hash = 0;
+        for(uint32 j=0; j<3; ++j)
+        {
+            const float3& position = positions[indexes[i * 3 + j]];
+            hash = hash * 0x100000001B3ULL + static_cast<uint64>(position.x) * 65536 + static_cast<uint64>(position.y);
+        }
+        result[i] = hash;
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void print(const char* name, const std::vector<uint32>& indexes, const uint32 vertexes, const double seconds)
+{
+    Forsyth::Statistics small = Forsyth::analyze(indexes, vertexes, 16);
+    Forsyth::Statistics large = Forsyth::analyze(indexes, vertexes, 32);
+    printf("%-14s | %10.3f | %8.3f | %8.3f | %8.3f | %8.3f\n",
+        name,
+        seconds * 1000.0,
+        small.acmr,
+        small.atvr,
+        large.acmr,
+        large.atvr);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32 size = GridSize;
+    if (argc > 1)
+    {
+        size = static_cast<uint32>(std::max(atoi(argv[1]), 1));
+    }
+
+    // Generate grid
+    std::vector<float3> positions;
+    positions.reserve((size + 1) * (size + 1));
+    for(uint32 y=0; y<=size; ++y)
+    {
+        for(uint32 x=0; x<=size; ++x)
+        {
+            positions.push_back(float3(static_cast<float>(x), static_cast<float>(y), sinf(x * 0.1f) * cosf(y * 0.1f)));
+        }
+    }
+
+    std::vector<uint32> grid;
+    grid.reserve(size * size * 6);
+    for(uint32 y=0; y<size; ++y)
+    {
+        for(uint32 x=0; x<size; ++x)
+        {
+            uint32 a = y * (size + 1) + x;
+            uint32 b = a + 1;
+            uint32 c = a + size + 1;
+            uint32 d = c + 1;
+            grid.insert(grid.end(), { a, b, c, b, d, c });
+        }
+    }
+
+    // Shuffle triangles
+    uint32 faces = static_cast<uint32>(grid.size() / 3);
+    uint64 seed  = 0x2545F4914F6CDD1DULL;
+    for(uint32 i=faces-1; i>0; --i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        uint32 j = static_cast<uint32>(seed % (i + 1));
+        for(uint32 k=0; k<3; ++k)
+        {
+            std::swap(grid[i * 3 + k], grid[j * 3 + k]);
+        }
+    }
+
+    uint32 vertexes = static_cast<uint32>(positions.size());
+    std::vector<uint64> reference = signature(grid, positions);
+
+    printf("Grid: %u triangles, %u vertices\n\n", faces, vertexes);
+    printf("Step           | Time (ms)  | ACMR 16  | ATVR 16  | ACMR 32  | ATVR 32\n");
+    print("Shuffled", grid, vertexes, 0.0);
+
+    std::vector<uint32> indexes;
+    Time begin = currentTime();
+    Forsyth::optimize(grid, indexes, vertexes);
+    print("Forsyth", indexes, vertexes, (currentTime() - begin).seconds());
+
+    begin = currentTime();
+    Forsyth::optimizeOverdraw(indexes, positions);
+    print("Overdraw", indexes, vertexes, (currentTime() - begin).seconds());
+
+    begin = currentTime();
+    std::vector<uint32> remap;
+    vertexes = Forsyth::optimizeVertexFetch(indexes, remap, vertexes);
+    Forsyth::remapVertices(positions, remap, vertexes);
+    print("Vertex fetch", indexes, vertexes, (currentTime() - begin).seconds());
+
+    bool valid = signature(indexes, positions) == reference;
+    printf("\nResult: %s\n", valid ? "ok" : "MISMATCH");
+    return valid ? 0 : 1;
+}
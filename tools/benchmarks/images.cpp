@@ -0,0 +1,315 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Image decoders benchmark.
+ Requirements: none
+ Description : Measures decode throughput of PNG, TGA, BMP, HDR, EXR, DDS and
+               TEX images, decoded to system memory (without GPU device), from
+               all images found in given directory (and its subdirectories).
+               Format is selected by file extension. Each image is decoded
+               given count of times (defaults to 4), to tightly packed
+               buffer. Throughput is reported both in megabytes of decoded
+               texels per second, and in images per second.
+
+               Usage:
+               images <directory> [repeats]
+
+               Build on Linux (from repository root), decoders don't require
+               GPU device nor Resources Manager:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/images.cpp
+                   src/resources/png.cpp
+                   src/resources/tga.cpp
+                   src/resources/bmp.cpp
+                   src/resources/hdr.cpp
+                   src/resources/exr.cpp
+                   src/resources/dds.cpp
+                   src/resources/tex.cpp
+                   src/core/rendering/common/texture.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/utilities/parser.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/half.cpp
+                   src/core/types/float2.cpp
+                   src/core/types/float3.cpp
+                   src/core/types/double3.cpp
+                   src/core/types/uint16v2.cpp
+                   src/core/types/uint16v4.cpp
+                   src/core/types/uint32v2.cpp
+                   src/core/types/uint32v3.cpp
+                   src/core/types/uint32v4.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/timer.cpp -lpthread -lz -o images
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "core/storage.h"
+#include "core/rendering/texture.h"
+#include "resources/png.h"
+#include "resources/tga.h"
+#include "resources/bmp.h"
+#include "resources/hdr.h"
+#include "resources/exr.h"
+#include "resources/dds.h"
+#include "resources/tex.h"
+#include "utilities/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace en;
+
+namespace en
+{
+extern void initHalfs(void);
+}
+
+constexpr uint32 Repeats = 4;
+
+enum class ImageType : uint8
+{
+    PNG = 0,
+    TGA    ,
+    BMP    ,
+    HDR    ,
+    EXR    ,
+    DDS    ,
+    TEX    ,
+    Count
+};
+
+const char* ImageTypeName[underlyingType(ImageType::Count)] =
+{
+    "png",
+    "tga",
+    "bmp",
+    "hdr",
+    "exr",
+    "dds",
+    "tex"
+};
+
+struct Result
+{
+    uint64 images;   // Count of decoded images
+    uint64 failures; // Count of images that couldn't be decoded
+    uint64 bytes;    // Bytes of decoded texels
+    double seconds;
+};
+
+bool readMetadata(const ImageType type, const std::string& filename, gpu::TextureState& settings, gpu::ColorSpace& colorSpace)
+{
+    colorSpace = gpu::ColorSpaceLinear;
+    switch(type)
+    {
+        case ImageType::PNG: return png::readMetadata(filename, settings, colorSpace);
+        case ImageType::TGA: return tga::readMetadata(filename, settings, colorSpace);
+        case ImageType::BMP: return bmp::readMetadata(filename, settings, colorSpace);
+        case ImageType::HDR: return hdr::readMetadata(filename, settings, colorSpace);
+        case ImageType::EXR: return exr::readMetadata(filename, settings, colorSpace);
+        case ImageType::DDS: return dds::readMetadata(filename, settings, colorSpace);
+        case ImageType::TEX: return tex::readMetadata(filename, settings, colorSpace);
+        default:
+            break;
+    }
+
+    return false;
+}
+
+// Three channel formats are decoded tightly packed (they are padded only in GPU memory)
+uint32 decodedTexelSize(const gpu::Format format)
+{
+    switch(format)
+    {
+        case gpu::Format::RGB_8:
+        case gpu::Format::RGB_8_sRGB:
+        case gpu::Format::BGR_8:
+        case gpu::Format::BGR_8_sRGB:
+            return 3;
+        case gpu::Format::RGB_16_hf:
+            return 6;
+        case gpu::Format::RGB_32_f:
+        case gpu::Format::RGB_32_u:
+            return 12;
+        default:
+            break;
+    }
+
+    return gpu::texelSize(format);
+}
+
+// Decodes whole image (for DDS and TEX all its surfaces) to tightly packed buffer
+bool decode(const ImageType type, const std::string& filename, const gpu::TextureState& settings, std::vector<uint8>& buffer, uint64& bytes)
+{
+    gpu::ImageMemoryAlignment alignment = {};
+    alignment.sampleSize = decodedTexelSize(settings.format);
+
+    if (type == ImageType::DDS ||
+        type == ImageType::TEX)
+    {
+        for(uint32 mipmap=0; mipmap<settings.mipmaps; ++mipmap)
+        {
+            uint32 layers = settings.type == gpu::TextureType::Texture3D ? settings.mipDepth(mipmap) : settings.layers;
+            uint32 size   = settings.surfaceSize(mipmap);
+            buffer.resize(std::max(buffer.size(), static_cast<size_t>(size)));
+            for(uint32 layer=0; layer<layers; ++layer)
+            {
+                bool result = type == ImageType::DDS ? dds::load(filename, mipmap, layer, buffer.data(), alignment)
+                                                     : tex::load(filename, mipmap, layer, buffer.data(), alignment);
+                if (!result)
+                {
+                    return false;
+                }
+
+                bytes += size;
+            }
+        }
+
+        return true;
+    }
+
+    uint32 size = alignment.surfaceSize(settings.width, settings.height);
+    buffer.resize(std::max(buffer.size(), static_cast<size_t>(size)));
+
+    bool result = false;
+    switch(type)
+    {
+        case ImageType::PNG: result = png::load(filename, buffer.data(), settings.width, settings.height, settings.format, alignment); break;
+        case ImageType::TGA: result = tga::load(filename, buffer.data(), settings.width, settings.height, settings.format, alignment); break;
+        case ImageType::BMP: result = bmp::load(filename, buffer.data(), settings.width, settings.height, settings.format, alignment); break;
+        case ImageType::HDR: result = hdr::load(filename, buffer.data(), settings.width, settings.height, settings.format, alignment); break;
+        case ImageType::EXR: result = exr::load(filename, buffer.data(), settings.width, settings.height, settings.format, alignment); break;
+        default:
+            break;
+    }
+
+    if (result)
+    {
+        bytes += size;
+    }
+
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: images <directory> [repeats]\n");
+        return 1;
+    }
+
+    std::filesystem::path directory(argv[1]);
+    uint32 repeats = argc > 2 ? std::max(atoi(argv[2]), 1) : Repeats;
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        printf("%s is not a directory!\n", argv[1]);
+        return 1;
+    }
+
+    initHalfs();
+    parallel::init();
+    log::Interface::create();
+    storage::Interface::create();
+
+    // Gather corpus, grouped by image type
+    std::vector<std::string> corpus[underlyingType(ImageType::Count)];
+    for(const auto& item : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (!item.is_regular_file())
+        {
+            continue;
+        }
+
+        std::string extension = item.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+        for(uint32 i=0; i<underlyingType(ImageType::Count); ++i)
+        {
+            if (extension.size() == 4 && extension.compare(1, 3, ImageTypeName[i]) == 0)
+            {
+                corpus[i].push_back(item.path().string());
+            }
+        }
+    }
+
+    printf("Format | Images | Failed | MB decoded | MB/s       | Images/s\n");
+
+    std::vector<uint8> buffer;
+    for(uint32 i=0; i<underlyingType(ImageType::Count); ++i)
+    {
+        ImageType type = static_cast<ImageType>(i);
+        Result result = { 0, 0, 0, 0.0 };
+
+        std::sort(corpus[i].begin(), corpus[i].end());
+        for(const std::string& filename : corpus[i])
+        {
+            gpu::TextureState settings;
+            gpu::ColorSpace   colorSpace;
+            if (!readMetadata(type, filename, settings, colorSpace))
+            {
+                result.failures++;
+                continue;
+            }
+
+            // First decode warms up OS page cache and buffer, and is not measured
+            uint64 bytes = 0;
+            if (!decode(type, filename, settings, buffer, bytes))
+            {
+                result.failures++;
+                continue;
+            }
+
+            Time begin = currentTime();
+            for(uint32 j=0; j<repeats; ++j)
+            {
+                decode(type, filename, settings, buffer, result.bytes);
+            }
+
+            result.seconds += (currentTime() - begin).seconds();
+            result.images  += repeats;
+        }
+
+        if (corpus[i].empty())
+        {
+            continue;
+        }
+
+        double megabytes = static_cast<double>(result.bytes) / (1024.0 * 1024.0);
+        double seconds   = std::max(result.seconds, 0.000001);
+        printf("%-6s | %6llu | %6llu | %10.2f | %10.2f | %10.2f\n",
+            ImageTypeName[i],
+            static_cast<unsigned long long>(result.images / repeats),
+            static_cast<unsigned long long>(result.failures),
+            megabytes,
+            megabytes / seconds,
+            static_cast<double>(result.images) / seconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+
+ Ngine v5.0
+
+ Module      : MPSC queue contention benchmark.
+ Requirements: none
+ Description : Measures throughput of single consumer draining elements
+               pushed concurrently by 1 to 64 producer threads. Compares
+               lock-free intrusive MPSCQueue with previous scheduler
+               implementation, that serialized producers with Mutex around
+               WorkStealingDeque (consumer was stealing from it).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -Ipublic/include -Isrc
+                   tools/benchmarks/mpscQueue.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/timer.cpp -lpthread -o mpscQueue
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/parallel/mutex.h"
+#include "memory/mpscQueue.h"
+#include "memory/workStealingDeque.h"
+#include "utilities/timer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace en;
+
+constexpr uint32 ElementsPerProducer = 100000;
+constexpr uint32 MaxProducers        = 64;
+
+struct Node
+{
+    std::atomic<Node*> next;
+    uint64 value;
+};
+
+// Previous implementation of scheduler MPSC deque
+class MutexDeque
+{
+    Mutex                    lockPush;
+    WorkStealingDeque<Node*> container;
+
+    public:
+    MutexDeque() :
+        lockPush(),
+        container(ElementsPerProducer * MaxProducers, ElementsPerProducer * MaxProducers)
+    {
+        // Whole capacity is committed upfront, so that deque never grows
+        // during measurement.
+    }
+
+    void push(Node* node)
+    {
+        lockPush.lock();
+        container.push(node);
+        lockPush.unlock();
+    }
+
+    DequeResult take(Node*& node)
+    {
+        return container.steal(node);
+    }
+};
+
+// Returns elements per second consumed
+template<typename Queue>
+double benchmark(Queue& queue, std::vector<Node>& nodes, const uint32 producers)
+{
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+
+    for(uint32 p=0; p<producers; ++p)
+    {
+        threads.emplace_back([&queue, &nodes, &start, p]()
+        {
+            while(!start.load(std::memory_order_acquire))
+            {
+            }
+
+            Node* base = &nodes[p * ElementsPerProducer];
+            for(uint32 i=0; i<ElementsPerProducer; ++i)
+            {
+                queue.push(&base[i]);
+            }
+        });
+    }
+
+    uint64 expected = static_cast<uint64>(producers) * ElementsPerProducer;
+    uint64 received = 0;
+    uint64 checksum = 0;
+
+    Time begin = currentTime();
+    start.store(true, std::memory_order_release);
+
+    Node* node = nullptr;
+    while(received < expected)
+    {
+        if (queue.take(node) == DequeResult::Success)
+        {
+            checksum += node->value;
+            received++;
+        }
+    }
+
+    Time end = currentTime();
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Each element carries its own index
+    assert( checksum == expected * (expected - 1) / 2 );
+    (void)checksum;
+
+    return static_cast<double>(expected) / (end - begin).seconds();
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<Node> nodes(ElementsPerProducer * MaxProducers);
+    for(uint32 i=0; i<nodes.size(); ++i)
+    {
+        nodes[i].value = i;
+    }
+
+    printf("Producers | MPSCQueue (M/s) | Mutex + Deque (M/s)\n");
+    for(uint32 producers=1; producers<=MaxProducers; producers *= 2)
+    {
+        MPSCQueue<Node> lockFree;
+        MutexDeque      locked;
+
+        double lockFreeRate = benchmark(lockFree, nodes, producers);
+        double lockedRate   = benchmark(locked, nodes, producers);
+
+        printf("%9u | %15.2f | %19.2f\n", producers, lockFreeRate / 1000000.0, lockedRate / 1000000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Text parser benchmark.
+ Requirements: none
+ Description : Measures how many floats per second can be extracted from
+               large OBJ file (vertex positions, normals and texture
+               coordinates), through:
+
+               - Stream       : Parser::read() to std::string, followed by
+                                previous implementation of stringTo<float>(),
+                                allocating std::istringstream per number
+               - strtof       : Parser::read() to std::string, followed by
+                                C library conversion (for reference)
+               - parseNumber  : Parser::read() to std::string_view, followed
+                                by parseNumber<float>() (no allocations)
+
+               Results of all methods are compared with strtof(). Optional
+               argument specifies OBJ file to parse, otherwise text with
+               given count of vertices is generated (defaults to 1M).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/parser.cpp
+                   src/core/utilities/parser.cpp
+                   src/utilities/timer.cpp -o parser
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/utilities/parser.h"
+#include "utilities/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace en;
+
+constexpr uint32 Vertices = 1000000;
+
+// Previous implementation of stringTo<float>()
+float streamToFloat(const std::string& in)
+{
+    std::istringstream parser(in);
+    float out;
+    parser >> out;
+    return out;
+}
+
+// Generates text resembling OBJ model
+std::string generate(const uint32 vertices)
+{
+    std::string text;
+    text.reserve(static_cast<size_t>(vertices) * 96);
+
+    uint64 seed = 0x2545F4914F6CDD1DULL;
+    char   line[128];
+    for(uint32 i=0; i<vertices; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        sint32 x = static_cast<sint32>(seed & 0xFFFFF) - 0x80000;
+        sint32 y = static_cast<sint32>((seed >> 20) & 0xFFFFF) - 0x80000;
+        sint32 z = static_cast<sint32>((seed >> 40) & 0xFFFFF) - 0x80000;
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x / 65536.0, y / 65536.0, z / 65536.0);
+        text += line;
+        snprintf(line, sizeof(line), "vn %.4f %.4f %.4f\n", x / 524288.0, y / 524288.0, z / 524288.0);
+        text += line;
+        snprintf(line, sizeof(line), "vt %.5f %.5f\n", (x & 0xFFFF) / 65536.0, (y & 0xFFFF) / 65536.0);
+        text += line;
+    }
+
+    return text;
+}
+
+bool isAttribute(std::string_view command)
+{
+    return command == "v" || command == "vn" || command == "vt";
+}
+
+enum class Method : uint8
+{
+    Stream = 0,
+    Strtof    ,
+    ParseNumber
+};
+
+struct Result
+{
+    std::vector<float> values;
+    double seconds;
+
+    double throughput(void) const
+    {
+        return static_cast<double>(values.size()) / seconds / 1000000.0;
+    }
+};
+
+Result parse(std::string& text, const Method method)
+{
+    Result result;
+    result.values.reserve(text.size() / 8);
+
+    // Parser takes ownership of buffer
+    uint8* buffer = new uint8[text.size()];
+    memcpy(buffer, text.data(), text.size());
+    Parser parser(buffer, text.size());
+
+    std::string      command;
+    std::string      word;
+    std::string_view commandView;
+    std::string_view wordView;
+    bool eol = false;
+
+    Time begin = currentTime();
+    while(!parser.end())
+    {
+        if (method == Method::ParseNumber)
+        {
+            if (!parser.read(commandView, eol))
+            {
+                continue;
+            }
+
+            while(!eol && isAttribute(commandView) && parser.read(wordView, eol))
+            {
+                result.values.push_back(parseNumber<float>(wordView));
+            }
+        }
+        else
+        {
+            if (!parser.read(command, eol))
+            {
+                continue;
+            }
+
+            while(!eol && isAttribute(command) && parser.read(word, eol))
+            {
+                result.values.push_back(method == Method::Stream ? streamToFloat(word) : strtof(word.c_str(), nullptr));
+            }
+        }
+
+        parser.skipToNextLine();
+    }
+
+    result.seconds = (currentTime() - begin).seconds();
+    return result;
+}
+
+void print(const char* name, const Result& result, const Result& reference)
+{
+    uint64 mismatches = 0;
+    for(uint64 i=0; i<result.values.size() && i<reference.values.size(); ++i)
+    {
+        if (result.values[i] != reference.values[i])
+        {
+            mismatches++;
+        }
+    }
+
+    if (result.values.size() != reference.values.size())
+    {
+        mismatches++;
+    }
+
+    printf("%-14s | %12.2f | %12llu | %s\n",
+        name,
+        result.throughput(),
+        static_cast<unsigned long long>(result.values.size()),
+        mismatches == 0 ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char* argv[])
+{
+    std::string text;
+    if (argc > 1)
+    {
+        FILE* file = fopen(argv[1], "rb");
+        if (!file)
+        {
+            printf("Cannot open %s!\n", argv[1]);
+            return 1;
+        }
+
+        char block[65536];
+        size_t read = 0;
+        while((read = fread(block, 1, sizeof(block), file)) > 0)
+        {
+            text.append(block, read);
+        }
+
+        fclose(file);
+    }
+    else
+    {
+        text = generate(Vertices);
+    }
+
+    if (text.empty())
+    {
+        printf("Nothing to parse!\n");
+        return 1;
+    }
+
+    printf("OBJ text: %llu MB\n\n", static_cast<unsigned long long>(text.size() / (1024 * 1024)));
+    printf("Method         | Mfloats/s    | Floats       | Result\n");
+
+    Result reference = parse(text, Method::Strtof);
+    Result stream    = parse(text, Method::Stream);
+    Result fast      = parse(text, Method::ParseNumber);
+
+    print("Stream", stream, reference);
+    print("strtof", reference, reference);
+    print("parseNumber", fast, reference);
+    printf("%-14s | %11.1fx\n", "Speed-up", fast.throughput() / stream.throughput());
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Buffered file reader benchmark.
+ Requirements: none
+ Description : Measures throughput of reading multi-megabyte text file line
+               by line, and word by word, through:
+
+               - Per-byte     : previous implementation of File::readLine()
+                                and File::readWord(), calling virtual read()
+                                for each byte (measured on first part of
+                                file only, as it's orders of magnitude slower)
+               - File helpers : File::readLine() and File::readWord(), now
+                                served from block buffered by storage::Reader
+               - Reader       : storage::Reader used directly, tokens are
+                                views into its block (no copies)
+
+               Results of all methods are compared, to verify that they
+               read the same text. Optional argument specifies size of
+               generated text file in megabytes (defaults to 32).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/reader.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/utilities/parser.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/uint32v2.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/timer.cpp -lpthread -o reader
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "core/storage.h"
+#include "core/storage/reader.h"
+#include "core/utilities/parser.h"
+#include "utilities/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+using namespace en;
+
+constexpr uint32 TextFileSize   = 32;                // In megabytes
+constexpr uint64 PerByteLimit   = 1 * 1024 * 1024;   // Bytes read with per-byte method
+constexpr uint32 MaxTokenLength = 256;
+const char*      TextFileName   = "reader_benchmark.txt";
+
+// Generates text resembling OBJ model (lines of few numbers)
+bool generate(const uint64 size)
+{
+    storage::File* file = Storage->open(TextFileName, storage::Write);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string text;
+    text.reserve(static_cast<size_t>(size) + 64);
+
+    uint64 seed = 0x2545F4914F6CDD1DULL;
+    char   line[128];
+    while(text.size() < size)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        sint32 x = static_cast<sint32>(seed & 0xFFFFF) - 0x80000;
+        sint32 y = static_cast<sint32>((seed >> 20) & 0xFFFFF) - 0x80000;
+        sint32 z = static_cast<sint32>((seed >> 40) & 0xFFFFF) - 0x80000;
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x / 65536.0, y / 65536.0, z / 65536.0);
+        text += line;
+    }
+
+    bool result = file->write(text.size(), &text[0]);
+    delete file;
+    return result;
+}
+
+// Previous implementation of File::readLine() / File::readWord()
+uint32 perByteToken(storage::File& file, const uint64 offset, const uint32 maxSize, std::string& token, storage::Delimiter delimiter)
+{
+    token.clear();
+    uint64 fileOffset = offset;
+    uint32 counter = 0;
+    uint8  letter;
+    for(; counter<maxSize; ++counter)
+    {
+        if (fileOffset >= file.size() || !file.read(fileOffset, 1, &letter))
+        {
+            return counter;
+        }
+
+        if (delimiter(letter))
+        {
+            return counter;
+        }
+
+        fileOffset++;
+        token.push_back(letter);
+    }
+
+    return counter;
+}
+
+struct Result
+{
+    uint64 bytes;    // Bytes of text processed
+    uint64 tokens;   // Count of read tokens
+    uint64 checksum; // Sum of token lengths multiplied by their first character
+    double seconds;
+
+    double throughput(void) const
+    {
+        return static_cast<double>(bytes) / seconds / (1024.0 * 1024.0);
+    }
+};
+
+// Tokens are read the way loaders do it, by offset, skipping single delimiter
+Result perByte(storage::File& file, const uint64 limit, storage::Delimiter delimiter)
+{
+    Result result = { 0, 0, 0, 0.0 };
+    std::string token;
+
+    Time begin = currentTime();
+    uint64 offset = 0;
+    while(offset < limit)
+    {
+        uint32 length = perByteToken(file, offset, MaxTokenLength, token, delimiter);
+        result.tokens++;
+        result.checksum += length * (length ? static_cast<uint8>(token[0]) : 1);
+        offset += length + 1;
+    }
+
+    result.seconds = (currentTime() - begin).seconds();
+    result.bytes   = offset;
+    return result;
+}
+
+Result fileHelpers(storage::File& file, const uint64 limit, const bool lines)
+{
+    Result result = { 0, 0, 0, 0.0 };
+    std::string token;
+
+    Time begin = currentTime();
+    uint64 offset = 0;
+    while(offset < limit)
+    {
+        uint32 length = lines ? file.readLine(offset, MaxTokenLength, token) :
+                                file.readWord(offset, MaxTokenLength, token);
+        result.tokens++;
+        result.checksum += length * (length ? static_cast<uint8>(token[0]) : 1);
+        offset += length + 1;
+    }
+
+    result.seconds = (currentTime() - begin).seconds();
+    result.bytes   = offset;
+    return result;
+}
+
+Result reader(storage::File& file, const uint64 limit, const bool lines)
+{
+    Result result = { 0, 0, 0, 0.0 };
+    storage::Reader text(&file);
+
+    Time begin = currentTime();
+    uint8 delimiter = 0;
+    while(text.offset() < limit)
+    {
+        std::string_view token = lines ? text.line(MaxTokenLength) :
+                                         text.word(MaxTokenLength);
+        uint64 length = token.size();
+        result.tokens++;
+        result.checksum += length * (length ? static_cast<uint8>(token[0]) : 1);
+
+        // Skip delimiter
+        if (!text.read(delimiter))
+        {
+            break;
+        }
+    }
+
+    result.seconds = (currentTime() - begin).seconds();
+    result.bytes   = text.offset();
+    return result;
+}
+
+void print(const char* name, const Result& result, const Result& reference)
+{
+    printf("%-22s | %10.2f | %10llu | %s\n",
+        name,
+        result.throughput(),
+        static_cast<unsigned long long>(result.tokens),
+        (result.tokens == reference.tokens && result.checksum == reference.checksum) ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char* argv[])
+{
+    uint64 megabytes = TextFileSize;
+    if (argc > 1)
+    {
+        megabytes = static_cast<uint64>(atoi(argv[1]));
+    }
+
+    uint64 size = std::max(megabytes, static_cast<uint64>(2)) * 1024 * 1024;
+
+    parallel::init();
+    log::Interface::create();
+    storage::Interface::create();
+
+    if (!generate(size))
+    {
+        printf("Cannot create %s!\n", TextFileName);
+        return 1;
+    }
+
+    storage::File* file = Storage->open(TextFileName);
+    if (!file)
+    {
+        printf("Cannot open %s!\n", TextFileName);
+        return 1;
+    }
+
+    size = file->size();
+    printf("Text file: %llu MB\n\n", static_cast<unsigned long long>(size / (1024 * 1024)));
+    printf("Method                 | MB/s       | Tokens     | Result\n");
+
+    for(uint32 lines=0; lines<2; ++lines)
+    {
+        storage::Delimiter delimiter = lines ? isEol : isWhitespace;
+        printf("%s\n", lines ? "Lines:" : "Words:");
+
+        // Per-byte method reads only part of file, so its result is
+        // compared with the same part read through buffered helpers.
+        Result slow     = perByte(*file, PerByteLimit, delimiter);
+        Result partial  = fileHelpers(*file, PerByteLimit, lines);
+        Result helpers  = fileHelpers(*file, size, lines);
+        Result direct   = reader(*file, size, lines);
+
+        print("  Per-byte (first MB)", slow, partial);
+        print("  File helpers", helpers, helpers);
+        print("  Reader", direct, helpers);
+        printf("%-22s | %9.1fx\n", "  Speed-up of helpers", helpers.throughput() / slow.throughput());
+    }
+
+    delete file;
+    remove(TextFileName);
+    return 0;
+}
@@ -0,0 +1,615 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Task Scheduler benchmark.
+ Requirements: none
+ Description : Measures throughput and latency of Thread-Pool Scheduler
+               (and WorkStealingDeque / MPSCQueue it is built on) with
+               1 to N worker threads, in following scenarios:
+
+               - Fib         : recursive fork-join, each task spawns two
+                               children and waits for them
+               - Fan-out     : one task spawns wide batch of small tasks
+                               and waits for all of them (like frame jobs)
+               - Wait chains : chains of tasks, each spawning next one
+                               and waiting for it (fiber suspend/resume)
+               - Parallel-for: range of small items processed by single
+                               parallel task, split lazily by workers
+               - Steal storm : single producer pushes empty tasks that all
+                               other workers try to steal at once
+               - Wake-up     : latency between submitting task to parked
+                               workers and its start, from external thread
+                               and from other worker thread
+               - Task graph  : layered TaskGraph executed repeatedly, each
+                               node checking that all its predecessors
+                               finished in the same execution
+
+               Before measurements, TaskGraph dependency ordering is also
+               verified on a diamond graph executed twice, and compilation
+               of cyclic graph is expected to fail.
+
+               Steal aborts are reported only if EN_PROFILER is defined.
+               Optional argument limits max count of worker threads
+               (defaults to count of logical cores).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/scheduler.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/taskGraph.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/utilities/parser.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/uint32v2.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/random.cpp
+                   src/utilities/timer.cpp -lpthread -o scheduler
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "parallel/scheduler.h"
+#include "parallel/taskGraph.h"
+#include "utilities/timer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace en;
+
+constexpr uint32 MaxWorkers       = 64;    // Thread ID's are never reused, so total count of spawned threads is limited
+constexpr uint32 WorkerFibers     = 256;
+constexpr uint32 FibDepth         = 22;
+constexpr uint32 FibRepeats       = 10;
+constexpr uint32 FanOutWidth      = 512;   // Below max capacity of worker tasks queue
+constexpr uint32 FanOutRounds     = 200;
+constexpr uint32 FanOutWork       = 256;   // Iterations of busy work per task
+constexpr uint32 Chains           = 4;
+constexpr uint32 ChainDepth       = 32;
+constexpr uint32 ChainRounds      = 500;
+constexpr uint32 ParallelItems    = 1 << 20;
+constexpr uint32 ParallelRounds   = 20;
+constexpr uint32 ParallelWork     = 16;    // Iterations of busy work per item
+constexpr uint32 StormBatch       = 512;
+constexpr uint32 StormRounds      = 400;
+constexpr uint32 WakeUpSamples    = 100;
+constexpr uint64 WakeUpIdleTime   = 2000000; // 2ms (in nanoseconds) is enough for workers to park
+constexpr uint32 GraphLayers      = 16;
+constexpr uint32 GraphWidth       = 64;
+constexpr uint32 GraphRounds      = 200;
+
+struct Measurement
+{
+    uint64 operations;
+    Time   duration;
+};
+
+// Executes task from main thread and spins until it's finished (main thread
+// is not part of Thread-Pool, so it cannot wait() on it).
+void execute(TaskFunction function, void* data)
+{
+    TaskState state;
+    Scheduler->run(function, data, &state);
+    while(!state.finished())
+    {
+        std::this_thread::yield();
+    }
+}
+
+void emptyTask(void* data)
+{
+}
+
+// Fib
+
+struct Fib
+{
+    uint32 n;
+    uint64 result;
+};
+
+void fibonacci(void* data)
+{
+    Fib& fib = *(Fib*)(data);
+    if (fib.n < 2)
+    {
+        fib.result = fib.n;
+        return;
+    }
+
+    Fib a = { fib.n - 1, 0 };
+    Fib b = { fib.n - 2, 0 };
+
+    TaskState state;
+    Scheduler->run(fibonacci, &a, &state);
+    Scheduler->run(fibonacci, &b, &state);
+    Scheduler->wait(&state);
+
+    fib.result = a.result + b.result;
+}
+
+void fibBenchmark(void* data)
+{
+    Measurement& result = *(Measurement*)(data);
+
+    // Count of tasks spawned to calculate fib(n) is 2 * fib(n+1) - 1
+    uint64 a = 0;
+    uint64 b = 1;
+    for(uint32 i=0; i<FibDepth + 1; ++i)
+    {
+        uint64 next = a + b;
+        a = b;
+        b = next;
+    }
+
+    Time begin = currentTime();
+    for(uint32 i=0; i<FibRepeats; ++i)
+    {
+        Fib fib = { FibDepth, 0 };
+        fibonacci(&fib);
+        assert( fib.result == b - a );
+    }
+
+    result.duration   = currentTime() - begin;
+    result.operations = FibRepeats * (2 * a - 1);
+}
+
+// Fan-out / fan-in
+
+std::atomic<uint64> fanOutChecksum(0);
+
+void fanOutTask(void* data)
+{
+    uint64 value = reinterpret_cast<uint64>(data);
+    for(uint32 i=0; i<FanOutWork; ++i)
+    {
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+
+    std::atomic_fetch_add_explicit(&fanOutChecksum, value & 1, std::memory_order_relaxed);
+}
+
+void fanOutBenchmark(void* data)
+{
+    Measurement& result = *(Measurement*)(data);
+
+    Time begin = currentTime();
+    for(uint32 round=0; round<FanOutRounds; ++round)
+    {
+        TaskState state;
+        for(uint32 i=0; i<FanOutWidth; ++i)
+        {
+            Scheduler->run(fanOutTask, reinterpret_cast<void*>(static_cast<uint64>(i)), &state);
+        }
+
+        Scheduler->wait(&state);
+    }
+
+    result.duration   = currentTime() - begin;
+    result.operations = FanOutRounds * FanOutWidth;
+}
+
+// Nested wait() chains
+
+void chainTask(void* data)
+{
+    uint64 depth = reinterpret_cast<uint64>(data);
+    if (depth == 0)
+    {
+        return;
+    }
+
+    TaskState state;
+    Scheduler->run(chainTask, reinterpret_cast<void*>(depth - 1), &state);
+    Scheduler->wait(&state);
+}
+
+void chainBenchmark(void* data)
+{
+    Measurement& result = *(Measurement*)(data);
+
+    Time begin = currentTime();
+    for(uint32 round=0; round<ChainRounds; ++round)
+    {
+        TaskState state;
+        for(uint32 i=0; i<Chains; ++i)
+        {
+            Scheduler->run(chainTask, reinterpret_cast<void*>(static_cast<uint64>(ChainDepth)), &state);
+        }
+
+        Scheduler->wait(&state);
+    }
+
+    result.duration   = currentTime() - begin;
+    result.operations = static_cast<uint64>(ChainRounds) * Chains * ChainDepth;
+}
+
+// Parallel-for
+
+std::atomic<uint64> parallelItems(0);
+std::atomic<uint64> parallelChecksum(0);
+
+void parallelTask(void* data, uint32v2 range)
+{
+    uint64 checksum = 0;
+    for(uint32 i=range.base; i<range.base + range.count; ++i)
+    {
+        uint64 value = i;
+        for(uint32 j=0; j<ParallelWork; ++j)
+        {
+            value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+        }
+
+        checksum += value & 1;
+    }
+
+    std::atomic_fetch_add_explicit(&parallelItems, static_cast<uint64>(range.count), std::memory_order_relaxed);
+    std::atomic_fetch_add_explicit(&parallelChecksum, checksum, std::memory_order_relaxed);
+}
+
+void parallelBenchmark(void* data)
+{
+    Measurement& result = *(Measurement*)(data);
+
+    // Grain is selected by Scheduler, and range is split only when workers
+    // are running out of work
+    parallelItems.store(0, std::memory_order_relaxed);
+    Time begin = currentTime();
+    for(uint32 round=0; round<ParallelRounds; ++round)
+    {
+        TaskState state;
+        Scheduler->run(parallelTask, nullptr, uint32v2(0, ParallelItems), &state);
+        Scheduler->wait(&state);
+    }
+
+    result.duration   = currentTime() - begin;
+    result.operations = static_cast<uint64>(ParallelRounds) * ParallelItems;
+
+    // Each item should be processed exactly once
+    if (parallelItems.load(std::memory_order_relaxed) != result.operations)
+    {
+        result.operations = 0;
+    }
+}
+
+// Steal storm
+
+void stormBenchmark(void* data)
+{
+    Measurement& result = *(Measurement*)(data);
+
+    // Tasks are pushed to deque of this worker thread, so all other workers
+    // compete for them on the same end of it.
+    Time begin = currentTime();
+    for(uint32 round=0; round<StormRounds; ++round)
+    {
+        TaskState state;
+        for(uint32 i=0; i<StormBatch; ++i)
+        {
+            Scheduler->run(emptyTask, nullptr, &state);
+        }
+
+        Scheduler->wait(&state);
+    }
+
+    result.duration   = currentTime() - begin;
+    result.operations = StormRounds * StormBatch;
+}
+
+// Wake-up latency
+
+struct WakeUp
+{
+    std::atomic<uint64> started;  // Timestamp in nanoseconds
+};
+
+void wakeUpTask(void* data)
+{
+    WakeUp& sample = *(WakeUp*)(data);
+    sample.started.store(currentTime().nanoseconds(), std::memory_order_release);
+}
+
+struct Latency
+{
+    std::vector<uint64> samples; // In nanoseconds
+
+    double median(void)
+    {
+        std::sort(samples.begin(), samples.end());
+        return static_cast<double>(samples[samples.size() / 2]) / 1000.0;
+    }
+
+    double worst(void)
+    {
+        return static_cast<double>(*std::max_element(samples.begin(), samples.end())) / 1000.0;
+    }
+};
+
+void externalWakeUp(Latency& latency)
+{
+    for(uint32 i=0; i<WakeUpSamples; ++i)
+    {
+        sleepFor(Time(WakeUpIdleTime));
+
+        WakeUp sample;
+        sample.started.store(0, std::memory_order_relaxed);
+
+        uint64 begin = currentTime().nanoseconds();
+        execute(wakeUpTask, &sample);
+
+        latency.samples.push_back(sample.started.load(std::memory_order_acquire) - begin);
+    }
+}
+
+void internalWakeUp(void* data)
+{
+    Latency& latency = *(Latency*)(data);
+
+    for(uint32 i=0; i<WakeUpSamples; ++i)
+    {
+        // Only this worker is not parked
+        sleepFor(Time(WakeUpIdleTime));
+
+        WakeUp sample;
+        sample.started.store(0, std::memory_order_relaxed);
+
+        // Task needs to be stolen by other worker, so this one keeps spinning
+        // instead of waiting (which would execute task on this worker).
+        TaskState state;
+        uint64 begin = currentTime().nanoseconds();
+        Scheduler->run(wakeUpTask, &sample, &state);
+        while(sample.started.load(std::memory_order_acquire) == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        latency.samples.push_back(sample.started.load(std::memory_order_acquire) - begin);
+        Scheduler->wait(&state);
+    }
+}
+
+// Task graph
+
+struct GraphCheck;
+
+struct GraphCheckNode
+{
+    GraphCheck*         check;
+    std::vector<uint32> predecessor;
+    std::atomic<uint32> finished;    // Last execution in which node finished
+};
+
+// Graph with nodes verifying order of their execution
+struct GraphCheck
+{
+    std::vector<GraphCheckNode> nodes;
+    TaskGraph                   graph;
+    uint32                      execution;  // Current execution of the graph (starting from 1)
+    std::atomic<uint32>         violations; // Nodes started before their predecessors finished
+
+    GraphCheck(const uint32 count);
+    void depend(const uint32 node, const uint32 predecessor);
+    bool execute(void);
+};
+
+void graphCheckTask(void* data)
+{
+    GraphCheckNode& node  = *(GraphCheckNode*)(data);
+    GraphCheck&     check = *node.check;
+    for(uint32 predecessor : node.predecessor)
+    {
+        if (check.nodes[predecessor].finished.load(std::memory_order_acquire) != check.execution)
+        {
+            std::atomic_fetch_add_explicit(&check.violations, 1U, std::memory_order_relaxed);
+        }
+    }
+
+    node.finished.store(check.execution, std::memory_order_release);
+}
+
+GraphCheck::GraphCheck(const uint32 count) :
+    nodes(count),
+    graph(count),
+    execution(0),
+    violations(0)
+{
+    for(uint32 i=0; i<count; ++i)
+    {
+        nodes[i].check = this;
+        nodes[i].finished.store(0, std::memory_order_relaxed);
+        graph.add(graphCheckTask, &nodes[i]);
+    }
+}
+
+void GraphCheck::depend(const uint32 node, const uint32 predecessor)
+{
+    nodes[node].predecessor.push_back(predecessor);
+    graph.depend(node, predecessor);
+}
+
+// Executes graph from worker thread, returns true if all nodes were executed
+// once, in order
+bool GraphCheck::execute(void)
+{
+    execution++;
+
+    TaskState state;
+    graph.run(&state);
+    Scheduler->wait(&state);
+
+    bool valid = violations.load(std::memory_order_relaxed) == 0;
+    for(GraphCheckNode& node : nodes)
+    {
+        valid &= node.finished.load(std::memory_order_relaxed) == execution;
+    }
+
+    return valid;
+}
+
+void graphValidation(void* data)
+{
+    bool& valid = *(bool*)(data);
+
+    // Diamond (A -> B, C -> D), executed twice to verify that graph is reset
+    // between executions
+    GraphCheck diamond(4);
+    diamond.depend(1, 0);
+    diamond.depend(2, 0);
+    diamond.depend(3, 1);
+    diamond.depend(3, 2);
+    valid = diamond.graph.compile();
+    valid &= diamond.execute();
+    valid &= diamond.execute();
+
+    // Cycle (A -> B -> C -> A) cannot be compiled
+    GraphCheck cycle(3);
+    cycle.depend(1, 0);
+    cycle.depend(2, 1);
+    cycle.depend(0, 2);
+    valid &= !cycle.graph.compile();
+}
+
+struct GraphMeasurement
+{
+    Measurement measurement;
+    bool        valid;
+};
+
+void graphBenchmark(void* data)
+{
+    GraphMeasurement& result = *(GraphMeasurement*)(data);
+
+    // Each node depends on two neighbouring nodes of previous layer
+    GraphCheck layers(GraphLayers * GraphWidth);
+    for(uint32 layer=1; layer<GraphLayers; ++layer)
+    {
+        for(uint32 i=0; i<GraphWidth; ++i)
+        {
+            uint32 node = layer * GraphWidth + i;
+            layers.depend(node, node - GraphWidth);
+            layers.depend(node, (layer - 1) * GraphWidth + (i + 1) % GraphWidth);
+        }
+    }
+
+    result.valid = layers.graph.compile();
+
+    Time begin = currentTime();
+    for(uint32 round=0; round<GraphRounds; ++round)
+    {
+        result.valid &= layers.execute();
+    }
+
+    result.measurement.duration   = currentTime() - begin;
+    result.measurement.operations = static_cast<uint64>(GraphRounds) * GraphLayers * GraphWidth;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32 maxWorkers = std::thread::hardware_concurrency();
+    if (argc > 1)
+    {
+        maxWorkers = static_cast<uint32>(atoi(argv[1]));
+    }
+
+    maxWorkers = std::min(std::max(maxWorkers, 1U), MaxWorkers);
+
+    parallel::init();
+    log::Interface::create();
+
+    printf("Workers | Fib (M/s) | Fan-out (M/s) | Wait chains (M/s) | Parallel-for (M/s) | Steal storm (M/s) | Steal aborts | Task graph (M/s) | External wake-up (us) | Worker wake-up (us)\n");
+    printf("        |           |               |                   |                    |                   |              |                  |     median / worst    |    median / worst  \n");
+
+    bool parallelValid = true;
+    bool graphsValid   = true;
+    uint32 workers = 1;
+    for(;;)
+    {
+        parallel::Interface::create(workers, WorkerFibers, MaxTasksPerWorker);
+
+        Measurement fib;
+        Measurement fanOut;
+        Measurement chains;
+        Measurement parallel;
+        Measurement storm;
+        execute(fibBenchmark, &fib);
+        execute(fanOutBenchmark, &fanOut);
+        execute(chainBenchmark, &chains);
+        execute(parallelBenchmark, &parallel);
+        parallelValid &= parallel.operations > 0;
+
+        uint64 aborts = Scheduler->counters().stealAborts;
+        execute(stormBenchmark, &storm);
+        aborts = Scheduler->counters().stealAborts - aborts;
+
+        bool graphValid = false;
+        GraphMeasurement graph;
+        execute(graphValidation, &graphValid);
+        execute(graphBenchmark, &graph);
+        graphsValid &= graphValid && graph.valid;
+
+        Latency external;
+        externalWakeUp(external);
+
+        printf("%7u | %9.2f | %13.2f | %17.2f | %18.2f | %17.2f | %12llu | %16.2f | %9.1f / %9.1f | ",
+            workers,
+            static_cast<double>(fib.operations) / fib.duration.seconds() / 1000000.0,
+            static_cast<double>(fanOut.operations) / fanOut.duration.seconds() / 1000000.0,
+            static_cast<double>(chains.operations) / chains.duration.seconds() / 1000000.0,
+            static_cast<double>(parallel.operations) / parallel.duration.seconds() / 1000000.0,
+            static_cast<double>(storm.operations) / storm.duration.seconds() / 1000000.0,
+            static_cast<unsigned long long>(aborts),
+            static_cast<double>(graph.measurement.operations) / graph.measurement.duration.seconds() / 1000000.0,
+            external.median(),
+            external.worst());
+
+        // Worker wake-up needs at least one other worker to steal the task
+        if (workers > 1)
+        {
+            Latency internal;
+            execute(internalWakeUp, &internal);
+            printf("%8.1f / %8.1f\n", internal.median(), internal.worst());
+        }
+        else
+        {
+            printf("%19s\n", "-");
+        }
+
+        fflush(stdout);
+
+        // Terminate worker threads before next configuration
+        Scheduler = nullptr;
+
+        if (workers == maxWorkers)
+        {
+            break;
+        }
+
+        workers = std::min(workers * 2, maxWorkers);
+    }
+
+    printf("\nParallel-for coverage: %s\n", parallelValid ? "ok" : "INVALID");
+    printf("Task graph ordering  : %s\n", graphsValid ? "ok" : "INVALID");
+    return (parallelValid && graphsValid) ? 0 : 1;
+}
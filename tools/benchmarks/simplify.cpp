@@ -0,0 +1,259 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Mesh simplification benchmark.
+ Requirements: none
+ Description : Generates set of wavy grid meshes with given count of
+               quads per side (defaults to 250), each with texture seam
+               splitting its vertices along middle column, and generates
+               chain of levels of detail for them. First on main thread,
+               then in parallel on all worker threads.
+
+               Reports time, count of triangles and error of each level.
+               Verifies that levels reference only existing vertices,
+               and that seam didn't open (both sides of it still cover
+               the same positions).
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/benchmarks/simplify.cpp
+                   src/resources/simplify.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/utilities/parser.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/float2.cpp
+                   src/core/types/float3.cpp
+                   src/core/types/float3x3.cpp
+                   src/core/types/float4.cpp
+                   src/core/types/float4x4.cpp
+                   src/core/types/double3.cpp
+                   src/core/types/double4.cpp
+                   src/core/types/uint32v2.cpp
+                   src/utilities/gpcpu/gpcpu.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/random.cpp
+                   src/utilities/timer.cpp -lpthread -o simplify
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "parallel/scheduler.h"
+#include "resources/simplify.h"
+#include "utilities/timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace en;
+
+constexpr uint32 GridSize     = 250;
+constexpr uint32 Meshes       = 32;
+constexpr uint32 Levels       = 8;
+constexpr uint32 WorkerFibers = 64;
+
+struct Mesh
+{
+    std::vector<float3> positions;
+    std::vector<uint32> positionIds;
+    std::vector<uint32> indexes;
+    std::vector<uint32> rowStart;  // First vertex of each row
+    uint32 seam;                   // Column of split vertices
+};
+
+// Grid with vertices of middle column duplicated (seam). Triangles
+// left of seam use first copy, right of it the second one.
+void generate(Mesh& mesh, const uint32 size, const float frequency)
+{
+    mesh.seam = size / 2;
+    for(uint32 y=0; y<=size; ++y)
+    {
+        mesh.rowStart.push_back(static_cast<uint32>(mesh.positions.size()));
+        for(uint32 x=0; x<=size; ++x)
+        {
+            float3 position(static_cast<float>(x), static_cast<float>(y), sinf(x * frequency) * cosf(y * frequency) * 10.0f);
+            uint32 id = y * (size + 1) + x;
+            mesh.positions.push_back(position);
+            mesh.positionIds.push_back(id);
+            if (x == mesh.seam)
+            {
+                mesh.positions.push_back(position);
+                mesh.positionIds.push_back(id);
+            }
+        }
+    }
+
+    auto vertex = [&](uint32 x, uint32 y, bool right)
+    {
+        return mesh.rowStart[y] + x + ((x > mesh.seam || (x == mesh.seam && right)) ? 1 : 0);
+    };
+
+    for(uint32 y=0; y<size; ++y)
+    {
+        for(uint32 x=0; x<size; ++x)
+        {
+            bool right = x >= mesh.seam;
+            uint32 a = vertex(x,     y,     right);
+            uint32 b = vertex(x + 1, y,     right);
+            uint32 c = vertex(x,     y + 1, right);
+            uint32 d = vertex(x + 1, y + 1, right);
+            mesh.indexes.insert(mesh.indexes.end(), { a, b, c, b, d, c });
+        }
+    }
+}
+
+bool validate(const Mesh& mesh, const std::vector<Simplify::Level>& levels)
+{
+    if (levels.empty())
+    {
+        return false;
+    }
+
+    uint32 vertexes = static_cast<uint32>(mesh.positions.size());
+    for(uint32 i=0; i<levels.size(); ++i)
+    {
+        // Rows of seam referenced from each side of it
+        std::set<uint32> left;
+        std::set<uint32> right;
+        for(uint32 index : levels[i].indexes)
+        {
+            if (index >= vertexes)
+            {
+                return false;
+            }
+
+            uint32 y = static_cast<uint32>(std::upper_bound(mesh.rowStart.begin(), mesh.rowStart.end(), index) - mesh.rowStart.begin()) - 1;
+            uint32 x = index - mesh.rowStart[y];
+            if (x == mesh.seam)
+            {
+                left.insert(y);
+            }
+            else
+            if (x == mesh.seam + 1)
+            {
+                right.insert(y);
+            }
+        }
+
+        if (left != right)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct Batch
+{
+    const Simplify::Geometry*     geometry;
+    std::vector<Simplify::Level>* levels;
+    Time duration;
+};
+
+void simplifyBatch(void* data)
+{
+    Batch& batch = *reinterpret_cast<Batch*>(data);
+
+    Time begin = currentTime();
+    Simplify::generateLevels(batch.geometry, batch.levels, Meshes, Levels);
+    batch.duration = currentTime() - begin;
+}
+
+// Executes task from main thread and spins until it's finished (main thread
+// is not part of Thread-Pool, so it cannot wait() on it).
+void execute(TaskFunction function, void* data)
+{
+    TaskState state;
+    Scheduler->run(function, data, &state);
+    while(!state.finished())
+    {
+        std::this_thread::yield();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint32 size = GridSize;
+    if (argc > 1)
+    {
+        size = static_cast<uint32>(std::max(atoi(argv[1]), 2));
+    }
+
+    std::vector<Mesh> meshes(Meshes);
+    std::vector<Simplify::Geometry> geometry(Meshes);
+    for(uint32 i=0; i<Meshes; ++i)
+    {
+        generate(meshes[i], size, 0.02f + 0.005f * i);
+
+        geometry[i].indexes     = meshes[i].indexes.data();
+        geometry[i].positions   = meshes[i].positions.data();
+        geometry[i].positionIds = meshes[i].positionIds.data();
+        geometry[i].indexCount  = static_cast<uint32>(meshes[i].indexes.size());
+        geometry[i].vertexCount = static_cast<uint32>(meshes[i].positions.size());
+    }
+
+    parallel::init();
+    log::Interface::create();
+    parallel::Interface::create(std::thread::hardware_concurrency(), WorkerFibers, MaxTasksPerWorker);
+
+    // Scheduler is not used outside of worker threads
+    std::vector<Simplify::Level> serialLevels[Meshes];
+    Batch serial = { geometry.data(), serialLevels, Time() };
+    simplifyBatch(&serial);
+
+    std::vector<Simplify::Level> parallelLevels[Meshes];
+    Batch parallel = { geometry.data(), parallelLevels, Time() };
+    execute(simplifyBatch, &parallel);
+
+    Scheduler = nullptr;
+
+    printf("Meshes: %u, each %u triangles, %u vertices\n", Meshes, geometry[0].indexCount / 3, geometry[0].vertexCount);
+    printf("Serial  : %10.3f ms\n", serial.duration.seconds() * 1000.0);
+    printf("Parallel: %10.3f ms (%u workers)\n\n", parallel.duration.seconds() * 1000.0, std::thread::hardware_concurrency());
+
+    printf("First mesh:\n");
+    printf("Level | Triangles  | Error\n");
+    printf("%5u | %10u | %8.6f\n", 0u, geometry[0].indexCount / 3, 0.0f);
+    for(uint32 i=0; i<serialLevels[0].size(); ++i)
+    {
+        printf("%5u | %10u | %8.6f\n", i + 1, static_cast<uint32>(serialLevels[0][i].indexes.size() / 3), serialLevels[0][i].error);
+    }
+
+    bool valid = true;
+    for(uint32 i=0; i<Meshes; ++i)
+    {
+        // Both runs should produce the same result
+        valid &= validate(meshes[i], serialLevels[i]);
+        valid &= serialLevels[i].size() == parallelLevels[i].size();
+        for(uint32 j=0; valid && j<serialLevels[i].size(); ++j)
+        {
+            valid &= serialLevels[i][j].indexes == parallelLevels[i][j].indexes;
+        }
+    }
+
+    printf("\nResult: %s\n", valid ? "ok" : "INVALID");
+    return valid ? 0 : 1;
+}
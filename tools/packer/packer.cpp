@@ -0,0 +1,115 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Assets packer.
+ Requirements: none
+ Description : Offline tool, that stores all files from given directory (and
+               its subdirectories) in single pack (see storage::createPack).
+               Files are named by their path relative to that directory,
+               with '/' separators, which is the name they are later opened
+               with after the pack is mounted (see storage::mountPack).
+
+               Usage:
+               packer <directory> <pack> [--store]
+
+               --store - files are stored without compression
+
+               Build (from repository root), for example:
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/packer/packer.cpp
+                   src/core/storage/packStorage.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/algorithm/hash.cpp
+                   src/core/algorithm/MurmurHash2.cpp
+                   src/core/algorithm/MurmurHash3.cpp
+                   src/core/utilities/parser.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/uint32v2.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/timer.cpp -lpthread -lz -o packer
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "core/storage.h"
+#include "core/storage/pack.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace en;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: packer <directory> <pack> [--store]\n");
+        return 1;
+    }
+
+    std::filesystem::path directory(argv[1]);
+    std::string filename(argv[2]);
+    bool compress = !(argc > 3 && strcmp(argv[3], "--store") == 0);
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        printf("%s is not a directory!\n", argv[1]);
+        return 1;
+    }
+
+    parallel::init();
+    log::Interface::create();
+    storage::Interface::create();
+
+    std::vector<storage::PackInput> files;
+    for(const auto& item : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (!item.is_regular_file())
+        {
+            continue;
+        }
+
+        storage::PackInput input;
+        input.name = item.path().lexically_relative(directory).generic_string();
+        input.path = item.path().string();
+        files.push_back(input);
+    }
+
+    // Order of payloads doesn't depend on order of directory entries
+    std::sort(files.begin(), files.end(), [](const storage::PackInput& a, const storage::PackInput& b)
+    {
+        return a.name < b.name;
+    });
+
+    if (!storage::createPack(filename, files, compress))
+    {
+        printf("Cannot create pack %s!\n", filename.c_str());
+        return 1;
+    }
+
+    printf("Packed %u files to %s.\n", static_cast<uint32>(files.size()), filename.c_str());
+    return 0;
+}
@@ -0,0 +1,457 @@
+/*
+
+ Ngine v5.0
+
+ Module      : Texture converter.
+ Requirements: none
+ Description : Offline tool, that decodes PNG, TGA, BMP, HDR, EXR or DDS
+               image (format is selected by file extension), and stores
+               it in TEX file (see tex::save), that can be loaded at
+               runtime without decoding. All surfaces of DDS files are
+               converted (mip-maps, layers and cube faces).
+
+               Usage:
+               texconv <input> <output> [--mipmaps] [--store] [--flip]
+
+               --mipmaps - generates missing mip-maps with box filter
+                           (uncompressed 8-bit unorm, 16-bit half and 32-bit
+                           float formats, sRGB ones are filtered in linear
+                           space)
+               --store   - surfaces are stored without compression
+               --flip    - image is flipped horizontally while decoding
+
+               Build on Linux (from repository root):
+               g++ -std=c++17 -O2 -DNDEBUG -Ipublic/include -Isrc
+                   tools/texconv/texconv.cpp
+                   src/resources/png.cpp
+                   src/resources/tga.cpp
+                   src/resources/bmp.cpp
+                   src/resources/hdr.cpp
+                   src/resources/exr.cpp
+                   src/resources/dds.cpp
+                   src/resources/tex.cpp
+                   src/core/rendering/common/texture.cpp
+                   src/core/storage/reader.cpp
+                   src/core/storage/storage.cpp
+                   src/core/storage/asyncIO.cpp
+                   src/core/storage/lnxAsyncIO.cpp
+                   src/core/storage/lnxStorage.cpp
+                   src/core/utilities/parser.cpp
+                   src/parallel/scheduler.cpp
+                   src/parallel/profiler.cpp
+                   src/core/parallel/parallel.cpp
+                   src/core/parallel/psxThread.cpp
+                   src/core/parallel/psxFiber.cpp
+                   src/core/parallel/lnxMutex.cpp
+                   src/core/memory/pageAllocator.cpp
+                   src/core/config/config.cpp
+                   src/core/log/log.cpp
+                   src/core/log/StreamLog.cpp
+                   src/core/types/half.cpp
+                   src/core/types/float2.cpp
+                   src/core/types/float3.cpp
+                   src/core/types/double3.cpp
+                   src/core/types/uint16v2.cpp
+                   src/core/types/uint16v4.cpp
+                   src/core/types/uint32v2.cpp
+                   src/core/types/uint32v3.cpp
+                   src/core/types/uint32v4.cpp
+                   src/utilities/utilities.cpp
+                   src/utilities/strings.cpp
+                   src/utilities/timer.cpp -lpthread -lz -o texconv
+
+*/
+
+#include "core/defines.h"
+#include "core/types.h"
+#include "core/log/log.h"
+#include "core/parallel/parallel.h"
+#include "core/storage.h"
+#include "core/rendering/texture.h"
+#include "resources/png.h"
+#include "resources/tga.h"
+#include "resources/bmp.h"
+#include "resources/hdr.h"
+#include "resources/exr.h"
+#include "resources/dds.h"
+#include "resources/tex.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace en;
+
+namespace en
+{
+extern void initHalfs(void);
+}
+
+// Formats that can be filtered when generating mip-maps
+struct FilterableFormat
+{
+    gpu::Format format;
+    uint32      channels;
+    uint32      channelSize; // 1 - 8-bit unorm, 2 - 16-bit half, 4 - 32-bit float
+    bool        sRGB;        // Color channels are sRGB encoded (alpha is always linear)
+};
+
+const FilterableFormat FilterableFormats[] =
+{
+    { gpu::Format::R_8,         1, 1, false },
+    { gpu::Format::R_8_sRGB,    1, 1, true  },
+    { gpu::Format::RG_8,        2, 1, false },
+    { gpu::Format::RG_8_sRGB,   2, 1, true  },
+    { gpu::Format::RGBA_8,      4, 1, false },
+    { gpu::Format::RGBA_8_sRGB, 4, 1, true  },
+    { gpu::Format::BGRA_8,      4, 1, false },
+    { gpu::Format::BGRA_8_sRGB, 4, 1, true  },
+    { gpu::Format::R_16_hf,     1, 2, false },
+    { gpu::Format::RG_16_hf,    2, 2, false },
+    { gpu::Format::RGBA_16_hf,  4, 2, false },
+    { gpu::Format::R_32_f,      1, 4, false },
+    { gpu::Format::RG_32_f,     2, 4, false },
+    { gpu::Format::RGBA_32_f,   4, 4, false },
+};
+
+// Three channel formats are padded in GPU memory, while decoders return them
+// tightly packed, so they are expanded to four channel counterparts with
+// opaque alpha before storing
+struct ExpandedFormat
+{
+    gpu::Format source;
+    gpu::Format target;
+    uint32      channelSize; // Size of channel in bytes
+    uint32      alpha;       // Bit pattern of opaque alpha
+};
+
+const ExpandedFormat ExpandedFormats[] =
+{
+    { gpu::Format::RGB_8,      gpu::Format::RGBA_8,      1, 0xFF       },
+    { gpu::Format::RGB_8_sRGB, gpu::Format::RGBA_8_sRGB, 1, 0xFF       },
+    { gpu::Format::BGR_8,      gpu::Format::BGRA_8,      1, 0xFF       },
+    { gpu::Format::BGR_8_sRGB, gpu::Format::BGRA_8_sRGB, 1, 0xFF       },
+    { gpu::Format::RGB_16_hf,  gpu::Format::RGBA_16_hf,  2, 0x3C00     }, // 1.0 half
+    { gpu::Format::RGB_32_f,   gpu::Format::RGBA_32_f,   4, 0x3F800000 }, // 1.0 float
+};
+
+float floatFromHalf(const uint16 value)
+{
+    uint32 sign     = static_cast<uint32>(value & 0x8000) << 16;
+    uint32 exponent = (value >> 10) & 0x1F;
+    uint32 mantissa = value & 0x03FF;
+    uint32 result;
+    if (exponent == 0x1F)
+    {
+        // Infinity or NaN
+        result = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    if (exponent == 0)
+    {
+        // Zero or denormal (value of denormal is mantissa * 2^-24)
+        float denormal = static_cast<float>(mantissa) / 16777216.0f;
+        memcpy(&result, &denormal, 4);
+        result |= sign;
+    }
+    else
+    {
+        result = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float output;
+    memcpy(&output, &result, 4);
+    return output;
+}
+
+float linearFromSRGB(const float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float sRGBFromLinear(const float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Reads channel of texel as linear value
+float read(const FilterableFormat& format, const uint8* texel, const uint32 channel)
+{
+    if (format.channelSize == 2)
+    {
+        uint16 value;
+        memcpy(&value, texel + channel * 2, 2);
+        return floatFromHalf(value);
+    }
+
+    if (format.channelSize == 4)
+    {
+        float value;
+        memcpy(&value, texel + channel * 4, 4);
+        return value;
+    }
+
+    float value = texel[channel] / 255.0f;
+    return (format.sRGB && channel < 3) ? linearFromSRGB(value) : value;
+}
+
+void write(const FilterableFormat& format, uint8* texel, const uint32 channel, float value)
+{
+    if (format.channelSize == 2)
+    {
+        half result(value);
+        memcpy(texel + channel * 2, &result.value, 2);
+        return;
+    }
+
+    if (format.channelSize == 4)
+    {
+        memcpy(texel + channel * 4, &value, 4);
+        return;
+    }
+
+    if (format.sRGB && channel < 3)
+    {
+        value = sRGBFromLinear(value);
+    }
+
+    texel[channel] = static_cast<uint8>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Averages blocks of 2x2 texels (clamped to edges of odd sized surfaces)
+void downsample(const FilterableFormat& format,
+                const uint8* source, const uint32 width, const uint32 height,
+                uint8* destination, const uint32 targetWidth, const uint32 targetHeight)
+{
+    uint32 texelSize = gpu::texelSize(format.format);
+    for(uint32 y=0; y<targetHeight; ++y)
+    {
+        uint32 y0 = std::min(y * 2,     height - 1);
+        uint32 y1 = std::min(y * 2 + 1, height - 1);
+        for(uint32 x=0; x<targetWidth; ++x)
+        {
+            uint32 x0 = std::min(x * 2,     width - 1);
+            uint32 x1 = std::min(x * 2 + 1, width - 1);
+
+            const uint8* texel[4] = { source + (y0 * width + x0) * texelSize,
+                                      source + (y0 * width + x1) * texelSize,
+                                      source + (y1 * width + x0) * texelSize,
+                                      source + (y1 * width + x1) * texelSize };
+
+            uint8* target = destination + (y * targetWidth + x) * texelSize;
+            for(uint32 channel=0; channel<format.channels; ++channel)
+            {
+                float sum = 0.0f;
+                for(uint32 i=0; i<4; ++i)
+                {
+                    sum += read(format, texel[i], channel);
+                }
+
+                write(format, target, channel, sum * 0.25f);
+            }
+        }
+    }
+}
+
+uint32 layersCount(const gpu::TextureState& settings, const uint32 mipmap)
+{
+    return settings.type == gpu::TextureType::Texture3D ? settings.mipDepth(mipmap) : settings.layers;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: texconv <input> <output> [--mipmaps] [--store] [--flip]\n");
+        return 1;
+    }
+
+    std::string input  = argv[1];
+    std::string output = argv[2];
+    bool mipmaps = false;
+    bool store   = false;
+    bool flip    = false;
+    for(sint32 i=3; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "--mipmaps") == 0)
+        {
+            mipmaps = true;
+        }
+        else
+        if (strcmp(argv[i], "--store") == 0)
+        {
+            store = true;
+        }
+        else
+        if (strcmp(argv[i], "--flip") == 0)
+        {
+            flip = true;
+        }
+        else
+        {
+            printf("Unknown option %s!\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::string extension;
+    size_t dot = input.find_last_of('.');
+    if (dot != std::string::npos)
+    {
+        extension = input.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    }
+
+    initHalfs();
+    parallel::init();
+    log::Interface::create();
+    storage::Interface::create();
+
+    gpu::TextureState settings;
+    gpu::ColorSpace   colorSpace = gpu::ColorSpaceLinear;
+    bool result = false;
+    if (extension == "png") result = png::readMetadata(input, settings, colorSpace); else
+    if (extension == "tga") result = tga::readMetadata(input, settings, colorSpace); else
+    if (extension == "bmp") result = bmp::readMetadata(input, settings, colorSpace); else
+    if (extension == "hdr") result = hdr::readMetadata(input, settings, colorSpace); else
+    if (extension == "exr") result = exr::readMetadata(input, settings, colorSpace); else
+    if (extension == "dds") result = dds::readMetadata(input, settings, colorSpace); else
+    {
+        printf("Unsupported image type of %s!\n", input.c_str());
+        return 1;
+    }
+
+    if (!result)
+    {
+        printf("Cannot read %s!\n", input.c_str());
+        return 1;
+    }
+
+    const ExpandedFormat* expanded = nullptr;
+    for(const ExpandedFormat& entry : ExpandedFormats)
+    {
+        if (entry.source == settings.format)
+        {
+            expanded = &entry;
+        }
+    }
+
+    gpu::ImageMemoryAlignment alignment = {};
+    alignment.sampleSize = expanded ? expanded->channelSize * 3 : gpu::texelSize(settings.format);
+
+    // Decode all surfaces, tightly packed, mip-map after mip-map
+    std::vector<uint8> data;
+    if (extension == "dds")
+    {
+        for(uint32 mipmap=0; result && mipmap<settings.mipmaps; ++mipmap)
+        {
+            uint32 size = settings.surfaceSize(mipmap);
+            for(uint32 layer=0; result && layer<layersCount(settings, mipmap); ++layer)
+            {
+                size_t offset = data.size();
+                data.resize(offset + size);
+                result = dds::load(input, mipmap, layer, &data[offset], alignment);
+            }
+        }
+    }
+    else
+    {
+        data.resize(settings.surfaceSize(0));
+        if (extension == "png") result = png::load(input, &data[0], settings.width, settings.height, settings.format, alignment, flip); else
+        if (extension == "tga") result = tga::load(input, &data[0], settings.width, settings.height, settings.format, alignment, flip); else
+        if (extension == "bmp") result = bmp::load(input, &data[0], settings.width, settings.height, settings.format, alignment, flip); else
+        if (extension == "hdr") result = hdr::load(input, &data[0], settings.width, settings.height, settings.format, alignment, flip); else
+        if (extension == "exr") result = exr::load(input, &data[0], settings.width, settings.height, settings.format, alignment, flip);
+    }
+
+    if (!result)
+    {
+        printf("Cannot decode %s!\n", input.c_str());
+        return 1;
+    }
+
+    // Expand texels in place, starting from the last one
+    if (expanded)
+    {
+        uint32 size   = expanded->channelSize;
+        uint32 texels = settings.width * settings.height;
+        for(uint32 i=texels; i>0; --i)
+        {
+            uint8 texel[12];
+            memcpy(texel, &data[(i - 1) * size * 3], size * 3);
+
+            uint8* target = &data[(i - 1) * size * 4];
+            memcpy(target, texel, size * 3);
+            memcpy(target + size * 3, &expanded->alpha, size); // Little-endian
+        }
+
+        settings.format = expanded->target;
+    }
+
+    // Generate missing mip-maps of each layer
+    if (mipmaps && settings.mipmaps == 1)
+    {
+        const FilterableFormat* format = nullptr;
+        for(const FilterableFormat& entry : FilterableFormats)
+        {
+            if (entry.format == settings.format)
+            {
+                format = &entry;
+            }
+        }
+
+        if (!format ||
+            settings.type == gpu::TextureType::Texture3D ||
+            settings.samples > 1)
+        {
+            printf("Mip-maps cannot be generated for texture of this type or format!\n");
+            return 1;
+        }
+
+        uint32 size  = std::max(settings.width, settings.height);
+        uint32 count = 1;
+        while(size > 1)
+        {
+            size >>= 1;
+            count++;
+        }
+
+        settings.mipmaps = static_cast<uint8>(count);
+
+        uint64 source = 0;
+        for(uint32 mipmap=1; mipmap<settings.mipmaps; ++mipmap)
+        {
+            uint32 sourceSize = settings.surfaceSize(mipmap - 1);
+            uint32 targetSize = settings.surfaceSize(mipmap);
+            uint64 target     = data.size();
+            data.resize(target + static_cast<uint64>(targetSize) * settings.layers);
+            for(uint32 layer=0; layer<settings.layers; ++layer)
+            {
+                downsample(*format,
+                           &data[source + static_cast<uint64>(layer) * sourceSize], settings.mipWidth(mipmap - 1), settings.mipHeight(mipmap - 1),
+                           &data[target + static_cast<uint64>(layer) * targetSize], settings.mipWidth(mipmap), settings.mipHeight(mipmap));
+            }
+
+            source = target;
+        }
+    }
+
+    if (!tex::save(output, settings, colorSpace, &data[0], data.size(), !store))
+    {
+        printf("Cannot write %s!\n", output.c_str());
+        return 1;
+    }
+
+    printf("%s: %ux%u, %u layers, %u mip-maps -> %s\n",
+        input.c_str(),
+        settings.width,
+        settings.height,
+        static_cast<uint32>(settings.layers),
+        static_cast<uint32>(settings.mipmaps),
+        output.c_str());
+    return 0;
+}